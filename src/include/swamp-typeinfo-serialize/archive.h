@@ -0,0 +1,77 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_ARCHIVE_H
+#define SWAMP_TYPEINFO_SERIALIZE_ARCHIVE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiChunk;
+struct ImprintAllocator;
+struct SwtisDeserializeOptions;
+
+// Many chunks in one file. All numbers are big endian.
+//
+//  Header:   'S' 'W' 'T' 'A', uint8 version, three zero octets, uint32 module count, uint32 string table offset,
+//            uint32 string table octet count.
+//  Index:    for each module, sorted by name (compared as unsigned octets): uint32 name (string table offset),
+//            uint32 chunk offset, uint32 chunk octet count, uint32 hash (CRC-32C of the chunk), uint32 name
+//            references offset, uint32 name count.
+//  Names:    for each module, a uint32 string table offset for each of its names, in the order of the names section.
+//  Strings:  every module and type name once, each followed by a zero octet.
+//  Chunks:   sectioned typeinfo (see SWTIS_FORMAT_FLAG_SECTIONED) without a names section.
+//
+// Offsets are from the start of the archive.
+#define SWTIS_ARCHIVE_VERSION (1)
+#define SWTIS_ARCHIVE_HEADER_OCTET_COUNT (20)
+#define SWTIS_ARCHIVE_INDEX_ENTRY_OCTET_COUNT (24)
+
+typedef struct SwtisArchiveWriter SwtisArchiveWriter;
+
+/// `formatFlags` (SWTIS_FORMAT_FLAG_XXX) are used for each chunk, SWTIS_FORMAT_FLAG_SECTIONED is always added.
+SwtisArchiveWriter* swtisArchiveWriterCreate(uint8_t formatFlags);
+void swtisArchiveWriterDestroy(SwtisArchiveWriter* self);
+/// Serializes `chunk` right away, so it does not have to outlive the writer. The names must be unique.
+int swtisArchiveWriterAdd(SwtisArchiveWriter* self, const char* moduleName, const struct SwtiChunk* chunk);
+size_t swtisArchiveWriterOctetCount(const SwtisArchiveWriter* self);
+/// Returns the number of octets written.
+int swtisArchiveWriterWrite(const SwtisArchiveWriter* self, uint8_t* octets, size_t maxCount);
+
+typedef struct SwtisArchive {
+    const uint8_t* octets;
+    size_t octetCount;
+    size_t moduleCount;
+    const char* strings;
+    size_t stringsOctetCount;
+    // Only when opened from a file
+    void* mapping;
+} SwtisArchive;
+
+typedef struct SwtisArchiveModule {
+    const char* name;
+    // Sectioned typeinfo without names
+    const uint8_t* octets;
+    size_t octetCount;
+    // CRC-32C of `octets`, to tell if a module has changed without deserializing it
+    uint32_t hash;
+    const uint8_t* nameReferences;
+    size_t nameCount;
+} SwtisArchiveModule;
+
+/// `octets` must outlive `self`.
+int swtisArchiveInit(SwtisArchive* self, const uint8_t* octets, size_t octetCount);
+/// Maps in the whole file. POSIX only.
+int swtisArchiveInitFromFile(SwtisArchive* self, const char* path);
+void swtisArchiveDestroy(SwtisArchive* self);
+
+/// Binary search in the index. Returns -1 if there is no module with that name.
+int swtisArchiveFind(const SwtisArchive* self, const char* moduleName, SwtisArchiveModule* outModule);
+int swtisArchiveModuleAt(const SwtisArchive* self, size_t index, SwtisArchiveModule* outModule);
+
+/// The names in `target` point into the string table, so the archive must outlive the chunk.
+int swtisArchiveDeserialize(const SwtisArchive* self, const SwtisArchiveModule* module, struct SwtiChunk* target,
+                            struct ImprintAllocator* allocator, const struct SwtisDeserializeOptions* options);
+
+#endif
@@ -0,0 +1,58 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_BITPACK_H
+#define SWAMP_TYPEINFO_SERIALIZE_BITPACK_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiType;
+struct FldInStream;
+struct FldOutStream;
+struct ImprintAllocator;
+
+/// Bits are collected in a 64-bit word, lowest bit first, and written 32 bits at a time.
+typedef struct SwtisBitWriter {
+    uint8_t* octets;
+    size_t octetCount;
+    size_t pos;
+    uint64_t accumulator;
+    size_t accumulatorBitCount;
+} SwtisBitWriter;
+
+typedef struct SwtisBitReader {
+    const uint8_t* octets;
+    size_t octetCount;
+    size_t pos;
+    uint64_t accumulator;
+    size_t accumulatorBitCount;
+} SwtisBitReader;
+
+void swtisBitWriterInit(SwtisBitWriter* self, uint8_t* octets, size_t octetCount);
+int swtisBitWriterWrite(SwtisBitWriter* self, uint32_t value, size_t bitCount);
+int swtisBitWriterFlush(SwtisBitWriter* self);
+
+void swtisBitReaderInit(SwtisBitReader* self, const uint8_t* octets, size_t octetCount);
+int swtisBitReaderRead(SwtisBitReader* self, size_t bitCount, uint32_t* value);
+size_t swtisBitReaderRemainingBits(const SwtisBitReader* self);
+
+/// Bit packed value format:
+///  Bool              - 1 bit.
+///  Custom            - variant index in ceil(log2(variantCount)) bits, then the fields of that variant.
+///  Int, Fixed        - zig-zag encoded, then a 2 bit width class (4, 8, 16 or 32 bits) and the value in that width.
+///  Char              - 1 bit, then 7 bits for ASCII or 21 bits for other code points.
+///  String, Blob      - count with the same width classes as Int (not zig-zag), then 8 bits per octet.
+///  List, Array       - count like String, then each item.
+///  Record, Tuple     - each field in declaration order.
+int swtisBitPackValue(SwtisBitWriter* writer, const struct SwtiType* type, const void* value);
+int swtisBitUnpackValue(SwtisBitReader* reader, const struct SwtiType* type, void* target,
+                        struct ImprintAllocator* allocator);
+
+/// Packs a single value and pads it to a whole octet. Returns the number of octets.
+int swtisBitPackSerializeValue(struct FldOutStream* stream, const struct SwtiType* type, const void* value);
+int swtisBitPackDeserializeValue(struct FldInStream* stream, const struct SwtiType* type, void* target,
+                                 struct ImprintAllocator* allocator);
+
+#endif
@@ -0,0 +1,332 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_BUILDER_HPP
+#define SWAMP_TYPEINFO_SERIALIZE_BUILDER_HPP
+
+// Builds the serialized typeinfo (see serialize.h) for C++ host types at compile time. Requires C++17.
+//
+//   struct Vec2 { int32_t x; int32_t y; };
+//   struct Handle;
+//
+//   template <> struct swtis::Describe<Vec2> {
+//       static constexpr const char* name = "Vec2";
+//       static constexpr auto fields = swtis::fields(SWTIS_FIELD(Vec2, x), SWTIS_FIELD(Vec2, y));
+//   };
+//   template <> struct swtis::Describe<Handle> {
+//       static constexpr const char* name = "Handle";
+//       static constexpr uint16_t userTypeId = 3;
+//   };
+//
+//   using HostTypes = swtis::Typeinfo<Vec2, Handle>;
+//   swtisDeserialize(HostTypes::octets.data(), HostTypes::octets.size(), &chunk, allocator);
+//   const SwtiType* vec2 = chunk.types[HostTypes::indexOf<Vec2>()];
+//
+// Records get their layout from offsetof(), sizeof() and alignof(), so it always matches the C++ compiler. Each
+// record is followed by an alias with its name, which is what indexOf() returns. Field types are int32_t (Int),
+// swtis::Fixed, bool, char32_t (Char), other described records and unmanaged types.
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include <swamp-typeinfo-serialize/version.h>
+#include <swamp-typeinfo/typeinfo.h>
+}
+
+#define SWTIS_FIELD(Struct, member) ::swtis::Field<decltype(Struct::member)>{#member, offsetof(Struct, member)}
+
+namespace swtis {
+
+struct Fixed {
+    int32_t value;
+};
+
+/// Specialize for each host record (`name` and `fields`) and unmanaged type (`name` and `userTypeId`).
+template <typename T>
+struct Describe;
+
+template <typename M>
+struct Field {
+    const char* name;
+    size_t offset;
+};
+
+template <typename... Ts>
+struct TypeList {
+};
+
+template <typename... Ms>
+struct Fields {
+    using Types = TypeList<Ms...>;
+    static constexpr size_t count = sizeof...(Ms);
+    const char* names[count == 0 ? 1 : count];
+    size_t offsets[count == 0 ? 1 : count];
+};
+
+template <typename... Ms>
+constexpr Fields<Ms...> fields(Field<Ms>... items)
+{
+    return Fields<Ms...>{{items.name...}, {items.offset...}};
+}
+
+namespace detail {
+
+template <typename T>
+struct Primitive {
+    static constexpr bool isPrimitive = false;
+};
+
+template <SwtiTypeValue V>
+struct PrimitiveKind {
+    static constexpr bool isPrimitive = true;
+    static constexpr SwtiTypeValue kind = V;
+};
+
+template <>
+struct Primitive<int32_t> : PrimitiveKind<SwtiTypeInt> {
+};
+
+template <>
+struct Primitive<Fixed> : PrimitiveKind<SwtiTypeFixed> {
+};
+
+template <>
+struct Primitive<bool> : PrimitiveKind<SwtiTypeBoolean> {
+};
+
+template <>
+struct Primitive<char32_t> : PrimitiveKind<SwtiTypeChar> {
+};
+
+template <typename T, typename = void>
+struct IsUnmanaged : std::false_type {
+};
+
+template <typename T>
+struct IsUnmanaged<T, std::void_t<decltype(Describe<T>::userTypeId)>> : std::true_type {
+};
+
+template <typename T>
+constexpr bool isPrimitive = Primitive<T>::isPrimitive;
+
+template <typename T>
+constexpr bool isUnmanaged = !isPrimitive<T> && IsUnmanaged<T>::value;
+
+template <typename T>
+constexpr bool isRecord = !isPrimitive<T> && !isUnmanaged<T>;
+
+// The record and its alias
+template <typename T>
+constexpr size_t typeCountOf = isRecord<T> ? 2 : 1;
+
+template <typename T, typename = void>
+struct ChildrenOf {
+    using type = TypeList<>;
+};
+
+template <typename T>
+struct ChildrenOf<T, std::enable_if_t<isRecord<T>>> {
+    using type = typename std::remove_const_t<decltype(Describe<T>::fields)>::Types;
+};
+
+template <typename T, typename List>
+struct Contains;
+
+template <typename T, typename... Ts>
+struct Contains<T, TypeList<Ts...>> : std::bool_constant<(std::is_same_v<T, Ts> || ...)> {
+};
+
+template <typename List, typename T>
+struct Append;
+
+template <typename... Ts, typename T>
+struct Append<TypeList<Ts...>, T> {
+    using type = TypeList<Ts..., T>;
+};
+
+template <typename List, typename T, bool IsKnown = Contains<T, List>::value>
+struct Collect;
+
+template <typename List, typename Children>
+struct CollectAll;
+
+template <typename List>
+struct CollectAll<List, TypeList<>> {
+    using type = List;
+};
+
+template <typename List, typename C, typename... Cs>
+struct CollectAll<List, TypeList<C, Cs...>> {
+    using type = typename CollectAll<typename Collect<List, C>::type, TypeList<Cs...>>::type;
+};
+
+template <typename List, typename T>
+struct Collect<List, T, true> {
+    using type = List;
+};
+
+template <typename List, typename T>
+struct Collect<List, T, false> {
+    using type = typename CollectAll<typename Append<List, T>::type, typename ChildrenOf<T>::type>::type;
+};
+
+template <typename T, typename List>
+struct IndexOf;
+
+template <typename T, typename... Ts>
+struct IndexOf<T, TypeList<T, Ts...>> {
+    static constexpr size_t value = 0;
+};
+
+template <typename T, typename U, typename... Ts>
+struct IndexOf<T, TypeList<U, Ts...>> {
+    static constexpr size_t value = typeCountOf<U> + IndexOf<T, TypeList<Ts...>>::value;
+};
+
+/// Only called when a name does not fit, which stops the constant evaluation with an error.
+inline void nameIsTooLong()
+{
+}
+
+class Writer {
+public:
+    // `octets` is null when only measuring
+    constexpr explicit Writer(uint8_t* target)
+        : octets(target)
+        , pos(0)
+    {
+    }
+
+    constexpr void writeUInt8(uint8_t value)
+    {
+        if (octets != nullptr) {
+            octets[pos] = value;
+        }
+        pos++;
+    }
+
+    constexpr void writeUInt16(uint16_t value)
+    {
+        writeUInt8(static_cast<uint8_t>(value >> 8));
+        writeUInt8(static_cast<uint8_t>(value & 0xff));
+    }
+
+    constexpr void writeString(const char* s)
+    {
+        size_t length = 0;
+        while (s[length] != 0) {
+            length++;
+        }
+        if (length > 255) {
+            nameIsTooLong();
+        }
+        writeUInt8(static_cast<uint8_t>(length));
+        for (size_t i = 0; i < length; ++i) {
+            writeUInt8(static_cast<uint8_t>(s[i]));
+        }
+    }
+
+    constexpr void writeMemoryInfo(size_t size, size_t align)
+    {
+        writeUInt16(static_cast<uint16_t>(size));
+        writeUInt8(static_cast<uint8_t>(align));
+    }
+
+    constexpr size_t size() const
+    {
+        return pos;
+    }
+
+private:
+    uint8_t* octets;
+    size_t pos;
+};
+
+template <typename Types, typename... Ms, size_t... Is>
+constexpr void writeFields(Writer& writer, const Fields<Ms...>& fields, std::index_sequence<Is...>)
+{
+    ((writer.writeString(fields.names[Is]), writer.writeUInt16(static_cast<uint16_t>(fields.offsets[Is])),
+      writer.writeMemoryInfo(sizeof(Ms), alignof(Ms)), writer.writeUInt16(static_cast<uint16_t>(IndexOf<Ms, Types>::value))),
+     ...);
+}
+
+template <typename Types, typename T>
+constexpr void writeType(Writer& writer)
+{
+    if constexpr (isPrimitive<T>) {
+        writer.writeUInt8(Primitive<T>::kind);
+    } else if constexpr (isUnmanaged<T>) {
+        writer.writeUInt8(SwtiTypeUnmanaged);
+        writer.writeString(Describe<T>::name);
+        writer.writeUInt16(Describe<T>::userTypeId);
+    } else {
+        constexpr auto& fields = Describe<T>::fields;
+        using FieldsType = std::remove_const_t<std::remove_reference_t<decltype(fields)>>;
+        static_assert(FieldsType::count <= 255, "too many fields");
+        static_assert(sizeof(T) <= 0xffff, "record is too large");
+        writer.writeUInt8(SwtiTypeRecord);
+        writer.writeMemoryInfo(sizeof(T), alignof(T));
+        writer.writeUInt8(static_cast<uint8_t>(FieldsType::count));
+        writeFields<Types>(writer, fields, std::make_index_sequence<FieldsType::count>{});
+
+        writer.writeUInt8(SwtiTypeAlias);
+        writer.writeString(Describe<T>::name);
+        writer.writeUInt16(static_cast<uint16_t>(IndexOf<T, Types>::value));
+    }
+}
+
+template <typename... Ts>
+constexpr size_t typeCount(TypeList<Ts...>)
+{
+    return (typeCountOf<Ts> + ... + 0);
+}
+
+template <typename Types, typename... Ts>
+constexpr size_t write(uint8_t* octets, TypeList<Ts...>)
+{
+    Writer writer(octets);
+    writer.writeUInt8(SWTI_SERIALIZE_VERSION_MAJOR);
+    writer.writeUInt8(SWTI_SERIALIZE_VERSION_MINOR);
+    writer.writeUInt8(SWTI_SERIALIZE_VERSION_PATCH);
+    writer.writeUInt8(0);
+    writer.writeUInt16(static_cast<uint16_t>(typeCount(Types{})));
+    (writeType<Types, Ts>(writer), ...);
+    return writer.size();
+}
+
+template <typename Types>
+constexpr auto build()
+{
+    constexpr size_t octetCount = write<Types>(nullptr, Types{});
+    std::array<uint8_t, octetCount> octets{};
+    write<Types>(octets.data(), Types{});
+    return octets;
+}
+
+} // namespace detail
+
+/// The typeinfo for `Roots` and every type they use.
+template <typename... Roots>
+struct Typeinfo {
+    using Types = typename detail::CollectAll<TypeList<>, TypeList<Roots...>>::type;
+
+    static_assert(detail::typeCount(Types{}) <= 0xffff, "too many types");
+
+    static constexpr auto octets = detail::build<Types>();
+
+    /// The index of the type in the deserialized chunk. For records it is the alias with the record name.
+    template <typename T>
+    static constexpr uint16_t indexOf()
+    {
+        return static_cast<uint16_t>(detail::IndexOf<T, Types>::value + (detail::isRecord<T> ? 1 : 0));
+    }
+};
+
+} // namespace swtis
+
+#endif
@@ -0,0 +1,52 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_CACHE_H
+#define SWAMP_TYPEINFO_SERIALIZE_CACHE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiChunk;
+struct SwtisDeserializeOptions;
+
+/// Memory reserved per octet of serialized typeinfo for each cached chunk.
+#define SWTIS_CACHE_MEMORY_FACTOR (64)
+
+/// Opaque, since they hold atomics. Create one cache per process and share it between all consumers.
+typedef struct SwtisCache SwtisCache;
+typedef struct SwtisCacheEntry SwtisCacheEntry;
+
+typedef struct SwtisCacheOptions {
+    // Maximum number of chunks held at the same time
+    size_t maxEntryCount;
+    // Chunks that are not acquired by anyone are evicted, least recently used first, to stay within this many
+    // octets of chunk memory. A miss that still does not fit is refused.
+    size_t memoryBudget;
+    // Optional, used for every chunk. `dependents` is not supported here.
+    const struct SwtisDeserializeOptions* deserializeOptions;
+} SwtisCacheOptions;
+
+SwtisCache* swtisCacheCreate(const SwtisCacheOptions* options);
+/// All entries must have been released.
+void swtisCacheDestroy(SwtisCache* self);
+
+/// Returns the chunk for the serialized typeinfo in `octets`, deserializing it only if no identical blob is in the
+/// cache. Hits take no lock. Returns -4 if every entry is acquired and -5 if the chunk does not fit in the memory
+/// budget next to the acquired ones. The chunk is shared and must not be modified. Release it with swtisCacheRelease().
+int swtisCacheAcquire(SwtisCache* self, const uint8_t* octets, size_t octetCount, SwtisCacheEntry** outEntry);
+const struct SwtiChunk* swtisCacheEntryChunk(const SwtisCacheEntry* entry);
+void swtisCacheRelease(SwtisCache* self, SwtisCacheEntry* entry);
+
+typedef struct SwtisCacheStats {
+    size_t entryCount;
+    size_t memoryUsed;
+    uint64_t hitCount;
+    uint64_t missCount;
+    uint64_t evictionCount;
+} SwtisCacheStats;
+
+void swtisCacheStats(SwtisCache* self, SwtisCacheStats* outStats);
+
+#endif
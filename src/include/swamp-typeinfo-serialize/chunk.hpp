@@ -0,0 +1,255 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_CHUNK_HPP
+#define SWAMP_TYPEINFO_SERIALIZE_CHUNK_HPP
+
+// A deserialized chunk that owns its memory. Requires C++20.
+//
+//   swtis::Chunk chunk;
+//   int error = swtis::Chunk::deserialize(std::as_bytes(std::span(octets)), chunk);
+//   for (const SwtiType* type : chunk.types()) {
+//       swtis::visit(*type, swtis::Overloaded{
+//           [&](const SwtiRecordType& record) { use(chunk.name(record.internal), chunk.fieldName(record, 0)); },
+//           [](const SwtiType&) {},
+//       });
+//   }
+//
+// The names are measured once, when deserializing, so the string_views cost nothing to get.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+extern "C" {
+#include <imprint/linear_allocator.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo/chunk.h>
+#include <swamp-typeinfo/typeinfo.h>
+}
+
+namespace swtis {
+
+class Chunk {
+public:
+    /// Memory reserved for the chunk, per octet of serialized typeinfo.
+    static constexpr size_t memoryFactor = 64;
+
+    Chunk() noexcept
+        : chunk{}
+    {
+    }
+
+    Chunk(const Chunk&) = delete;
+    Chunk& operator=(const Chunk&) = delete;
+
+    Chunk(Chunk&& other) noexcept
+        : memory(std::move(other.memory))
+        , firstNameIndices(std::move(other.firstNameIndices))
+        , nameLengths(std::move(other.nameLengths))
+        , chunk(std::exchange(other.chunk, SwtiChunk{}))
+    {
+    }
+
+    Chunk& operator=(Chunk&& other) noexcept
+    {
+        memory = std::move(other.memory);
+        firstNameIndices = std::move(other.firstNameIndices);
+        nameLengths = std::move(other.nameLengths);
+        chunk = std::exchange(other.chunk, SwtiChunk{});
+        return *this;
+    }
+
+    /// Replaces the contents of `target`. Returns the same errors as swtisDeserializeWithOptions(), `target` is left
+    /// empty on error.
+    static int deserialize(std::span<const std::byte> octets, Chunk& target,
+                           const SwtisDeserializeOptions* options = nullptr)
+    {
+        target = Chunk{};
+
+        size_t memorySize = octets.size() * memoryFactor;
+        auto memory = std::make_unique<uint8_t[]>(memorySize);
+        ImprintLinearAllocator allocator;
+        imprintLinearAllocatorInit(&allocator, memory.get(), memorySize, "swtis::Chunk");
+
+        SwtiChunk chunk;
+        int result = swtisDeserializeWithOptions(reinterpret_cast<const uint8_t*>(octets.data()), octets.size(), &chunk,
+                                                 &allocator.info, options);
+        if (result < 0) {
+            return result;
+        }
+
+        target.memory = std::move(memory);
+        target.chunk = chunk;
+        target.measureNames();
+
+        return 0;
+    }
+
+    std::span<const SwtiType* const> types() const noexcept
+    {
+        return {chunk.types, chunk.typeCount};
+    }
+
+    size_t size() const noexcept
+    {
+        return chunk.typeCount;
+    }
+
+    const SwtiType* operator[](size_t index) const noexcept
+    {
+        return chunk.types[index];
+    }
+
+    /// For the C functions.
+    const SwtiChunk& get() const noexcept
+    {
+        return chunk;
+    }
+
+    /// The name in SwtiType, for example the custom type or alias name. `type` must be in this chunk.
+    std::string_view name(const SwtiType& type) const noexcept
+    {
+        return {type.name, nameLengths[firstNameIndices[type.index]]};
+    }
+
+    std::string_view variantName(const SwtiCustomTypeVariant& variant) const noexcept
+    {
+        return {variant.name, nameLengths[firstNameIndices[variant.internal.index] + 1]};
+    }
+
+    std::string_view fieldName(const SwtiRecordType& record, size_t fieldIndex) const noexcept
+    {
+        return {record.fields[fieldIndex].name, nameLengths[firstNameIndices[record.internal.index] + 1 + fieldIndex]};
+    }
+
+private:
+    static size_t extraNameCount(const SwtiType& type) noexcept
+    {
+        switch (type.type) {
+            case SwtiTypeCustomVariant:
+                return 1;
+            case SwtiTypeRecord:
+                return reinterpret_cast<const SwtiRecordType&>(type).fieldCount;
+            default:
+                return 0;
+        }
+    }
+
+    static uint32_t measure(const char* name) noexcept
+    {
+        return name != nullptr ? static_cast<uint32_t>(std::strlen(name)) : 0;
+    }
+
+    // For each type: its own name, then the variant name or the record field names
+    void measureNames()
+    {
+        firstNameIndices = std::make_unique<uint32_t[]>(chunk.typeCount);
+        size_t nameCount = 0;
+        for (size_t i = 0; i < chunk.typeCount; ++i) {
+            firstNameIndices[i] = static_cast<uint32_t>(nameCount);
+            nameCount += 1 + extraNameCount(*chunk.types[i]);
+        }
+
+        nameLengths = std::make_unique<uint32_t[]>(nameCount);
+        for (size_t i = 0; i < chunk.typeCount; ++i) {
+            const SwtiType& type = *chunk.types[i];
+            uint32_t* lengths = &nameLengths[firstNameIndices[i]];
+            lengths[0] = measure(type.name);
+            if (type.type == SwtiTypeCustomVariant) {
+                lengths[1] = measure(reinterpret_cast<const SwtiCustomTypeVariant&>(type).name);
+            } else if (type.type == SwtiTypeRecord) {
+                const auto& record = reinterpret_cast<const SwtiRecordType&>(type);
+                for (size_t j = 0; j < record.fieldCount; ++j) {
+                    lengths[1 + j] = measure(record.fields[j].name);
+                }
+            }
+        }
+    }
+
+    std::unique_ptr<uint8_t[]> memory;
+    std::unique_ptr<uint32_t[]> firstNameIndices;
+    std::unique_ptr<uint32_t[]> nameLengths;
+    SwtiChunk chunk;
+};
+
+/// Combines lambdas into one visitor.
+template <typename... Fs>
+struct Overloaded : Fs... {
+    using Fs::operator()...;
+};
+
+template <typename... Fs>
+Overloaded(Fs...) -> Overloaded<Fs...>;
+
+namespace detail {
+
+/// The C structs only embed SwtiType as `internal`, so a visitor that takes SwtiType can not be called with them.
+template <typename Struct, typename Visitor>
+decltype(auto) visitAs(const SwtiType& type, Visitor&& visitor)
+{
+    if constexpr (std::is_invocable_v<Visitor, const Struct&>) {
+        return visitor(reinterpret_cast<const Struct&>(type));
+    } else {
+        return visitor(type);
+    }
+}
+
+} // namespace detail
+
+/// Calls `visitor` with `type` as its own struct, for example SwtiRecordType for SwtiTypeRecord. If the visitor can
+/// not be called with that struct, or the type has no struct of its own, it is called with the SwtiType instead.
+template <typename Visitor>
+decltype(auto) visit(const SwtiType& type, Visitor&& visitor)
+{
+    switch (type.type) {
+        case SwtiTypeInt:
+            return detail::visitAs<SwtiIntType>(type, visitor);
+        case SwtiTypeFixed:
+            return detail::visitAs<SwtiFixedType>(type, visitor);
+        case SwtiTypeBoolean:
+            return detail::visitAs<SwtiBooleanType>(type, visitor);
+        case SwtiTypeString:
+            return detail::visitAs<SwtiStringType>(type, visitor);
+        case SwtiTypeChar:
+            return detail::visitAs<SwtiCharType>(type, visitor);
+        case SwtiTypeBlob:
+            return detail::visitAs<SwtiBlobType>(type, visitor);
+        case SwtiTypeList:
+            return detail::visitAs<SwtiListType>(type, visitor);
+        case SwtiTypeArray:
+            return detail::visitAs<SwtiArrayType>(type, visitor);
+        case SwtiTypeRecord:
+            return detail::visitAs<SwtiRecordType>(type, visitor);
+        case SwtiTypeTuple:
+            return detail::visitAs<SwtiTupleType>(type, visitor);
+        case SwtiTypeCustom:
+            return detail::visitAs<SwtiCustomType>(type, visitor);
+        case SwtiTypeCustomVariant:
+            return detail::visitAs<SwtiCustomTypeVariant>(type, visitor);
+        case SwtiTypeFunction:
+            return detail::visitAs<SwtiFunctionType>(type, visitor);
+        case SwtiTypeAlias:
+            return detail::visitAs<SwtiAliasType>(type, visitor);
+        case SwtiTypeRefId:
+            return detail::visitAs<SwtiTypeRefIdType>(type, visitor);
+        case SwtiTypeAny:
+            return detail::visitAs<SwtiAnyType>(type, visitor);
+        case SwtiTypeAnyMatchingTypes:
+            return detail::visitAs<SwtiAnyMatchingTypesType>(type, visitor);
+        case SwtiTypeUnmanaged:
+            return detail::visitAs<SwtiUnmanagedType>(type, visitor);
+        default:
+            return visitor(type);
+    }
+}
+
+} // namespace swtis
+
+#endif
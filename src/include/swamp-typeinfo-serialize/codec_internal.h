@@ -0,0 +1,118 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_CODEC_INTERNAL_H
+#define SWAMP_TYPEINFO_SERIALIZE_CODEC_INTERNAL_H
+
+// The wire layout of every type kind, in one place. The writer, the size calculation, the measuring, both readers
+// and the fixup are all expanded from it, so they can not disagree on the format.
+//
+// Every type starts with its uint8 type value. SWTIS_CODEC_KINDS lists the kinds that have more than that as
+// KIND(typeValue, Struct, LAYOUT) and the kinds that do not as BARE(typeValue). Each LAYOUT is called with the
+// element macros below and expands to the elements in wire order. `self` is the struct, or the item inside ITEMS.
+//
+//  NAME(self, member)                         uint8 octet count and the octets. Not written when sectioned.
+//  EMPTY_NAME(self, member)                   Nothing on the wire, the reader sets it to an empty string.
+//  MEMORY_INFO(self, member)                  uint16 size, uint8 align. Not written when the layout is omitted.
+//  MEMORY_OFFSET_INFO(self, member)           uint16 offset, then as MEMORY_INFO. Not written when the layout is
+//                                             omitted.
+//  OWNER(self, member, Pointer, ACCEPT)       uint16 type index of the type that `self` belongs to.
+//  REF(self, member, Pointer, ACCEPT)         uint16 type index of a type that `self` refers to.
+//  REFS(self, member, count, Pointer, ACCEPT) uint8 count, then a uint16 type index for each.
+//  U16(self, member)                          uint16.
+//  ITEMS(self, member, count, Item, item, ...) uint8 count, then the elements after `item` for each item.
+//
+// References are resolved to `Pointer`. ACCEPT is one of the SWTIS_CODEC_ACCEPT macros, it is given the referenced
+// type. If its _STRICT value is 1, a reference that can not be resolved or is not accepted fails the fixup. Otherwise
+// a reference that can not be resolved is cleared and one that is not accepted is kept. REF and REFS references are
+// reported as dependents, OWNER references are not. A cleared reference is written as SWTIS_CODEC_CLEARED_TYPE_REF,
+// which is only allowed where _STRICT is 0.
+
+#define SWTIS_CODEC_CLEARED_TYPE_REF (0xffff)
+
+#define SWTIS_CODEC_ACCEPT_ANY(referenced) (1)
+#define SWTIS_CODEC_ACCEPT_ANY_STRICT (1)
+#define SWTIS_CODEC_ACCEPT_CUSTOM(referenced) ((referenced)->type == SwtiTypeCustom)
+#define SWTIS_CODEC_ACCEPT_CUSTOM_STRICT (1)
+#define SWTIS_CODEC_ACCEPT_VARIANT(referenced) ((referenced)->type == SwtiTypeCustomVariant)
+#define SWTIS_CODEC_ACCEPT_VARIANT_STRICT (1)
+// Generic parameters of custom types have never failed a load
+#define SWTIS_CODEC_ACCEPT_GENERIC(referenced) ((referenced)->type != SwtiTypeCustomVariant)
+#define SWTIS_CODEC_ACCEPT_GENERIC_STRICT (0)
+
+#define SWTIS_CODEC_CUSTOM(NAME, EMPTY_NAME, MEMORY_INFO, MEMORY_OFFSET_INFO, OWNER, REF, REFS, U16, ITEMS)         \
+    NAME(self, internal.name)                                                                                      \
+    MEMORY_INFO(self, memoryInfo)                                                                                  \
+    REFS(self, generic.genericTypes, generic.genericCount, const SwtiType*, SWTIS_CODEC_ACCEPT_GENERIC)             \
+    REFS(self, variantTypes, variantCount, const SwtiCustomTypeVariant*, SWTIS_CODEC_ACCEPT_VARIANT)
+
+#define SWTIS_CODEC_CUSTOM_VARIANT(NAME, EMPTY_NAME, MEMORY_INFO, MEMORY_OFFSET_INFO, OWNER, REF, REFS, U16, ITEMS) \
+    OWNER(self, inCustomType, const struct SwtiCustomType*, SWTIS_CODEC_ACCEPT_CUSTOM)                             \
+    NAME(self, name)                                                                                               \
+    MEMORY_INFO(self, memoryInfo)                                                                                  \
+    ITEMS(self, fields, paramCount, SwtiCustomTypeVariantField, field,                                             \
+          REF(field, fieldType, const SwtiType*, SWTIS_CODEC_ACCEPT_ANY)                                           \
+          MEMORY_OFFSET_INFO(field, memoryOffsetInfo))
+
+#define SWTIS_CODEC_FUNCTION(NAME, EMPTY_NAME, MEMORY_INFO, MEMORY_OFFSET_INFO, OWNER, REF, REFS, U16, ITEMS)       \
+    REFS(self, parameterTypes, parameterCount, const SwtiType*, SWTIS_CODEC_ACCEPT_ANY)
+
+#define SWTIS_CODEC_ALIAS(NAME, EMPTY_NAME, MEMORY_INFO, MEMORY_OFFSET_INFO, OWNER, REF, REFS, U16, ITEMS)          \
+    NAME(self, internal.name)                                                                                      \
+    REF(self, targetType, const SwtiType*, SWTIS_CODEC_ACCEPT_ANY)
+
+#define SWTIS_CODEC_REF_ID(NAME, EMPTY_NAME, MEMORY_INFO, MEMORY_OFFSET_INFO, OWNER, REF, REFS, U16, ITEMS)         \
+    REF(self, referencedType, const SwtiType*, SWTIS_CODEC_ACCEPT_ANY)
+
+#define SWTIS_CODEC_RECORD(NAME, EMPTY_NAME, MEMORY_INFO, MEMORY_OFFSET_INFO, OWNER, REF, REFS, U16, ITEMS)         \
+    MEMORY_INFO(self, memoryInfo)                                                                                  \
+    ITEMS(self, fields, fieldCount, SwtiRecordTypeField, field,                                                    \
+          NAME(field, name)                                                                                        \
+          MEMORY_OFFSET_INFO(field, memoryOffsetInfo)                                                              \
+          REF(field, fieldType, const SwtiType*, SWTIS_CODEC_ACCEPT_ANY))
+
+#define SWTIS_CODEC_ARRAY(NAME, EMPTY_NAME, MEMORY_INFO, MEMORY_OFFSET_INFO, OWNER, REF, REFS, U16, ITEMS)          \
+    REF(self, itemType, const SwtiType*, SWTIS_CODEC_ACCEPT_ANY)                                                    \
+    MEMORY_INFO(self, memoryInfo)
+
+#define SWTIS_CODEC_LIST SWTIS_CODEC_ARRAY
+
+#define SWTIS_CODEC_TUPLE(NAME, EMPTY_NAME, MEMORY_INFO, MEMORY_OFFSET_INFO, OWNER, REF, REFS, U16, ITEMS)          \
+    MEMORY_INFO(self, memoryInfo)                                                                                  \
+    ITEMS(self, fields, fieldCount, SwtiTupleTypeField, field,                                                     \
+          MEMORY_OFFSET_INFO(field, memoryOffsetInfo)                                                              \
+          REF(field, fieldType, const SwtiType*, SWTIS_CODEC_ACCEPT_ANY)                                           \
+          EMPTY_NAME(field, name))
+
+#define SWTIS_CODEC_UNMANAGED(NAME, EMPTY_NAME, MEMORY_INFO, MEMORY_OFFSET_INFO, OWNER, REF, REFS, U16, ITEMS)      \
+    NAME(self, internal.name)                                                                                      \
+    U16(self, userTypeId)
+
+#define SWTIS_CODEC_KINDS(KIND, BARE)                                                                              \
+    KIND(SwtiTypeCustom, SwtiCustomType, SWTIS_CODEC_CUSTOM)                                                       \
+    KIND(SwtiTypeCustomVariant, SwtiCustomTypeVariant, SWTIS_CODEC_CUSTOM_VARIANT)                                 \
+    KIND(SwtiTypeFunction, SwtiFunctionType, SWTIS_CODEC_FUNCTION)                                                 \
+    KIND(SwtiTypeAlias, SwtiAliasType, SWTIS_CODEC_ALIAS)                                                          \
+    KIND(SwtiTypeRefId, SwtiTypeRefIdType, SWTIS_CODEC_REF_ID)                                                     \
+    KIND(SwtiTypeRecord, SwtiRecordType, SWTIS_CODEC_RECORD)                                                       \
+    KIND(SwtiTypeArray, SwtiArrayType, SWTIS_CODEC_ARRAY)                                                          \
+    KIND(SwtiTypeList, SwtiListType, SWTIS_CODEC_LIST)                                                             \
+    KIND(SwtiTypeTuple, SwtiTupleType, SWTIS_CODEC_TUPLE)                                                          \
+    KIND(SwtiTypeUnmanaged, SwtiUnmanagedType, SWTIS_CODEC_UNMANAGED)                                              \
+    BARE(SwtiTypeString)                                                                                           \
+    BARE(SwtiTypeInt)                                                                                              \
+    BARE(SwtiTypeFixed)                                                                                            \
+    BARE(SwtiTypeBoolean)                                                                                          \
+    BARE(SwtiTypeBlob)                                                                                             \
+    BARE(SwtiTypeResourceName)                                                                                     \
+    BARE(SwtiTypeChar)                                                                                             \
+    BARE(SwtiTypeAny)                                                                                              \
+    BARE(SwtiTypeAnyMatchingTypes)
+
+/// Expands `LAYOUT` with the element macros that share `PREFIX`, for example PREFIX##_NAME.
+#define SWTIS_CODEC_EXPAND(LAYOUT, PREFIX)                                                                         \
+    LAYOUT(PREFIX##_NAME, PREFIX##_EMPTY_NAME, PREFIX##_MEMORY_INFO, PREFIX##_MEMORY_OFFSET_INFO, PREFIX##_OWNER,  \
+           PREFIX##_REF, PREFIX##_REFS, PREFIX##_U16, PREFIX##_ITEMS)
+
+#endif
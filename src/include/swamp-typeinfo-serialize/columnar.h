@@ -0,0 +1,36 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_COLUMNAR_H
+#define SWAMP_TYPEINFO_SERIALIZE_COLUMNAR_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiRecordType;
+struct FldInStream;
+struct FldOutStream;
+struct ImprintAllocator;
+
+typedef enum SwtisColumnEncoding {
+    // Each value with swtisSerializeValue()
+    SwtisColumnEncodingValues,
+    // Int and Fixed: zig-zag varint of the difference to the previous row
+    SwtisColumnEncodingDelta,
+    // Bool: one bit per row
+    SwtisColumnEncodingBits,
+    // Char and custom types without parameters: a table of distinct values and bit packed indices into it
+    SwtisColumnEncodingDictionary,
+} SwtisColumnEncoding;
+
+#define SWTIS_COLUMNAR_MAX_DICTIONARY_COUNT (256)
+
+/// Batch format: uint32 row count, then for each record field: uint8 encoding, uint32 octet count and the column.
+/// Values are `record->memoryInfo.memorySize` apart in memory.
+int swtisColumnarEncode(struct FldOutStream* stream, const struct SwtiRecordType* record, const void* values,
+                        size_t count);
+int swtisColumnarDecode(struct FldInStream* stream, const struct SwtiRecordType* record, void* values,
+                        size_t maxCount, size_t* outCount, struct ImprintAllocator* allocator);
+
+#endif
@@ -0,0 +1,18 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_CRC32C_INTERNAL_H
+#define SWAMP_TYPEINFO_SERIALIZE_CRC32C_INTERNAL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/// CRC-32C (Castagnoli). Start with 0. Updating with `a` and then `b` gives the same result as updating with `a`
+/// followed by `b` in one call. Uses the SSE4.2 or ARMv8 CRC instructions when the CPU has them.
+uint32_t swtisCrc32cUpdate(uint32_t crc, const uint8_t* octets, size_t octetCount);
+
+/// Same as swtisCrc32cUpdate(), but always uses the slicing-by-8 tables, so it can be checked on any CPU.
+uint32_t swtisCrc32cUpdatePortable(uint32_t crc, const uint8_t* octets, size_t octetCount);
+
+#endif
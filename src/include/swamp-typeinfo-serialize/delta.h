@@ -0,0 +1,33 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_DELTA_H
+#define SWAMP_TYPEINFO_SERIALIZE_DELTA_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiType;
+struct FldInStream;
+struct FldOutStream;
+struct ImprintAllocator;
+
+/// Delta wire format, relative to a baseline value that both sides already have:
+///  Record, Tuple - changed field bitmask (one bit per field, lowest bit first), then the delta of each changed field.
+///  Custom        - uint8 variant index. Same variant as the baseline: a changed field bitmask and the changed
+///                  fields, like a tuple. Other variant: all fields of the new variant in the value wire format.
+///  Other types   - the whole value in the value wire format (see value.h).
+/// A value that is not a record, tuple or custom type is prefixed with a uint8 that is zero when it is unchanged.
+int swtisDeltaSerializeValue(struct FldOutStream* stream, const struct SwtiType* type, const void* baseline,
+                             const void* value);
+
+/// Applies a delta in place to `target`, which must hold the baseline that the delta was written against.
+/// New strings, blobs and lists are allocated from `allocator`.
+int swtisDeltaApplyValue(struct FldInStream* stream, const struct SwtiType* type, void* target,
+                         struct ImprintAllocator* allocator);
+
+/// Returns 1 if the two values are equal, comparing strings, blobs and lists by content.
+int swtisDeltaValuesEqual(const struct SwtiType* type, const void* a, const void* b);
+
+#endif
@@ -0,0 +1,29 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_DEPENDENTS_H
+#define SWAMP_TYPEINFO_SERIALIZE_DEPENDENTS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+/// Reverse type references, built by the deserializer when SwtisDeserializeOptions::dependents is set.
+/// The types that refer directly to type index `i` are `indices[offsets[i]]` up to `indices[offsets[i + 1]]`.
+/// Records, tuples and variants refer to their field types, lists and arrays to their item type, functions to their
+/// parameters, aliases and type ref ids to their target and custom types to their variants and generic types.
+typedef struct SwtisDependents {
+    const uint32_t* offsets;
+    const uint16_t* indices;
+    size_t typeCount;
+} SwtisDependents;
+
+int swtisDependentsDirect(const SwtisDependents* self, size_t typeIndex, const uint16_t** outIndices,
+                          size_t* outCount);
+
+/// Finds every type that refers to any of the changed types, directly or through other types.
+/// The changed types themselves are not included. Returns the number of type indices written to `outIndices`.
+int swtisDependentsTransitive(const SwtisDependents* self, const uint16_t* changedIndices, size_t changedCount,
+                              uint16_t* outIndices, size_t maxCount);
+
+#endif
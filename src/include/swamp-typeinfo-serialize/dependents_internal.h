@@ -0,0 +1,33 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_DEPENDENTS_INTERNAL_H
+#define SWAMP_TYPEINFO_SERIALIZE_DEPENDENTS_INTERNAL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtisDependents;
+struct ImprintAllocator;
+
+// Collects references while the deserializer resolves them, do not use directly
+
+typedef struct SwtisDependentsBuilderEdge {
+    uint16_t referencedIndex;
+    uint16_t fromIndex;
+} SwtisDependentsBuilderEdge;
+
+typedef struct SwtisDependentsBuilder {
+    SwtisDependentsBuilderEdge* edges;
+    size_t edgeCount;
+    size_t edgeCapacity;
+} SwtisDependentsBuilder;
+
+void swtisDependentsBuilderInit(SwtisDependentsBuilder* self);
+void swtisDependentsBuilderAdd(SwtisDependentsBuilder* self, size_t referencedIndex, size_t fromIndex);
+int swtisDependentsBuilderFinish(SwtisDependentsBuilder* self, size_t typeCount, struct SwtisDependents* target,
+                                 struct ImprintAllocator* allocator);
+void swtisDependentsBuilderDestroy(SwtisDependentsBuilder* self);
+
+#endif
@@ -11,8 +11,31 @@
 struct SwtiChunk;
 struct FldInStream;
 struct ImprintAllocator;
+struct SwtisLayoutProfile;
+struct SwtisDependents;
+struct SwtisUnmanagedTable;
+
+typedef struct SwtisDeserializeOptions {
+    // Profile used when the layout was omitted by the producer, or when validating. Defaults to the host profile.
+    const struct SwtisLayoutProfile* layoutProfile;
+    // Check producer supplied layouts against the layout profile
+    int validateLayout;
+    // If set, filled in with the reverse type references, allocated from the same allocator as the chunk
+    struct SwtisDependents* dependents;
+    // Leave the names empty for sectioned typeinfo, instead of copying them from the names section. Look them up
+    // with SwtisNames when they are needed.
+    int lazyNames;
+    // If set, filled in with the unmanaged types indexed by userTypeId, allocated from the same allocator as the chunk.
+    // Loading fails if two unmanaged types have the same userTypeId.
+    struct SwtisUnmanagedTable* unmanagedTable;
+    // Read every value through the bounds checked stream. By default each type is bounds checked once, as a whole,
+    // and then read without checks, which is just as safe but faster.
+    int checkedReads;
+} SwtisDeserializeOptions;
 
 int swtisDeserialize(const uint8_t* octets, size_t count, struct SwtiChunk* target, struct ImprintAllocator* allocator);
+int swtisDeserializeWithOptions(const uint8_t* octets, size_t count, struct SwtiChunk* target, struct ImprintAllocator* allocator, const SwtisDeserializeOptions* options);
 int swtisDeserializeFromStream(struct FldInStream* stream, struct SwtiChunk* target, struct ImprintAllocator* allocator);
+int swtisDeserializeFromStreamWithOptions(struct FldInStream* stream, struct SwtiChunk* target, struct ImprintAllocator* allocator, const SwtisDeserializeOptions* options);
 
 #endif
@@ -9,9 +9,36 @@
 #include <stdlib.h>
 
 struct SwtiChunk;
+struct SwtisDependents;
+struct ImprintAllocator;
 
 // Only for tests, do not use
 //int swtiDeserializeRaw(const uint8_t* octets, size_t count, struct SwtiChunk* target);
 int swtisDeserializeFixup(struct SwtiChunk* chunk);
+struct SwtisDeserializeOptions;
+
+/// Reads the typeinfo as the octets arrive, one complete type at a time.
+typedef struct SwtisDeserializeProgress {
+    struct SwtiChunk* target;
+    struct ImprintAllocator* allocator;
+    const struct SwtisDeserializeOptions* options;
+    uint8_t formatFlags;
+    int hasHeader;
+    size_t typeIndex;
+    size_t pos;
+    // Sectioned format only
+    size_t typesEndPos;
+    size_t namesOffset;
+    size_t namesOctetCount;
+    size_t endPos;
+    uint32_t checksum;
+    size_t checksumPos;
+} SwtisDeserializeProgress;
+
+void swtisDeserializeProgressInit(SwtisDeserializeProgress* self, struct SwtiChunk* target, struct ImprintAllocator* allocator, const struct SwtisDeserializeOptions* options);
+int swtisDeserializeProgressFeed(SwtisDeserializeProgress* self, const uint8_t* octets, size_t octetCount);
+int swtisDeserializeProgressFinish(SwtisDeserializeProgress* self);
+
+int swtisDeserializeFixupWithDependents(struct SwtiChunk* chunk, struct SwtisDependents* dependents, struct ImprintAllocator* allocator);
 
 #endif
@@ -0,0 +1,42 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_DESERIALIZE_MANY_H
+#define SWAMP_TYPEINFO_SERIALIZE_DESERIALIZE_MANY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiChunk;
+struct SwtisDeserializeOptions;
+
+/// Memory needed per octet of serialized typeinfo, with a good margin.
+#define SWTIS_DESERIALIZE_MANY_MEMORY_FACTOR (64)
+
+typedef struct SwtisBlob {
+    const uint8_t* octets;
+    size_t octetCount;
+} SwtisBlob;
+
+typedef int (*SwtisDeserializeManyLinkFn)(void* userData, struct SwtiChunk* chunks, size_t chunkCount);
+
+typedef struct SwtisDeserializeManyOptions {
+    // Split into one linear allocator partition per blob, sized by the blob. The chunks are allocated from it.
+    // Must be at least SWTIS_DESERIALIZE_MANY_MEMORY_FACTOR times the total blob size.
+    uint8_t* memory;
+    size_t memorySize;
+    // Optional, used for every blob. `dependents` is not supported here.
+    const struct SwtisDeserializeOptions* deserializeOptions;
+    // Optional, called on the calling thread once all blobs have loaded
+    SwtisDeserializeManyLinkFn link;
+    void* linkUserData;
+    // Optional, receives the result of swtisDeserialize() for each blob
+    int* outResults;
+} SwtisDeserializeManyOptions;
+
+/// Deserializes independent blobs in parallel. Returns 0 if all of them loaded, otherwise the first error.
+int swtisDeserializeMany(const SwtisBlob* blobs, size_t count, struct SwtiChunk* outChunks, size_t threadCount,
+                         const SwtisDeserializeManyOptions* options);
+
+#endif
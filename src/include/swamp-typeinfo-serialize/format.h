@@ -0,0 +1,32 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_FORMAT_H
+#define SWAMP_TYPEINFO_SERIALIZE_FORMAT_H
+
+// Format flags are written as a single octet directly after the version.
+// A reader must reject any flag it does not know about.
+
+// No SwtiMemoryInfo or SwtiMemoryOffsetInfo is written. The reader computes them with the layout engine.
+#define SWTIS_FORMAT_FLAG_LAYOUT_OMITTED (0x01)
+
+// The type count is followed by a section directory instead of the types:
+//  uint8 sectionCount, then for each section: uint8 id, uint32 offset (from the version octet), uint32 octet count.
+// The types are written as usual in the SWTIS_SECTION_TYPES section, but without any names. The names are in the
+// optional SWTIS_SECTION_NAMES section. A reader skips sections it does not know about.
+#define SWTIS_FORMAT_FLAG_SECTIONED (0x02)
+
+// A uint32 CRC-32C of everything from the version octet up to the end of the types (or the last section) follows
+// as a footer.
+#define SWTIS_FORMAT_FLAG_CHECKSUM (0x04)
+
+#define SWTIS_FORMAT_FLAGS_KNOWN (SWTIS_FORMAT_FLAG_LAYOUT_OMITTED | SWTIS_FORMAT_FLAG_SECTIONED | SWTIS_FORMAT_FLAG_CHECKSUM)
+
+#define SWTIS_SECTION_TYPES (0x01)
+
+// uint16 name count, then the names, each followed by a zero octet. The names are in type order; within a type in the order they would have been written inline:
+// the custom type, variant, alias or unmanaged name, or the record field names.
+#define SWTIS_SECTION_NAMES (0x02)
+
+#endif
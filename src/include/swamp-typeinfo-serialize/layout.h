@@ -0,0 +1,38 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_LAYOUT_H
+#define SWAMP_TYPEINFO_SERIALIZE_LAYOUT_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <swamp-typeinfo/typeinfo.h>
+
+struct SwtiChunk;
+
+/// Describes how the primitive values are stored in memory for a target.
+/// String, Blob, List, Array, Function, Any, Unmanaged and TypeRefId are all stored as references.
+/// Records and tuples are laid out in declaration order, each field aligned to its own alignment.
+/// Custom types start with a tag, followed by the fields of the active variant.
+/// For Array and List the memory info describes the item (size is the item stride).
+typedef struct SwtisLayoutProfile {
+    SwtiMemoryInfo intInfo;
+    SwtiMemoryInfo fixedInfo;
+    SwtiMemoryInfo boolInfo;
+    SwtiMemoryInfo charInfo;
+    SwtiMemoryInfo referenceInfo;
+    SwtiMemoryInfo tagInfo;
+} SwtisLayoutProfile;
+
+extern const SwtisLayoutProfile swtisLayoutProfile32;
+extern const SwtisLayoutProfile swtisLayoutProfile64;
+
+#define SWTIS_LAYOUT_PROFILE_HOST (sizeof(void*) == 8 ? &swtisLayoutProfile64 : &swtisLayoutProfile32)
+
+int swtisLayoutMemoryInfo(const SwtiType* type, const SwtisLayoutProfile* profile, SwtiMemoryInfo* outInfo);
+int swtisLayoutCompute(struct SwtiChunk* chunk, const SwtisLayoutProfile* profile);
+int swtisLayoutValidate(const struct SwtiChunk* chunk, const SwtisLayoutProfile* profile);
+
+#endif
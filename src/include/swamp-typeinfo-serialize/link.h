@@ -0,0 +1,53 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_LINK_H
+#define SWAMP_TYPEINFO_SERIALIZE_LINK_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiChunk;
+
+/// A named binding, usually a function or an unmanaged type, and the index of its type in its chunk.
+typedef struct SwtisLinkSymbol {
+    const char* name;
+    uint16_t typeIndex;
+} SwtisLinkSymbol;
+
+typedef enum SwtisLinkReason {
+    // The host has no symbol with that name
+    SwtisLinkReasonMissing,
+    // Different kinds of types, e.g. a record and a tuple
+    SwtisLinkReasonKind,
+    // Custom type or variant names differ
+    SwtisLinkReasonName,
+    // Number of fields, parameters, variants or generic parameters differ
+    SwtisLinkReasonCount,
+    // Record field `memberIndex` has another name
+    SwtisLinkReasonFieldName,
+    // Unmanaged types with different user type ids
+    SwtisLinkReasonUserTypeId,
+} SwtisLinkReason;
+
+/// `moduleTypeIndex` and `hostTypeIndex` are the innermost types that differ, which can be deep inside the types of
+/// the symbols.
+typedef struct SwtisLinkMismatch {
+    const char* name;
+    SwtisLinkReason reason;
+    uint16_t moduleTypeIndex;
+    uint16_t hostTypeIndex;
+    size_t memberIndex;
+} SwtisLinkMismatch;
+
+/// Checks that each module symbol has a host symbol with the same name and a structurally equivalent type. Aliases
+/// are looked through, but type ref ids are not, since they are represented differently at runtime. Custom types
+/// must have the same name, and unmanaged types the same user type id.
+/// Results are shared between all the symbols, so each pair of types is only compared once. Returns the number of
+/// mismatches, of which the first `maxMismatchCount` are written to `outMismatches`, or a negative value on error.
+int swtisLinkCheck(const struct SwtiChunk* module, const SwtisLinkSymbol* moduleSymbols, size_t moduleSymbolCount,
+                   const struct SwtiChunk* host, const SwtisLinkSymbol* hostSymbols, size_t hostSymbolCount,
+                   SwtisLinkMismatch* outMismatches, size_t maxMismatchCount);
+
+#endif
@@ -0,0 +1,45 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_LOADER_H
+#define SWAMP_TYPEINFO_SERIALIZE_LOADER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiChunk;
+struct ImprintAllocator;
+struct SwtisDeserializeOptions;
+
+typedef enum SwtisLoadMode {
+    // Maps the file and asks the kernel to read ahead, page faults during decoding wait for the rest
+    SwtisLoadModeMap,
+    // Reads the file in blocks on a background thread, decoding starts as soon as the first block is in
+    SwtisLoadModeBlocks,
+} SwtisLoadMode;
+
+#define SWTIS_LOAD_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+typedef struct SwtisLoadOptions {
+    SwtisLoadMode mode;
+    // Only for SwtisLoadModeBlocks. Zero means SWTIS_LOAD_DEFAULT_BLOCK_SIZE.
+    size_t blockSize;
+    const struct SwtisDeserializeOptions* deserializeOptions;
+} SwtisLoadOptions;
+
+/// I/O is the time spent opening, mapping or reading the file, decode the time spent deserializing. In block mode
+/// they overlap, so together they can be more than the total. Time the decoder spent waiting for blocks is in
+/// neither. In map mode, page faults are part of decode.
+typedef struct SwtisLoadStats {
+    uint64_t ioNanoseconds;
+    uint64_t decodeNanoseconds;
+    uint64_t totalNanoseconds;
+    size_t octetCount;
+} SwtisLoadStats;
+
+/// Loads and deserializes a typeinfo file. `options` and `outStats` can be null. Returns the number of octets read.
+int swtisLoadFile(const char* path, struct SwtiChunk* target, struct ImprintAllocator* allocator,
+                  const SwtisLoadOptions* options, SwtisLoadStats* outStats);
+
+#endif
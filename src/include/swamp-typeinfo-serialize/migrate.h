@@ -0,0 +1,105 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_MIGRATE_H
+#define SWAMP_TYPEINFO_SERIALIZE_MIGRATE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiChunk;
+struct SwtiType;
+struct ImprintAllocator;
+
+#define SWTIS_MIGRATE_FIXED_FACTOR (1000)
+
+typedef enum SwtisMigrationOpcode {
+    SwtisMigrationOpcodeCopy,
+    SwtisMigrationOpcodeIntToFixed,
+    SwtisMigrationOpcodeFixedToInt,
+    SwtisMigrationOpcodeValue,
+    SwtisMigrationOpcodeList,
+} SwtisMigrationOpcode;
+
+struct SwtisMigrationTable;
+
+/// Copy: `size` octets. IntToFixed and FixedToInt: a `size` octet integer, an Int that does not fit as Fixed fails
+/// the migration. Value: migrate a nested value with `table`. List: a new list with every item migrated by
+/// `table`. Fields that only exist in the new type are not mentioned and keep their default (zero).
+typedef struct SwtisMigrationOp {
+    uint8_t opcode;
+    uint32_t oldOffset;
+    uint32_t newOffset;
+    uint32_t size;
+    const struct SwtisMigrationTable* table;
+} SwtisMigrationOp;
+
+typedef struct SwtisMigrationOps {
+    const SwtisMigrationOp* ops;
+    size_t opCount;
+} SwtisMigrationOps;
+
+typedef struct SwtisMigrationVariant {
+    uint8_t newVariantIndex;
+    SwtisMigrationOps fields;
+} SwtisMigrationVariant;
+
+typedef struct SwtisMigrationTable {
+    const struct SwtiType* oldType;
+    const struct SwtiType* newType;
+    size_t oldMemorySize;
+    size_t newMemorySize;
+    // The memory layout is the same, values can be copied as is
+    int isIdentical;
+    // Records and tuples
+    SwtisMigrationOps fields;
+    // Custom types, indexed by the old variant index
+    const SwtisMigrationVariant* variants;
+    size_t variantCount;
+    struct SwtisMigrationTable* next;
+    // The table built before this one, so a failed prepare can remove what it built
+    struct SwtisMigrationTable* builtBefore;
+} SwtisMigrationTable;
+
+typedef struct SwtisMigrationNamedType {
+    const char* name;
+    const struct SwtiType* type;
+} SwtisMigrationNamedType;
+
+/// The variant `oldVariantName` of the old custom type `customTypeName` is migrated to the new variant
+/// `newVariantName`. Several old variants can be renamed to the same new variant.
+typedef struct SwtisMigrationVariantRename {
+    const char* customTypeName;
+    const char* oldVariantName;
+    const char* newVariantName;
+} SwtisMigrationVariantRename;
+
+/// Matches types between an old and a new chunk and keeps the migration tables built so far.
+/// Custom types and aliases are matched by name, record fields by name, tuple and variant fields by position and
+/// variants by name, or by the variant renames. An old variant that matches no new variant fails the prepare.
+typedef struct SwtisMigration {
+    const struct SwtiChunk* oldChunk;
+    const struct SwtiChunk* newChunk;
+    SwtisMigrationTable** tablesByOldIndex;
+    SwtisMigrationNamedType* newNamedTypes;
+    size_t newNamedTypeCount;
+    const SwtisMigrationVariantRename* variantRenames;
+    size_t variantRenameCount;
+    SwtisMigrationTable* lastBuilt;
+    struct ImprintAllocator* allocator;
+} SwtisMigration;
+
+int swtisMigrationInit(SwtisMigration* self, const struct SwtiChunk* oldChunk, const struct SwtiChunk* newChunk,
+                       struct ImprintAllocator* allocator);
+void swtisMigrationSetVariantRenames(SwtisMigration* self, const SwtisMigrationVariantRename* renames, size_t count);
+const struct SwtiType* swtisMigrationFindNewType(const SwtisMigration* self, const char* name);
+int swtisMigrationPrepare(SwtisMigration* self, const struct SwtiType* oldType, const struct SwtiType* newType,
+                          const SwtisMigrationTable** outTable);
+int swtisMigrationPrepareByName(SwtisMigration* self, const struct SwtiType* oldType,
+                                const SwtisMigrationTable** outTable);
+
+int swtisMigrateValues(const SwtisMigrationTable* table, const void* oldValues, size_t count, void* newValues,
+                       struct ImprintAllocator* allocator);
+
+#endif
@@ -0,0 +1,43 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_NAMES_H
+#define SWAMP_TYPEINFO_SERIALIZE_NAMES_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiChunk;
+
+/// Looks up names in the names section of sectioned typeinfo (see SWTIS_FORMAT_FLAG_SECTIONED), for chunks that
+/// were deserialized with `lazyNames`. Nothing is read, or mapped in from the file, until the first lookup.
+/// Not thread safe.
+typedef struct SwtisNames {
+    const struct SwtiChunk* chunk;
+    const uint8_t* octets;
+    size_t octetCount;
+    // Built on the first lookup
+    uint16_t* firstNameIndices;
+    uint32_t* nameOffsets;
+    // Only when created from a file
+    int fd;
+    size_t fileOffset;
+    void* mapping;
+    size_t mappingSize;
+} SwtisNames;
+
+/// `octets` is the whole serialized typeinfo and must outlive `self`. Returns -1 if the names were stripped.
+int swtisNamesInit(SwtisNames* self, const struct SwtiChunk* chunk, const uint8_t* octets, size_t octetCount);
+/// Only reads the section directory from the file. The names section is mapped in on the first lookup. POSIX only.
+int swtisNamesInitFromFile(SwtisNames* self, const struct SwtiChunk* chunk, const char* path);
+void swtisNamesDestroy(SwtisNames* self);
+
+/// The name of a custom type, variant, alias or unmanaged type. Returns 0 for other types.
+const char* swtisNamesType(SwtisNames* self, size_t typeIndex);
+const char* swtisNamesRecordField(SwtisNames* self, size_t typeIndex, size_t fieldIndex);
+
+/// Sets all the names in `chunk`. They point into the names section, so `self` must outlive the chunk.
+int swtisNamesApply(SwtisNames* self, struct SwtiChunk* chunk);
+
+#endif
@@ -0,0 +1,75 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_PLAN_H
+#define SWAMP_TYPEINFO_SERIALIZE_PLAN_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiChunk;
+struct SwtiType;
+struct FldInStream;
+struct FldOutStream;
+struct ImprintAllocator;
+
+typedef enum SwtisPlanOpcode {
+    SwtisPlanOpcodeCopy,
+    SwtisPlanOpcodeScalar,
+    SwtisPlanOpcodeString,
+    SwtisPlanOpcodeBlob,
+    SwtisPlanOpcodeList,
+    SwtisPlanOpcodeVariant,
+    SwtisPlanOpcodeJump,
+    SwtisPlanOpcodeEnd,
+} SwtisPlanOpcode;
+
+struct SwtisPlan;
+
+/// Copy and Scalar: `size` octets at `offset`.
+/// List: item plan for the list at `offset`, `size` is the item stride and `target` the item alignment.
+/// Variant: tag at `offset`, `size` variant count, `target` is the start in the jump table.
+/// Jump: continue at op `target`.
+typedef struct SwtisPlanOp {
+    uint8_t opcode;
+    uint32_t offset;
+    uint32_t size;
+    uint32_t target;
+    const struct SwtisPlan* itemPlan;
+} SwtisPlanOp;
+
+typedef struct SwtisPlan {
+    const struct SwtiType* type;
+    const SwtisPlanOp* ops;
+    size_t opCount;
+    const uint32_t* jumpTable;
+    size_t jumpTableCount;
+    size_t memorySize;
+    size_t minimumWireSize;
+    // Only Copy ops, so the wire size is the same for all values
+    int isFlat;
+    size_t flatWireSize;
+    // A single Copy that covers the whole value, so arrays of it can be copied in one go
+    int isContiguous;
+} SwtisPlan;
+
+/// Plans are compiled on first use and kept for the lifetime of the cache, one per type index.
+/// Compilation is not thread safe, call swtisPlanCacheCompileAll() before sharing the cache between threads.
+typedef struct SwtisPlanCache {
+    const struct SwtiChunk* chunk;
+    SwtisPlan** plans;
+    struct ImprintAllocator* allocator;
+} SwtisPlanCache;
+
+int swtisPlanCacheInit(SwtisPlanCache* self, const struct SwtiChunk* chunk, struct ImprintAllocator* allocator);
+int swtisPlanCacheGet(SwtisPlanCache* self, const struct SwtiType* type, const SwtisPlan** outPlan);
+int swtisPlanCacheCompileAll(SwtisPlanCache* self);
+
+int swtisPlanSerializeValue(const SwtisPlan* plan, struct FldOutStream* stream, const void* value);
+int swtisPlanSerializeValues(const SwtisPlan* plan, struct FldOutStream* stream, const void* values, size_t count,
+                             size_t stride);
+int swtisPlanDeserializeValue(const SwtisPlan* plan, struct FldInStream* stream, void* target,
+                              struct ImprintAllocator* allocator);
+
+#endif
@@ -0,0 +1,22 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_POOL_INTERNAL_H
+#define SWAMP_TYPEINFO_SERIALIZE_POOL_INTERNAL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// Small work-stealing thread pool shared by the bulk functions, do not use directly
+
+#define SWTIS_POOL_MAX_THREAD_COUNT (64)
+
+typedef void (*SwtisPoolTaskFn)(void* userData, size_t taskIndex, size_t workerIndex);
+
+/// Runs `taskFn` once for every task index in [0, taskCount) on up to `threadCount` threads, the calling thread
+/// included, and returns when all tasks are done. Tasks are handed out as one range per worker; a worker that runs
+/// out steals half of the remaining range of another worker.
+int swtisPoolRun(size_t taskCount, size_t threadCount, SwtisPoolTaskFn taskFn, void* userData);
+
+#endif
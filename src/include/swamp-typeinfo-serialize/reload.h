@@ -0,0 +1,59 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_RELOAD_H
+#define SWAMP_TYPEINFO_SERIALIZE_RELOAD_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiChunk;
+struct SwtisDeserializeOptions;
+
+// Hot reload without stopping the readers. The reloader has two arenas: one holds the current chunk, the other the
+// previous chunk until no reader can be using it anymore, and then the next one.
+//
+// Readers never block. Each reader thread registers once and brackets its use of the chunk with
+// swtisReloadReaderEnter() and swtisReloadReaderLeave(). Leaving is the quiescent point: pointers into the chunk must
+// not be kept past it. A reload publishes the new chunk with one atomic store and starts a new epoch. The previous
+// arena can be reused once every reader has left or entered again in the new epoch.
+
+/// Memory reserved per octet of serialized typeinfo for each arena.
+#define SWTIS_RELOAD_MEMORY_FACTOR (64)
+
+/// Opaque, since they hold atomics.
+typedef struct SwtisReloader SwtisReloader;
+typedef struct SwtisReloadReader SwtisReloadReader;
+
+typedef struct SwtisReloaderOptions {
+    // Maximum number of reader threads registered at the same time
+    size_t maxReaderCount;
+    // Optional, used for every reload. `dependents` and `unmanagedTable` are not supported here.
+    const struct SwtisDeserializeOptions* deserializeOptions;
+} SwtisReloaderOptions;
+
+SwtisReloader* swtisReloaderCreate(const SwtisReloaderOptions* options);
+/// All readers must have been unregistered.
+void swtisReloaderDestroy(SwtisReloader* self);
+
+/// Deserializes `octets` into the free arena and publishes it. `octets` are copied. Call from one thread at a time.
+/// Returns the number of octets read, or -4 if a reader might still be using the previous chunk, try again later. On
+/// error, the current chunk is kept.
+int swtisReloaderReload(SwtisReloader* self, const uint8_t* octets, size_t octetCount);
+/// Returns 1 if the arena of the previous chunk is free, so the next reload will not return -4.
+int swtisReloaderCollect(SwtisReloader* self);
+/// Increases with every successful reload, starts at zero.
+uint64_t swtisReloaderGeneration(SwtisReloader* self);
+
+/// Returns -4 if `maxReaderCount` readers are already registered.
+int swtisReloadReaderRegister(SwtisReloader* self, SwtisReloadReader** outReader);
+/// Must not be entered.
+void swtisReloadReaderUnregister(SwtisReloadReader* reader);
+
+/// Returns the current chunk, or zero if nothing has been loaded yet. It stays valid until swtisReloadReaderLeave().
+/// Enter and leave can not be nested.
+const struct SwtiChunk* swtisReloadReaderEnter(SwtisReloadReader* reader);
+void swtisReloadReaderLeave(SwtisReloadReader* reader);
+
+#endif
@@ -0,0 +1,51 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_SECTIONS_INTERNAL_H
+#define SWAMP_TYPEINFO_SERIALIZE_SECTIONS_INTERNAL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiType;
+struct SwtiChunk;
+struct ImprintAllocator;
+
+#define SWTIS_SECTIONS_MAX_COUNT (16)
+#define SWTIS_SECTIONS_HEADER_OCTET_COUNT (6)
+#define SWTIS_SECTIONS_ENTRY_OCTET_COUNT (9)
+
+typedef struct SwtisSection {
+    uint8_t id;
+    uint32_t offset;
+    uint32_t octetCount;
+} SwtisSection;
+
+typedef struct SwtisSectionDirectory {
+    SwtisSection sections[SWTIS_SECTIONS_MAX_COUNT];
+    size_t sectionCount;
+    // Octets used by the header and the directory
+    size_t octetCount;
+    // Octets up to the end of the last section
+    size_t totalOctetCount;
+} SwtisSectionDirectory;
+
+/// Reads the header and section directory from the start of a sectioned typeinfo. Returns -1 if `octets` ends
+/// before the directory does.
+int swtisSectionDirectoryRead(SwtisSectionDirectory* self, const uint8_t* octets, size_t octetCount);
+const SwtisSection* swtisSectionDirectoryFind(const SwtisSectionDirectory* self, uint8_t id);
+
+/// The names of a type, in the order they are written in the names section.
+size_t swtisSectionNameCount(const struct SwtiType* type);
+const char** swtisSectionNameAt(struct SwtiType* type, size_t index);
+
+/// Finds where each name starts in a names section. Returns the name count, or a negative value if the section is
+/// malformed or has more than `maxCount` names.
+int swtisSectionNamesFind(const uint8_t* octets, size_t octetCount, uint32_t* outOffsets, size_t maxCount);
+/// Sets all the names in the chunk from a names section. The names are copied if `allocator` is set, otherwise they
+/// point into `octets`.
+int swtisSectionNamesApply(struct SwtiChunk* chunk, const uint8_t* octets, size_t octetCount,
+                           struct ImprintAllocator* allocator);
+
+#endif
@@ -0,0 +1,17 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_SERIALIZE_INTERNAL_H
+#define SWAMP_TYPEINFO_SERIALIZE_SERIALIZE_INTERNAL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiType;
+
+/// The number of octets `type` is serialized to with `formatFlags`, names included unless sectioned. Zero if the
+/// type is unknown.
+size_t swtisSerializeTypeOctetCount(uint8_t formatFlags, const struct SwtiType* type);
+
+#endif
@@ -0,0 +1,47 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_UNMANAGED_H
+#define SWAMP_TYPEINFO_SERIALIZE_UNMANAGED_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiChunk;
+struct SwtiUnmanagedType;
+struct ImprintAllocator;
+
+typedef struct SwtisUnmanagedEntry {
+    // Zero if no unmanaged type in the chunk has this id
+    const struct SwtiUnmanagedType* type;
+    // Set by the host with swtisUnmanagedTableSetHandler(), zero until then
+    void* handler;
+} SwtisUnmanagedEntry;
+
+/// Unmanaged types indexed by userTypeId, built by the deserializer when SwtisDeserializeOptions::unmanagedTable is
+/// set. `count` is one more than the highest userTypeId in the chunk, or zero if there are no unmanaged types.
+typedef struct SwtisUnmanagedTable {
+    SwtisUnmanagedEntry* entries;
+    size_t count;
+} SwtisUnmanagedTable;
+
+/// Builds the table for an already deserialized chunk, allocated from `allocator`.
+/// Returns -6 if two unmanaged types have the same userTypeId.
+int swtisUnmanagedTableBuild(SwtisUnmanagedTable* target, const struct SwtiChunk* chunk,
+                             struct ImprintAllocator* allocator);
+
+/// Returns -1 if there is no unmanaged type with that id.
+int swtisUnmanagedTableSetHandler(SwtisUnmanagedTable* self, uint16_t userTypeId, void* handler);
+
+/// Returns zero if there is no unmanaged type with that id.
+static inline const SwtisUnmanagedEntry* swtisUnmanagedTableFind(const SwtisUnmanagedTable* self, uint16_t userTypeId)
+{
+    if (userTypeId >= self->count || self->entries[userTypeId].type == 0) {
+        return 0;
+    }
+
+    return &self->entries[userTypeId];
+}
+
+#endif
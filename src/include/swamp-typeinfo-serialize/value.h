@@ -0,0 +1,49 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_VALUE_H
+#define SWAMP_TYPEINFO_SERIALIZE_VALUE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+struct SwtiType;
+struct FldInStream;
+struct FldOutStream;
+struct ImprintAllocator;
+
+/// String, Blob, List and Array values are stored in VM memory as a pointer to one of these.
+typedef struct SwtisValueString {
+    const char* characters;
+    size_t characterCount;
+} SwtisValueString;
+
+typedef struct SwtisValueBlob {
+    const uint8_t* octets;
+    size_t octetCount;
+} SwtisValueBlob;
+
+/// Used for both List and Array. Items are stored back to back, itemSize apart.
+typedef struct SwtisValueList {
+    const void* value;
+    size_t count;
+    size_t itemSize;
+    size_t itemAlign;
+} SwtisValueList;
+
+#define SWTIS_VALUE_MAX_DEPTH (128)
+// Items that take no octets on the wire, like empty records, can not be bounded by the stream size
+#define SWTIS_VALUE_MAX_EMPTY_ITEM_COUNT (64 * 1024)
+
+/// Value wire format:
+///  Int, Fixed, Bool, Char - the memory size of the primitive, little endian.
+///  String, Blob           - uint32 count followed by the octets.
+///  List, Array            - uint32 count followed by each item.
+///  Record, Tuple          - each field in declaration order, no padding.
+///  Custom                 - uint8 variant index followed by the fields of that variant.
+int swtisSerializeValue(struct FldOutStream* stream, const struct SwtiType* type, const void* value);
+int swtisDeserializeValue(struct FldInStream* stream, const struct SwtiType* type, void* target,
+                          struct ImprintAllocator* allocator);
+
+#endif
@@ -0,0 +1,95 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_VALUE_INTERNAL_H
+#define SWAMP_TYPEINFO_SERIALIZE_VALUE_INTERNAL_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <swamp-typeinfo/typeinfo.h>
+
+// Shared by the value codecs, do not use directly
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define SWTIS_VALUE_HOST_IS_LITTLE_ENDIAN (0)
+#else
+#define SWTIS_VALUE_HOST_IS_LITTLE_ENDIAN (1)
+#endif
+
+static inline const SwtiType* swtisValueUnalias(const SwtiType* type)
+{
+    for (size_t depth = 0; depth < 256 && type->type == SwtiTypeAlias; ++depth) {
+        type = ((const SwtiAliasType*) type)->targetType;
+    }
+
+    return type;
+}
+
+static inline int swtisValueIsScalar(SwtiTypeValue typeValue)
+{
+    switch (typeValue) {
+        case SwtiTypeInt:
+        case SwtiTypeFixed:
+        case SwtiTypeBoolean:
+        case SwtiTypeChar:
+        case SwtiTypeResourceName:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+/// Copies a scalar between host memory and little endian wire order.
+static inline void swtisValueCopyScalar(uint8_t* target, const uint8_t* source, size_t size)
+{
+#if SWTIS_VALUE_HOST_IS_LITTLE_ENDIAN
+    for (size_t i = 0; i < size; ++i) {
+        target[i] = source[i];
+    }
+#else
+    for (size_t i = 0; i < size; ++i) {
+        target[i] = source[size - 1 - i];
+    }
+#endif
+}
+
+static inline void swtisValueWriteUInt32(uint8_t* target, uint32_t value)
+{
+    target[0] = (uint8_t) value;
+    target[1] = (uint8_t) (value >> 8);
+    target[2] = (uint8_t) (value >> 16);
+    target[3] = (uint8_t) (value >> 24);
+}
+
+static inline uint32_t swtisValueReadUInt32(const uint8_t* source)
+{
+    return (uint32_t) source[0] | ((uint32_t) source[1] << 8) | ((uint32_t) source[2] << 16) |
+           ((uint32_t) source[3] << 24);
+}
+
+/// Values are written to and read from host memory, so a reference must have the size of a host pointer.
+static inline int swtisValueCheckReferenceSlot(const SwtiMemoryInfo* slot)
+{
+    if (slot != 0 && slot->memorySize != sizeof(void*)) {
+        return -4;
+    }
+
+    return 0;
+}
+
+int swtisValueScalarSize(const SwtiType* type, const SwtiMemoryInfo* slot, size_t* outSize);
+int swtisValueMemorySize(const SwtiType* type, const SwtiMemoryInfo* slot, size_t* outSize);
+size_t swtisValueMinimumWireSize(const SwtiType* type, const SwtiMemoryInfo* slot);
+
+struct FldInStream;
+struct FldOutStream;
+struct ImprintAllocator;
+
+int swtisValueSerializeInSlot(struct FldOutStream* stream, const SwtiType* type, const SwtiMemoryInfo* slot,
+                              const void* value);
+int swtisValueDeserializeInSlot(struct FldInStream* stream, const SwtiType* type, const SwtiMemoryInfo* slot,
+                                void* target, struct ImprintAllocator* allocator);
+
+#endif
@@ -0,0 +1,53 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_VIEW_H
+#define SWAMP_TYPEINFO_SERIALIZE_VIEW_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <swamp-typeinfo/typeinfo.h>
+
+struct FldOutStream;
+
+/// View wire format. Same as the value wire format (see value.h), except that the parts that do not have the same
+/// size for every value get a table of uint32 little endian offsets, so any part can be reached without reading the
+/// ones before it:
+///  Record, Tuple - if any field varies in size: one offset per field, relative to the start of the record.
+///  Custom        - uint8 variant index, then the variant fields laid out like a tuple.
+///  List, Array   - uint32 count. If the item varies in size: one offset per item, relative to the start of the list.
+/// Int, Fixed, Bool and Char, and records, tuples and custom types made only of them (where all variants have the
+/// same size), have a fixed size and need no table.
+int swtisViewSerializeValue(struct FldOutStream* stream, const struct SwtiType* type, const void* value);
+
+/// A typed window into a buffer written by swtisViewSerializeValue(). Nothing is copied or allocated.
+typedef struct SwtisView {
+    const struct SwtiType* type;
+    // The field or list that holds the value, zero for the top level value. Scalars take their size from it.
+    const SwtiMemoryInfo* slot;
+    const uint8_t* octets;
+    size_t octetCount;
+} SwtisView;
+
+int swtisViewInit(SwtisView* self, const struct SwtiType* type, const uint8_t* octets, size_t octetCount);
+
+/// Record and tuple fields.
+int swtisViewField(const SwtisView* self, size_t fieldIndex, SwtisView* outField);
+int swtisViewFieldByName(const SwtisView* self, const char* name, SwtisView* outField);
+
+/// Custom types.
+int swtisViewVariant(const SwtisView* self, uint8_t* outVariantIndex);
+int swtisViewVariantField(const SwtisView* self, size_t fieldIndex, SwtisView* outField);
+
+/// Lists and arrays.
+int swtisViewListCount(const SwtisView* self, size_t* outCount);
+int swtisViewListItem(const SwtisView* self, size_t index, SwtisView* outItem);
+
+/// Copies an Int, Fixed, Bool or Char into `target`, using the memory size of the field or list that holds it.
+int swtisViewScalar(const SwtisView* self, void* target);
+/// Points into the buffer for a String or Blob.
+int swtisViewOctets(const SwtisView* self, const uint8_t** outOctets, size_t* outCount);
+
+#endif
@@ -0,0 +1,559 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <swamp-typeinfo-serialize/archive.h>
+#include <swamp-typeinfo-serialize/crc32c_internal.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo-serialize/format.h>
+#include <swamp-typeinfo-serialize/sections_internal.h>
+#include <swamp-typeinfo-serialize/serialize.h>
+#include <swamp-typeinfo/chunk.h>
+#include <swamp-typeinfo/typeinfo.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <tiny-libc/tiny_libc.h>
+#include <unistd.h>
+
+/// Serializing a chunk that needs more than this is treated as an error rather than a full buffer.
+#define SWTIS_ARCHIVE_MAX_CHUNK_OCTET_COUNT (16 * 1024 * 1024)
+
+typedef struct ArchiveBuffer {
+    uint8_t* octets;
+    size_t count;
+    size_t capacity;
+} ArchiveBuffer;
+
+typedef struct ArchiveWriterModule {
+    uint32_t nameOffset;
+    size_t chunkOffset;
+    size_t chunkOctetCount;
+    uint32_t hash;
+    size_t firstNameReference;
+    size_t nameCount;
+} ArchiveWriterModule;
+
+struct SwtisArchiveWriter {
+    uint8_t formatFlags;
+    ArchiveWriterModule* modules;
+    size_t moduleCount;
+    size_t moduleCapacity;
+    ArchiveBuffer chunks;
+    ArchiveBuffer strings;
+    uint32_t* nameReferences;
+    size_t nameReferenceCount;
+    size_t nameReferenceCapacity;
+    // Open addressing table of string table offsets + 1, zero is empty
+    uint32_t* stringSlots;
+    size_t stringSlotCount;
+    size_t stringCount;
+};
+
+static void bufferReserve(ArchiveBuffer* buffer, size_t extra)
+{
+    if (buffer->count + extra <= buffer->capacity) {
+        return;
+    }
+
+    size_t newCapacity = buffer->capacity == 0 ? 256 : buffer->capacity * 2;
+    while (newCapacity < buffer->count + extra) {
+        newCapacity *= 2;
+    }
+
+    uint8_t* newOctets = tc_malloc(newCapacity);
+    if (buffer->count > 0) {
+        tc_memcpy_octets(newOctets, buffer->octets, buffer->count);
+    }
+    tc_free(buffer->octets);
+    buffer->octets = newOctets;
+    buffer->capacity = newCapacity;
+}
+
+static uint32_t readUInt32(const uint8_t* octets)
+{
+    return ((uint32_t) octets[0] << 24) | ((uint32_t) octets[1] << 16) | ((uint32_t) octets[2] << 8) | octets[3];
+}
+
+static void writeUInt32(uint8_t* octets, uint32_t value)
+{
+    octets[0] = (uint8_t) (value >> 24);
+    octets[1] = (uint8_t) (value >> 16);
+    octets[2] = (uint8_t) (value >> 8);
+    octets[3] = (uint8_t) value;
+}
+
+static uint32_t hashString(const char* s)
+{
+    uint32_t hash = 0x811c9dc5u;
+    for (const uint8_t* p = (const uint8_t*) s; *p != 0; ++p) {
+        hash ^= *p;
+        hash *= 0x01000193u;
+    }
+
+    return hash;
+}
+
+static void rehashStrings(SwtisArchiveWriter* self, size_t slotCount)
+{
+    uint32_t* slots = tc_malloc_type_count(uint32_t, slotCount);
+    tc_mem_clear_type_n(slots, slotCount);
+
+    for (size_t i = 0; i < self->stringSlotCount; ++i) {
+        uint32_t entry = self->stringSlots[i];
+        if (entry == 0) {
+            continue;
+        }
+        size_t slot = hashString((const char*) self->strings.octets + entry - 1) & (slotCount - 1);
+        while (slots[slot] != 0) {
+            slot = (slot + 1) & (slotCount - 1);
+        }
+        slots[slot] = entry;
+    }
+
+    tc_free(self->stringSlots);
+    self->stringSlots = slots;
+    self->stringSlotCount = slotCount;
+}
+
+/// Returns the string table offset of `s`, adding it if it is not there already.
+static uint32_t addString(SwtisArchiveWriter* self, const char* s)
+{
+    if (s == 0) {
+        s = "";
+    }
+
+    // At most half full, so probe sequences stay short
+    if ((self->stringCount + 1) * 2 > self->stringSlotCount) {
+        rehashStrings(self, self->stringSlotCount * 2);
+    }
+
+    size_t mask = self->stringSlotCount - 1;
+    size_t slot = hashString(s) & mask;
+    while (self->stringSlots[slot] != 0) {
+        uint32_t offset = self->stringSlots[slot] - 1;
+        if (strcmp((const char*) self->strings.octets + offset, s) == 0) {
+            return offset;
+        }
+        slot = (slot + 1) & mask;
+    }
+
+    size_t length = tc_strlen(s);
+    uint32_t offset = (uint32_t) self->strings.count;
+    bufferReserve(&self->strings, length + 1);
+    tc_memcpy_octets(self->strings.octets + self->strings.count, s, length + 1);
+    self->strings.count += length + 1;
+
+    self->stringSlots[slot] = offset + 1;
+    self->stringCount++;
+
+    return offset;
+}
+
+static void addNameReference(SwtisArchiveWriter* self, uint32_t offset)
+{
+    if (self->nameReferenceCount == self->nameReferenceCapacity) {
+        size_t newCapacity = self->nameReferenceCapacity == 0 ? 256 : self->nameReferenceCapacity * 2;
+        uint32_t* newReferences = tc_malloc_type_count(uint32_t, newCapacity);
+        if (self->nameReferenceCount > 0) {
+            tc_memcpy_octets(newReferences, self->nameReferences, self->nameReferenceCount * sizeof(uint32_t));
+        }
+        tc_free(self->nameReferences);
+        self->nameReferences = newReferences;
+        self->nameReferenceCapacity = newCapacity;
+    }
+
+    self->nameReferences[self->nameReferenceCount++] = offset;
+}
+
+static int serializeChunk(SwtisArchiveWriter* self, const SwtiChunk* chunk)
+{
+    SwtisSerializeOptions options;
+    options.formatFlags = self->formatFlags;
+    options.stripNames = 1;
+    options.threadCount = 0;
+
+    bufferReserve(&self->chunks, 1024);
+
+    for (;;) {
+        size_t available = self->chunks.capacity - self->chunks.count;
+        int octetsWritten = swtisSerializeWithOptions(self->chunks.octets + self->chunks.count, available, chunk,
+                                                      &options);
+        if (octetsWritten >= 0) {
+            self->chunks.count += (size_t) octetsWritten;
+            return octetsWritten;
+        }
+        if (octetsWritten != -1 || available >= SWTIS_ARCHIVE_MAX_CHUNK_OCTET_COUNT) {
+            return octetsWritten;
+        }
+        // The buffer was full
+        bufferReserve(&self->chunks, available * 2);
+    }
+}
+
+SwtisArchiveWriter* swtisArchiveWriterCreate(uint8_t formatFlags)
+{
+    SwtisArchiveWriter* self = tc_malloc_type(SwtisArchiveWriter);
+    tc_mem_clear_type(self);
+
+    self->formatFlags = formatFlags | SWTIS_FORMAT_FLAG_SECTIONED;
+    self->stringSlotCount = 256;
+    self->stringSlots = tc_malloc_type_count(uint32_t, self->stringSlotCount);
+    tc_mem_clear_type_n(self->stringSlots, self->stringSlotCount);
+
+    return self;
+}
+
+void swtisArchiveWriterDestroy(SwtisArchiveWriter* self)
+{
+    tc_free(self->modules);
+    tc_free(self->chunks.octets);
+    tc_free(self->strings.octets);
+    tc_free(self->nameReferences);
+    tc_free(self->stringSlots);
+    tc_free(self);
+}
+
+int swtisArchiveWriterAdd(SwtisArchiveWriter* self, const char* moduleName, const SwtiChunk* chunk)
+{
+    if (self->moduleCount == self->moduleCapacity) {
+        size_t newCapacity = self->moduleCapacity == 0 ? 64 : self->moduleCapacity * 2;
+        ArchiveWriterModule* newModules = tc_malloc_type_count(ArchiveWriterModule, newCapacity);
+        if (self->moduleCount > 0) {
+            tc_memcpy_octets(newModules, self->modules, self->moduleCount * sizeof(ArchiveWriterModule));
+        }
+        tc_free(self->modules);
+        self->modules = newModules;
+        self->moduleCapacity = newCapacity;
+    }
+
+    size_t chunkOffset = self->chunks.count;
+    int octetsWritten = serializeChunk(self, chunk);
+    if (octetsWritten < 0) {
+        CLOG_SOFT_ERROR("archive: could not serialize module '%s' (%d)", moduleName, octetsWritten)
+        return octetsWritten;
+    }
+
+    ArchiveWriterModule* module = &self->modules[self->moduleCount];
+    module->nameOffset = addString(self, moduleName);
+    module->chunkOffset = chunkOffset;
+    module->chunkOctetCount = (size_t) octetsWritten;
+    module->hash = swtisCrc32cUpdate(0, self->chunks.octets + chunkOffset, module->chunkOctetCount);
+    module->firstNameReference = self->nameReferenceCount;
+
+    for (size_t i = 0; i < chunk->typeCount; ++i) {
+        SwtiType* type = (SwtiType*) chunk->types[i];
+        size_t nameCount = swtisSectionNameCount(type);
+        for (size_t j = 0; j < nameCount; ++j) {
+            addNameReference(self, addString(self, *swtisSectionNameAt(type, j)));
+        }
+    }
+    module->nameCount = self->nameReferenceCount - module->firstNameReference;
+
+    self->moduleCount++;
+
+    return 0;
+}
+
+static size_t nameReferencesOffset(const SwtisArchiveWriter* self)
+{
+    return SWTIS_ARCHIVE_HEADER_OCTET_COUNT + self->moduleCount * SWTIS_ARCHIVE_INDEX_ENTRY_OCTET_COUNT;
+}
+
+static size_t stringsOffset(const SwtisArchiveWriter* self)
+{
+    return nameReferencesOffset(self) + self->nameReferenceCount * 4;
+}
+
+static size_t chunksOffset(const SwtisArchiveWriter* self)
+{
+    return stringsOffset(self) + self->strings.count;
+}
+
+size_t swtisArchiveWriterOctetCount(const SwtisArchiveWriter* self)
+{
+    return chunksOffset(self) + self->chunks.count;
+}
+
+typedef struct SortedModule {
+    const char* name;
+    const ArchiveWriterModule* module;
+} SortedModule;
+
+static int compareSortedModules(const void* a, const void* b)
+{
+    return strcmp(((const SortedModule*) a)->name, ((const SortedModule*) b)->name);
+}
+
+int swtisArchiveWriterWrite(const SwtisArchiveWriter* self, uint8_t* octets, size_t maxCount)
+{
+    size_t octetCount = swtisArchiveWriterOctetCount(self);
+    if (octetCount > maxCount) {
+        return -1;
+    }
+    if (octetCount > 0x7fffffff) {
+        CLOG_SOFT_ERROR("archive: too large, %zu octets", octetCount)
+        return -4;
+    }
+
+    SortedModule* sorted = tc_malloc_type_count(SortedModule, self->moduleCount + 1);
+    for (size_t i = 0; i < self->moduleCount; ++i) {
+        sorted[i].name = (const char*) self->strings.octets + self->modules[i].nameOffset;
+        sorted[i].module = &self->modules[i];
+    }
+    qsort(sorted, self->moduleCount, sizeof(SortedModule), compareSortedModules);
+
+    for (size_t i = 1; i < self->moduleCount; ++i) {
+        if (sorted[i - 1].module->nameOffset == sorted[i].module->nameOffset) {
+            CLOG_SOFT_ERROR("archive: module '%s' was added more than once", sorted[i].name)
+            tc_free(sorted);
+            return -6;
+        }
+    }
+
+    uint8_t* p = octets;
+    p[0] = 'S';
+    p[1] = 'W';
+    p[2] = 'T';
+    p[3] = 'A';
+    p[4] = SWTIS_ARCHIVE_VERSION;
+    p[5] = 0;
+    p[6] = 0;
+    p[7] = 0;
+    writeUInt32(p + 8, (uint32_t) self->moduleCount);
+    writeUInt32(p + 12, (uint32_t) stringsOffset(self));
+    writeUInt32(p + 16, (uint32_t) self->strings.count);
+    p += SWTIS_ARCHIVE_HEADER_OCTET_COUNT;
+
+    size_t referencesOffset = nameReferencesOffset(self);
+    size_t moduleChunksOffset = chunksOffset(self);
+    for (size_t i = 0; i < self->moduleCount; ++i) {
+        const ArchiveWriterModule* module = sorted[i].module;
+        writeUInt32(p, module->nameOffset);
+        writeUInt32(p + 4, (uint32_t) (moduleChunksOffset + module->chunkOffset));
+        writeUInt32(p + 8, (uint32_t) module->chunkOctetCount);
+        writeUInt32(p + 12, module->hash);
+        writeUInt32(p + 16, (uint32_t) (referencesOffset + module->firstNameReference * 4));
+        writeUInt32(p + 20, (uint32_t) module->nameCount);
+        p += SWTIS_ARCHIVE_INDEX_ENTRY_OCTET_COUNT;
+    }
+
+    tc_free(sorted);
+
+    for (size_t i = 0; i < self->nameReferenceCount; ++i) {
+        writeUInt32(p, self->nameReferences[i]);
+        p += 4;
+    }
+
+    if (self->strings.count > 0) {
+        tc_memcpy_octets(p, self->strings.octets, self->strings.count);
+        p += self->strings.count;
+    }
+
+    if (self->chunks.count > 0) {
+        tc_memcpy_octets(p, self->chunks.octets, self->chunks.count);
+        p += self->chunks.count;
+    }
+
+    return (int) (p - octets);
+}
+
+int swtisArchiveInit(SwtisArchive* self, const uint8_t* octets, size_t octetCount)
+{
+    self->octets = 0;
+    self->octetCount = 0;
+    self->moduleCount = 0;
+    self->strings = 0;
+    self->stringsOctetCount = 0;
+    self->mapping = 0;
+
+    if (octetCount < SWTIS_ARCHIVE_HEADER_OCTET_COUNT || octets[0] != 'S' || octets[1] != 'W' || octets[2] != 'T' ||
+        octets[3] != 'A') {
+        CLOG_SOFT_ERROR("archive: not a typeinfo archive")
+        return -6;
+    }
+
+    if (octets[4] != SWTIS_ARCHIVE_VERSION) {
+        CLOG_SOFT_ERROR("archive: wrong version %d", octets[4])
+        return -2;
+    }
+
+    size_t moduleCount = readUInt32(octets + 8);
+    size_t stringsStart = readUInt32(octets + 12);
+    size_t stringsOctetCount = readUInt32(octets + 16);
+
+    if (moduleCount > (octetCount - SWTIS_ARCHIVE_HEADER_OCTET_COUNT) / SWTIS_ARCHIVE_INDEX_ENTRY_OCTET_COUNT ||
+        stringsStart > octetCount || stringsOctetCount > octetCount - stringsStart) {
+        CLOG_SOFT_ERROR("archive: index or string table ends after the archive")
+        return -6;
+    }
+
+    // Then every string table offset is the start of a terminated string
+    if (stringsOctetCount > 0 && octets[stringsStart + stringsOctetCount - 1] != 0) {
+        CLOG_SOFT_ERROR("archive: string table is not terminated")
+        return -6;
+    }
+
+    self->octets = octets;
+    self->octetCount = octetCount;
+    self->moduleCount = moduleCount;
+    self->strings = (const char*) octets + stringsStart;
+    self->stringsOctetCount = stringsOctetCount;
+
+    return 0;
+}
+
+int swtisArchiveInitFromFile(SwtisArchive* self, const char* path)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        CLOG_SOFT_ERROR("archive: could not open '%s' (%d)", path, errno)
+        return -1;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        CLOG_SOFT_ERROR("archive: '%s' is empty or can not be read", path)
+        close(fd);
+        return -1;
+    }
+
+    size_t octetCount = (size_t) info.st_size;
+    void* mapping = mmap(0, octetCount, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED) {
+        CLOG_SOFT_ERROR("archive: could not map '%s' (%d)", path, errno)
+        return -1;
+    }
+
+    int error = swtisArchiveInit(self, (const uint8_t*) mapping, octetCount);
+    if (error != 0) {
+        munmap(mapping, octetCount);
+        return error;
+    }
+
+    self->mapping = mapping;
+
+    return 0;
+}
+
+void swtisArchiveDestroy(SwtisArchive* self)
+{
+    if (self->mapping != 0) {
+        munmap(self->mapping, self->octetCount);
+    }
+    self->mapping = 0;
+    self->octets = 0;
+    self->octetCount = 0;
+    self->moduleCount = 0;
+}
+
+static const uint8_t* indexEntry(const SwtisArchive* self, size_t index)
+{
+    return self->octets + SWTIS_ARCHIVE_HEADER_OCTET_COUNT + index * SWTIS_ARCHIVE_INDEX_ENTRY_OCTET_COUNT;
+}
+
+static const char* entryName(const SwtisArchive* self, const uint8_t* entry)
+{
+    uint32_t offset = readUInt32(entry);
+    if (offset >= self->stringsOctetCount) {
+        return 0;
+    }
+
+    return self->strings + offset;
+}
+
+int swtisArchiveModuleAt(const SwtisArchive* self, size_t index, SwtisArchiveModule* outModule)
+{
+    if (index >= self->moduleCount) {
+        return -3;
+    }
+
+    const uint8_t* entry = indexEntry(self, index);
+    const char* name = entryName(self, entry);
+    size_t chunkOffset = readUInt32(entry + 4);
+    size_t chunkOctetCount = readUInt32(entry + 8);
+    size_t referencesOffset = readUInt32(entry + 16);
+    size_t nameCount = readUInt32(entry + 20);
+
+    if (name == 0 || chunkOffset > self->octetCount || chunkOctetCount > self->octetCount - chunkOffset ||
+        referencesOffset > self->octetCount || nameCount > (self->octetCount - referencesOffset) / 4) {
+        CLOG_SOFT_ERROR("archive: index entry %zu is out of range", index)
+        return -6;
+    }
+
+    outModule->name = name;
+    outModule->octets = self->octets + chunkOffset;
+    outModule->octetCount = chunkOctetCount;
+    outModule->hash = readUInt32(entry + 12);
+    outModule->nameReferences = self->octets + referencesOffset;
+    outModule->nameCount = nameCount;
+
+    return 0;
+}
+
+int swtisArchiveFind(const SwtisArchive* self, const char* moduleName, SwtisArchiveModule* outModule)
+{
+    size_t low = 0;
+    size_t high = self->moduleCount;
+
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        const char* name = entryName(self, indexEntry(self, middle));
+        if (name == 0) {
+            CLOG_SOFT_ERROR("archive: index entry %zu is out of range", middle)
+            return -6;
+        }
+        int comparison = strcmp(name, moduleName);
+        if (comparison == 0) {
+            return swtisArchiveModuleAt(self, middle, outModule);
+        }
+        if (comparison < 0) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+
+    return -1;
+}
+
+int swtisArchiveDeserialize(const SwtisArchive* self, const SwtisArchiveModule* module, SwtiChunk* target,
+                            struct ImprintAllocator* allocator, const SwtisDeserializeOptions* options)
+{
+    int result = swtisDeserializeWithOptions(module->octets, module->octetCount, target, allocator, options);
+    if (result < 0) {
+        CLOG_SOFT_ERROR("archive: could not deserialize module '%s' (%d)", module->name, result)
+        return result;
+    }
+
+    size_t expectedCount = 0;
+    for (size_t i = 0; i < target->typeCount; ++i) {
+        expectedCount += swtisSectionNameCount(target->types[i]);
+    }
+    if (expectedCount != module->nameCount) {
+        CLOG_SOFT_ERROR("archive: module '%s' has %zu names, but its types need %zu", module->name, module->nameCount,
+                        expectedCount)
+        return -6;
+    }
+
+    const uint8_t* reference = module->nameReferences;
+    for (size_t i = 0; i < target->typeCount; ++i) {
+        SwtiType* type = (SwtiType*) target->types[i];
+        size_t nameCount = swtisSectionNameCount(type);
+        for (size_t j = 0; j < nameCount; ++j) {
+            uint32_t offset = readUInt32(reference);
+            reference += 4;
+            if (offset >= self->stringsOctetCount) {
+                CLOG_SOFT_ERROR("archive: module '%s' has a name outside the string table", module->name)
+                return -6;
+            }
+            *swtisSectionNameAt(type, j) = self->strings + offset;
+        }
+    }
+
+    return 0;
+}
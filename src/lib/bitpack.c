@@ -0,0 +1,710 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <flood/in_stream.h>
+#include <flood/out_stream.h>
+#include <imprint/allocator.h>
+#include <swamp-typeinfo-serialize/bitpack.h>
+#include <swamp-typeinfo-serialize/value.h>
+#include <swamp-typeinfo-serialize/value_internal.h>
+#include <swamp-typeinfo/typeinfo.h>
+#include <tiny-libc/tiny_libc.h>
+
+static const size_t widthClasses[4] = {4, 8, 16, 32};
+
+void swtisBitWriterInit(SwtisBitWriter* self, uint8_t* octets, size_t octetCount)
+{
+    self->octets = octets;
+    self->octetCount = octetCount;
+    self->pos = 0;
+    self->accumulator = 0;
+    self->accumulatorBitCount = 0;
+}
+
+/// `bitCount` is at most 32.
+int swtisBitWriterWrite(SwtisBitWriter* self, uint32_t value, size_t bitCount)
+{
+    if (bitCount < 32) {
+        value &= ((uint32_t) 1 << bitCount) - 1;
+    }
+
+    self->accumulator |= (uint64_t) value << self->accumulatorBitCount;
+    self->accumulatorBitCount += bitCount;
+
+    if (self->accumulatorBitCount >= 32) {
+        if (self->pos + 4 > self->octetCount) {
+            return -1;
+        }
+        uint8_t* p = self->octets + self->pos;
+        p[0] = (uint8_t) self->accumulator;
+        p[1] = (uint8_t) (self->accumulator >> 8);
+        p[2] = (uint8_t) (self->accumulator >> 16);
+        p[3] = (uint8_t) (self->accumulator >> 24);
+        self->pos += 4;
+        self->accumulator >>= 32;
+        self->accumulatorBitCount -= 32;
+    }
+
+    return 0;
+}
+
+/// Writes the remaining bits, padded with zeros to a whole octet. Returns the total number of octets written.
+int swtisBitWriterFlush(SwtisBitWriter* self)
+{
+    while (self->accumulatorBitCount > 0) {
+        if (self->pos + 1 > self->octetCount) {
+            return -1;
+        }
+        self->octets[self->pos++] = (uint8_t) self->accumulator;
+        self->accumulator >>= 8;
+        self->accumulatorBitCount = self->accumulatorBitCount > 8 ? self->accumulatorBitCount - 8 : 0;
+    }
+
+    self->accumulator = 0;
+
+    return (int) self->pos;
+}
+
+void swtisBitReaderInit(SwtisBitReader* self, const uint8_t* octets, size_t octetCount)
+{
+    self->octets = octets;
+    self->octetCount = octetCount;
+    self->pos = 0;
+    self->accumulator = 0;
+    self->accumulatorBitCount = 0;
+}
+
+int swtisBitReaderRead(SwtisBitReader* self, size_t bitCount, uint32_t* value)
+{
+    if (self->accumulatorBitCount < bitCount) {
+        if (self->pos + 4 <= self->octetCount) {
+            const uint8_t* p = self->octets + self->pos;
+            uint64_t word = (uint64_t) p[0] | ((uint64_t) p[1] << 8) | ((uint64_t) p[2] << 16) | ((uint64_t) p[3] << 24);
+            self->accumulator |= word << self->accumulatorBitCount;
+            self->accumulatorBitCount += 32;
+            self->pos += 4;
+        } else {
+            while (self->accumulatorBitCount < bitCount && self->pos < self->octetCount) {
+                self->accumulator |= (uint64_t) self->octets[self->pos++] << self->accumulatorBitCount;
+                self->accumulatorBitCount += 8;
+            }
+        }
+        if (self->accumulatorBitCount < bitCount) {
+            return -1;
+        }
+    }
+
+    *value = bitCount < 32 ? (uint32_t) self->accumulator & (((uint32_t) 1 << bitCount) - 1)
+                           : (uint32_t) self->accumulator;
+    self->accumulator >>= bitCount;
+    self->accumulatorBitCount -= bitCount;
+
+    return 0;
+}
+
+size_t swtisBitReaderRemainingBits(const SwtisBitReader* self)
+{
+    return self->accumulatorBitCount + (self->octetCount - self->pos) * 8;
+}
+
+static size_t bitsNeeded(size_t count)
+{
+    size_t bits = 0;
+    while (((size_t) 1 << bits) < count) {
+        bits++;
+    }
+    return bits;
+}
+
+static int writeUnsigned(SwtisBitWriter* writer, uint32_t value)
+{
+    size_t widthClass = 0;
+    while (widthClass < 3 && (value >> widthClasses[widthClass]) != 0) {
+        widthClass++;
+    }
+
+    int error;
+    if ((error = swtisBitWriterWrite(writer, (uint32_t) widthClass, 2)) != 0) {
+        return error;
+    }
+
+    return swtisBitWriterWrite(writer, value, widthClasses[widthClass]);
+}
+
+static int readUnsigned(SwtisBitReader* reader, uint32_t* value)
+{
+    uint32_t widthClass;
+    int error;
+
+    if ((error = swtisBitReaderRead(reader, 2, &widthClass)) != 0) {
+        return error;
+    }
+
+    return swtisBitReaderRead(reader, widthClasses[widthClass], value);
+}
+
+static const void* readPointer(const uint8_t* source)
+{
+    const void* pointer;
+    tc_memcpy_octets((void*) &pointer, source, sizeof(pointer));
+    return pointer;
+}
+
+static void writePointer(uint8_t* target, const void* pointer)
+{
+    tc_memcpy_octets(target, (const void*) &pointer, sizeof(pointer));
+}
+
+static uint32_t readScalar(const uint8_t* source, size_t size)
+{
+    uint8_t octets[4] = {0, 0, 0, 0};
+    swtisValueCopyScalar(octets, source, size);
+    return swtisValueReadUInt32(octets);
+}
+
+static void writeScalar(uint8_t* target, uint32_t value, size_t size)
+{
+    uint8_t octets[4];
+    swtisValueWriteUInt32(octets, value);
+    swtisValueCopyScalar(target, octets, size);
+}
+
+/// `outItemSlot` is the memory info of the list, see swtisValueScalarSize().
+static int listItemInfo(const SwtiType* type, const SwtiType** outItemType, const SwtiMemoryInfo** outItemSlot)
+{
+    const SwtiMemoryInfo* info;
+
+    if (type->type == SwtiTypeList) {
+        *outItemType = ((const SwtiListType*) type)->itemType;
+        info = &((const SwtiListType*) type)->memoryInfo;
+    } else {
+        *outItemType = ((const SwtiArrayType*) type)->itemType;
+        info = &((const SwtiArrayType*) type)->memoryInfo;
+    }
+
+    if (info->memorySize == 0 && swtisValueMinimumWireSize(*outItemType, info) != 0) {
+        CLOG_SOFT_ERROR("bitpack: list %d has no item layout", type->index)
+        return -4;
+    }
+
+    *outItemSlot = info;
+
+    return 0;
+}
+
+static int checkReferenceSlot(const SwtiType* type, const SwtiMemoryInfo* slot)
+{
+    switch (type->type) {
+        case SwtiTypeString:
+        case SwtiTypeBlob:
+        case SwtiTypeList:
+        case SwtiTypeArray:
+            if (swtisValueCheckReferenceSlot(slot) != 0) {
+                CLOG_SOFT_ERROR("bitpack: type %d is held in %d octets, the host needs %zu for a reference",
+                                type->index, slot->memorySize, sizeof(void*))
+                return -4;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+static int writeOctets(SwtisBitWriter* writer, const uint8_t* octets, size_t count)
+{
+    if (count > 0xffffffff) {
+        return -5;
+    }
+
+    int error;
+    if ((error = writeUnsigned(writer, (uint32_t) count)) != 0) {
+        return error;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if ((error = swtisBitWriterWrite(writer, octets[i], 8)) != 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+static int readOctets(SwtisBitReader* reader, uint8_t** outOctets, uint32_t* outCount, ImprintAllocator* allocator)
+{
+    uint32_t count;
+    int error;
+
+    if ((error = readUnsigned(reader, &count)) != 0) {
+        return error;
+    }
+
+    if (count > swtisBitReaderRemainingBits(reader) / 8) {
+        return -7;
+    }
+
+    uint8_t* octets = IMPRINT_ALLOC(allocator, count + 1, "bitpack octets");
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t octet;
+        if ((error = swtisBitReaderRead(reader, 8, &octet)) != 0) {
+            return error;
+        }
+        octets[i] = (uint8_t) octet;
+    }
+    octets[count] = 0;
+
+    *outOctets = octets;
+    *outCount = count;
+
+    return 0;
+}
+
+static int packValue(SwtisBitWriter* writer, const SwtiType* type, const SwtiMemoryInfo* slot, const uint8_t* source,
+                     size_t depth);
+
+static int packFields(SwtisBitWriter* writer, const SwtiType* owner, const uint8_t* source, size_t depth)
+{
+    int error;
+
+    if (owner->type == SwtiTypeRecord) {
+        const SwtiRecordType* record = (const SwtiRecordType*) owner;
+        for (size_t i = 0; i < record->fieldCount; ++i) {
+            const SwtiRecordTypeField* field = &record->fields[i];
+            if ((error = packValue(writer, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                   source + field->memoryOffsetInfo.memoryOffset, depth)) != 0) {
+                return error;
+            }
+        }
+    } else {
+        const SwtiTupleType* tuple = (const SwtiTupleType*) owner;
+        for (size_t i = 0; i < tuple->fieldCount; ++i) {
+            const SwtiTupleTypeField* field = &tuple->fields[i];
+            if ((error = packValue(writer, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                   source + field->memoryOffsetInfo.memoryOffset, depth)) != 0) {
+                return error;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int packCustom(SwtisBitWriter* writer, const SwtiCustomType* custom, const uint8_t* source, size_t depth)
+{
+    uint8_t variantIndex = source[0];
+    if (variantIndex >= custom->variantCount) {
+        CLOG_SOFT_ERROR("bitpack: illegal variant %d for custom type %s", variantIndex, custom->internal.name)
+        return -6;
+    }
+
+    int error;
+    if ((error = swtisBitWriterWrite(writer, variantIndex, bitsNeeded(custom->variantCount))) != 0) {
+        return error;
+    }
+
+    const SwtiCustomTypeVariant* variant = custom->variantTypes[variantIndex];
+    for (size_t i = 0; i < variant->paramCount; ++i) {
+        const SwtiCustomTypeVariantField* field = &variant->fields[i];
+        if ((error = packValue(writer, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                               source + field->memoryOffsetInfo.memoryOffset, depth)) != 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+static int packList(SwtisBitWriter* writer, const SwtiType* type, const uint8_t* source, size_t depth)
+{
+    const SwtiType* itemType;
+    const SwtiMemoryInfo* itemSlot;
+    int error;
+
+    if ((error = listItemInfo(type, &itemType, &itemSlot)) != 0) {
+        return error;
+    }
+
+    size_t stride = itemSlot->memorySize;
+    const SwtisValueList* list = readPointer(source);
+    size_t count = list != 0 ? list->count : 0;
+    if (count > 0xffffffff) {
+        return -5;
+    }
+
+    if ((error = writeUnsigned(writer, (uint32_t) count)) != 0) {
+        return error;
+    }
+
+    const uint8_t* item = count != 0 ? (const uint8_t*) list->value : 0;
+    for (size_t i = 0; i < count; ++i) {
+        if ((error = packValue(writer, itemType, itemSlot, item, depth)) != 0) {
+            return error;
+        }
+        item += stride;
+    }
+
+    return 0;
+}
+
+static int packValue(SwtisBitWriter* writer, const SwtiType* type, const SwtiMemoryInfo* slot, const uint8_t* source,
+                     size_t depth)
+{
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        CLOG_SOFT_ERROR("bitpack: too deep")
+        return -2;
+    }
+
+    type = swtisValueUnalias(type);
+    int error;
+
+    if ((error = checkReferenceSlot(type, slot)) != 0) {
+        return error;
+    }
+
+    switch (type->type) {
+        case SwtiTypeBoolean:
+            return swtisBitWriterWrite(writer, source[0] != 0, 1);
+        case SwtiTypeInt:
+        case SwtiTypeFixed:
+        case SwtiTypeResourceName: {
+            size_t size;
+            if ((error = swtisValueScalarSize(type, slot, &size)) != 0) {
+                return error;
+            }
+            if (size > 4) {
+                CLOG_SOFT_ERROR("bitpack: integers of size %zu are not supported", size)
+                return -3;
+            }
+            uint32_t raw = readScalar(source, size);
+            int32_t value = size == 4 ? (int32_t) raw : (int32_t) (raw << (32 - size * 8)) >> (32 - size * 8);
+            return writeUnsigned(writer, ((uint32_t) value << 1) ^ (uint32_t) (value >> 31));
+        }
+        case SwtiTypeChar: {
+            size_t size;
+            if ((error = swtisValueScalarSize(type, slot, &size)) != 0) {
+                return error;
+            }
+            uint32_t codePoint = readScalar(source, size);
+            if (codePoint < 0x80) {
+                return swtisBitWriterWrite(writer, codePoint << 1, 8);
+            }
+            if (codePoint > 0x1fffff) {
+                CLOG_SOFT_ERROR("bitpack: illegal char %u", codePoint)
+                return -6;
+            }
+            return swtisBitWriterWrite(writer, (codePoint << 1) | 1, 22);
+        }
+        case SwtiTypeString: {
+            const SwtisValueString* string = readPointer(source);
+            return string != 0 ? writeOctets(writer, (const uint8_t*) string->characters, string->characterCount)
+                               : writeOctets(writer, 0, 0);
+        }
+        case SwtiTypeBlob: {
+            const SwtisValueBlob* blob = readPointer(source);
+            return blob != 0 ? writeOctets(writer, blob->octets, blob->octetCount) : writeOctets(writer, 0, 0);
+        }
+        case SwtiTypeList:
+        case SwtiTypeArray:
+            return packList(writer, type, source, depth + 1);
+        case SwtiTypeRecord:
+        case SwtiTypeTuple:
+            return packFields(writer, type, source, depth + 1);
+        case SwtiTypeCustom:
+            return packCustom(writer, (const SwtiCustomType*) type, source, depth + 1);
+        default:
+            CLOG_SOFT_ERROR("bitpack: can not serialize values of type %d", type->type)
+            return -1;
+    }
+}
+
+static size_t minimumBitCount(const SwtiType* type, size_t depth)
+{
+    type = swtisValueUnalias(type);
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        return 0;
+    }
+
+    switch (type->type) {
+        case SwtiTypeBoolean:
+            return 1;
+        case SwtiTypeInt:
+        case SwtiTypeFixed:
+        case SwtiTypeResourceName:
+        case SwtiTypeString:
+        case SwtiTypeBlob:
+        case SwtiTypeList:
+        case SwtiTypeArray:
+            return 2 + widthClasses[0];
+        case SwtiTypeChar:
+            return 8;
+        case SwtiTypeCustom:
+            return bitsNeeded(((const SwtiCustomType*) type)->variantCount);
+        case SwtiTypeRecord: {
+            const SwtiRecordType* record = (const SwtiRecordType*) type;
+            size_t total = 0;
+            for (size_t i = 0; i < record->fieldCount; ++i) {
+                total += minimumBitCount(record->fields[i].fieldType, depth + 1);
+            }
+            return total;
+        }
+        case SwtiTypeTuple: {
+            const SwtiTupleType* tuple = (const SwtiTupleType*) type;
+            size_t total = 0;
+            for (size_t i = 0; i < tuple->fieldCount; ++i) {
+                total += minimumBitCount(tuple->fields[i].fieldType, depth + 1);
+            }
+            return total;
+        }
+        default:
+            return 0;
+    }
+}
+
+static int unpackValue(SwtisBitReader* reader, const SwtiType* type, const SwtiMemoryInfo* slot, uint8_t* target,
+                       ImprintAllocator* allocator, size_t depth);
+
+static int unpackFields(SwtisBitReader* reader, const SwtiType* owner, uint8_t* target, ImprintAllocator* allocator,
+                        size_t depth)
+{
+    int error;
+
+    if (owner->type == SwtiTypeRecord) {
+        const SwtiRecordType* record = (const SwtiRecordType*) owner;
+        tc_mem_clear(target, record->memoryInfo.memorySize);
+        for (size_t i = 0; i < record->fieldCount; ++i) {
+            const SwtiRecordTypeField* field = &record->fields[i];
+            if ((error = unpackValue(reader, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                     target + field->memoryOffsetInfo.memoryOffset, allocator, depth)) != 0) {
+                return error;
+            }
+        }
+    } else {
+        const SwtiTupleType* tuple = (const SwtiTupleType*) owner;
+        tc_mem_clear(target, tuple->memoryInfo.memorySize);
+        for (size_t i = 0; i < tuple->fieldCount; ++i) {
+            const SwtiTupleTypeField* field = &tuple->fields[i];
+            if ((error = unpackValue(reader, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                     target + field->memoryOffsetInfo.memoryOffset, allocator, depth)) != 0) {
+                return error;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int unpackCustom(SwtisBitReader* reader, const SwtiCustomType* custom, uint8_t* target,
+                        ImprintAllocator* allocator, size_t depth)
+{
+    uint32_t variantIndex;
+    int error;
+
+    if ((error = swtisBitReaderRead(reader, bitsNeeded(custom->variantCount), &variantIndex)) != 0) {
+        return error;
+    }
+
+    if (variantIndex >= custom->variantCount) {
+        CLOG_SOFT_ERROR("bitpack: illegal variant %d for custom type %s", variantIndex, custom->internal.name)
+        return -6;
+    }
+
+    tc_mem_clear(target, custom->memoryInfo.memorySize);
+    target[0] = (uint8_t) variantIndex;
+
+    const SwtiCustomTypeVariant* variant = custom->variantTypes[variantIndex];
+    for (size_t i = 0; i < variant->paramCount; ++i) {
+        const SwtiCustomTypeVariantField* field = &variant->fields[i];
+        if ((error = unpackValue(reader, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                 target + field->memoryOffsetInfo.memoryOffset, allocator, depth)) != 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+static int unpackList(SwtisBitReader* reader, const SwtiType* type, uint8_t* target, ImprintAllocator* allocator,
+                      size_t depth)
+{
+    const SwtiType* itemType;
+    const SwtiMemoryInfo* itemSlot;
+    int error;
+
+    if ((error = listItemInfo(type, &itemType, &itemSlot)) != 0) {
+        return error;
+    }
+
+    size_t stride = itemSlot->memorySize;
+    uint32_t count;
+    if ((error = readUnsigned(reader, &count)) != 0) {
+        return error;
+    }
+
+    size_t itemBitCount = minimumBitCount(itemType, 0);
+    size_t remaining = swtisBitReaderRemainingBits(reader);
+    if (itemBitCount != 0 ? count > remaining / itemBitCount : count > SWTIS_VALUE_MAX_EMPTY_ITEM_COUNT) {
+        CLOG_SOFT_ERROR("bitpack: list count %u is more than the stream can hold", count)
+        return -7;
+    }
+
+    SwtisValueList* list = IMPRINT_ALLOC_TYPE(allocator, SwtisValueList);
+    uint8_t* items = count != 0 ? IMPRINT_ALLOC(allocator, count * stride, "bitpack list items") : 0;
+
+    list->value = items;
+    list->count = count;
+    list->itemSize = stride;
+    list->itemAlign = itemSlot->memoryAlign;
+
+    for (size_t i = 0; i < count; ++i) {
+        if ((error = unpackValue(reader, itemType, itemSlot, items + i * stride, allocator, depth)) != 0) {
+            return error;
+        }
+    }
+
+    writePointer(target, list);
+
+    return 0;
+}
+
+static int unpackValue(SwtisBitReader* reader, const SwtiType* type, const SwtiMemoryInfo* slot, uint8_t* target,
+                       ImprintAllocator* allocator, size_t depth)
+{
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        CLOG_SOFT_ERROR("bitpack: too deep")
+        return -2;
+    }
+
+    type = swtisValueUnalias(type);
+    int error;
+
+    if ((error = checkReferenceSlot(type, slot)) != 0) {
+        return error;
+    }
+
+    switch (type->type) {
+        case SwtiTypeBoolean: {
+            uint32_t value;
+            if ((error = swtisBitReaderRead(reader, 1, &value)) != 0) {
+                return error;
+            }
+            target[0] = (uint8_t) value;
+            return 0;
+        }
+        case SwtiTypeInt:
+        case SwtiTypeFixed:
+        case SwtiTypeResourceName: {
+            size_t size;
+            if ((error = swtisValueScalarSize(type, slot, &size)) != 0) {
+                return error;
+            }
+            if (size > 4) {
+                return -3;
+            }
+            uint32_t zigZag;
+            if ((error = readUnsigned(reader, &zigZag)) != 0) {
+                return error;
+            }
+            writeScalar(target, (zigZag >> 1) ^ (uint32_t) - (int32_t) (zigZag & 1), size);
+            return 0;
+        }
+        case SwtiTypeChar: {
+            size_t size;
+            if ((error = swtisValueScalarSize(type, slot, &size)) != 0) {
+                return error;
+            }
+            uint32_t isWide;
+            uint32_t codePoint;
+            if ((error = swtisBitReaderRead(reader, 1, &isWide)) != 0 ||
+                (error = swtisBitReaderRead(reader, isWide ? 21 : 7, &codePoint)) != 0) {
+                return error;
+            }
+            writeScalar(target, codePoint, size);
+            return 0;
+        }
+        case SwtiTypeString: {
+            uint8_t* characters;
+            uint32_t count;
+            if ((error = readOctets(reader, &characters, &count, allocator)) != 0) {
+                return error;
+            }
+            SwtisValueString* string = IMPRINT_ALLOC_TYPE(allocator, SwtisValueString);
+            string->characters = (const char*) characters;
+            string->characterCount = count;
+            writePointer(target, string);
+            return 0;
+        }
+        case SwtiTypeBlob: {
+            uint8_t* octets;
+            uint32_t count;
+            if ((error = readOctets(reader, &octets, &count, allocator)) != 0) {
+                return error;
+            }
+            SwtisValueBlob* blob = IMPRINT_ALLOC_TYPE(allocator, SwtisValueBlob);
+            blob->octets = octets;
+            blob->octetCount = count;
+            writePointer(target, blob);
+            return 0;
+        }
+        case SwtiTypeList:
+        case SwtiTypeArray:
+            return unpackList(reader, type, target, allocator, depth + 1);
+        case SwtiTypeRecord:
+        case SwtiTypeTuple:
+            return unpackFields(reader, type, target, allocator, depth + 1);
+        case SwtiTypeCustom:
+            return unpackCustom(reader, (const SwtiCustomType*) type, target, allocator, depth + 1);
+        default:
+            CLOG_SOFT_ERROR("bitpack: can not deserialize values of type %d", type->type)
+            return -1;
+    }
+}
+
+int swtisBitPackValue(SwtisBitWriter* writer, const SwtiType* type, const void* value)
+{
+    return packValue(writer, type, 0, (const uint8_t*) value, 0);
+}
+
+/// Strings, blobs and list items are allocated from `allocator`.
+int swtisBitUnpackValue(SwtisBitReader* reader, const SwtiType* type, void* target, ImprintAllocator* allocator)
+{
+    return unpackValue(reader, type, 0, (uint8_t*) target, allocator, 0);
+}
+
+/// Packs directly into the stream buffer and then skips the octets that were used.
+int swtisBitPackSerializeValue(FldOutStream* stream, const SwtiType* type, const void* value)
+{
+    SwtisBitWriter writer;
+    int error;
+
+    swtisBitWriterInit(&writer, stream->octets + stream->pos, stream->size - stream->pos);
+    if ((error = swtisBitPackValue(&writer, type, value)) != 0 || (error = swtisBitWriterFlush(&writer)) < 0) {
+        return error;
+    }
+
+    stream->pos += writer.pos;
+    stream->p += writer.pos;
+
+    return (int) writer.pos;
+}
+
+/// Reads directly from the stream buffer and then skips the octets that were used.
+int swtisBitPackDeserializeValue(FldInStream* stream, const SwtiType* type, void* target,
+                                 ImprintAllocator* allocator)
+{
+    SwtisBitReader reader;
+    int error;
+
+    swtisBitReaderInit(&reader, stream->octets + stream->pos, stream->size - stream->pos);
+    if ((error = swtisBitUnpackValue(&reader, type, target, allocator)) != 0) {
+        return error;
+    }
+
+    // Octets that were only read ahead into the accumulator are given back
+    size_t octetCount = reader.pos - reader.accumulatorBitCount / 8;
+    stream->pos += octetCount;
+    stream->p += octetCount;
+
+    return (int) octetCount;
+}
@@ -0,0 +1,374 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <imprint/linear_allocator.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <swamp-typeinfo-serialize/cache.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo/chunk.h>
+#include <tiny-libc/tiny_libc.h>
+
+/// Entries are never freed while the cache lives, only reused, so a lookup can always touch an entry it found in a
+/// slot, even if it has been evicted since. It only trusts the contents after it has taken a reference.
+struct SwtisCacheEntry {
+    // 0: free or being evicted, 1: only held by the cache, more: acquired by someone
+    _Atomic uint32_t refCount;
+    _Atomic uint64_t hash;
+    _Atomic uint64_t lastUsed;
+    uint8_t* octets;
+    size_t octetCount;
+    uint8_t* memory;
+    size_t memorySize;
+    size_t slotIndex;
+    SwtiChunk chunk;
+};
+
+struct SwtisCache {
+    // Open addressing, linear probing. Only changed while holding the mutex.
+    SwtisCacheEntry* _Atomic* slots;
+    size_t slotMask;
+    SwtisCacheEntry* entries;
+    size_t maxEntryCount;
+    size_t entryCount;
+    size_t memoryBudget;
+    size_t memoryUsed;
+    SwtisDeserializeOptions deserializeOptions;
+    int hasDeserializeOptions;
+    pthread_mutex_t mutex;
+    _Atomic uint64_t clock;
+    _Atomic uint64_t hitCount;
+    _Atomic uint64_t missCount;
+    uint64_t evictionCount;
+};
+
+/// Marks a slot that used to hold an entry, so lookups keep probing past it.
+static SwtisCacheEntry tombstone;
+
+static uint64_t hashOctets(const uint8_t* octets, size_t octetCount)
+{
+    uint64_t hash = 0xcbf29ce484222325u;
+    for (size_t i = 0; i < octetCount; ++i) {
+        hash ^= octets[i];
+        hash *= 0x100000001b3u;
+    }
+
+    return hash;
+}
+
+static int tryRetain(SwtisCacheEntry* entry)
+{
+    uint32_t refCount = atomic_load_explicit(&entry->refCount, memory_order_relaxed);
+    while (refCount != 0) {
+        if (atomic_compare_exchange_weak_explicit(&entry->refCount, &refCount, refCount + 1, memory_order_acquire,
+                                                  memory_order_relaxed)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+static void releaseEntry(SwtisCacheEntry* entry)
+{
+    atomic_fetch_sub_explicit(&entry->refCount, 1, memory_order_release);
+}
+
+static SwtisCacheEntry* findAndRetain(SwtisCache* self, uint64_t hash, const uint8_t* octets, size_t octetCount)
+{
+    for (size_t i = 0; i <= self->slotMask; ++i) {
+        SwtisCacheEntry* entry = atomic_load_explicit(&self->slots[(hash + i) & self->slotMask], memory_order_acquire);
+        if (entry == 0) {
+            return 0;
+        }
+        if (entry == &tombstone || atomic_load_explicit(&entry->hash, memory_order_relaxed) != hash) {
+            continue;
+        }
+        if (!tryRetain(entry)) {
+            continue;
+        }
+        // It might have been reused for another blob between reading the slot and taking the reference
+        if (atomic_load_explicit(&entry->hash, memory_order_relaxed) == hash && entry->octetCount == octetCount &&
+            memcmp(entry->octets, octets, octetCount) == 0) {
+            atomic_store_explicit(&entry->lastUsed, atomic_fetch_add(&self->clock, 1), memory_order_relaxed);
+            return entry;
+        }
+        releaseEntry(entry);
+    }
+
+    return 0;
+}
+
+static void removeFromSlots(SwtisCache* self, SwtisCacheEntry* entry)
+{
+    size_t slotIndex = entry->slotIndex;
+    atomic_store_explicit(&self->slots[slotIndex], &tombstone, memory_order_release);
+
+    // Tombstones right before an empty slot are not needed to reach anything
+    while (atomic_load_explicit(&self->slots[slotIndex], memory_order_relaxed) == &tombstone &&
+           atomic_load_explicit(&self->slots[(slotIndex + 1) & self->slotMask], memory_order_relaxed) == 0) {
+        atomic_store_explicit(&self->slots[slotIndex], 0, memory_order_release);
+        slotIndex = (slotIndex - 1) & self->slotMask;
+    }
+}
+
+/// Must hold the mutex. Only entries that nobody has acquired can be evicted.
+static int evictLeastRecentlyUsed(SwtisCache* self)
+{
+    for (;;) {
+        SwtisCacheEntry* oldest = 0;
+        uint64_t oldestUsed = 0;
+        for (size_t i = 0; i < self->maxEntryCount; ++i) {
+            SwtisCacheEntry* entry = &self->entries[i];
+            if (entry->memory == 0 || atomic_load_explicit(&entry->refCount, memory_order_relaxed) != 1) {
+                continue;
+            }
+            uint64_t lastUsed = atomic_load_explicit(&entry->lastUsed, memory_order_relaxed);
+            if (oldest == 0 || lastUsed < oldestUsed) {
+                oldest = entry;
+                oldestUsed = lastUsed;
+            }
+        }
+
+        if (oldest == 0) {
+            return 0;
+        }
+
+        uint32_t expected = 1;
+        if (!atomic_compare_exchange_strong(&oldest->refCount, &expected, 0)) {
+            // Someone acquired it after we looked
+            continue;
+        }
+
+        removeFromSlots(self, oldest);
+        tc_free(oldest->octets);
+        tc_free(oldest->memory);
+        oldest->octets = 0;
+        oldest->memory = 0;
+        self->memoryUsed -= oldest->memorySize;
+        self->entryCount--;
+        self->evictionCount++;
+
+        return 1;
+    }
+}
+
+/// Must hold the mutex.
+static int insert(SwtisCache* self, uint64_t hash, const uint8_t* octets, size_t octetCount,
+                  SwtisCacheEntry** outEntry)
+{
+    if (octetCount > self->memoryBudget / SWTIS_CACHE_MEMORY_FACTOR) {
+        CLOG_SOFT_ERROR("swtisCache: %zu octets of typeinfo do not fit in a budget of %zu", octetCount,
+                        self->memoryBudget)
+        return -5;
+    }
+
+    size_t memorySize = octetCount * SWTIS_CACHE_MEMORY_FACTOR;
+
+    while (self->entryCount > 0 &&
+           (self->entryCount == self->maxEntryCount || self->memoryUsed + memorySize > self->memoryBudget)) {
+        if (!evictLeastRecentlyUsed(self)) {
+            break;
+        }
+    }
+
+    if (self->entryCount == self->maxEntryCount) {
+        CLOG_SOFT_ERROR("swtisCache: all %zu entries are acquired", self->maxEntryCount)
+        return -4;
+    }
+
+    if (self->memoryUsed + memorySize > self->memoryBudget) {
+        CLOG_SOFT_ERROR("swtisCache: the budget is held by acquired entries (%zu of %zu octets)", self->memoryUsed,
+                        self->memoryBudget)
+        return -5;
+    }
+
+    SwtisCacheEntry* entry = 0;
+    for (size_t i = 0; i < self->maxEntryCount; ++i) {
+        if (self->entries[i].memory == 0) {
+            entry = &self->entries[i];
+            break;
+        }
+    }
+
+    entry->memory = tc_malloc(memorySize);
+    if (entry->memory == 0) {
+        CLOG_SOFT_ERROR("swtisCache: out of memory for %zu octets", memorySize)
+        return -7;
+    }
+    entry->memorySize = memorySize;
+
+    ImprintLinearAllocator allocator;
+    imprintLinearAllocatorInit(&allocator, entry->memory, memorySize, "swtisCache");
+    int result = swtisDeserializeWithOptions(octets, octetCount, &entry->chunk, &allocator.info,
+                                             self->hasDeserializeOptions ? &self->deserializeOptions : 0);
+    if (result < 0) {
+        tc_free(entry->memory);
+        entry->memory = 0;
+        return result;
+    }
+
+    entry->octets = tc_malloc(octetCount);
+    if (entry->octets == 0) {
+        CLOG_SOFT_ERROR("swtisCache: out of memory for %zu octets", octetCount)
+        tc_free(entry->memory);
+        entry->memory = 0;
+        return -7;
+    }
+    tc_memcpy_octets(entry->octets, octets, octetCount);
+    entry->octetCount = octetCount;
+
+    size_t slotIndex = hash & self->slotMask;
+    for (;;) {
+        SwtisCacheEntry* existing = atomic_load_explicit(&self->slots[slotIndex], memory_order_relaxed);
+        if (existing == 0 || existing == &tombstone) {
+            break;
+        }
+        slotIndex = (slotIndex + 1) & self->slotMask;
+    }
+    entry->slotIndex = slotIndex;
+
+    atomic_store_explicit(&entry->hash, hash, memory_order_relaxed);
+    atomic_store_explicit(&entry->lastUsed, atomic_fetch_add(&self->clock, 1), memory_order_relaxed);
+    // One reference for the cache and one for the caller. Publishes the contents to lookups that retain it.
+    atomic_store_explicit(&entry->refCount, 2, memory_order_release);
+    atomic_store_explicit(&self->slots[slotIndex], entry, memory_order_release);
+
+    self->memoryUsed += memorySize;
+    self->entryCount++;
+
+    *outEntry = entry;
+
+    return 0;
+}
+
+SwtisCache* swtisCacheCreate(const SwtisCacheOptions* options)
+{
+    if (options->maxEntryCount == 0) {
+        CLOG_SOFT_ERROR("swtisCache: maxEntryCount must be at least one")
+        return 0;
+    }
+
+    if (options->deserializeOptions != 0 && options->deserializeOptions->dependents != 0) {
+        CLOG_SOFT_ERROR("swtisCache: dependents can not be shared between chunks")
+        return 0;
+    }
+
+    if (options->deserializeOptions != 0 && options->deserializeOptions->unmanagedTable != 0) {
+        CLOG_SOFT_ERROR("swtisCache: unmanaged tables can not be shared between chunks")
+        return 0;
+    }
+
+    SwtisCache* self = tc_malloc_type(SwtisCache);
+    tc_mem_clear_type(self);
+
+    // At most half full, so probe sequences stay short
+    size_t slotCount = 1;
+    while (slotCount < options->maxEntryCount * 2) {
+        slotCount *= 2;
+    }
+
+    self->slots = tc_malloc_type_count(SwtisCacheEntry* _Atomic, slotCount);
+    for (size_t i = 0; i < slotCount; ++i) {
+        atomic_init(&self->slots[i], 0);
+    }
+    self->slotMask = slotCount - 1;
+
+    self->entries = tc_malloc_type_count(SwtisCacheEntry, options->maxEntryCount);
+    tc_mem_clear_type_n(self->entries, options->maxEntryCount);
+    for (size_t i = 0; i < options->maxEntryCount; ++i) {
+        atomic_init(&self->entries[i].refCount, 0);
+        atomic_init(&self->entries[i].hash, 0);
+        atomic_init(&self->entries[i].lastUsed, 0);
+    }
+    self->maxEntryCount = options->maxEntryCount;
+    self->memoryBudget = options->memoryBudget;
+
+    if (options->deserializeOptions != 0) {
+        self->deserializeOptions = *options->deserializeOptions;
+        self->hasDeserializeOptions = 1;
+    }
+
+    atomic_init(&self->clock, 0);
+    atomic_init(&self->hitCount, 0);
+    atomic_init(&self->missCount, 0);
+    pthread_mutex_init(&self->mutex, 0);
+
+    return self;
+}
+
+void swtisCacheDestroy(SwtisCache* self)
+{
+    for (size_t i = 0; i < self->maxEntryCount; ++i) {
+        SwtisCacheEntry* entry = &self->entries[i];
+        if (entry->memory == 0) {
+            continue;
+        }
+        if (atomic_load(&entry->refCount) != 1) {
+            CLOG_ERROR("swtisCache: destroyed while an entry is still acquired")
+        }
+        tc_free(entry->octets);
+        tc_free(entry->memory);
+    }
+
+    pthread_mutex_destroy(&self->mutex);
+    tc_free(self->entries);
+    tc_free(self->slots);
+    tc_free(self);
+}
+
+int swtisCacheAcquire(SwtisCache* self, const uint8_t* octets, size_t octetCount, SwtisCacheEntry** outEntry)
+{
+    uint64_t hash = hashOctets(octets, octetCount);
+
+    SwtisCacheEntry* entry = findAndRetain(self, hash, octets, octetCount);
+    if (entry != 0) {
+        atomic_fetch_add_explicit(&self->hitCount, 1, memory_order_relaxed);
+        *outEntry = entry;
+        return 0;
+    }
+
+    // Misses are decoded while holding the lock, so each blob is only decoded once even if many ask at once
+    pthread_mutex_lock(&self->mutex);
+
+    entry = findAndRetain(self, hash, octets, octetCount);
+    if (entry != 0) {
+        pthread_mutex_unlock(&self->mutex);
+        atomic_fetch_add_explicit(&self->hitCount, 1, memory_order_relaxed);
+        *outEntry = entry;
+        return 0;
+    }
+
+    atomic_fetch_add_explicit(&self->missCount, 1, memory_order_relaxed);
+    int result = insert(self, hash, octets, octetCount, outEntry);
+
+    pthread_mutex_unlock(&self->mutex);
+
+    return result;
+}
+
+const SwtiChunk* swtisCacheEntryChunk(const SwtisCacheEntry* entry)
+{
+    return &entry->chunk;
+}
+
+void swtisCacheRelease(SwtisCache* self, SwtisCacheEntry* entry)
+{
+    (void) self;
+    releaseEntry(entry);
+}
+
+void swtisCacheStats(SwtisCache* self, SwtisCacheStats* outStats)
+{
+    pthread_mutex_lock(&self->mutex);
+    outStats->entryCount = self->entryCount;
+    outStats->memoryUsed = self->memoryUsed;
+    outStats->evictionCount = self->evictionCount;
+    pthread_mutex_unlock(&self->mutex);
+
+    outStats->hitCount = atomic_load_explicit(&self->hitCount, memory_order_relaxed);
+    outStats->missCount = atomic_load_explicit(&self->missCount, memory_order_relaxed);
+}
@@ -0,0 +1,516 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <flood/in_stream.h>
+#include <flood/out_stream.h>
+#include <imprint/allocator.h>
+#include <swamp-typeinfo-serialize/columnar.h>
+#include <swamp-typeinfo-serialize/value.h>
+#include <swamp-typeinfo-serialize/value_internal.h>
+#include <swamp-typeinfo/typeinfo.h>
+#include <tiny-libc/tiny_libc.h>
+
+typedef struct ColumnBuffer {
+    uint8_t* octets;
+    size_t count;
+    size_t capacity;
+} ColumnBuffer;
+
+typedef struct ColumnField {
+    const SwtiType* fieldType;
+    const SwtiMemoryInfo* slot;
+    size_t offset;
+    SwtisColumnEncoding encoding;
+    size_t scalarSize;
+    size_t variantCount;
+} ColumnField;
+
+static void bufferReserve(ColumnBuffer* buffer, size_t extra)
+{
+    if (buffer->count + extra <= buffer->capacity) {
+        return;
+    }
+
+    size_t newCapacity = buffer->capacity == 0 ? 256 : buffer->capacity * 2;
+    while (newCapacity < buffer->count + extra) {
+        newCapacity *= 2;
+    }
+
+    uint8_t* newOctets = tc_malloc(newCapacity);
+    if (buffer->count > 0) {
+        tc_memcpy_octets(newOctets, buffer->octets, buffer->count);
+    }
+    tc_free(buffer->octets);
+    buffer->octets = newOctets;
+    buffer->capacity = newCapacity;
+}
+
+static void bufferAppend(ColumnBuffer* buffer, const uint8_t* octets, size_t count)
+{
+    bufferReserve(buffer, count);
+    tc_memcpy_octets(buffer->octets + buffer->count, octets, count);
+    buffer->count += count;
+}
+
+static int isEnumLike(const SwtiCustomType* custom)
+{
+    for (size_t i = 0; i < custom->variantCount; ++i) {
+        if (custom->variantTypes[i]->paramCount != 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static void describeField(ColumnField* column, const SwtiRecordTypeField* field)
+{
+    const SwtiType* type = swtisValueUnalias(field->fieldType);
+    const SwtiMemoryInfo* slot = &field->memoryOffsetInfo.memoryInfo;
+    column->fieldType = field->fieldType;
+    column->slot = slot;
+    column->offset = field->memoryOffsetInfo.memoryOffset;
+    column->encoding = SwtisColumnEncodingValues;
+    column->scalarSize = 0;
+    column->variantCount = 0;
+
+    switch (type->type) {
+        case SwtiTypeInt:
+        case SwtiTypeFixed:
+        case SwtiTypeResourceName:
+            if (swtisValueScalarSize(type, slot, &column->scalarSize) == 0 && column->scalarSize == 4) {
+                column->encoding = SwtisColumnEncodingDelta;
+            }
+            break;
+        case SwtiTypeBoolean:
+            if (swtisValueScalarSize(type, slot, &column->scalarSize) == 0 && column->scalarSize == 1) {
+                column->encoding = SwtisColumnEncodingBits;
+            }
+            break;
+        case SwtiTypeChar:
+            if (swtisValueScalarSize(type, slot, &column->scalarSize) == 0 && column->scalarSize == 4) {
+                column->encoding = SwtisColumnEncodingDictionary;
+            }
+            break;
+        case SwtiTypeCustom: {
+            const SwtiCustomType* custom = (const SwtiCustomType*) type;
+            if (isEnumLike(custom) && custom->variantCount > 0) {
+                column->encoding = SwtisColumnEncodingDictionary;
+                column->scalarSize = 1;
+                column->variantCount = custom->variantCount;
+            }
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static size_t bitsNeeded(size_t count)
+{
+    size_t bits = 0;
+    while (((size_t) 1 << bits) < count) {
+        bits++;
+    }
+    return bits;
+}
+
+static uint32_t readColumnScalar(const uint8_t* source, size_t size)
+{
+    uint8_t octets[4] = {0, 0, 0, 0};
+    swtisValueCopyScalar(octets, source, size);
+    return swtisValueReadUInt32(octets);
+}
+
+static void writeColumnScalar(uint8_t* target, uint32_t value, size_t size)
+{
+    uint8_t octets[4];
+    swtisValueWriteUInt32(octets, value);
+    swtisValueCopyScalar(target, octets, size);
+}
+
+static void encodeDelta(ColumnBuffer* buffer, const ColumnField* column, const uint8_t* rows, size_t count,
+                        size_t stride)
+{
+    uint32_t* values = tc_malloc_type_count(uint32_t, count + 1);
+    for (size_t i = 0; i < count; ++i) {
+        values[i] = readColumnScalar(rows + i * stride + column->offset, 4);
+    }
+
+    for (size_t i = count; i > 1; --i) {
+        values[i - 1] -= values[i - 2];
+    }
+
+    bufferReserve(buffer, count * 5);
+    uint8_t* p = buffer->octets + buffer->count;
+    for (size_t i = 0; i < count; ++i) {
+        int32_t delta = (int32_t) values[i];
+        uint32_t zigZag = ((uint32_t) delta << 1) ^ (uint32_t) (delta >> 31);
+        while (zigZag >= 0x80) {
+            *p++ = (uint8_t) (zigZag | 0x80);
+            zigZag >>= 7;
+        }
+        *p++ = (uint8_t) zigZag;
+    }
+    buffer->count = (size_t) (p - buffer->octets);
+
+    tc_free(values);
+}
+
+static void encodeBits(ColumnBuffer* buffer, const ColumnField* column, const uint8_t* rows, size_t count,
+                       size_t stride)
+{
+    size_t octetCount = (count + 7) / 8;
+    bufferReserve(buffer, octetCount);
+    uint8_t* bits = buffer->octets + buffer->count;
+    tc_mem_clear(bits, octetCount);
+
+    for (size_t i = 0; i < count; ++i) {
+        bits[i >> 3] |= (uint8_t) ((rows[i * stride + column->offset] != 0) << (i & 7));
+    }
+
+    buffer->count += octetCount;
+}
+
+static void packBits(ColumnBuffer* buffer, const uint8_t* indices, size_t count, size_t bitWidth)
+{
+    size_t octetCount = (count * bitWidth + 7) / 8;
+    bufferReserve(buffer, octetCount);
+    uint8_t* packed = buffer->octets + buffer->count;
+    tc_mem_clear(packed, octetCount);
+
+    size_t bitPosition = 0;
+    for (size_t i = 0; i < count; ++i) {
+        for (size_t bit = 0; bit < bitWidth; ++bit) {
+            packed[bitPosition >> 3] |= (uint8_t) (((indices[i] >> bit) & 1) << (bitPosition & 7));
+            bitPosition++;
+        }
+    }
+
+    buffer->count += octetCount;
+}
+
+/// Returns 0 when there are too many distinct values for a dictionary.
+static int encodeDictionary(ColumnBuffer* buffer, const ColumnField* column, const uint8_t* rows, size_t count,
+                            size_t stride)
+{
+    uint32_t dictionary[SWTIS_COLUMNAR_MAX_DICTIONARY_COUNT];
+    size_t dictionaryCount = 0;
+    uint8_t* indices = tc_malloc(count + 1);
+
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t value = readColumnScalar(rows + i * stride + column->offset, column->scalarSize);
+        size_t found = 0;
+        while (found < dictionaryCount && dictionary[found] != value) {
+            found++;
+        }
+        if (found == dictionaryCount) {
+            if (dictionaryCount == SWTIS_COLUMNAR_MAX_DICTIONARY_COUNT) {
+                tc_free(indices);
+                return 0;
+            }
+            dictionary[dictionaryCount++] = value;
+        }
+        indices[i] = (uint8_t) found;
+    }
+
+    uint8_t header[3];
+    header[0] = (uint8_t) (dictionaryCount >> 8);
+    header[1] = (uint8_t) dictionaryCount;
+    size_t bitWidth = bitsNeeded(dictionaryCount);
+    header[2] = (uint8_t) bitWidth;
+    bufferAppend(buffer, header, 3);
+
+    for (size_t i = 0; i < dictionaryCount; ++i) {
+        uint8_t octets[4];
+        swtisValueWriteUInt32(octets, dictionary[i]);
+        bufferAppend(buffer, octets, column->scalarSize);
+    }
+
+    packBits(buffer, indices, count, bitWidth);
+    tc_free(indices);
+
+    return 1;
+}
+
+/// Written straight to the stream, the octet count in front of it is filled in afterwards.
+static int encodeValues(FldOutStream* stream, const ColumnField* column, const uint8_t* rows, size_t count,
+                        size_t stride)
+{
+    int error;
+
+    if ((error = fldOutStreamWriteUInt8(stream, SwtisColumnEncodingValues)) != 0 ||
+        (error = fldOutStreamWriteUInt32(stream, 0)) != 0) {
+        return error;
+    }
+
+    size_t countPos = stream->pos - 4;
+    for (size_t i = 0; i < count; ++i) {
+        if ((error = swtisValueSerializeInSlot(stream, column->fieldType, column->slot,
+                                               rows + i * stride + column->offset)) < 0) {
+            return error;
+        }
+    }
+
+    size_t endPos = stream->pos;
+    if (endPos - countPos - 4 > 0xffffffff) {
+        return -5;
+    }
+    stream->p = stream->octets + countPos;
+    stream->pos = countPos;
+    if ((error = fldOutStreamWriteUInt32(stream, (uint32_t) (endPos - countPos - 4))) != 0) {
+        return error;
+    }
+    stream->p = stream->octets + endPos;
+    stream->pos = endPos;
+
+    return 0;
+}
+
+/// Transposes the rows into one column per record field and writes them.
+int swtisColumnarEncode(FldOutStream* stream, const SwtiRecordType* record, const void* values, size_t count)
+{
+    const uint8_t* rows = (const uint8_t*) values;
+    size_t stride = record->memoryInfo.memorySize;
+    size_t tell = stream->pos;
+    int error;
+
+    if (count > 0xffffffff) {
+        return -5;
+    }
+
+    if ((error = fldOutStreamWriteUInt32(stream, (uint32_t) count)) != 0) {
+        return error;
+    }
+
+    ColumnBuffer buffer;
+    tc_mem_clear_type(&buffer);
+
+    for (size_t fieldIndex = 0; fieldIndex < record->fieldCount; ++fieldIndex) {
+        ColumnField column;
+        describeField(&column, &record->fields[fieldIndex]);
+        buffer.count = 0;
+
+        switch (column.encoding) {
+            case SwtisColumnEncodingDelta:
+                encodeDelta(&buffer, &column, rows, count, stride);
+                break;
+            case SwtisColumnEncodingBits:
+                encodeBits(&buffer, &column, rows, count, stride);
+                break;
+            case SwtisColumnEncodingDictionary:
+                if (!encodeDictionary(&buffer, &column, rows, count, stride)) {
+                    column.encoding = SwtisColumnEncodingValues;
+                }
+                break;
+            case SwtisColumnEncodingValues:
+                break;
+        }
+
+        if (column.encoding == SwtisColumnEncodingValues) {
+            error = encodeValues(stream, &column, rows, count, stride);
+        } else if ((error = fldOutStreamWriteUInt8(stream, (uint8_t) column.encoding)) == 0 &&
+                   (error = fldOutStreamWriteUInt32(stream, (uint32_t) buffer.count)) == 0) {
+            error = fldOutStreamWriteOctets(stream, buffer.octets, buffer.count);
+        }
+
+        if (error != 0) {
+            tc_free(buffer.octets);
+            return error;
+        }
+    }
+
+    tc_free(buffer.octets);
+
+    return (int) (stream->pos - tell);
+}
+
+static int decodeDelta(const uint8_t* payload, size_t payloadCount, const ColumnField* column, uint8_t* rows,
+                       size_t count, size_t stride)
+{
+    uint32_t* values = tc_malloc_type_count(uint32_t, count + 1);
+    const uint8_t* p = payload;
+    const uint8_t* end = payload + payloadCount;
+
+    for (size_t i = 0; i < count; ++i) {
+        uint32_t zigZag = 0;
+        for (size_t shift = 0;; shift += 7) {
+            if (p == end || shift > 28) {
+                tc_free(values);
+                return -8;
+            }
+            uint8_t octet = *p++;
+            zigZag |= (uint32_t) (octet & 0x7f) << shift;
+            if ((octet & 0x80) == 0) {
+                break;
+            }
+        }
+        values[i] = (zigZag >> 1) ^ (uint32_t) - (int32_t) (zigZag & 1);
+    }
+
+    for (size_t i = 1; i < count; ++i) {
+        values[i] += values[i - 1];
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        writeColumnScalar(rows + i * stride + column->offset, values[i], 4);
+    }
+
+    tc_free(values);
+
+    return 0;
+}
+
+static int decodeBits(const uint8_t* payload, size_t payloadCount, const ColumnField* column, uint8_t* rows,
+                      size_t count, size_t stride)
+{
+    if (payloadCount < (count + 7) / 8) {
+        return -8;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        rows[i * stride + column->offset] = (payload[i >> 3] >> (i & 7)) & 1;
+    }
+
+    return 0;
+}
+
+static int decodeDictionary(const uint8_t* payload, size_t payloadCount, const ColumnField* column, uint8_t* rows,
+                            size_t count, size_t stride)
+{
+    if (payloadCount < 3) {
+        return -8;
+    }
+
+    size_t dictionaryCount = ((size_t) payload[0] << 8) | payload[1];
+    size_t bitWidth = payload[2];
+    if (dictionaryCount == 0 || dictionaryCount > SWTIS_COLUMNAR_MAX_DICTIONARY_COUNT ||
+        bitWidth != bitsNeeded(dictionaryCount)) {
+        return -8;
+    }
+
+    size_t dictionaryOctetCount = dictionaryCount * column->scalarSize;
+    if (payloadCount < 3 + dictionaryOctetCount + (count * bitWidth + 7) / 8) {
+        return -8;
+    }
+
+    uint32_t dictionary[SWTIS_COLUMNAR_MAX_DICTIONARY_COUNT];
+    const uint8_t* p = payload + 3;
+    for (size_t i = 0; i < dictionaryCount; ++i) {
+        uint8_t octets[4] = {0, 0, 0, 0};
+        tc_memcpy_octets(octets, p, column->scalarSize);
+        dictionary[i] = swtisValueReadUInt32(octets);
+        if (column->variantCount != 0 && dictionary[i] >= column->variantCount) {
+            return -6;
+        }
+        p += column->scalarSize;
+    }
+
+    const uint8_t* packed = p;
+    size_t bitPosition = 0;
+    for (size_t i = 0; i < count; ++i) {
+        size_t index = 0;
+        for (size_t bit = 0; bit < bitWidth; ++bit) {
+            index |= (size_t) ((packed[bitPosition >> 3] >> (bitPosition & 7)) & 1) << bit;
+            bitPosition++;
+        }
+        if (index >= dictionaryCount) {
+            return -8;
+        }
+        writeColumnScalar(rows + i * stride + column->offset, dictionary[index], column->scalarSize);
+    }
+
+    return 0;
+}
+
+static int decodeValues(const uint8_t* payload, size_t payloadCount, const ColumnField* column, uint8_t* rows,
+                        size_t count, size_t stride, ImprintAllocator* allocator)
+{
+    FldInStream in;
+    fldInStreamInit(&in, payload, payloadCount);
+
+    int error;
+    for (size_t i = 0; i < count; ++i) {
+        if ((error = swtisValueDeserializeInSlot(&in, column->fieldType, column->slot,
+                                                 rows + i * stride + column->offset, allocator)) < 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+/// Reads a batch written by swtisColumnarEncode() back into row layout.
+int swtisColumnarDecode(FldInStream* stream, const SwtiRecordType* record, void* values, size_t maxCount,
+                        size_t* outCount, ImprintAllocator* allocator)
+{
+    uint8_t* rows = (uint8_t*) values;
+    size_t stride = record->memoryInfo.memorySize;
+    size_t tell = stream->pos;
+    int error;
+
+    uint32_t count;
+    if ((error = fldInStreamReadUInt32(stream, &count)) != 0) {
+        return error;
+    }
+
+    if (count > maxCount) {
+        CLOG_SOFT_ERROR("columnar: batch has %u values, room for %zu", count, maxCount)
+        return -7;
+    }
+
+    tc_mem_clear(rows, count * stride);
+
+    for (size_t fieldIndex = 0; fieldIndex < record->fieldCount; ++fieldIndex) {
+        const SwtiRecordTypeField* field = &record->fields[fieldIndex];
+        ColumnField column;
+        describeField(&column, field);
+
+        uint8_t encoding;
+        uint32_t payloadCount;
+        if ((error = fldInStreamReadUInt8(stream, &encoding)) != 0 ||
+            (error = fldInStreamReadUInt32(stream, &payloadCount)) != 0) {
+            return error;
+        }
+
+        if (encoding != SwtisColumnEncodingValues && encoding != column.encoding) {
+            CLOG_SOFT_ERROR("columnar: encoding %d does not match field '%s'", encoding, field->name)
+            return -9;
+        }
+
+        if (payloadCount > stream->size - stream->pos) {
+            return -7;
+        }
+
+        // Decoded in place, strings and blobs are copied to the allocator by the value codec
+        const uint8_t* payload = stream->octets + stream->pos;
+        stream->pos += payloadCount;
+        stream->p = stream->octets + stream->pos;
+
+        switch (encoding) {
+            case SwtisColumnEncodingDelta:
+                error = decodeDelta(payload, payloadCount, &column, rows, count, stride);
+                break;
+            case SwtisColumnEncodingBits:
+                error = decodeBits(payload, payloadCount, &column, rows, count, stride);
+                break;
+            case SwtisColumnEncodingDictionary:
+                error = decodeDictionary(payload, payloadCount, &column, rows, count, stride);
+                break;
+            default:
+                error = decodeValues(payload, payloadCount, &column, rows, count, stride, allocator);
+                break;
+        }
+
+        if (error != 0) {
+            CLOG_SOFT_ERROR("columnar: could not decode field '%s' %d", field->name, error)
+            return error;
+        }
+    }
+
+    *outCount = count;
+
+    return (int) (stream->pos - tell);
+}
@@ -0,0 +1,130 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <pthread.h>
+#include <string.h>
+#include <swamp-typeinfo-serialize/crc32c_internal.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define SWTIS_CRC32C_SSE42 (1)
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define SWTIS_CRC32C_ARMV8 (1)
+#endif
+
+#define SWTIS_CRC32C_POLYNOMIAL (0x82f63b78u)
+
+typedef uint32_t (*Crc32cFn)(uint32_t crc, const uint8_t* octets, size_t octetCount);
+
+static uint32_t table[8][256];
+static Crc32cFn crc32cFn;
+static pthread_once_t initOnce = PTHREAD_ONCE_INIT;
+
+/// Slicing-by-8: one table lookup per octet, eight octets per step, without any dependency between the lookups.
+static uint32_t crc32cPortable(uint32_t crc, const uint8_t* octets, size_t octetCount)
+{
+    while (octetCount > 0 && ((uintptr_t) octets & 7) != 0) {
+        crc = table[0][(crc ^ *octets++) & 0xff] ^ (crc >> 8);
+        octetCount--;
+    }
+
+    while (octetCount >= 8) {
+        uint32_t low = crc ^ ((uint32_t) octets[0] | ((uint32_t) octets[1] << 8) | ((uint32_t) octets[2] << 16) |
+                              ((uint32_t) octets[3] << 24));
+        crc = table[7][low & 0xff] ^ table[6][(low >> 8) & 0xff] ^ table[5][(low >> 16) & 0xff] ^ table[4][low >> 24] ^
+              table[3][octets[4]] ^ table[2][octets[5]] ^ table[1][octets[6]] ^ table[0][octets[7]];
+        octets += 8;
+        octetCount -= 8;
+    }
+
+    while (octetCount > 0) {
+        crc = table[0][(crc ^ *octets++) & 0xff] ^ (crc >> 8);
+        octetCount--;
+    }
+
+    return crc;
+}
+
+#if defined(SWTIS_CRC32C_SSE42)
+__attribute__((target("sse4.2"))) static uint32_t crc32cHardware(uint32_t crc, const uint8_t* octets,
+                                                                  size_t octetCount)
+{
+    uint64_t crc64 = crc;
+    while (octetCount >= 8) {
+        uint64_t word;
+        memcpy(&word, octets, 8);
+        crc64 = _mm_crc32_u64(crc64, word);
+        octets += 8;
+        octetCount -= 8;
+    }
+
+    uint32_t crc32 = (uint32_t) crc64;
+    while (octetCount > 0) {
+        crc32 = _mm_crc32_u8(crc32, *octets++);
+        octetCount--;
+    }
+
+    return crc32;
+}
+#elif defined(SWTIS_CRC32C_ARMV8)
+static uint32_t crc32cHardware(uint32_t crc, const uint8_t* octets, size_t octetCount)
+{
+    while (octetCount >= 8) {
+        uint64_t word;
+        memcpy(&word, octets, 8);
+        crc = __crc32cd(crc, word);
+        octets += 8;
+        octetCount -= 8;
+    }
+
+    while (octetCount > 0) {
+        crc = __crc32cb(crc, *octets++);
+        octetCount--;
+    }
+
+    return crc;
+}
+#endif
+
+static void init(void)
+{
+    for (uint32_t i = 0; i < 256; ++i) {
+        uint32_t crc = i;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc >> 1) ^ ((crc & 1) ? SWTIS_CRC32C_POLYNOMIAL : 0);
+        }
+        table[0][i] = crc;
+    }
+
+    for (uint32_t i = 0; i < 256; ++i) {
+        for (int slice = 1; slice < 8; ++slice) {
+            table[slice][i] = table[0][table[slice - 1][i] & 0xff] ^ (table[slice - 1][i] >> 8);
+        }
+    }
+
+    crc32cFn = crc32cPortable;
+
+#if defined(SWTIS_CRC32C_SSE42)
+    if (__builtin_cpu_supports("sse4.2")) {
+        crc32cFn = crc32cHardware;
+    }
+#elif defined(SWTIS_CRC32C_ARMV8)
+    crc32cFn = crc32cHardware;
+#endif
+}
+
+uint32_t swtisCrc32cUpdate(uint32_t crc, const uint8_t* octets, size_t octetCount)
+{
+    pthread_once(&initOnce, init);
+
+    return ~crc32cFn(~crc, octets, octetCount);
+}
+
+uint32_t swtisCrc32cUpdatePortable(uint32_t crc, const uint8_t* octets, size_t octetCount)
+{
+    pthread_once(&initOnce, init);
+
+    return ~crc32cPortable(~crc, octets, octetCount);
+}
@@ -0,0 +1,418 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <flood/in_stream.h>
+#include <flood/out_stream.h>
+#include <imprint/allocator.h>
+#include <swamp-typeinfo-serialize/delta.h>
+#include <swamp-typeinfo-serialize/value.h>
+#include <swamp-typeinfo-serialize/value_internal.h>
+#include <swamp-typeinfo/typeinfo.h>
+#include <tiny-libc/tiny_libc.h>
+
+#define SWTIS_DELTA_MAX_FIELD_COUNT (256)
+
+static const void* readPointer(const uint8_t* source)
+{
+    const void* pointer;
+    tc_memcpy_octets((void*) &pointer, source, sizeof(pointer));
+    return pointer;
+}
+
+static int isStructured(const SwtiType* type)
+{
+    return type->type == SwtiTypeRecord || type->type == SwtiTypeTuple || type->type == SwtiTypeCustom;
+}
+
+/// `owner` is a record, tuple or custom type variant.
+static size_t fieldCount(const SwtiType* owner)
+{
+    switch (owner->type) {
+        case SwtiTypeRecord:
+            return ((const SwtiRecordType*) owner)->fieldCount;
+        case SwtiTypeTuple:
+            return ((const SwtiTupleType*) owner)->fieldCount;
+        default:
+            return ((const SwtiCustomTypeVariant*) owner)->paramCount;
+    }
+}
+
+/// `outSlot` is the memory info of the field, see swtisValueScalarSize().
+static const SwtiType* fieldAt(const SwtiType* owner, size_t index, size_t* outOffset, const SwtiMemoryInfo** outSlot)
+{
+    const SwtiMemoryOffsetInfo* offsetInfo;
+    const SwtiType* fieldType;
+
+    switch (owner->type) {
+        case SwtiTypeRecord: {
+            const SwtiRecordTypeField* field = &((const SwtiRecordType*) owner)->fields[index];
+            offsetInfo = &field->memoryOffsetInfo;
+            fieldType = field->fieldType;
+            break;
+        }
+        case SwtiTypeTuple: {
+            const SwtiTupleTypeField* field = &((const SwtiTupleType*) owner)->fields[index];
+            offsetInfo = &field->memoryOffsetInfo;
+            fieldType = field->fieldType;
+            break;
+        }
+        default: {
+            const SwtiCustomTypeVariantField* field = &((const SwtiCustomTypeVariant*) owner)->fields[index];
+            offsetInfo = &field->memoryOffsetInfo;
+            fieldType = field->fieldType;
+            break;
+        }
+    }
+
+    *outOffset = offsetInfo->memoryOffset;
+    *outSlot = &offsetInfo->memoryInfo;
+
+    return fieldType;
+}
+
+static int octetsEqual(const uint8_t* a, const uint8_t* b, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (a[i] != b[i]) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int sequencesEqual(const uint8_t* a, size_t countA, const uint8_t* b, size_t countB)
+{
+    return countA == countB && (countA == 0 || a == b || octetsEqual(a, b, countA));
+}
+
+static int valuesEqual(const SwtiType* type, const SwtiMemoryInfo* slot, const uint8_t* a, const uint8_t* b,
+                       size_t depth);
+
+static int fieldsEqual(const SwtiType* owner, const uint8_t* a, const uint8_t* b, size_t depth)
+{
+    size_t count = fieldCount(owner);
+    for (size_t i = 0; i < count; ++i) {
+        size_t offset;
+        const SwtiMemoryInfo* slot;
+        const SwtiType* fieldType = fieldAt(owner, i, &offset, &slot);
+        if (!valuesEqual(fieldType, slot, a + offset, b + offset, depth)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int listsEqual(const SwtiType* type, const uint8_t* a, const uint8_t* b, size_t depth)
+{
+    const SwtisValueList* listA = readPointer(a);
+    const SwtisValueList* listB = readPointer(b);
+    if (listA == listB) {
+        return 1;
+    }
+
+    size_t countA = listA != 0 ? listA->count : 0;
+    size_t countB = listB != 0 ? listB->count : 0;
+    if (countA != countB) {
+        return 0;
+    }
+
+    const SwtiType* itemType = type->type == SwtiTypeList ? ((const SwtiListType*) type)->itemType
+                                                          : ((const SwtiArrayType*) type)->itemType;
+    const SwtiMemoryInfo* itemSlot = type->type == SwtiTypeList ? &((const SwtiListType*) type)->memoryInfo
+                                                                : &((const SwtiArrayType*) type)->memoryInfo;
+    for (size_t i = 0; i < countA; ++i) {
+        const uint8_t* itemA = (const uint8_t*) listA->value + i * listA->itemSize;
+        const uint8_t* itemB = (const uint8_t*) listB->value + i * listB->itemSize;
+        if (!valuesEqual(itemType, itemSlot, itemA, itemB, depth)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+static int valuesEqual(const SwtiType* type, const SwtiMemoryInfo* slot, const uint8_t* a, const uint8_t* b,
+                       size_t depth)
+{
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        return 0;
+    }
+
+    type = swtisValueUnalias(type);
+
+    switch (type->type) {
+        case SwtiTypeInt:
+        case SwtiTypeFixed:
+        case SwtiTypeBoolean:
+        case SwtiTypeChar:
+        case SwtiTypeResourceName: {
+            size_t size;
+            if (swtisValueScalarSize(type, slot, &size) != 0) {
+                return 0;
+            }
+            return octetsEqual(a, b, size);
+        }
+        case SwtiTypeString: {
+            const SwtisValueString* stringA = readPointer(a);
+            const SwtisValueString* stringB = readPointer(b);
+            return stringA == stringB ||
+                   sequencesEqual(stringA != 0 ? (const uint8_t*) stringA->characters : 0,
+                                  stringA != 0 ? stringA->characterCount : 0,
+                                  stringB != 0 ? (const uint8_t*) stringB->characters : 0,
+                                  stringB != 0 ? stringB->characterCount : 0);
+        }
+        case SwtiTypeBlob: {
+            const SwtisValueBlob* blobA = readPointer(a);
+            const SwtisValueBlob* blobB = readPointer(b);
+            return blobA == blobB || sequencesEqual(blobA != 0 ? blobA->octets : 0, blobA != 0 ? blobA->octetCount : 0,
+                                                    blobB != 0 ? blobB->octets : 0, blobB != 0 ? blobB->octetCount : 0);
+        }
+        case SwtiTypeList:
+        case SwtiTypeArray:
+            return listsEqual(type, a, b, depth + 1);
+        case SwtiTypeRecord:
+        case SwtiTypeTuple:
+            return fieldsEqual(type, a, b, depth + 1);
+        case SwtiTypeCustom: {
+            const SwtiCustomType* custom = (const SwtiCustomType*) type;
+            if (a[0] != b[0] || a[0] >= custom->variantCount) {
+                return 0;
+            }
+            return fieldsEqual(&custom->variantTypes[a[0]]->internal, a, b, depth + 1);
+        }
+        default:
+            return 0;
+    }
+}
+
+static int writeDelta(FldOutStream* stream, const SwtiType* type, const uint8_t* baseline, const uint8_t* value,
+                      size_t depth);
+
+static int writeChangedFields(FldOutStream* stream, const SwtiType* owner, const uint8_t* baseline,
+                              const uint8_t* value, size_t depth)
+{
+    size_t count = fieldCount(owner);
+    if (count > SWTIS_DELTA_MAX_FIELD_COUNT) {
+        CLOG_SOFT_ERROR("delta: too many fields %zu", count)
+        return -5;
+    }
+
+    uint8_t mask[SWTIS_DELTA_MAX_FIELD_COUNT / 8];
+    size_t maskOctetCount = (count + 7) / 8;
+    tc_mem_clear(mask, maskOctetCount);
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t offset;
+        const SwtiMemoryInfo* slot;
+        const SwtiType* fieldType = fieldAt(owner, i, &offset, &slot);
+        if (!valuesEqual(fieldType, slot, baseline + offset, value + offset, depth)) {
+            mask[i >> 3] |= (uint8_t) (1 << (i & 7));
+        }
+    }
+
+    int error;
+    if ((error = fldOutStreamWriteOctets(stream, mask, maskOctetCount)) != 0) {
+        return error;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if ((mask[i >> 3] & (1 << (i & 7))) == 0) {
+            continue;
+        }
+        size_t offset;
+        const SwtiMemoryInfo* slot;
+        const SwtiType* fieldType = swtisValueUnalias(fieldAt(owner, i, &offset, &slot));
+        if (isStructured(fieldType)) {
+            error = writeDelta(stream, fieldType, baseline + offset, value + offset, depth);
+        } else {
+            error = swtisValueSerializeInSlot(stream, fieldType, slot, value + offset);
+        }
+        if (error < 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+static int writeDelta(FldOutStream* stream, const SwtiType* type, const uint8_t* baseline, const uint8_t* value,
+                      size_t depth)
+{
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        CLOG_SOFT_ERROR("delta: too deep")
+        return -2;
+    }
+
+    if (type->type != SwtiTypeCustom) {
+        return writeChangedFields(stream, type, baseline, value, depth + 1);
+    }
+
+    const SwtiCustomType* custom = (const SwtiCustomType*) type;
+    uint8_t variantIndex = value[0];
+    if (variantIndex >= custom->variantCount) {
+        CLOG_SOFT_ERROR("delta: illegal variant %d for custom type %s", variantIndex, custom->internal.name)
+        return -6;
+    }
+
+    int error;
+    if ((error = fldOutStreamWriteUInt8(stream, variantIndex)) != 0) {
+        return error;
+    }
+
+    const SwtiCustomTypeVariant* variant = custom->variantTypes[variantIndex];
+    if (baseline[0] == variantIndex) {
+        return writeChangedFields(stream, &variant->internal, baseline, value, depth + 1);
+    }
+
+    for (size_t i = 0; i < variant->paramCount; ++i) {
+        const SwtiCustomTypeVariantField* field = &variant->fields[i];
+        if ((error = swtisValueSerializeInSlot(stream, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                               value + field->memoryOffsetInfo.memoryOffset)) < 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+static int applyDelta(FldInStream* stream, const SwtiType* type, uint8_t* target, ImprintAllocator* allocator,
+                      size_t depth);
+
+static int applyChangedFields(FldInStream* stream, const SwtiType* owner, uint8_t* target,
+                              ImprintAllocator* allocator, size_t depth)
+{
+    size_t count = fieldCount(owner);
+    if (count > SWTIS_DELTA_MAX_FIELD_COUNT) {
+        return -5;
+    }
+
+    uint8_t mask[SWTIS_DELTA_MAX_FIELD_COUNT / 8];
+    size_t maskOctetCount = (count + 7) / 8;
+    int error;
+
+    if ((error = fldInStreamReadOctets(stream, mask, maskOctetCount)) != 0) {
+        return error;
+    }
+
+    if ((count & 7) != 0 && (mask[maskOctetCount - 1] >> (count & 7)) != 0) {
+        CLOG_SOFT_ERROR("delta: changed field mask mentions fields that do not exist")
+        return -8;
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if ((mask[i >> 3] & (1 << (i & 7))) == 0) {
+            continue;
+        }
+        size_t offset;
+        const SwtiMemoryInfo* slot;
+        const SwtiType* fieldType = swtisValueUnalias(fieldAt(owner, i, &offset, &slot));
+        if (isStructured(fieldType)) {
+            error = applyDelta(stream, fieldType, target + offset, allocator, depth);
+        } else {
+            error = swtisValueDeserializeInSlot(stream, fieldType, slot, target + offset, allocator);
+        }
+        if (error < 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+static int applyDelta(FldInStream* stream, const SwtiType* type, uint8_t* target, ImprintAllocator* allocator,
+                      size_t depth)
+{
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        CLOG_SOFT_ERROR("delta: too deep")
+        return -2;
+    }
+
+    if (type->type != SwtiTypeCustom) {
+        return applyChangedFields(stream, type, target, allocator, depth + 1);
+    }
+
+    const SwtiCustomType* custom = (const SwtiCustomType*) type;
+    uint8_t variantIndex;
+    int error;
+
+    if ((error = fldInStreamReadUInt8(stream, &variantIndex)) != 0) {
+        return error;
+    }
+
+    if (variantIndex >= custom->variantCount) {
+        CLOG_SOFT_ERROR("delta: illegal variant %d for custom type %s", variantIndex, custom->internal.name)
+        return -6;
+    }
+
+    const SwtiCustomTypeVariant* variant = custom->variantTypes[variantIndex];
+    if (target[0] == variantIndex) {
+        return applyChangedFields(stream, &variant->internal, target, allocator, depth + 1);
+    }
+
+    tc_mem_clear(target, custom->memoryInfo.memorySize);
+    target[0] = variantIndex;
+
+    for (size_t i = 0; i < variant->paramCount; ++i) {
+        const SwtiCustomTypeVariantField* field = &variant->fields[i];
+        if ((error = swtisValueDeserializeInSlot(stream, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                                 target + field->memoryOffsetInfo.memoryOffset, allocator)) < 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+/// Writes only what differs between `baseline` and `value`. Returns the number of octets written.
+int swtisDeltaSerializeValue(FldOutStream* stream, const SwtiType* type, const void* baseline, const void* value)
+{
+    size_t tell = stream->pos;
+    int error;
+
+    type = swtisValueUnalias(type);
+    if (isStructured(type)) {
+        error = writeDelta(stream, type, (const uint8_t*) baseline, (const uint8_t*) value, 0);
+    } else if (valuesEqual(type, 0, (const uint8_t*) baseline, (const uint8_t*) value, 0)) {
+        error = fldOutStreamWriteUInt8(stream, 0);
+    } else if ((error = fldOutStreamWriteUInt8(stream, 1)) == 0) {
+        error = swtisSerializeValue(stream, type, value);
+    }
+
+    if (error < 0) {
+        return error;
+    }
+
+    return (int) (stream->pos - tell);
+}
+
+/// Returns the number of octets read.
+int swtisDeltaApplyValue(FldInStream* stream, const SwtiType* type, void* target, ImprintAllocator* allocator)
+{
+    size_t tell = stream->pos;
+    int error;
+
+    type = swtisValueUnalias(type);
+    if (isStructured(type)) {
+        error = applyDelta(stream, type, (uint8_t*) target, allocator, 0);
+    } else {
+        uint8_t changed;
+        if ((error = fldInStreamReadUInt8(stream, &changed)) == 0 && changed != 0) {
+            error = swtisDeserializeValue(stream, type, target, allocator);
+        }
+    }
+
+    if (error < 0) {
+        return error;
+    }
+
+    return (int) (stream->pos - tell);
+}
+
+int swtisDeltaValuesEqual(const SwtiType* type, const void* a, const void* b)
+{
+    return valuesEqual(type, 0, (const uint8_t*) a, (const uint8_t*) b, 0);
+}
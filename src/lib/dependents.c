@@ -0,0 +1,160 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <imprint/allocator.h>
+#include <swamp-typeinfo-serialize/dependents.h>
+#include <swamp-typeinfo-serialize/dependents_internal.h>
+#include <tiny-libc/tiny_libc.h>
+
+void swtisDependentsBuilderInit(SwtisDependentsBuilder* self)
+{
+    self->edges = 0;
+    self->edgeCount = 0;
+    self->edgeCapacity = 0;
+}
+
+void swtisDependentsBuilderAdd(SwtisDependentsBuilder* self, size_t referencedIndex, size_t fromIndex)
+{
+    if (self->edgeCount == self->edgeCapacity) {
+        size_t newCapacity = self->edgeCapacity == 0 ? 64 : self->edgeCapacity * 2;
+        SwtisDependentsBuilderEdge* newEdges = tc_malloc_type_count(SwtisDependentsBuilderEdge, newCapacity);
+        if (self->edgeCount > 0) {
+            tc_memcpy_octets(newEdges, self->edges, self->edgeCount * sizeof(SwtisDependentsBuilderEdge));
+        }
+        tc_free(self->edges);
+        self->edges = newEdges;
+        self->edgeCapacity = newCapacity;
+    }
+
+    SwtisDependentsBuilderEdge* edge = &self->edges[self->edgeCount++];
+    edge->referencedIndex = (uint16_t) referencedIndex;
+    edge->fromIndex = (uint16_t) fromIndex;
+}
+
+/// Sorts the edges into buckets by referenced type (counting sort) and drops duplicates.
+/// Edges are added in increasing `fromIndex` order, so duplicates end up next to each other in a bucket.
+int swtisDependentsBuilderFinish(SwtisDependentsBuilder* self, size_t typeCount, SwtisDependents* target,
+                                 ImprintAllocator* allocator)
+{
+    uint32_t* starts = tc_malloc_type_count(uint32_t, typeCount + 1);
+    tc_mem_clear_type_n(starts, typeCount + 1);
+
+    for (size_t i = 0; i < self->edgeCount; ++i) {
+        if (self->edges[i].referencedIndex >= typeCount) {
+            tc_free(starts);
+            return -3;
+        }
+        starts[self->edges[i].referencedIndex + 1]++;
+    }
+
+    for (size_t i = 0; i < typeCount; ++i) {
+        starts[i + 1] += starts[i];
+    }
+
+    uint16_t* sorted = tc_malloc_type_count(uint16_t, self->edgeCount + 1);
+    uint32_t* cursors = tc_malloc_type_count(uint32_t, typeCount + 1);
+    tc_memcpy_octets(cursors, starts, (typeCount + 1) * sizeof(uint32_t));
+    for (size_t i = 0; i < self->edgeCount; ++i) {
+        const SwtisDependentsBuilderEdge* edge = &self->edges[i];
+        sorted[cursors[edge->referencedIndex]++] = edge->fromIndex;
+    }
+    tc_free(cursors);
+
+    uint32_t* offsets = IMPRINT_ALLOC_TYPE_COUNT(allocator, uint32_t, typeCount + 1);
+    uint16_t* indices = IMPRINT_ALLOC_TYPE_COUNT(allocator, uint16_t, self->edgeCount + 1);
+    size_t count = 0;
+
+    for (size_t typeIndex = 0; typeIndex < typeCount; ++typeIndex) {
+        offsets[typeIndex] = (uint32_t) count;
+        size_t bucketStart = count;
+        for (size_t i = starts[typeIndex]; i < starts[typeIndex + 1]; ++i) {
+            if (count > bucketStart && indices[count - 1] == sorted[i]) {
+                continue;
+            }
+            indices[count++] = sorted[i];
+        }
+    }
+    offsets[typeCount] = (uint32_t) count;
+
+    tc_free(sorted);
+    tc_free(starts);
+
+    target->offsets = offsets;
+    target->indices = indices;
+    target->typeCount = typeCount;
+
+    return 0;
+}
+
+void swtisDependentsBuilderDestroy(SwtisDependentsBuilder* self)
+{
+    tc_free(self->edges);
+    self->edges = 0;
+    self->edgeCount = 0;
+    self->edgeCapacity = 0;
+}
+
+int swtisDependentsDirect(const SwtisDependents* self, size_t typeIndex, const uint16_t** outIndices,
+                          size_t* outCount)
+{
+    if (typeIndex >= self->typeCount) {
+        CLOG_SOFT_ERROR("dependents: type index %zu is out of range", typeIndex)
+        return -3;
+    }
+
+    *outIndices = self->indices + self->offsets[typeIndex];
+    *outCount = self->offsets[typeIndex + 1] - self->offsets[typeIndex];
+
+    return 0;
+}
+
+/// Breadth first, so the closest dependents come first.
+int swtisDependentsTransitive(const SwtisDependents* self, const uint16_t* changedIndices, size_t changedCount,
+                              uint16_t* outIndices, size_t maxCount)
+{
+    uint8_t* visited = tc_malloc(self->typeCount + 1);
+    uint16_t* queue = tc_malloc_type_count(uint16_t, self->typeCount + 1);
+    size_t queueCount = 0;
+    size_t outCount = 0;
+
+    tc_mem_clear(visited, self->typeCount);
+
+    for (size_t i = 0; i < changedCount; ++i) {
+        uint16_t changedIndex = changedIndices[i];
+        if (changedIndex >= self->typeCount) {
+            tc_free(queue);
+            tc_free(visited);
+            return -3;
+        }
+        if (!visited[changedIndex]) {
+            visited[changedIndex] = 1;
+            queue[queueCount++] = changedIndex;
+        }
+    }
+
+    for (size_t head = 0; head < queueCount; ++head) {
+        uint16_t typeIndex = queue[head];
+        for (uint32_t i = self->offsets[typeIndex]; i < self->offsets[typeIndex + 1]; ++i) {
+            uint16_t dependentIndex = self->indices[i];
+            if (visited[dependentIndex]) {
+                continue;
+            }
+            visited[dependentIndex] = 1;
+            queue[queueCount++] = dependentIndex;
+            if (outCount == maxCount) {
+                tc_free(queue);
+                tc_free(visited);
+                CLOG_SOFT_ERROR("dependents: more than %zu dependents", maxCount)
+                return -4;
+            }
+            outIndices[outCount++] = dependentIndex;
+        }
+    }
+
+    tc_free(queue);
+    tc_free(visited);
+
+    return (int) outCount;
+}
@@ -5,21 +5,81 @@
 #include <clog/clog.h>
 #include <flood/in_stream.h>
 #include <imprint/allocator.h>
+#include <swamp-typeinfo-serialize/codec_internal.h>
+#include <swamp-typeinfo-serialize/crc32c_internal.h>
 #include <swamp-typeinfo-serialize/deserialize.h>
 #include <swamp-typeinfo-serialize/deserialize_internal.h>
+#include <swamp-typeinfo-serialize/format.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/sections_internal.h>
+#include <swamp-typeinfo-serialize/unmanaged.h>
 #include <swamp-typeinfo-serialize/version.h>
 #include <swamp-typeinfo/chunk.h>
 #include <swamp-typeinfo/typeinfo.h>
 
-static int readString(FldInStream* stream, const char** outString, ImprintAllocator* allocator)
+typedef struct DeserializeContext {
+    FldInStream* stream;
+    ImprintAllocator* allocator;
+    uint8_t formatFlags;
+    int lazyNames;
+    int checkedReads;
+    uint32_t checksum;
+    size_t checksumPos;
+} DeserializeContext;
+
+/// Octets read before the checksum is updated. Small enough that they are still in the L1 cache.
+#define SWTIS_CHECKSUM_BATCH_OCTET_COUNT (1024)
+
+/// The checksum is updated as the types are read, while the octets are still in the cache.
+static void checksumTo(DeserializeContext* context, size_t pos, size_t minimumOctetCount)
 {
+    if (!(context->formatFlags & SWTIS_FORMAT_FLAG_CHECKSUM) || pos < context->checksumPos + minimumOctetCount ||
+        pos <= context->checksumPos) {
+        return;
+    }
+
+    context->checksum = swtisCrc32cUpdate(context->checksum, context->stream->octets + context->checksumPos,
+                                          pos - context->checksumPos);
+    context->checksumPos = pos;
+}
+
+static int readChecksum(DeserializeContext* context)
+{
+    if (!(context->formatFlags & SWTIS_FORMAT_FLAG_CHECKSUM)) {
+        return 0;
+    }
+
+    checksumTo(context, context->stream->pos, 0);
+
+    uint32_t expected;
+    int error;
+    if ((error = fldInStreamReadUInt32(context->stream, &expected)) != 0) {
+        return error;
+    }
+
+    if (expected != context->checksum) {
+        CLOG_SOFT_ERROR("checksum mismatch. expected %08X but got %08X", expected, context->checksum)
+        return -7;
+    }
+
+    return 0;
+}
+
+static int readString(DeserializeContext* context, const char** outString)
+{
+    if (context->formatFlags & SWTIS_FORMAT_FLAG_SECTIONED) {
+        // Filled in from the names section, if there is one
+        *outString = "";
+        return 0;
+    }
+
     int error;
     uint8_t count;
-    if ((error = fldInStreamReadUInt8(stream, &count)) != 0) {
+    if ((error = fldInStreamReadUInt8(context->stream, &count)) != 0) {
         return error;
     }
-    uint8_t* characters = IMPRINT_ALLOC(allocator, count + 1, "readString");
-    if ((error = fldInStreamReadOctets(stream, characters, count)) != 0) {
+    uint8_t* characters = IMPRINT_ALLOC(context->allocator, count + 1, "readString");
+    if ((error = fldInStreamReadOctets(context->stream, characters, count)) != 0) {
         return error;
     }
     characters[count] = 0;
@@ -28,18 +88,24 @@ static int readString(FldInStream* stream, const char** outString, ImprintAlloca
     return 0;
 }
 
-static int readMemoryOffset(FldInStream* stream, uint16_t* memoryOffset)
+static int readMemoryOffset(DeserializeContext* context, uint16_t* memoryOffset)
 {
-    return fldInStreamReadUInt16(stream, memoryOffset);
+    return fldInStreamReadUInt16(context->stream, memoryOffset);
 }
 
-static int readMemoryInfo(FldInStream* stream, SwtiMemoryInfo* memoryInfo)
+static int readMemoryInfo(DeserializeContext* context, SwtiMemoryInfo* memoryInfo)
 {
-    int err = fldInStreamReadUInt16(stream, &memoryInfo->memorySize);
+    if (context->formatFlags & SWTIS_FORMAT_FLAG_LAYOUT_OMITTED) {
+        memoryInfo->memorySize = 0;
+        memoryInfo->memoryAlign = 0;
+        return 0;
+    }
+
+    int err = fldInStreamReadUInt16(context->stream, &memoryInfo->memorySize);
     if (err < 0) {
         return err;
     }
-    err = fldInStreamReadUInt8(stream, &memoryInfo->memoryAlign);
+    err = fldInStreamReadUInt8(context->stream, &memoryInfo->memoryAlign);
     if (err < 0) {
         return err;
     }
@@ -47,20 +113,25 @@ static int readMemoryInfo(FldInStream* stream, SwtiMemoryInfo* memoryInfo)
     return 0;
 }
 
-static int readMemoryOffsetInfo(FldInStream* stream, SwtiMemoryOffsetInfo* memoryOffset)
+static int readMemoryOffsetInfo(DeserializeContext* context, SwtiMemoryOffsetInfo* memoryOffset)
 {
-    int err = readMemoryOffset(stream, &memoryOffset->memoryOffset);
+    if (context->formatFlags & SWTIS_FORMAT_FLAG_LAYOUT_OMITTED) {
+        memoryOffset->memoryOffset = 0;
+        return readMemoryInfo(context, &memoryOffset->memoryInfo);
+    }
+
+    int err = readMemoryOffset(context, &memoryOffset->memoryOffset);
     if (err < 0) {
         return err;
     }
-    return readMemoryInfo(stream, &memoryOffset->memoryInfo);
+    return readMemoryInfo(context, &memoryOffset->memoryInfo);
 }
 
-static int readTypeRef(FldInStream* stream, const SwtiType** type)
+static int readTypeRef(DeserializeContext* context, const SwtiType** type)
 {
     uint16_t index;
     int error;
-    if ((error = fldInStreamReadUInt16(stream, &index)) != 0) {
+    if ((error = fldInStreamReadUInt16(context->stream, &index)) != 0) {
         return error;
     }
 
@@ -74,611 +145,847 @@ static int readTypeRef(FldInStream* stream, const SwtiType** type)
     return 0;
 }
 
-static int readCount(FldInStream* stream, uint8_t* count)
+/// Allocates and initializes the struct for `typeValue`, the layout is read into it afterwards. Returns zero if the
+/// type value is unknown.
+static SwtiType* allocateType(DeserializeContext* context, SwtiTypeValue typeValue)
 {
-    int error;
+    ImprintAllocator* allocator = context->allocator;
 
-    if ((error = fldInStreamReadUInt8(stream, count)) != 0) {
-        return error;
+    switch (typeValue) {
+        case SwtiTypeCustom: {
+            SwtiCustomType* custom = IMPRINT_ALLOC_TYPE(allocator, SwtiCustomType);
+            swtiInitCustom(custom, 0, 0, 0, allocator);
+            return &custom->internal;
+        }
+        case SwtiTypeCustomVariant: {
+            SwtiCustomTypeVariant* variant = IMPRINT_ALLOC_TYPE(allocator, SwtiCustomTypeVariant);
+            swtiInitVariant(variant, 0, 0, allocator);
+            return &variant->internal;
+        }
+        case SwtiTypeFunction: {
+            SwtiFunctionType* fn = IMPRINT_ALLOC_TYPE(allocator, SwtiFunctionType);
+            swtiInitFunction(fn, 0, 0, allocator);
+            return &fn->internal;
+        }
+        case SwtiTypeAlias: {
+            SwtiAliasType* alias = IMPRINT_ALLOC_TYPE(allocator, SwtiAliasType);
+            alias->internal.type = SwtiTypeAlias;
+            return &alias->internal;
+        }
+        case SwtiTypeRefId: {
+            SwtiTypeRefIdType* typeRefId = IMPRINT_ALLOC_TYPE(allocator, SwtiTypeRefIdType);
+            typeRefId->internal.type = SwtiTypeRefId;
+            typeRefId->internal.name = "TypeRefId";
+            return &typeRefId->internal;
+        }
+        case SwtiTypeRecord: {
+            SwtiRecordType* record = IMPRINT_ALLOC_TYPE(allocator, SwtiRecordType);
+            swtiInitRecord(record);
+            return &record->internal;
+        }
+        case SwtiTypeArray: {
+            SwtiArrayType* array = IMPRINT_ALLOC_TYPE(allocator, SwtiArrayType);
+            swtiInitArray(array);
+            return &array->internal;
+        }
+        case SwtiTypeList: {
+            SwtiListType* list = IMPRINT_ALLOC_TYPE(allocator, SwtiListType);
+            swtiInitList(list);
+            return &list->internal;
+        }
+        case SwtiTypeTuple: {
+            SwtiTupleType* tuple = IMPRINT_ALLOC_TYPE(allocator, SwtiTupleType);
+            swtiInitTuple(tuple, 0, 0, allocator);
+            return &tuple->internal;
+        }
+        case SwtiTypeUnmanaged: {
+            SwtiUnmanagedType* unmanaged = IMPRINT_ALLOC_TYPE(allocator, SwtiUnmanagedType);
+            unmanaged->internal.index = 0;
+            unmanaged->internal.hash = 0;
+            unmanaged->userTypeId = 0;
+            swtiInitUnmanaged(unmanaged, 0, 0, allocator);
+            return &unmanaged->internal;
+        }
+        case SwtiTypeString: {
+            SwtiStringType* string = IMPRINT_ALLOC_TYPE(allocator, SwtiStringType);
+            swtiInitString(string);
+            return &string->internal;
+        }
+        case SwtiTypeFixed: {
+            SwtiFixedType* fixed = IMPRINT_ALLOC_TYPE(allocator, SwtiFixedType);
+            swtiInitFixed(fixed);
+            return &fixed->internal;
+        }
+        case SwtiTypeBoolean: {
+            SwtiBooleanType* bool = IMPRINT_ALLOC_TYPE(allocator, SwtiBooleanType);
+            swtiInitBoolean(bool);
+            return &bool->internal;
+        }
+        case SwtiTypeBlob: {
+            SwtiBlobType* blob = IMPRINT_ALLOC_TYPE(allocator, SwtiBlobType);
+            swtiInitBlob(blob);
+            return &blob->internal;
+        }
+        case SwtiTypeChar: {
+            SwtiCharType* ch = IMPRINT_ALLOC_TYPE(allocator, SwtiCharType);
+            swtiInitChar(ch);
+            return &ch->internal;
+        }
+        case SwtiTypeAny: {
+            SwtiAnyType* any = IMPRINT_ALLOC_TYPE(allocator, SwtiAnyType);
+            swtiInitAny(any);
+            return &any->internal;
+        }
+        case SwtiTypeAnyMatchingTypes: {
+            SwtiAnyMatchingTypesType* anyMatchingTypes = IMPRINT_ALLOC_TYPE(allocator, SwtiAnyMatchingTypesType);
+            swtiInitAnyMatchingTypes(anyMatchingTypes);
+            return &anyMatchingTypes->internal;
+        }
+        case SwtiTypeInt:
+        case SwtiTypeResourceName: {
+            SwtiIntType* intType = IMPRINT_ALLOC_TYPE(allocator, SwtiIntType);
+            swtiInitInt(intType);
+            return &intType->internal;
+        }
+        default:
+            return 0;
     }
-
-    return 0;
 }
 
-static int readTypeRefs(FldInStream* stream, const SwtiType*** outTypes, size_t* outCount, ImprintAllocator* allocator)
+#define READ_CHECK(expression)             \
+    if ((error = (expression)) != 0) {     \
+        return error;                      \
+    }
+
+#define READ_NAME(self, member) READ_CHECK(readString(context, &(self)->member))
+#define READ_EMPTY_NAME(self, member) (self)->member = "";
+#define READ_MEMORY_INFO(self, member) READ_CHECK(readMemoryInfo(context, &(self)->member))
+#define READ_MEMORY_OFFSET_INFO(self, member) READ_CHECK(readMemoryOffsetInfo(context, &(self)->member))
+#define READ_OWNER(self, member, Pointer, ACCEPT)    \
+    {                                                \
+        const SwtiType* ref;                         \
+        READ_CHECK(readTypeRef(context, &ref))       \
+        (self)->member = (Pointer) ref;              \
+    }
+#define READ_REF READ_OWNER
+#define READ_REFS(self, member, count, Pointer, ACCEPT)                                    \
+    {                                                                                      \
+        uint8_t refCount;                                                                  \
+        READ_CHECK(fldInStreamReadUInt8(context->stream, &refCount))                       \
+        Pointer* refs = IMPRINT_ALLOC_TYPE_COUNT(context->allocator, Pointer, refCount);   \
+        for (uint8_t refIndex = 0; refIndex < refCount; ++refIndex) {                      \
+            const SwtiType* ref;                                                           \
+            READ_CHECK(readTypeRef(context, &ref))                                         \
+            refs[refIndex] = (Pointer) ref;                                                \
+        }                                                                                  \
+        (self)->member = refs;                                                             \
+        (self)->count = refCount;                                                          \
+    }
+#define READ_U16(self, member) READ_CHECK(fldInStreamReadUInt16(context->stream, &(self)->member))
+#define READ_ITEMS(self, member, count, Item, item, ...)                                          \
+    {                                                                                             \
+        uint8_t item##Count;                                                                      \
+        READ_CHECK(fldInStreamReadUInt8(context->stream, &item##Count))                           \
+        Item* item##Items = IMPRINT_ALLOC_TYPE_COUNT(context->allocator, Item, item##Count);      \
+        (self)->member = item##Items;                                                             \
+        (self)->count = item##Count;                                                              \
+        for (uint8_t item##Index = 0; item##Index < item##Count; ++item##Index) {                 \
+            Item* item = &item##Items[item##Index];                                               \
+            __VA_ARGS__                                                                           \
+        }                                                                                         \
+    }
+
+#define READ_KIND(typeValue, Struct, LAYOUT)   \
+    case typeValue: {                          \
+        Struct* self = (Struct*) type;         \
+        SWTIS_CODEC_EXPAND(LAYOUT, READ)       \
+        break;                                 \
+    }
+#define READ_BARE(typeValue) \
+    case typeValue:          \
+        break;
+
+/// Reads every value through the bounds checked stream. Expanded from the layouts in codec_internal.h.
+static int readType(DeserializeContext* context, const SwtiType** outType)
 {
+    uint8_t typeValueRaw;
     int error;
-    uint8_t count;
-    if ((error = fldInStreamReadUInt8(stream, &count)) != 0) {
-        *outTypes = 0;
-        *outCount = 0;
+    if ((error = fldInStreamReadUInt8(context->stream, &typeValueRaw)) != 0) {
+        CLOG_SOFT_ERROR("readType couldn't read type")
         return error;
     }
 
-    const SwtiType** types = IMPRINT_ALLOC_TYPE_COUNT(allocator, const SwtiType*, count);
-    for (uint8_t i = 0; i < count; i++) {
-        if ((error = readTypeRef(stream, &types[i])) != 0) {
-            CLOG_ERROR("couldn't read type ref %d", error);
-            return error;
-        }
+    SwtiTypeValue typeValue = (SwtiTypeValue) typeValueRaw;
+    SwtiType* type = allocateType(context, typeValue);
+    if (type == 0) {
+        CLOG_ERROR("type information: readType unknown type:%d", typeValue)
+        return -14;
     }
+    *outType = type;
 
-    *outTypes = (const SwtiType**) types;
-    *outCount = (size_t) count;
+    switch (typeValue) {
+        SWTIS_CODEC_KINDS(READ_KIND, READ_BARE)
+        default:
+            break;
+    }
 
     return 0;
 }
 
-static int readVariantField(FldInStream* stream, SwtiCustomTypeVariantField* field)
-{
-    int err = readTypeRef(stream, &field->fieldType);
-    if (err < 0) {
-        return err;
-    }
+static int measureType(const uint8_t* octets, size_t octetCount, uint8_t formatFlags, size_t* outOctetCount);
 
-    int memoryOffsetErr = readMemoryOffsetInfo(stream, &field->memoryOffsetInfo);
-    if (memoryOffsetErr < 0) {
-        return memoryOffsetErr;
-    }
+// Unchecked decoding, for types that measureType() has already bounds checked. It must read exactly the octets that
+// measureType() counts.
 
-    return 0;
+static inline uint8_t loadUInt8(const uint8_t** p)
+{
+    return *(*p)++;
 }
 
-static int readVariantEmbedded(FldInStream* stream, SwtiCustomTypeVariant* variant, ImprintAllocator* allocator)
+static inline uint16_t loadUInt16(const uint8_t** p)
 {
-    const char* name;
+    uint16_t value = (uint16_t) (((*p)[0] << 8) | (*p)[1]);
+    *p += 2;
+    return value;
+}
 
-    readString(stream, &name, allocator);
-    variant->name = name;
+static inline const SwtiType* loadTypeRef(const uint8_t** p)
+{
+    return (const SwtiType*) (intptr_t) loadUInt16(p);
+}
 
-    int error = readMemoryInfo(stream, &variant->memoryInfo);
-    if (error < 0) {
-        return error;
+static inline const char* loadString(DeserializeContext* context, const uint8_t** p)
+{
+    if (context->formatFlags & SWTIS_FORMAT_FLAG_SECTIONED) {
+        return "";
     }
 
-    error = readCount(stream, &variant->paramCount);
-    if (error < 0) {
-        return error;
-    }
+    uint8_t count = loadUInt8(p);
+    uint8_t* characters = IMPRINT_ALLOC(context->allocator, count + 1, "loadString");
+    tc_memcpy_octets(characters, *p, count);
+    characters[count] = 0;
+    *p += count;
 
-    SwtiCustomTypeVariantField* fields = IMPRINT_ALLOC_TYPE_COUNT(allocator, SwtiCustomTypeVariantField, variant->paramCount);
-    variant->fields = fields;
-    for (size_t i=0; i<variant->paramCount; ++i) {
-        int readErr = readVariantField(stream, (SwtiCustomTypeVariantField *)&variant->fields[i]);
-        if (readErr < 0) {
-            return readErr;
-        }
-    }
-    return 0;
+    return (const char*) characters;
 }
 
-static int readVariant(FldInStream* stream, SwtiCustomTypeVariant** out, ImprintAllocator* allocator)
+static inline void loadMemoryInfo(DeserializeContext* context, const uint8_t** p, SwtiMemoryInfo* memoryInfo)
 {
-    SwtiCustomTypeVariant* variant = IMPRINT_ALLOC_TYPE(allocator, SwtiCustomTypeVariant);
-
-    swtiInitVariant(variant, 0, 0, allocator);
-
-    *out = variant;
-
-    const SwtiType* hopefullyCustomType;
-    readTypeRef(stream, &hopefullyCustomType);
-
-    variant->inCustomType = (const SwtiCustomType*) hopefullyCustomType;
+    if (context->formatFlags & SWTIS_FORMAT_FLAG_LAYOUT_OMITTED) {
+        memoryInfo->memorySize = 0;
+        memoryInfo->memoryAlign = 0;
+        return;
+    }
 
-    return readVariantEmbedded(stream, variant, allocator);
+    memoryInfo->memorySize = loadUInt16(p);
+    memoryInfo->memoryAlign = loadUInt8(p);
 }
 
-static int readEmbeddedVariants(FldInStream* stream, SwtiCustomType* custom, uint8_t count, ImprintAllocator* allocator)
+static inline void loadMemoryOffsetInfo(DeserializeContext* context, const uint8_t** p,
+                                        SwtiMemoryOffsetInfo* memoryOffset)
 {
-    custom->variantTypes = IMPRINT_ALLOC_TYPE_COUNT(allocator, const SwtiCustomTypeVariant*, count);
-    for (uint8_t i = 0; i < count; i++) {
-        SwtiCustomTypeVariant** field = (SwtiCustomTypeVariant**) &custom->variantTypes[i];
-        const SwtiType* hopefullyCustomVariantType;
-        readTypeRef(stream, &hopefullyCustomVariantType);
-        *field = ( SwtiCustomTypeVariant *) hopefullyCustomVariantType;
-      }
-
-    return 0;
+    memoryOffset->memoryOffset = (context->formatFlags & SWTIS_FORMAT_FLAG_LAYOUT_OMITTED) ? 0 : loadUInt16(p);
+    loadMemoryInfo(context, p, &memoryOffset->memoryInfo);
 }
 
-static int readGenerics(FldInStream* stream, SwtiGenericParams* params, ImprintAllocator* allocator)
+#define LOAD_NAME(self, member) (self)->member = loadString(context, &p);
+#define LOAD_EMPTY_NAME(self, member) (self)->member = "";
+#define LOAD_MEMORY_INFO(self, member) loadMemoryInfo(context, &p, &(self)->member);
+#define LOAD_MEMORY_OFFSET_INFO(self, member) loadMemoryOffsetInfo(context, &p, &(self)->member);
+#define LOAD_OWNER(self, member, Pointer, ACCEPT) (self)->member = (Pointer) loadTypeRef(&p);
+#define LOAD_REF LOAD_OWNER
+#define LOAD_REFS(self, member, count, Pointer, ACCEPT)                                    \
+    {                                                                                      \
+        uint8_t refCount = loadUInt8(&p);                                                  \
+        Pointer* refs = IMPRINT_ALLOC_TYPE_COUNT(context->allocator, Pointer, refCount);   \
+        for (uint8_t refIndex = 0; refIndex < refCount; ++refIndex) {                      \
+            refs[refIndex] = (Pointer) loadTypeRef(&p);                                    \
+        }                                                                                  \
+        (self)->member = refs;                                                             \
+        (self)->count = refCount;                                                          \
+    }
+#define LOAD_U16(self, member) (self)->member = loadUInt16(&p);
+#define LOAD_ITEMS(self, member, count, Item, item, ...)                                          \
+    {                                                                                             \
+        uint8_t item##Count = loadUInt8(&p);                                                      \
+        Item* item##Items = IMPRINT_ALLOC_TYPE_COUNT(context->allocator, Item, item##Count);      \
+        for (uint8_t item##Index = 0; item##Index < item##Count; ++item##Index) {                 \
+            Item* item = &item##Items[item##Index];                                               \
+            __VA_ARGS__                                                                           \
+        }                                                                                         \
+        (self)->member = item##Items;                                                             \
+        (self)->count = item##Count;                                                              \
+    }
+
+#define LOAD_KIND(typeValue, Struct, LAYOUT)   \
+    case typeValue: {                          \
+        Struct* self = (Struct*) type;         \
+        SWTIS_CODEC_EXPAND(LAYOUT, LOAD)       \
+        break;                                 \
+    }
+#define LOAD_BARE(typeValue) \
+    case typeValue:          \
+        break;
+
+/// Same result as readType(), but `octets` must hold the whole type, as measured by measureType(). Expanded from the
+/// layouts in codec_internal.h.
+static int loadType(DeserializeContext* context, const uint8_t* octets, size_t octetCount, const SwtiType** outType)
 {
-    int error;
+    const uint8_t* p = octets;
+    SwtiTypeValue typeValue = (SwtiTypeValue) loadUInt8(&p);
+    SwtiType* type = allocateType(context, typeValue);
+    if (type == 0) {
+        CLOG_ERROR("type information: loadType unknown type:%d", typeValue)
+        return -14;
+    }
 
-    if ((error = readTypeRefs(stream, &params->genericTypes, &params->genericCount, allocator)) != 0) {
-        return error;
+    switch (typeValue) {
+        SWTIS_CODEC_KINDS(LOAD_KIND, LOAD_BARE)
+        default:
+            break;
     }
 
+    if ((size_t) (p - octets) != octetCount) {
+        CLOG_SOFT_ERROR("loadType read %zu octets but measured %zu", (size_t) (p - octets), octetCount)
+        return -6;
+    }
+
+    *outType = type;
+
     return 0;
 }
 
-static int readCustomType(FldInStream* stream, SwtiCustomType** outCustom, ImprintAllocator* allocator)
+static int readHeader(DeserializeContext* context, uint16_t* outTypeCount)
 {
-    SwtiCustomType* custom = IMPRINT_ALLOC_TYPE(allocator, SwtiCustomType);
-    swtiInitCustom(custom, 0, 0, 0, allocator);
-    //tc_free((void*)custom->variantTypes);
     int error;
+    uint8_t major;
+    uint8_t minor;
+    uint8_t patch;
 
-    if ((error = readString(stream, &custom->internal.name, allocator)) != 0) {
-        return error;
-    }
+    FldInStream* stream = context->stream;
 
-    error = readMemoryInfo(stream, &custom->memoryInfo);
-    if (error < 0) {
+    if ((error = fldInStreamReadUInt8(stream, &major)) != 0) {
         return error;
     }
-
-    if ((error = readGenerics(stream, &custom->generic, allocator)) != 0) {
+    if ((error = fldInStreamReadUInt8(stream, &minor)) != 0) {
         return error;
     }
-
-    uint8_t variantCount;
-    if ((error = fldInStreamReadUInt8(stream, &variantCount)) != 0) {
+    if ((error = fldInStreamReadUInt8(stream, &patch)) != 0) {
         return error;
     }
 
-    if (variantCount > 32) {
-        CLOG_ERROR("too many variants %d", variantCount)
+    int correct = (major == SWTI_SERIALIZE_VERSION_MAJOR) && (minor == SWTI_SERIALIZE_VERSION_MINOR) && (patch == SWTI_SERIALIZE_VERSION_PATCH);
+    if (!correct) {
+        CLOG_SOFT_ERROR("got wrong version. Expected %d.%d.%d and got %d.%d.%d", SWTI_SERIALIZE_VERSION_MAJOR, SWTI_SERIALIZE_VERSION_MINOR, SWTI_SERIALIZE_VERSION_PATCH, major, minor, patch)
+        return -2;
     }
 
-    custom->variantCount = variantCount;
-
-    if ((error = readEmbeddedVariants(stream, custom, variantCount, allocator)) != 0) {
-        *outCustom = 0;
+    if ((error = fldInStreamReadUInt8(stream, &context->formatFlags)) != 0) {
         return error;
     }
 
-    *outCustom = custom;
+    if (context->formatFlags & ~SWTIS_FORMAT_FLAGS_KNOWN) {
+        CLOG_SOFT_ERROR("unknown format flags %02X", context->formatFlags)
+        return -5;
+    }
 
-    return 0;
+    return fldInStreamReadUInt16(stream, outTypeCount);
 }
 
-static int readRecordField(FldInStream* stream, SwtiRecordTypeField* field, ImprintAllocator* allocator)
+static void initTypes(DeserializeContext* context, SwtiChunk* target, uint16_t typeCount)
 {
+    const struct SwtiType** array = IMPRINT_ALLOC_TYPE_COUNT(context->allocator, const SwtiType*, typeCount);
+    target->types = array;
+    tc_mem_clear_type_n(array, typeCount);
+    target->typeCount = typeCount;
+}
+
+static void seek(FldInStream* stream, size_t pos)
+{
+    stream->p = stream->octets + pos;
+    stream->pos = pos;
+}
+
+/// Bounds checks the whole type once, then reads it without checks.
+static int readTypeMeasured(DeserializeContext* context, const SwtiType** outType)
+{
+    FldInStream* stream = context->stream;
+    size_t octetCount;
     int error;
-    if ((error = readString(stream, &field->name, allocator)) != 0) {
+    if ((error = measureType(stream->p, stream->size - stream->pos, context->formatFlags, &octetCount)) != 0) {
         return error;
     }
 
-    error = readMemoryOffsetInfo(stream, &field->memoryOffsetInfo);
-    if (error < 0) {
+    if ((error = loadType(context, stream->p, octetCount, outType)) != 0) {
         return error;
     }
 
-    return readTypeRef(stream,  &field->fieldType);
+    seek(stream, stream->pos + octetCount);
+
+    return 0;
 }
 
-static int readRecordFields(FldInStream* stream, SwtiRecordType* record, uint8_t count, ImprintAllocator* allocator)
+static int readTypes(DeserializeContext* context, SwtiChunk* target)
 {
     int error;
-    record->fields = IMPRINT_ALLOC_TYPE_COUNT(allocator, SwtiRecordTypeField, count);
-    for (uint8_t i = 0; i < count; i++) {
-        if ((error = readRecordField(stream, (SwtiRecordTypeField*) &record->fields[i], allocator)) != 0) {
+
+    for (size_t i = 0; i < target->typeCount; i++) {
+        if (context->checkedReads) {
+            error = readType(context, &target->types[i]);
+        } else {
+            error = readTypeMeasured(context, &target->types[i]);
+        }
+        if (error != 0) {
             return error;
         }
+        ((SwtiType*) (target->types[i]))->index = i;
+        checksumTo(context, context->stream->pos, SWTIS_CHECKSUM_BATCH_OCTET_COUNT);
     }
-    record->fieldCount = count;
 
     return 0;
 }
 
-static int readRecord(FldInStream* stream, SwtiRecordType** outRecord, ImprintAllocator* allocator)
+static int readSections(DeserializeContext* context, SwtiChunk* target, size_t tell)
 {
-    SwtiRecordType* record = IMPRINT_ALLOC_TYPE(allocator, SwtiRecordType);
-    swtiInitRecord(record);
+    FldInStream* stream = context->stream;
+    SwtisSectionDirectory directory;
     int error;
-    uint8_t fieldCount;
 
-    if ((error = readMemoryInfo(stream, &record->memoryInfo)) != 0) {
+    if ((error = swtisSectionDirectoryRead(&directory, stream->octets + tell, stream->size - tell)) != 0) {
+        CLOG_SOFT_ERROR("could not read section directory %d", error)
         return error;
     }
 
-    if ((error = fldInStreamReadUInt8(stream, &fieldCount)) != 0) {
-        return error;
+    if (tell + directory.totalOctetCount > stream->size) {
+        CLOG_SOFT_ERROR("sections end after the typeinfo")
+        return -6;
     }
 
-    if ((error = readRecordFields(stream, record, fieldCount, allocator)) != 0) {
-        *outRecord = 0;
-        return error;
+    const SwtisSection* types = swtisSectionDirectoryFind(&directory, SWTIS_SECTION_TYPES);
+    if (types == 0) {
+        CLOG_SOFT_ERROR("typeinfo has no types section")
+        return -6;
     }
 
-    *outRecord = record;
+    seek(stream, tell + types->offset);
+    if ((error = readTypes(context, target)) != 0) {
+        return error;
+    }
 
-    return 0;
-}
+    if (stream->pos != tell + types->offset + types->octetCount) {
+        CLOG_SOFT_ERROR("types section has the wrong size")
+        return -6;
+    }
 
-static int readArray(FldInStream* stream, SwtiArrayType** outArray, ImprintAllocator* allocator)
-{
-    SwtiArrayType* array = IMPRINT_ALLOC_TYPE(allocator, SwtiArrayType);
-    swtiInitArray(array);
-    int error;
-    if ((error = readTypeRef(stream,  &array->itemType)) != 0) {
-        *outArray = 0;
-        return error;
+    const SwtisSection* names = swtisSectionDirectoryFind(&directory, SWTIS_SECTION_NAMES);
+    if (names != 0 && !context->lazyNames) {
+        if ((error = swtisSectionNamesApply(target, stream->octets + tell + names->offset, names->octetCount,
+                                            context->allocator)) != 0) {
+            return error;
+        }
     }
 
-    if ((error = readMemoryInfo(stream, &array->memoryInfo)) != 0) {
-        *outArray = 0;
+    seek(stream, tell + directory.totalOctetCount);
+
+    if ((error = readChecksum(context)) != 0) {
         return error;
     }
 
-    *outArray = array;
-    return 0;
+    return (int) (stream->pos - tell);
 }
 
-static int readList(FldInStream* stream, SwtiListType** outList, ImprintAllocator* allocator)
+static int deserializeRawFromStream(DeserializeContext* context, SwtiChunk* target)
 {
-    SwtiListType* list = IMPRINT_ALLOC_TYPE(allocator, SwtiListType);
-    swtiInitList(list);
     int error;
-    if ((error = readTypeRef(stream,  &list->itemType)) != 0) {
-        *outList = 0;
+    FldInStream* stream = context->stream;
+    int tell = stream->pos;
+
+    context->checksum = 0;
+    context->checksumPos = tell;
+
+    uint16_t typesThatFollowCount;
+    if ((error = readHeader(context, &typesThatFollowCount)) != 0) {
         return error;
     }
 
-    if ((error = readMemoryInfo(stream, &list->memoryInfo)) != 0) {
-        *outList = 0;
-        return error;
+    initTypes(context, target, typesThatFollowCount);
+
+    if (context->formatFlags & SWTIS_FORMAT_FLAG_SECTIONED) {
+        return readSections(context, target, tell);
     }
 
-    *outList = list;
-    return 0;
-}
+    if ((error = readTypes(context, target)) != 0) {
+        return error;
+    }
 
-static int readFunction(FldInStream* stream, SwtiFunctionType** outFn, ImprintAllocator* allocator)
-{
-    struct SwtiFunctionType* fn = IMPRINT_ALLOC_TYPE(allocator, SwtiFunctionType);
-    swtiInitFunction(fn, 0, 0, allocator);
-    //tc_free(fn->parameterTypes);
-    int error;
-    if ((error = readTypeRefs(stream, &fn->parameterTypes, &fn->parameterCount, allocator)) != 0) {
-        *outFn = 0;
+    if ((error = readChecksum(context)) != 0) {
         return error;
     }
 
-    *outFn = fn;
-    return 0;
+    int octetsRead = stream->pos - tell;
+    return octetsRead;
 }
 
-
-static int readTupleField(FldInStream* stream, SwtiTupleTypeField* field)
+static int deserializeLayout(SwtiChunk* target, uint8_t formatFlags, const SwtisDeserializeOptions* options)
 {
-    int memoryOffsetErr = readMemoryOffsetInfo(stream, &field->memoryOffsetInfo);
-    if (memoryOffsetErr < 0) {
-        return memoryOffsetErr;
-    }
+    const SwtisLayoutProfile* profile = (options != 0 && options->layoutProfile != 0) ? options->layoutProfile : SWTIS_LAYOUT_PROFILE_HOST;
 
-    int err = readTypeRef(stream, &field->fieldType);
-    if (err < 0) {
-        return err;
+    if (formatFlags & SWTIS_FORMAT_FLAG_LAYOUT_OMITTED) {
+        return swtisLayoutCompute(target, profile);
     }
 
-    field->name = "";
+    if (options != 0 && options->validateLayout) {
+        return swtisLayoutValidate(target, profile);
+    }
 
     return 0;
 }
 
-
-static int readTuple(FldInStream* stream, SwtiTupleType** outTuple, ImprintAllocator* allocator)
+static int deserializeFinish(SwtiChunk* target, uint8_t formatFlags, ImprintAllocator* allocator, const SwtisDeserializeOptions* options)
 {
-    SwtiTupleType* tuple = IMPRINT_ALLOC_TYPE(allocator, SwtiTupleType);
-    swtiInitTuple(tuple, 0, 0, allocator);
     int error;
-
-    if ((error = readMemoryInfo(stream, &tuple->memoryInfo)) != 0) {
+    error = swtisDeserializeFixupWithDependents(target, options != 0 ? options->dependents : 0, allocator);
+    if (error < 0) {
+        CLOG_SOFT_ERROR("swtiDeserializeFixup %d", error)
         return error;
     }
 
-    uint8_t fieldCount;
-    if ((error = fldInStreamReadUInt8(stream, &fieldCount)) != 0) {
+    error = deserializeLayout(target, formatFlags, options);
+    if (error < 0) {
+        CLOG_SOFT_ERROR("deserializeLayout %d", error)
         return error;
     }
 
-    tuple->fieldCount = fieldCount;
-    SwtiTupleTypeField* fields = IMPRINT_ALLOC_TYPE_COUNT(allocator, SwtiTupleTypeField, tuple->fieldCount);
-    tuple->fields = fields;
-    for (size_t i = 0; i < tuple->fieldCount; ++i) {
-        readTupleField(stream, (SwtiTupleTypeField *)&tuple->fields[i]);
+    if (options != 0 && options->unmanagedTable != 0) {
+        error = swtisUnmanagedTableBuild(options->unmanagedTable, target, allocator);
+        if (error < 0) {
+            return error;
+        }
     }
 
-
-    *outTuple = tuple;
     return 0;
 }
 
-static int readAlias(FldInStream* stream, SwtiAliasType** outAlias, ImprintAllocator* allocator)
+static int deserializeFromStream(FldInStream* stream, SwtiChunk* target, ImprintAllocator* allocator, const SwtisDeserializeOptions* options)
 {
-    SwtiAliasType* alias = IMPRINT_ALLOC_TYPE(allocator, SwtiAliasType);
-    int error;
-    if ((error = readString(stream, &alias->internal.name, allocator)) != 0) {
-        return error;
+    DeserializeContext context;
+    context.stream = stream;
+    context.allocator = allocator;
+    context.formatFlags = 0;
+    context.lazyNames = options != 0 ? options->lazyNames : 0;
+    context.checkedReads = options != 0 ? options->checkedReads : 0;
+
+    int octetsRead;
+
+    if ((octetsRead = deserializeRawFromStream(&context, target)) < 0) {
+        CLOG_SOFT_ERROR("deserializeRawFromStream %d", octetsRead)
+        return octetsRead;
     }
-    alias->internal.type = SwtiTypeAlias;
 
-    if ((error = readTypeRef(stream,  &alias->targetType)) != 0) {
-        *outAlias = 0;
+    int error;
+    if ((error = deserializeFinish(target, context.formatFlags, allocator, options)) < 0) {
         return error;
     }
 
-    *outAlias = alias;
+    return octetsRead;
+}
 
+typedef struct MeasureCursor {
+    const uint8_t* octets;
+    size_t octetCount;
+    size_t pos;
+    int hasNames;
+} MeasureCursor;
+
+static int measureSkip(MeasureCursor* cursor, size_t count)
+{
+    if (count > cursor->octetCount - cursor->pos) {
+        return -1;
+    }
+    cursor->pos += count;
     return 0;
 }
 
-static int readTypeRefId(FldInStream* stream, SwtiTypeRefIdType** outTypeRefId, ImprintAllocator* allocator)
+static int measureCount(MeasureCursor* cursor, uint8_t* count)
 {
-    SwtiTypeRefIdType* newTypeRefId = IMPRINT_ALLOC_TYPE(allocator, SwtiTypeRefIdType);
-    newTypeRefId->internal.type = SwtiTypeRefId;
-    newTypeRefId->internal.name = "TypeRefId";
+    if (cursor->pos + 1 > cursor->octetCount) {
+        return -1;
+    }
+    *count = cursor->octets[cursor->pos++];
+    return 0;
+}
 
-    int error;
+static int measureString(MeasureCursor* cursor)
+{
+    if (!cursor->hasNames) {
+        return 0;
+    }
 
-    if ((error = readTypeRef(stream,  &newTypeRefId->referencedType)) != 0) {
-        *outTypeRefId = 0;
-        return error;
+    uint8_t count;
+    if (measureCount(cursor, &count) != 0) {
+        return -1;
+    }
+    return measureSkip(cursor, count);
+}
+
+#define MEASURE_CHECK(expression)  \
+    if ((expression) != 0) {       \
+        return -1;                 \
+    }
+
+#define MEASURE_NAME(self, member) MEASURE_CHECK(measureString(&cursor))
+#define MEASURE_EMPTY_NAME(self, member)
+#define MEASURE_MEMORY_INFO(self, member) MEASURE_CHECK(measureSkip(&cursor, memoryInfoSize))
+#define MEASURE_MEMORY_OFFSET_INFO(self, member) MEASURE_CHECK(measureSkip(&cursor, memoryOffsetInfoSize))
+#define MEASURE_OWNER(self, member, Pointer, ACCEPT) MEASURE_CHECK(measureSkip(&cursor, 2))
+#define MEASURE_REF MEASURE_OWNER
+#define MEASURE_REFS(self, member, count, Pointer, ACCEPT)         \
+    {                                                              \
+        uint8_t refCount;                                          \
+        MEASURE_CHECK(measureCount(&cursor, &refCount))            \
+        MEASURE_CHECK(measureSkip(&cursor, (size_t) refCount * 2)) \
+    }
+#define MEASURE_U16(self, member) MEASURE_CHECK(measureSkip(&cursor, 2))
+#define MEASURE_ITEMS(self, member, count, Item, item, ...)                        \
+    {                                                                              \
+        uint8_t item##Count;                                                       \
+        MEASURE_CHECK(measureCount(&cursor, &item##Count))                         \
+        for (uint8_t item##Index = 0; item##Index < item##Count; ++item##Index) {  \
+            __VA_ARGS__                                                            \
+        }                                                                          \
+    }
+
+#define MEASURE_KIND(typeValue, Struct, LAYOUT) \
+    case typeValue:                             \
+        SWTIS_CODEC_EXPAND(LAYOUT, MEASURE)     \
+        break;
+#define MEASURE_BARE(typeValue) \
+    case typeValue:             \
+        break;
+
+/// Finds the size of the next type without reading it. Returns -1 if the octets end before the type does.
+/// Expanded from the layouts in codec_internal.h.
+static int measureType(const uint8_t* octets, size_t octetCount, uint8_t formatFlags, size_t* outOctetCount)
+{
+    MeasureCursor cursor;
+    cursor.octets = octets;
+    cursor.octetCount = octetCount;
+    cursor.pos = 0;
+    cursor.hasNames = !(formatFlags & SWTIS_FORMAT_FLAG_SECTIONED);
+
+    size_t memoryInfoSize = (formatFlags & SWTIS_FORMAT_FLAG_LAYOUT_OMITTED) ? 0 : 3;
+    size_t memoryOffsetInfoSize = (formatFlags & SWTIS_FORMAT_FLAG_LAYOUT_OMITTED) ? 0 : 5;
+    uint8_t typeValue;
+
+    if (measureCount(&cursor, &typeValue) != 0) {
+        return -1;
     }
 
-    *outTypeRefId = newTypeRefId;
+    switch (typeValue) {
+        SWTIS_CODEC_KINDS(MEASURE_KIND, MEASURE_BARE)
+        default:
+            CLOG_SOFT_ERROR("type information: measureType unknown type:%d", typeValue)
+            return -14;
+    }
+
+    *outOctetCount = cursor.pos;
 
     return 0;
 }
 
-static int readUnmanagedType(FldInStream* stream, SwtiUnmanagedType* unmanagedType, ImprintAllocator* allocator)
+void swtisDeserializeProgressInit(SwtisDeserializeProgress* self, SwtiChunk* target, ImprintAllocator* allocator,
+                                  const SwtisDeserializeOptions* options)
+{
+    self->target = target;
+    self->allocator = allocator;
+    self->options = options;
+    self->formatFlags = 0;
+    self->hasHeader = 0;
+    self->typeIndex = 0;
+    self->pos = 0;
+    self->typesEndPos = 0;
+    self->namesOffset = 0;
+    self->namesOctetCount = 0;
+    self->endPos = 0;
+    self->checksum = 0;
+    self->checksumPos = 0;
+}
+
+static int progressReadHeader(SwtisDeserializeProgress* self, DeserializeContext* context, const uint8_t* octets,
+                              size_t octetCount)
 {
+    FldInStream stream;
     int error;
 
-    if ((error = readString(stream, &unmanagedType->internal.name, allocator)) != 0) {
-        return error;
+    if (octetCount < SWTIS_SECTIONS_HEADER_OCTET_COUNT) {
+        return 0;
+    }
+
+    if (octets[3] & SWTIS_FORMAT_FLAG_SECTIONED) {
+        SwtisSectionDirectory directory;
+        if ((error = swtisSectionDirectoryRead(&directory, octets, octetCount)) != 0) {
+            return error == -1 ? 0 : error;
+        }
+        const SwtisSection* types = swtisSectionDirectoryFind(&directory, SWTIS_SECTION_TYPES);
+        if (types == 0) {
+            CLOG_SOFT_ERROR("typeinfo has no types section")
+            return -6;
+        }
+        const SwtisSection* names = swtisSectionDirectoryFind(&directory, SWTIS_SECTION_NAMES);
+        if (names != 0 && !context->lazyNames) {
+            self->namesOffset = names->offset;
+            self->namesOctetCount = names->octetCount;
+        }
+        self->pos = types->offset;
+        self->typesEndPos = types->offset + types->octetCount;
+        self->endPos = directory.totalOctetCount;
     }
-    
-    if ((error = fldInStreamReadUInt16(stream, &unmanagedType->userTypeId)) != 0) {
+
+    context->stream = &stream;
+    fldInStreamInit(&stream, octets, octetCount);
+    uint16_t typeCount;
+    if ((error = readHeader(context, &typeCount)) != 0) {
         return error;
     }
+    initTypes(context, self->target, typeCount);
+    self->formatFlags = context->formatFlags;
+    self->hasHeader = 1;
+    if (!(self->formatFlags & SWTIS_FORMAT_FLAG_SECTIONED)) {
+        self->pos = stream.pos;
+    }
 
-    return 0;
+    return 1;
 }
 
-static int readType(FldInStream* stream, const SwtiType** outType, ImprintAllocator* allocator)
+/// `octets` is everything that has arrived so far, starting from the first octet of the typeinfo.
+/// Reads every complete type that has not been read yet. Returns 1 when all types are read, 0 if more octets are
+/// needed and a negative value on error.
+int swtisDeserializeProgressFeed(SwtisDeserializeProgress* self, const uint8_t* octets, size_t octetCount)
 {
-    uint8_t typeValueRaw;
+    DeserializeContext context;
+    FldInStream stream;
     int error;
-    if ((error = fldInStreamReadUInt8(stream, &typeValueRaw)) != 0) {
-        CLOG_SOFT_ERROR("readType couldn't read type")
-        return error;
-    }
 
-    error = -99;
-    SwtiTypeValue typeValue = (SwtiTypeValue) typeValueRaw;
+    context.allocator = self->allocator;
+    context.formatFlags = self->formatFlags;
+    context.lazyNames = self->options != 0 ? self->options->lazyNames : 0;
+    context.checkedReads = self->options != 0 ? self->options->checkedReads : 0;
 
-    switch (typeValue) {
-        case SwtiTypeCustom: {
-            SwtiCustomType* custom;
-            error = readCustomType(stream, &custom, allocator);
-            *outType = (const SwtiType*) custom;
-            break;
-        }
-        case SwtiTypeCustomVariant: {
-            SwtiCustomTypeVariant* custom;
-            error = readVariant(stream, &custom, allocator);
-            *outType = (const SwtiType*) custom;
-            break;
-        }
-        case SwtiTypeFunction: {
-            SwtiFunctionType* fn;
-            error = readFunction(stream, &fn, allocator);
-            *outType = (const SwtiType*) fn;
-            break;
-        }
-        case SwtiTypeAlias: {
-            SwtiAliasType* alias;
-            error = readAlias(stream, &alias, allocator);
-            *outType = (const SwtiType*) alias;
-            break;
-        }
-        case SwtiTypeRefId: {
-            SwtiTypeRefIdType* typeRef = IMPRINT_ALLOC_TYPE(allocator, SwtiTypeRefIdType);
-            error = readTypeRefId(stream, &typeRef, allocator);
-            *outType = (const SwtiType*) typeRef;
-            break;
-        }
-        case SwtiTypeRecord: {
-            SwtiRecordType* record;
-            error = readRecord(stream, &record, allocator);
-            *outType = (const SwtiType*) record;
-            break;
-        }
-        case SwtiTypeArray: {
-            SwtiArrayType* array;
-            error = readArray(stream, &array, allocator);
-            *outType = (const SwtiType*) array;
-            break;
+    if (!self->hasHeader) {
+        if ((error = progressReadHeader(self, &context, octets, octetCount)) <= 0) {
+            return error;
         }
-        case SwtiTypeList: {
-            SwtiListType* list;
-            error = readList(stream, &list, allocator);
-            *outType = (const SwtiType*) list;
-            break;
+    }
+
+    context.stream = &stream;
+
+    while (self->typeIndex < self->target->typeCount) {
+        size_t typeOctetCount;
+        if (self->pos > octetCount) {
+            return 0;
         }
-        case SwtiTypeString: {
-            SwtiStringType* string = IMPRINT_ALLOC_TYPE(allocator, SwtiStringType);
-            swtiInitString(string);
-            error = 0;
-            *outType = (const SwtiType*) string;
-            break;
+        if ((error = measureType(octets + self->pos, octetCount - self->pos, self->formatFlags, &typeOctetCount)) != 0) {
+            return error == -1 ? 0 : error;
         }
-        case SwtiTypeInt: {
-            SwtiIntType* intType = IMPRINT_ALLOC_TYPE(allocator, SwtiIntType);
-            swtiInitInt(intType);
-            error = 0;
-            *outType = (const SwtiType*) intType;
-            break;
-        }
-        case SwtiTypeFixed: {
-            SwtiFixedType* fixed = IMPRINT_ALLOC_TYPE(allocator, SwtiFixedType);
-            swtiInitFixed(fixed);
-            *outType = (const SwtiType*) fixed;
-            error = 0;
-            break;
+
+        if ((self->formatFlags & SWTIS_FORMAT_FLAG_SECTIONED) && self->pos + typeOctetCount > self->typesEndPos) {
+            CLOG_SOFT_ERROR("types section has the wrong size")
+            return -6;
         }
-        case SwtiTypeBoolean: {
-            SwtiBooleanType* bool = IMPRINT_ALLOC_TYPE(allocator, SwtiBooleanType);
-            swtiInitBoolean(bool);
-            *outType = (const SwtiType*) bool;
-            error = 0;
-            break;
+
+        const SwtiType** type = &self->target->types[self->typeIndex];
+        if (context.checkedReads) {
+            fldInStreamInit(&stream, octets + self->pos, typeOctetCount);
+            error = readType(&context, type);
+        } else {
+            error = loadType(&context, octets + self->pos, typeOctetCount, type);
         }
-        case SwtiTypeBlob: {
-            SwtiBlobType* blob = IMPRINT_ALLOC_TYPE(allocator, SwtiBlobType);
-            swtiInitBlob(blob);
-            *outType = (const SwtiType*) blob;
-            error = 0;
-            break;
+        if (error != 0) {
+            return error;
         }
-        case SwtiTypeResourceName: {
-            SwtiIntType* intType = IMPRINT_ALLOC_TYPE(allocator, SwtiIntType);
-            swtiInitInt(intType);
-            error = 0;
-            *outType = (const SwtiType*) intType;
-            break;
+        ((SwtiType*) *type)->index = self->typeIndex;
+
+        self->typeIndex++;
+        self->pos += typeOctetCount;
+
+        if ((self->formatFlags & SWTIS_FORMAT_FLAG_CHECKSUM) && self->pos >= self->checksumPos + SWTIS_CHECKSUM_BATCH_OCTET_COUNT) {
+            self->checksum = swtisCrc32cUpdate(self->checksum, octets + self->checksumPos, self->pos - self->checksumPos);
+            self->checksumPos = self->pos;
         }
-        case SwtiTypeChar: {
-            SwtiCharType* ch = IMPRINT_ALLOC_TYPE(allocator, SwtiCharType);
-            swtiInitChar(ch);
-            error = 0;
-            *outType = (const SwtiType*) ch;
-            break;
+    }
+
+    if ((self->formatFlags & SWTIS_FORMAT_FLAG_SECTIONED) && self->pos != self->typesEndPos) {
+        CLOG_SOFT_ERROR("types section has the wrong size")
+        return -6;
+    }
+
+    if (self->namesOctetCount != 0) {
+        if (octetCount < self->namesOffset + self->namesOctetCount) {
+            return 0;
         }
-        case SwtiTypeTuple: {
-            SwtiTupleType* tuple;
-            error = readTuple(stream, &tuple, allocator);
-            *outType = (const SwtiType*) tuple;
-            break;
+        if ((error = swtisSectionNamesApply(self->target, octets + self->namesOffset, self->namesOctetCount,
+                                            self->allocator)) != 0) {
+            return error;
         }
+        self->namesOctetCount = 0;
+    }
 
-        case SwtiTypeAny: {
-            SwtiAnyType* any = IMPRINT_ALLOC_TYPE(allocator, SwtiAnyType);
-            swtiInitAny(any);
-            *outType = (const SwtiType*) any;
-            error = 0;
-            break;
+    size_t endPos = self->endPos > self->pos ? self->endPos : self->pos;
+
+    if (self->formatFlags & SWTIS_FORMAT_FLAG_CHECKSUM) {
+        if (octetCount < endPos + 4) {
+            return 0;
         }
-        case SwtiTypeAnyMatchingTypes: {
-            SwtiAnyMatchingTypesType* anyMatchingTypes = IMPRINT_ALLOC_TYPE(allocator, SwtiAnyMatchingTypesType);
-            swtiInitAnyMatchingTypes(anyMatchingTypes);
-            *outType = (const SwtiType*) anyMatchingTypes;
-            error = 0;
-            break;
+        uint32_t checksum = swtisCrc32cUpdate(self->checksum, octets + self->checksumPos, endPos - self->checksumPos);
+        const uint8_t* footer = octets + endPos;
+        uint32_t expected = ((uint32_t) footer[0] << 24) | ((uint32_t) footer[1] << 16) | ((uint32_t) footer[2] << 8) | footer[3];
+        if (expected != checksum) {
+            CLOG_SOFT_ERROR("checksum mismatch. expected %08X but got %08X", expected, checksum)
+            return -7;
         }
-        case SwtiTypeUnmanaged: {
-            SwtiUnmanagedType* unmanaged = IMPRINT_ALLOC_TYPE(allocator, SwtiUnmanagedType);
-            unmanaged->internal.index = 0;
-            unmanaged->internal.hash = 0;
-            unmanaged->userTypeId = 0;
-            swtiInitUnmanaged(unmanaged, 0, 0, allocator);
-            readUnmanagedType(stream, unmanaged, allocator);
-            *outType = (const SwtiType*) unmanaged;
-            error = 0;
-            break;
-        }
-        default:
-            CLOG_ERROR("type information: readType unknown type:%d", typeValue)
-            return -14;
+        endPos += 4;
     }
 
-    return error;
+    self->pos = endPos;
+
+    return 1;
 }
 
-static int deserializeRawFromStream(FldInStream* stream, SwtiChunk* target, ImprintAllocator* allocator)
+/// Resolves the type references and the layout once swtisDeserializeProgressFeed() has returned 1.
+int swtisDeserializeProgressFinish(SwtisDeserializeProgress* self)
 {
-    int error;
-    uint8_t major;
-    uint8_t minor;
-    uint8_t patch;
-
-    int tell = stream->pos;
-
-    if ((error = fldInStreamReadUInt8(stream, &major)) != 0) {
-        return error;
-    }
-    if ((error = fldInStreamReadUInt8(stream, &minor)) != 0) {
-        return error;
-    }
-    if ((error = fldInStreamReadUInt8(stream, &patch)) != 0) {
-        return error;
+    if (!self->hasHeader || self->typeIndex < self->target->typeCount || self->namesOctetCount != 0) {
+        return -1;
     }
 
-    int correct = (major == SWTI_SERIALIZE_VERSION_MAJOR) && (minor == SWTI_SERIALIZE_VERSION_MINOR) && (patch == SWTI_SERIALIZE_VERSION_PATCH);
-    if (!correct) {
-        CLOG_SOFT_ERROR("got wrong version. Expected %d.%d.%d and got %d.%d.%d", SWTI_SERIALIZE_VERSION_MAJOR, SWTI_SERIALIZE_VERSION_MINOR, SWTI_SERIALIZE_VERSION_PATCH, major, minor, patch)
-        return -2;
-    }
-
-    uint16_t typesThatFollowCount;
-    if ((error = fldInStreamReadUInt16(stream, &typesThatFollowCount)) != 0) {
+    int error;
+    if ((error = deserializeFinish(self->target, self->formatFlags, self->allocator, self->options)) < 0) {
         return error;
     }
 
-    const struct SwtiType** array = IMPRINT_ALLOC_TYPE_COUNT(allocator, const SwtiType*, typesThatFollowCount);
-    target->types = array;
-    tc_mem_clear_type_n(array, typesThatFollowCount);
-    target->typeCount = typesThatFollowCount;
-
-    for (uint16_t i = 0; i < typesThatFollowCount; i++) {
-        target->types[i] = 0;
-    }
-
-    for (uint16_t i = 0; i < typesThatFollowCount; i++) {
-        if ((error = readType(stream, &target->types[i], allocator)) != 0) {
-            return error;
-        }
-        ((SwtiType*) (target->types[i]))->index = i;
-    }
-
-    int octetsRead = stream->pos - tell;
-    return octetsRead;
+    return (int) self->pos;
 }
 
-static int swtiDeserializeRaw(const uint8_t* octets, size_t octetCount, SwtiChunk* target, ImprintAllocator* allocator)
+int swtisDeserializeWithOptions(const uint8_t* octets, size_t octetCount, SwtiChunk* target, ImprintAllocator* allocator, const SwtisDeserializeOptions* options)
 {
     FldInStream stream;
 
     fldInStreamInit(&stream, octets, octetCount);
 
-    return deserializeRawFromStream(&stream, target, allocator);
+    return deserializeFromStream(&stream, target, allocator, options);
 }
 
 int swtisDeserialize(const uint8_t* octets, size_t octetCount, SwtiChunk* target, ImprintAllocator* allocator)
 {
-    int octetsRead;
-
-    if ((octetsRead = swtiDeserializeRaw(octets, octetCount, target, allocator)) < 0) {
-        CLOG_SOFT_ERROR("swtiDeserializeRaw %d", octetsRead)
-        return octetsRead;
-    }
-
-    int error;
-    error = swtisDeserializeFixup(target);
-    if (error < 0) {
-        CLOG_SOFT_ERROR("swtiDeserializeFixup %d", octetsRead)
-        return error;
-    }
+    return swtisDeserializeWithOptions(octets, octetCount, target, allocator, 0);
+}
 
-    return octetsRead;
+int swtisDeserializeFromStreamWithOptions(FldInStream* stream, SwtiChunk* target, ImprintAllocator* allocator, const SwtisDeserializeOptions* options)
+{
+    return deserializeFromStream(stream, target, allocator, options);
 }
 
 int swtisDeserializeFromStream(FldInStream* stream, SwtiChunk* target, struct ImprintAllocator* allocator)
 {
-    int octetsRead;
-
-    if ((octetsRead = deserializeRawFromStream(stream, target, allocator)) < 0) {
-        return octetsRead;
-    }
-
-    int error;
-    error = swtisDeserializeFixup(target);
-    if (error < 0) {
-        return error;
-    }
-
-    return octetsRead;
+    return deserializeFromStream(stream, target, allocator, 0);
 }
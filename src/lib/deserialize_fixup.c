@@ -3,15 +3,28 @@
  *  Licensed under the MIT License. See LICENSE in the project root for license information.
  *--------------------------------------------------------------------------------------------*/
 #include <swamp-typeinfo/chunk.h>
+#include <swamp-typeinfo-serialize/codec_internal.h>
+#include <swamp-typeinfo-serialize/dependents_internal.h>
 #include <swamp-typeinfo-serialize/deserialize.h>
 #include <swamp-typeinfo-serialize/deserialize_internal.h>
 #include <swamp-typeinfo/typeinfo.h>
 
 #include <clog/clog.h>
 
-static int fixupTypeRef(const SwtiType** type, const SwtiChunk* chunk)
+typedef struct FixupContext {
+    const SwtiChunk* chunk;
+    size_t fromIndex;
+    SwtisDependentsBuilder* dependents;
+} FixupContext;
+
+static int resolveTypeRef(const SwtiType** type, const SwtiChunk* chunk)
 {
     uintptr_t ptrValue = (uintptr_t)(*type);
+    if (ptrValue == SWTIS_CODEC_CLEARED_TYPE_REF) {
+        // Written for a reference that was already cleared, not an error unless the reference is strict
+        *type = 0;
+        return -2;
+    }
     if (ptrValue >= 65535) {
         CLOG_ERROR("illegal ref")
         *type = 0;
@@ -33,173 +46,129 @@ static int fixupTypeRef(const SwtiType** type, const SwtiChunk* chunk)
     return 0;
 }
 
-static int fixupTypeRefs(const SwtiType** types, size_t count, const struct SwtiChunk* chunk)
+static int fixupTypeRef(const SwtiType** type, const FixupContext* context)
 {
     int error;
 
-    for (size_t i = 0; i < count; ++i) {
-        if ((error = fixupTypeRef(&types[i], chunk)) != 0) {
-            return error;
-        }
+    if ((error = resolveTypeRef(type, context->chunk)) != 0) {
+        return error;
     }
 
-    return 0;
-}
-
-static int fixupRecordType(SwtiRecordType* record, const struct SwtiChunk* chunk)
-{
-    int error;
-    for (size_t i = 0; i < record->fieldCount; ++i) {
-        SwtiRecordTypeField* mutableField = (SwtiRecordTypeField*) &record->fields[i];
-        if ((error = fixupTypeRef(&mutableField->fieldType, chunk)) != 0) {
-            return error;
-        }
+    if (context->dependents != 0) {
+        swtisDependentsBuilderAdd(context->dependents, (*type)->index, context->fromIndex);
     }
 
     return 0;
 }
 
-
-static int fixupTupleType(SwtiTupleType* tuple, const struct SwtiChunk* chunk)
-{
-    int error;
-    for (size_t i = 0; i < tuple->fieldCount; ++i) {
-        SwtiRecordTypeField* mutableField = (SwtiRecordTypeField*) &tuple->fields[i];
-        if ((error = fixupTypeRef(&mutableField->fieldType, chunk)) != 0) {
-            return error;
-        }
+#define FIXUP_CHECK(expression)            \
+    if ((error = (expression)) != 0) {     \
+        return error;                      \
     }
 
-    return 0;
-}
-
-static int fixupCustomVariantType(SwtiCustomTypeVariant* variant, const struct SwtiChunk* chunk)
-{
-    int error;
-
-    if ((error = fixupTypeRef((const SwtiType**) &variant->inCustomType, chunk)) != 0) {
-        return error;
+#define FIXUP_NAME(self, member)
+#define FIXUP_EMPTY_NAME(self, member)
+#define FIXUP_MEMORY_INFO(self, member)
+#define FIXUP_MEMORY_OFFSET_INFO(self, member)
+#define FIXUP_U16(self, member)
+#define FIXUP_OWNER(self, member, Pointer, ACCEPT)                    \
+    {                                                                 \
+        const SwtiType* ref = (const SwtiType*) (self)->member;       \
+        error = resolveTypeRef(&ref, context->chunk);                 \
+        if (error != 0 && ACCEPT##_STRICT) {                          \
+            return error;                                             \
+        }                                                             \
+        if (error == 0 && !ACCEPT(ref) && ACCEPT##_STRICT) {          \
+            return -4;                                                \
+        }                                                             \
+        (self)->member = (Pointer) ref;                               \
     }
-    if (variant->inCustomType->internal.type != SwtiTypeCustom) {
-        return -4;
+#define FIXUP_REFERENCE(reference, Pointer, ACCEPT)                   \
+    {                                                                 \
+        const SwtiType* ref = (const SwtiType*) (reference);          \
+        error = fixupTypeRef(&ref, context);                          \
+        if (error != 0 && ACCEPT##_STRICT) {                          \
+            return error;                                             \
+        }                                                             \
+        if (error == 0 && !ACCEPT(ref) && ACCEPT##_STRICT) {          \
+            return -46;                                               \
+        }                                                             \
+        (reference) = (Pointer) ref;                                  \
     }
-
-    for (size_t i = 0; i < variant->paramCount; ++i) {
-        SwtiCustomTypeVariantField * mutableField = (SwtiCustomTypeVariantField*) &variant->fields[i];
-        if ((error = fixupTypeRef(&mutableField->fieldType, chunk)) != 0) {
-            return error;
-        }
+#define FIXUP_REF(self, member, Pointer, ACCEPT) FIXUP_REFERENCE((self)->member, Pointer, ACCEPT)
+#define FIXUP_REFS(self, member, count, Pointer, ACCEPT)                             \
+    for (size_t refIndex = 0; refIndex < (self)->count; ++refIndex) {                \
+        FIXUP_REFERENCE((self)->member[refIndex], Pointer, ACCEPT)                   \
     }
-
-    return 0;
-}
-
-static int fixupGenerics(SwtiGenericParams* generics, const struct SwtiChunk* chunk)
-{
-    int error;
-    for (size_t i = 0; i < generics->genericCount; ++i) {
-        const SwtiType** mutableVariant = (const SwtiType **) &generics->genericTypes[i];
-        if ((error = fixupTypeRef(mutableVariant, chunk)) != 0) {
-            return error;
-        }
-        const SwtiType * genericType = generics->genericTypes[i];
-        if (genericType->type == SwtiTypeCustomVariant) {
-            return -46;
-        }
+#define FIXUP_ITEMS(self, member, count, Item, item, ...)                            \
+    for (size_t item##Index = 0; item##Index < (self)->count; ++item##Index) {       \
+        Item* item = (Item*) &(self)->member[item##Index];                           \
+        __VA_ARGS__                                                                  \
     }
 
-    return 0;
-}
-
+#define FIXUP_KIND(typeValue, Struct, LAYOUT)  \
+    case typeValue: {                          \
+        Struct* self = (Struct*) type;         \
+        (void) self;                           \
+        SWTIS_CODEC_EXPAND(LAYOUT, FIXUP)      \
+        return 0;                              \
+    }
+#define FIXUP_BARE(typeValue) \
+    case typeValue:           \
+        return 0;
 
-static int fixupCustomType(SwtiCustomType* custom, const struct SwtiChunk* chunk)
+/// Resolves the references in the layouts in codec_internal.h.
+static int fixupType(SwtiType* type, const FixupContext* context)
 {
     int error;
 
-    fixupGenerics(&custom->generic, chunk);
-
-    for (size_t i = 0; i < custom->variantCount; ++i) {
-        const SwtiType** mutableVariant = (const SwtiType **) &custom->variantTypes[i];
-        if ((error = fixupTypeRef(mutableVariant, chunk)) != 0) {
-            return error;
-        }
-        const SwtiCustomTypeVariant* variant = custom->variantTypes[i];
-
-        if (variant->internal.type != SwtiTypeCustomVariant) {
-            return -46;
-        }
-    }
-
-    return 0;
-}
-
-static int fixupType(SwtiType* type, const SwtiChunk* chunk)
-{
     switch (type->type) {
-        case SwtiTypeCustom: {
-            SwtiCustomType* custom = (SwtiCustomType*) type;
-            return fixupCustomType(custom, chunk);
-        }
-        case SwtiTypeCustomVariant: {
-            SwtiCustomTypeVariant * custom = (SwtiCustomTypeVariant*) type;
-            return fixupCustomVariantType(custom, chunk);
-        }
-        case SwtiTypeFunction: {
-            SwtiFunctionType* fn = (SwtiFunctionType*) type;
-            return fixupTypeRefs((const SwtiType**) fn->parameterTypes, fn->parameterCount, chunk);
-        }
-        case SwtiTypeTuple: {
-            SwtiTupleType* tuple = (SwtiTupleType*) type;
-            return fixupTupleType(tuple, chunk);
-        }
-        case SwtiTypeAlias: {
-            SwtiAliasType* alias = (SwtiAliasType*) type;
-            return fixupTypeRef((const SwtiType**) &alias->targetType, chunk);
-        }
-        case SwtiTypeRefId: {
-            SwtiTypeRefIdType * typeRefId = (SwtiTypeRefIdType *) type;
-            return fixupTypeRef((const SwtiType**) &typeRefId->referencedType, chunk);
-        }
-        case SwtiTypeRecord: {
-            SwtiRecordType* record = (SwtiRecordType*) type;
-            return fixupRecordType(record, chunk);
-        }
-        case SwtiTypeArray: {
-            SwtiArrayType* array = (SwtiArrayType*) type;
-            return fixupTypeRef((const SwtiType**) &array->itemType, chunk);
-        }
-        case SwtiTypeList: {
-            SwtiListType* list = (SwtiListType*) type;
-            return fixupTypeRef((const SwtiType**) &list->itemType, chunk);
-        }
-        // All these do not require fixup
-        case SwtiTypeBoolean:
-        case SwtiTypeBlob:
-        case SwtiTypeFixed:
-        case SwtiTypeInt:
-        case SwtiTypeAny:
-        case SwtiTypeAnyMatchingTypes:
-        case SwtiTypeUnmanaged:
-        case SwtiTypeString:
-        case SwtiTypeChar:
-        case SwtiTypeResourceName:
-            return 0;
+        SWTIS_CODEC_KINDS(FIXUP_KIND, FIXUP_BARE)
+        default:
+            break;
     }
 
     CLOG_ERROR("type information: don't know how to fixup type %d", type->type);
     return -1;
 }
 
-int swtisDeserializeFixup(SwtiChunk* chunk)
+int swtisDeserializeFixupWithDependents(SwtiChunk* chunk, struct SwtisDependents* dependents, struct ImprintAllocator* allocator)
 {
+    SwtisDependentsBuilder builder;
+    FixupContext context;
     int error;
+
+    context.chunk = chunk;
+    context.dependents = 0;
+    if (dependents != 0) {
+        swtisDependentsBuilderInit(&builder);
+        context.dependents = &builder;
+    }
+
     for (size_t i = 0; i < chunk->typeCount; ++i) {
         const SwtiType* item = chunk->types[i];
-        if ((error = fixupType((SwtiType*) item, chunk)) != 0) {
+        context.fromIndex = i;
+        if ((error = fixupType((SwtiType*) item, &context)) != 0) {
             CLOG_SOFT_ERROR("fixupType %d %s", error, item->name)
+            if (dependents != 0) {
+                swtisDependentsBuilderDestroy(&builder);
+            }
+            return error;
+        }
+    }
+
+    if (dependents != 0) {
+        error = swtisDependentsBuilderFinish(&builder, chunk->typeCount, dependents, allocator);
+        swtisDependentsBuilderDestroy(&builder);
+        if (error != 0) {
             return error;
         }
     }
 
     return 0;
 }
+
+int swtisDeserializeFixup(SwtiChunk* chunk)
+{
+    return swtisDeserializeFixupWithDependents(chunk, 0, 0);
+}
@@ -0,0 +1,107 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <imprint/linear_allocator.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo-serialize/deserialize_many.h>
+#include <swamp-typeinfo-serialize/pool_internal.h>
+#include <swamp-typeinfo/chunk.h>
+#include <tiny-libc/tiny_libc.h>
+
+#define SWTIS_DESERIALIZE_MANY_PARTITION_ALIGN (64)
+
+typedef struct ManyContext {
+    const SwtisBlob* blobs;
+    SwtiChunk* outChunks;
+    int* results;
+    const size_t* partitionOffsets;
+    uint8_t* memory;
+    const SwtisDeserializeOptions* deserializeOptions;
+} ManyContext;
+
+static void deserializeTask(void* userData, size_t taskIndex, size_t workerIndex)
+{
+    ManyContext* context = (ManyContext*) userData;
+    const SwtisBlob* blob = &context->blobs[taskIndex];
+    size_t offset = context->partitionOffsets[taskIndex];
+    size_t size = context->partitionOffsets[taskIndex + 1] - offset;
+
+    ImprintLinearAllocator partition;
+    imprintLinearAllocatorInit(&partition, context->memory + offset, size, "swtisDeserializeMany");
+
+    context->results[taskIndex] = swtisDeserializeWithOptions(blob->octets, blob->octetCount,
+                                                              &context->outChunks[taskIndex], &partition.info,
+                                                              context->deserializeOptions);
+}
+
+/// Each blob gets its own partition of the memory, proportional to its size, so workers never share an allocator
+/// and the partitions do not depend on which worker ends up loading the blob.
+int swtisDeserializeMany(const SwtisBlob* blobs, size_t count, SwtiChunk* outChunks, size_t threadCount,
+                         const SwtisDeserializeManyOptions* options)
+{
+    if (options->deserializeOptions != 0 && options->deserializeOptions->dependents != 0) {
+        CLOG_SOFT_ERROR("swtisDeserializeMany: dependents can not be shared between blobs")
+        return -2;
+    }
+
+    if (options->deserializeOptions != 0 && options->deserializeOptions->unmanagedTable != 0) {
+        CLOG_SOFT_ERROR("swtisDeserializeMany: unmanaged tables can not be shared between blobs")
+        return -2;
+    }
+
+    size_t totalOctetCount = 0;
+    for (size_t i = 0; i < count; ++i) {
+        totalOctetCount += blobs[i].octetCount;
+    }
+
+    size_t alignPadding = count * SWTIS_DESERIALIZE_MANY_PARTITION_ALIGN;
+    if (options->memorySize < totalOctetCount * SWTIS_DESERIALIZE_MANY_MEMORY_FACTOR + alignPadding) {
+        CLOG_SOFT_ERROR("swtisDeserializeMany: %zu octets of memory is not enough for %zu octets of typeinfo",
+                        options->memorySize, totalOctetCount)
+        return -3;
+    }
+
+    size_t* partitionOffsets = tc_malloc_type_count(size_t, count + 1);
+    size_t spare = options->memorySize - alignPadding;
+    size_t offset = 0;
+    for (size_t i = 0; i < count; ++i) {
+        partitionOffsets[i] = offset;
+        size_t share = totalOctetCount != 0 ? (size_t) ((double) spare * blobs[i].octetCount / totalOctetCount)
+                                            : spare / count;
+        offset += share + SWTIS_DESERIALIZE_MANY_PARTITION_ALIGN;
+        offset -= offset % SWTIS_DESERIALIZE_MANY_PARTITION_ALIGN;
+    }
+    partitionOffsets[count] = offset < options->memorySize ? offset : options->memorySize;
+
+    int* results = options->outResults != 0 ? options->outResults : tc_malloc_type_count(int, count + 1);
+
+    ManyContext context;
+    context.blobs = blobs;
+    context.outChunks = outChunks;
+    context.results = results;
+    context.partitionOffsets = partitionOffsets;
+    context.memory = options->memory;
+    context.deserializeOptions = options->deserializeOptions;
+
+    int error = swtisPoolRun(count, threadCount, deserializeTask, &context);
+
+    for (size_t i = 0; i < count && error == 0; ++i) {
+        if (results[i] < 0) {
+            CLOG_SOFT_ERROR("swtisDeserializeMany: blob %zu failed %d", i, results[i])
+            error = results[i];
+        }
+    }
+
+    if (results != options->outResults) {
+        tc_free(results);
+    }
+    tc_free(partitionOffsets);
+
+    if (error == 0 && options->link != 0) {
+        error = options->link(options->linkUserData, outChunks, count);
+    }
+
+    return error;
+}
@@ -0,0 +1,392 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo/chunk.h>
+#include <swamp-typeinfo/typeinfo.h>
+#include <tiny-libc/tiny_libc.h>
+
+const SwtisLayoutProfile swtisLayoutProfile32 = {
+    {4, 4}, {4, 4}, {1, 1}, {4, 4}, {4, 4}, {1, 1},
+};
+
+const SwtisLayoutProfile swtisLayoutProfile64 = {
+    {4, 4}, {4, 4}, {1, 1}, {4, 4}, {8, 8}, {1, 1},
+};
+
+typedef enum LayoutState {
+    LayoutStateUnvisited,
+    LayoutStateVisiting,
+    LayoutStateDone,
+} LayoutState;
+
+typedef struct LayoutContext {
+    const SwtiChunk* chunk;
+    const SwtisLayoutProfile* profile;
+    uint8_t* states;
+    SwtiMemoryInfo* infos;
+    int validateOnly;
+} LayoutContext;
+
+static size_t alignUp(size_t offset, size_t align)
+{
+    if (align <= 1) {
+        return offset;
+    }
+    return (offset + align - 1) / align * align;
+}
+
+static int primitiveMemoryInfo(const SwtiType* type, const SwtisLayoutProfile* profile, SwtiMemoryInfo* outInfo)
+{
+    switch (type->type) {
+        case SwtiTypeInt:
+        case SwtiTypeResourceName:
+            *outInfo = profile->intInfo;
+            return 1;
+        case SwtiTypeFixed:
+            *outInfo = profile->fixedInfo;
+            return 1;
+        case SwtiTypeBoolean:
+            *outInfo = profile->boolInfo;
+            return 1;
+        case SwtiTypeChar:
+            *outInfo = profile->charInfo;
+            return 1;
+        case SwtiTypeString:
+        case SwtiTypeBlob:
+        case SwtiTypeList:
+        case SwtiTypeArray:
+        case SwtiTypeFunction:
+        case SwtiTypeAny:
+        case SwtiTypeAnyMatchingTypes:
+        case SwtiTypeUnmanaged:
+        case SwtiTypeRefId:
+            *outInfo = profile->referenceInfo;
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+int swtisLayoutMemoryInfo(const SwtiType* type, const SwtisLayoutProfile* profile, SwtiMemoryInfo* outInfo)
+{
+    for (size_t depth = 0; depth < 256; ++depth) {
+        if (primitiveMemoryInfo(type, profile, outInfo)) {
+            return 0;
+        }
+
+        switch (type->type) {
+            case SwtiTypeAlias:
+                type = ((const SwtiAliasType*) type)->targetType;
+                continue;
+            case SwtiTypeRecord:
+                *outInfo = ((const SwtiRecordType*) type)->memoryInfo;
+                return 0;
+            case SwtiTypeTuple:
+                *outInfo = ((const SwtiTupleType*) type)->memoryInfo;
+                return 0;
+            case SwtiTypeCustom:
+                *outInfo = ((const SwtiCustomType*) type)->memoryInfo;
+                return 0;
+            case SwtiTypeCustomVariant:
+                *outInfo = ((const SwtiCustomTypeVariant*) type)->memoryInfo;
+                return 0;
+            default:
+                CLOG_SOFT_ERROR("layout: unknown type %d", type->type)
+                return -1;
+        }
+    }
+
+    CLOG_SOFT_ERROR("layout: alias chain is too deep")
+    return -2;
+}
+
+static int layoutType(LayoutContext* context, const SwtiType* type);
+
+static int slotMemoryInfo(LayoutContext* context, const SwtiType* type, SwtiMemoryInfo* outInfo)
+{
+    for (size_t depth = 0; depth <= context->chunk->typeCount; ++depth) {
+        if (primitiveMemoryInfo(type, context->profile, outInfo)) {
+            return 0;
+        }
+
+        if (type->type == SwtiTypeAlias) {
+            type = ((const SwtiAliasType*) type)->targetType;
+            continue;
+        }
+
+        int error;
+        if ((error = layoutType(context, type)) != 0) {
+            return error;
+        }
+        *outInfo = context->infos[type->index];
+        return 0;
+    }
+
+    CLOG_SOFT_ERROR("layout: alias cycle detected")
+    return -2;
+}
+
+static int storeMemoryInfo(LayoutContext* context, const SwtiType* owner, SwtiMemoryInfo* target,
+                           SwtiMemoryInfo computed)
+{
+    if (!context->validateOnly) {
+        *target = computed;
+        return 0;
+    }
+
+    if (target->memorySize != computed.memorySize || target->memoryAlign != computed.memoryAlign) {
+        CLOG_SOFT_ERROR("layout: type %d has size %d align %d, expected size %d align %d", owner->index,
+                        target->memorySize, target->memoryAlign, computed.memorySize, computed.memoryAlign)
+        return -6;
+    }
+
+    return 0;
+}
+
+static int storeMemoryOffsetInfo(LayoutContext* context, const SwtiType* owner, SwtiMemoryOffsetInfo* target,
+                                 size_t offset, SwtiMemoryInfo computed)
+{
+    if (!context->validateOnly) {
+        target->memoryOffset = (SwtiMemoryOffset) offset;
+        target->memoryInfo = computed;
+        return 0;
+    }
+
+    if (target->memoryOffset != offset) {
+        CLOG_SOFT_ERROR("layout: type %d has a field at offset %d, expected %zu", owner->index, target->memoryOffset,
+                        offset)
+        return -6;
+    }
+
+    return storeMemoryInfo(context, owner, &target->memoryInfo, computed);
+}
+
+static int finishComposite(LayoutContext* context, const SwtiType* owner, SwtiMemoryInfo* target, size_t offset,
+                           size_t maxAlign)
+{
+    size_t size = alignUp(offset, maxAlign);
+    if (size > 0xffff) {
+        CLOG_SOFT_ERROR("layout: type %d is too big %zu", owner->index, size)
+        return -4;
+    }
+
+    SwtiMemoryInfo computed;
+    computed.memorySize = (SwtiMemorySize) size;
+    computed.memoryAlign = (SwtiMemoryAlign) maxAlign;
+
+    context->infos[owner->index] = computed;
+
+    return storeMemoryInfo(context, owner, target, computed);
+}
+
+static int layoutField(LayoutContext* context, const SwtiType* owner, const SwtiType* fieldType,
+                       SwtiMemoryOffsetInfo* target, size_t* offset, size_t* maxAlign)
+{
+    SwtiMemoryInfo fieldInfo;
+    int error;
+
+    if ((error = slotMemoryInfo(context, fieldType, &fieldInfo)) != 0) {
+        return error;
+    }
+
+    *offset = alignUp(*offset, fieldInfo.memoryAlign);
+    if ((error = storeMemoryOffsetInfo(context, owner, target, *offset, fieldInfo)) != 0) {
+        return error;
+    }
+    *offset += fieldInfo.memorySize;
+    if (fieldInfo.memoryAlign > *maxAlign) {
+        *maxAlign = fieldInfo.memoryAlign;
+    }
+
+    return 0;
+}
+
+static int layoutRecord(LayoutContext* context, SwtiRecordType* record)
+{
+    size_t offset = 0;
+    size_t maxAlign = 1;
+    int error;
+
+    for (size_t i = 0; i < record->fieldCount; ++i) {
+        SwtiRecordTypeField* field = (SwtiRecordTypeField*) &record->fields[i];
+        if ((error = layoutField(context, &record->internal, field->fieldType, &field->memoryOffsetInfo, &offset,
+                                 &maxAlign)) != 0) {
+            return error;
+        }
+    }
+
+    return finishComposite(context, &record->internal, &record->memoryInfo, offset, maxAlign);
+}
+
+static int layoutTuple(LayoutContext* context, SwtiTupleType* tuple)
+{
+    size_t offset = 0;
+    size_t maxAlign = 1;
+    int error;
+
+    for (size_t i = 0; i < tuple->fieldCount; ++i) {
+        SwtiTupleTypeField* field = (SwtiTupleTypeField*) &tuple->fields[i];
+        if ((error = layoutField(context, &tuple->internal, field->fieldType, &field->memoryOffsetInfo, &offset,
+                                 &maxAlign)) != 0) {
+            return error;
+        }
+    }
+
+    return finishComposite(context, &tuple->internal, &tuple->memoryInfo, offset, maxAlign);
+}
+
+static int layoutVariant(LayoutContext* context, SwtiCustomTypeVariant* variant)
+{
+    size_t offset = context->profile->tagInfo.memorySize;
+    size_t maxAlign = context->profile->tagInfo.memoryAlign;
+    int error;
+
+    for (size_t i = 0; i < variant->paramCount; ++i) {
+        SwtiCustomTypeVariantField* field = (SwtiCustomTypeVariantField*) &variant->fields[i];
+        if ((error = layoutField(context, &variant->internal, field->fieldType, &field->memoryOffsetInfo, &offset,
+                                 &maxAlign)) != 0) {
+            return error;
+        }
+    }
+
+    return finishComposite(context, &variant->internal, &variant->memoryInfo, offset, maxAlign);
+}
+
+static int layoutCustom(LayoutContext* context, SwtiCustomType* custom)
+{
+    size_t maxSize = context->profile->tagInfo.memorySize;
+    size_t maxAlign = context->profile->tagInfo.memoryAlign;
+    int error;
+
+    for (size_t i = 0; i < custom->variantCount; ++i) {
+        const SwtiCustomTypeVariant* variant = custom->variantTypes[i];
+        if ((error = layoutType(context, &variant->internal)) != 0) {
+            return error;
+        }
+        SwtiMemoryInfo variantInfo = context->infos[variant->internal.index];
+        if (variantInfo.memorySize > maxSize) {
+            maxSize = variantInfo.memorySize;
+        }
+        if (variantInfo.memoryAlign > maxAlign) {
+            maxAlign = variantInfo.memoryAlign;
+        }
+    }
+
+    return finishComposite(context, &custom->internal, &custom->memoryInfo, maxSize, maxAlign);
+}
+
+static int layoutItems(LayoutContext* context, const SwtiType* owner, const SwtiType* itemType, SwtiMemoryInfo* target)
+{
+    SwtiMemoryInfo itemInfo;
+    int error;
+
+    if ((error = slotMemoryInfo(context, itemType, &itemInfo)) != 0) {
+        return error;
+    }
+
+    context->infos[owner->index] = itemInfo;
+
+    return storeMemoryInfo(context, owner, target, itemInfo);
+}
+
+static int layoutType(LayoutContext* context, const SwtiType* type)
+{
+    if (type->index >= context->chunk->typeCount || context->chunk->types[type->index] != type) {
+        CLOG_SOFT_ERROR("layout: type %d is not part of the chunk", type->index)
+        return -5;
+    }
+
+    switch (context->states[type->index]) {
+        case LayoutStateDone:
+            return 0;
+        case LayoutStateVisiting:
+            CLOG_SOFT_ERROR("layout: type %d contains itself without a reference in between", type->index)
+            return -3;
+        default:
+            break;
+    }
+
+    context->states[type->index] = LayoutStateVisiting;
+
+    int error = 0;
+    switch (type->type) {
+        case SwtiTypeRecord:
+            error = layoutRecord(context, (SwtiRecordType*) type);
+            break;
+        case SwtiTypeTuple:
+            error = layoutTuple(context, (SwtiTupleType*) type);
+            break;
+        case SwtiTypeCustomVariant:
+            error = layoutVariant(context, (SwtiCustomTypeVariant*) type);
+            break;
+        case SwtiTypeCustom:
+            error = layoutCustom(context, (SwtiCustomType*) type);
+            break;
+        case SwtiTypeArray: {
+            SwtiArrayType* array = (SwtiArrayType*) type;
+            error = layoutItems(context, type, array->itemType, &array->memoryInfo);
+            break;
+        }
+        case SwtiTypeList: {
+            SwtiListType* list = (SwtiListType*) type;
+            error = layoutItems(context, type, list->itemType, &list->memoryInfo);
+            break;
+        }
+        default:
+            // Everything else has no memory info of its own
+            break;
+    }
+
+    if (error != 0) {
+        return error;
+    }
+
+    context->states[type->index] = LayoutStateDone;
+
+    return 0;
+}
+
+static int layoutChunk(const SwtiChunk* chunk, const SwtisLayoutProfile* profile, int validateOnly)
+{
+    LayoutContext context;
+    context.chunk = chunk;
+    context.profile = profile;
+    context.validateOnly = validateOnly;
+    context.states = tc_malloc_type_count(uint8_t, chunk->typeCount + 1);
+    context.infos = tc_malloc_type_count(SwtiMemoryInfo, chunk->typeCount + 1);
+    if (context.states == 0 || context.infos == 0) {
+        CLOG_SOFT_ERROR("layout: out of memory for %zu types", chunk->typeCount)
+        tc_free(context.infos);
+        tc_free(context.states);
+        return -7;
+    }
+    tc_mem_clear_type_n(context.states, chunk->typeCount);
+
+    int error = 0;
+    for (size_t i = 0; i < chunk->typeCount; ++i) {
+        if ((error = layoutType(&context, chunk->types[i])) != 0) {
+            break;
+        }
+    }
+
+    tc_free(context.infos);
+    tc_free(context.states);
+
+    return error;
+}
+
+/// Computes memory size, alignment and field offsets for every type in the chunk.
+/// Types are visited depth first, so each type is laid out after everything it embeds.
+int swtisLayoutCompute(SwtiChunk* chunk, const SwtisLayoutProfile* profile)
+{
+    return layoutChunk(chunk, profile, 0);
+}
+
+/// Checks that the memory info already present in the chunk matches what the profile would produce.
+int swtisLayoutValidate(const SwtiChunk* chunk, const SwtisLayoutProfile* profile)
+{
+    return layoutChunk(chunk, profile, 1);
+}
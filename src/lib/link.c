@@ -0,0 +1,544 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <string.h>
+#include <swamp-typeinfo-serialize/link.h>
+#include <swamp-typeinfo/chunk.h>
+#include <swamp-typeinfo/typeinfo.h>
+#include <tiny-libc/tiny_libc.h>
+
+#define SWTIS_LINK_MAX_ALIAS_DEPTH (32)
+
+typedef enum HashState {
+    HashStateNone,
+    HashStateInProgress,
+    HashStateDone,
+    // Reached a type that was already being hashed, so the hash depends on where the hashing started
+    HashStateUnreliable,
+} HashState;
+
+typedef struct ChunkHashes {
+    uint64_t* hashes;
+    uint8_t* states;
+} ChunkHashes;
+
+typedef enum PairState {
+    PairStateEmpty,
+    // Has been compared, but the result was thrown away. Keeps the slot so that probing still works.
+    PairStateUnknown,
+    // Being compared, or compared equal while assuming that a pair further up is equal
+    PairStateAssumed,
+    PairStateEqual,
+    PairStateDifferent,
+} PairState;
+
+typedef struct Pair {
+    uint32_t key;
+    uint8_t state;
+    uint8_t reason;
+    uint16_t moduleTypeIndex;
+    uint16_t hostTypeIndex;
+    uint16_t memberIndex;
+} Pair;
+
+typedef struct LinkContext {
+    ChunkHashes moduleHashes;
+    ChunkHashes hostHashes;
+    Pair* pairs;
+    size_t pairCapacity;
+    size_t pairCount;
+    uint32_t* assumedKeys;
+    size_t assumedCount;
+    size_t assumedCapacity;
+    // The innermost difference of the last comparison that failed
+    Pair failure;
+} LinkContext;
+
+static uint64_t mix(uint64_t hash, uint64_t value)
+{
+    hash ^= value + 0x9e3779b97f4a7c15u + (hash << 6) + (hash >> 2);
+    return hash * 0x100000001b3u;
+}
+
+static uint64_t mixString(uint64_t hash, const char* s)
+{
+    while (*s != 0) {
+        hash = mix(hash, (uint8_t) *s++);
+    }
+    return mix(hash, 0);
+}
+
+static const SwtiType* unwrap(const SwtiType* type)
+{
+    for (size_t i = 0; i < SWTIS_LINK_MAX_ALIAS_DEPTH && type != 0; ++i) {
+        if (type->type != SwtiTypeAlias) {
+            return type;
+        }
+        type = ((const SwtiAliasType*) type)->targetType;
+    }
+
+    return type;
+}
+
+/// A hash that is the same for structurally equivalent types. Custom types are only hashed by name, generics and
+/// variant count, which keeps recursive types finite.
+static uint64_t typeHash(ChunkHashes* self, const SwtiType* type, int* isReliable)
+{
+    type = unwrap(type);
+    if (type == 0) {
+        return 0;
+    }
+
+    switch (self->states[type->index]) {
+        case HashStateDone:
+            return self->hashes[type->index];
+        case HashStateUnreliable:
+            *isReliable = 0;
+            return self->hashes[type->index];
+        case HashStateInProgress:
+            *isReliable = 0;
+            return 0;
+        default:
+            break;
+    }
+
+    self->states[type->index] = HashStateInProgress;
+
+    int isThisReliable = 1;
+    uint64_t hash = mix(0xcbf29ce484222325u, type->type);
+
+    switch (type->type) {
+        case SwtiTypeCustom: {
+            const SwtiCustomType* custom = (const SwtiCustomType*) type;
+            hash = mixString(hash, custom->internal.name);
+            hash = mix(hash, custom->generic.genericCount);
+            for (size_t i = 0; i < custom->generic.genericCount; ++i) {
+                hash = mix(hash, typeHash(self, custom->generic.genericTypes[i], &isThisReliable));
+            }
+            hash = mix(hash, custom->variantCount);
+            break;
+        }
+        case SwtiTypeCustomVariant: {
+            const SwtiCustomTypeVariant* variant = (const SwtiCustomTypeVariant*) type;
+            hash = mixString(hash, variant->name);
+            hash = mix(hash, variant->paramCount);
+            break;
+        }
+        case SwtiTypeRecord: {
+            const SwtiRecordType* record = (const SwtiRecordType*) type;
+            hash = mix(hash, record->fieldCount);
+            for (size_t i = 0; i < record->fieldCount; ++i) {
+                hash = mixString(hash, record->fields[i].name);
+                hash = mix(hash, typeHash(self, record->fields[i].fieldType, &isThisReliable));
+            }
+            break;
+        }
+        case SwtiTypeTuple: {
+            const SwtiTupleType* tuple = (const SwtiTupleType*) type;
+            hash = mix(hash, tuple->fieldCount);
+            for (size_t i = 0; i < tuple->fieldCount; ++i) {
+                hash = mix(hash, typeHash(self, tuple->fields[i].fieldType, &isThisReliable));
+            }
+            break;
+        }
+        case SwtiTypeFunction: {
+            const SwtiFunctionType* fn = (const SwtiFunctionType*) type;
+            hash = mix(hash, fn->parameterCount);
+            for (size_t i = 0; i < fn->parameterCount; ++i) {
+                hash = mix(hash, typeHash(self, fn->parameterTypes[i], &isThisReliable));
+            }
+            break;
+        }
+        case SwtiTypeList:
+            hash = mix(hash, typeHash(self, ((const SwtiListType*) type)->itemType, &isThisReliable));
+            break;
+        case SwtiTypeArray:
+            hash = mix(hash, typeHash(self, ((const SwtiArrayType*) type)->itemType, &isThisReliable));
+            break;
+        case SwtiTypeRefId:
+            hash = mix(hash, typeHash(self, ((const SwtiTypeRefIdType*) type)->referencedType, &isThisReliable));
+            break;
+        case SwtiTypeUnmanaged:
+            hash = mix(hash, ((const SwtiUnmanagedType*) type)->userTypeId);
+            break;
+        default:
+            break;
+    }
+
+    self->hashes[type->index] = hash;
+    self->states[type->index] = isThisReliable ? HashStateDone : HashStateUnreliable;
+    if (!isThisReliable) {
+        *isReliable = 0;
+    }
+
+    return hash;
+}
+
+/// Returns 1 if the types can not be equivalent.
+static int hashesDiffer(LinkContext* context, const SwtiType* moduleType, const SwtiType* hostType)
+{
+    int isReliable = 1;
+    uint64_t moduleHash = typeHash(&context->moduleHashes, moduleType, &isReliable);
+    uint64_t hostHash = typeHash(&context->hostHashes, hostType, &isReliable);
+
+    return isReliable && moduleHash != hostHash;
+}
+
+static Pair* findPair(LinkContext* context, uint32_t key)
+{
+    size_t mask = context->pairCapacity - 1;
+    size_t index = (size_t) ((key * 2654435761u) & mask);
+    for (;;) {
+        Pair* pair = &context->pairs[index];
+        if (pair->state == PairStateEmpty || pair->key == key) {
+            return pair;
+        }
+        index = (index + 1) & mask;
+    }
+}
+
+static Pair* insertPair(LinkContext* context, uint32_t key)
+{
+    if ((context->pairCount + 1) * 2 > context->pairCapacity) {
+        Pair* oldPairs = context->pairs;
+        size_t oldCapacity = context->pairCapacity;
+        context->pairCapacity = oldCapacity * 2;
+        context->pairs = tc_malloc_type_count(Pair, context->pairCapacity);
+        tc_mem_clear_type_n(context->pairs, context->pairCapacity);
+        for (size_t i = 0; i < oldCapacity; ++i) {
+            if (oldPairs[i].state != PairStateEmpty) {
+                *findPair(context, oldPairs[i].key) = oldPairs[i];
+            }
+        }
+        tc_free(oldPairs);
+    }
+
+    Pair* pair = findPair(context, key);
+    if (pair->state == PairStateEmpty) {
+        pair->key = key;
+        context->pairCount++;
+    }
+
+    return pair;
+}
+
+static void pushAssumed(LinkContext* context, uint32_t key)
+{
+    if (context->assumedCount == context->assumedCapacity) {
+        size_t newCapacity = context->assumedCapacity == 0 ? 64 : context->assumedCapacity * 2;
+        uint32_t* newKeys = tc_malloc_type_count(uint32_t, newCapacity);
+        if (context->assumedCount > 0) {
+            tc_memcpy_octets(newKeys, context->assumedKeys, context->assumedCount * sizeof(uint32_t));
+        }
+        tc_free(context->assumedKeys);
+        context->assumedKeys = newKeys;
+        context->assumedCapacity = newCapacity;
+    }
+
+    context->assumedKeys[context->assumedCount++] = key;
+}
+
+static int fail(LinkContext* context, const SwtiType* moduleType, const SwtiType* hostType, SwtisLinkReason reason,
+                size_t memberIndex)
+{
+    context->failure.reason = (uint8_t) reason;
+    context->failure.moduleTypeIndex = moduleType->index;
+    context->failure.hostTypeIndex = hostType->index;
+    context->failure.memberIndex = (uint16_t) memberIndex;
+
+    return 0;
+}
+
+static int equivalent(LinkContext* context, const SwtiType* moduleType, const SwtiType* hostType);
+
+static const SwtiType* childAt(const SwtiType* type, size_t index)
+{
+    switch (type->type) {
+        case SwtiTypeCustom: {
+            const SwtiCustomType* custom = (const SwtiCustomType*) type;
+            if (index < custom->generic.genericCount) {
+                return custom->generic.genericTypes[index];
+            }
+            return (const SwtiType*) custom->variantTypes[index - custom->generic.genericCount];
+        }
+        case SwtiTypeCustomVariant: {
+            const SwtiCustomTypeVariant* variant = (const SwtiCustomTypeVariant*) type;
+            if (index < variant->paramCount) {
+                return variant->fields[index].fieldType;
+            }
+            return (const SwtiType*) variant->inCustomType;
+        }
+        case SwtiTypeRecord:
+            return ((const SwtiRecordType*) type)->fields[index].fieldType;
+        case SwtiTypeTuple:
+            return ((const SwtiTupleType*) type)->fields[index].fieldType;
+        case SwtiTypeFunction:
+            return ((const SwtiFunctionType*) type)->parameterTypes[index];
+        case SwtiTypeList:
+            return ((const SwtiListType*) type)->itemType;
+        case SwtiTypeArray:
+            return ((const SwtiArrayType*) type)->itemType;
+        case SwtiTypeRefId:
+            return ((const SwtiTypeRefIdType*) type)->referencedType;
+        default:
+            return 0;
+    }
+}
+
+/// Compares everything but the child types, and returns the number of children.
+static int compareShallow(LinkContext* context, const SwtiType* moduleType, const SwtiType* hostType,
+                          size_t* outChildCount)
+{
+    switch (moduleType->type) {
+        case SwtiTypeCustom: {
+            const SwtiCustomType* a = (const SwtiCustomType*) moduleType;
+            const SwtiCustomType* b = (const SwtiCustomType*) hostType;
+            if (strcmp(a->internal.name, b->internal.name) != 0) {
+                return fail(context, moduleType, hostType, SwtisLinkReasonName, 0);
+            }
+            if (a->generic.genericCount != b->generic.genericCount || a->variantCount != b->variantCount) {
+                return fail(context, moduleType, hostType, SwtisLinkReasonCount, 0);
+            }
+            *outChildCount = a->generic.genericCount + a->variantCount;
+            return 1;
+        }
+        case SwtiTypeCustomVariant: {
+            const SwtiCustomTypeVariant* a = (const SwtiCustomTypeVariant*) moduleType;
+            const SwtiCustomTypeVariant* b = (const SwtiCustomTypeVariant*) hostType;
+            if (strcmp(a->name, b->name) != 0) {
+                return fail(context, moduleType, hostType, SwtisLinkReasonName, 0);
+            }
+            if (a->paramCount != b->paramCount) {
+                return fail(context, moduleType, hostType, SwtisLinkReasonCount, 0);
+            }
+            *outChildCount = a->paramCount + 1;
+            return 1;
+        }
+        case SwtiTypeRecord: {
+            const SwtiRecordType* a = (const SwtiRecordType*) moduleType;
+            const SwtiRecordType* b = (const SwtiRecordType*) hostType;
+            if (a->fieldCount != b->fieldCount) {
+                return fail(context, moduleType, hostType, SwtisLinkReasonCount, 0);
+            }
+            for (size_t i = 0; i < a->fieldCount; ++i) {
+                if (strcmp(a->fields[i].name, b->fields[i].name) != 0) {
+                    return fail(context, moduleType, hostType, SwtisLinkReasonFieldName, i);
+                }
+            }
+            *outChildCount = a->fieldCount;
+            return 1;
+        }
+        case SwtiTypeTuple: {
+            size_t count = ((const SwtiTupleType*) moduleType)->fieldCount;
+            if (count != ((const SwtiTupleType*) hostType)->fieldCount) {
+                return fail(context, moduleType, hostType, SwtisLinkReasonCount, 0);
+            }
+            *outChildCount = count;
+            return 1;
+        }
+        case SwtiTypeFunction: {
+            size_t count = ((const SwtiFunctionType*) moduleType)->parameterCount;
+            if (count != ((const SwtiFunctionType*) hostType)->parameterCount) {
+                return fail(context, moduleType, hostType, SwtisLinkReasonCount, 0);
+            }
+            *outChildCount = count;
+            return 1;
+        }
+        case SwtiTypeList:
+        case SwtiTypeArray:
+        case SwtiTypeRefId:
+            *outChildCount = 1;
+            return 1;
+        case SwtiTypeUnmanaged:
+            if (((const SwtiUnmanagedType*) moduleType)->userTypeId != ((const SwtiUnmanagedType*) hostType)->userTypeId) {
+                return fail(context, moduleType, hostType, SwtisLinkReasonUserTypeId, 0);
+            }
+            *outChildCount = 0;
+            return 1;
+        default:
+            *outChildCount = 0;
+            return 1;
+    }
+}
+
+static int compareChildren(LinkContext* context, const SwtiType* moduleType, const SwtiType* hostType,
+                           size_t childCount)
+{
+    // A child with a different hash can not match, so go straight to it
+    for (size_t i = 0; i < childCount; ++i) {
+        if (hashesDiffer(context, childAt(moduleType, i), childAt(hostType, i)) &&
+            !equivalent(context, childAt(moduleType, i), childAt(hostType, i))) {
+            return 0;
+        }
+    }
+
+    for (size_t i = 0; i < childCount; ++i) {
+        if (!equivalent(context, childAt(moduleType, i), childAt(hostType, i))) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/// Types that are being compared are assumed to be equivalent, so recursive types terminate. A difference never
+/// depends on an assumption, so those are kept. Equalities are only kept if the comparison they were part of
+/// succeeded, see checkRoot().
+static int equivalent(LinkContext* context, const SwtiType* moduleType, const SwtiType* hostType)
+{
+    moduleType = unwrap(moduleType);
+    hostType = unwrap(hostType);
+    // Generic parameters that could not be resolved are cleared by the deserializer
+    if (moduleType == 0 && hostType == 0) {
+        return 1;
+    }
+    if (moduleType == 0 || hostType == 0) {
+        context->failure.reason = SwtisLinkReasonKind;
+        return 0;
+    }
+
+    uint32_t key = ((uint32_t) moduleType->index << 16) | hostType->index;
+    Pair* pair = findPair(context, key);
+    switch (pair->state) {
+        case PairStateEqual:
+        case PairStateAssumed:
+            return 1;
+        case PairStateDifferent:
+            context->failure = *pair;
+            return 0;
+        default:
+            break;
+    }
+
+    if (moduleType->type != hostType->type) {
+        fail(context, moduleType, hostType, SwtisLinkReasonKind, 0);
+    } else {
+        size_t childCount;
+        if (compareShallow(context, moduleType, hostType, &childCount)) {
+            pair = insertPair(context, key);
+            pair->state = PairStateAssumed;
+            pushAssumed(context, key);
+            if (compareChildren(context, moduleType, hostType, childCount)) {
+                return 1;
+            }
+        }
+    }
+
+    pair = insertPair(context, key);
+    pair->state = PairStateDifferent;
+    pair->reason = context->failure.reason;
+    pair->moduleTypeIndex = context->failure.moduleTypeIndex;
+    pair->hostTypeIndex = context->failure.hostTypeIndex;
+    pair->memberIndex = context->failure.memberIndex;
+
+    return 0;
+}
+
+static int checkRoot(LinkContext* context, const SwtiType* moduleType, const SwtiType* hostType)
+{
+    context->assumedCount = 0;
+
+    int isEquivalent = equivalent(context, moduleType, hostType);
+
+    for (size_t i = 0; i < context->assumedCount; ++i) {
+        Pair* pair = findPair(context, context->assumedKeys[i]);
+        if (pair->state == PairStateAssumed) {
+            pair->state = isEquivalent ? PairStateEqual : PairStateUnknown;
+        }
+    }
+
+    return isEquivalent;
+}
+
+static int compareSymbols(const void* a, const void* b)
+{
+    return strcmp(((const SwtisLinkSymbol*) a)->name, ((const SwtisLinkSymbol*) b)->name);
+}
+
+static void initHashes(ChunkHashes* self, const SwtiChunk* chunk)
+{
+    self->hashes = tc_malloc_type_count(uint64_t, chunk->typeCount + 1);
+    self->states = tc_malloc(chunk->typeCount + 1);
+    tc_mem_clear(self->states, chunk->typeCount + 1);
+}
+
+static void destroyHashes(ChunkHashes* self)
+{
+    tc_free(self->hashes);
+    tc_free(self->states);
+}
+
+int swtisLinkCheck(const SwtiChunk* module, const SwtisLinkSymbol* moduleSymbols, size_t moduleSymbolCount,
+                   const SwtiChunk* host, const SwtisLinkSymbol* hostSymbols, size_t hostSymbolCount,
+                   SwtisLinkMismatch* outMismatches, size_t maxMismatchCount)
+{
+    for (size_t i = 0; i < moduleSymbolCount; ++i) {
+        if (moduleSymbols[i].typeIndex >= module->typeCount) {
+            CLOG_SOFT_ERROR("swtisLinkCheck: module symbol '%s' has an illegal type index", moduleSymbols[i].name)
+            return -3;
+        }
+    }
+
+    for (size_t i = 0; i < hostSymbolCount; ++i) {
+        if (hostSymbols[i].typeIndex >= host->typeCount) {
+            CLOG_SOFT_ERROR("swtisLinkCheck: host symbol '%s' has an illegal type index", hostSymbols[i].name)
+            return -3;
+        }
+    }
+
+    SwtisLinkSymbol* sortedHostSymbols = tc_malloc_type_count(SwtisLinkSymbol, hostSymbolCount + 1);
+    if (hostSymbolCount > 0) {
+        tc_memcpy_octets(sortedHostSymbols, hostSymbols, hostSymbolCount * sizeof(SwtisLinkSymbol));
+        qsort(sortedHostSymbols, hostSymbolCount, sizeof(SwtisLinkSymbol), compareSymbols);
+    }
+
+    LinkContext context;
+    tc_mem_clear_type(&context);
+    initHashes(&context.moduleHashes, module);
+    initHashes(&context.hostHashes, host);
+    context.pairCapacity = 256;
+    context.pairs = tc_malloc_type_count(Pair, context.pairCapacity);
+    tc_mem_clear_type_n(context.pairs, context.pairCapacity);
+
+    size_t mismatchCount = 0;
+
+    for (size_t i = 0; i < moduleSymbolCount; ++i) {
+        const SwtisLinkSymbol* symbol = &moduleSymbols[i];
+        const SwtisLinkSymbol* found = hostSymbolCount > 0 ? bsearch(symbol, sortedHostSymbols, hostSymbolCount,
+                                                                     sizeof(SwtisLinkSymbol), compareSymbols)
+                                                           : 0;
+        SwtisLinkMismatch mismatch;
+        mismatch.name = symbol->name;
+        mismatch.moduleTypeIndex = symbol->typeIndex;
+        mismatch.hostTypeIndex = 0;
+        mismatch.memberIndex = 0;
+
+        if (found == 0) {
+            mismatch.reason = SwtisLinkReasonMissing;
+        } else {
+            mismatch.hostTypeIndex = found->typeIndex;
+            if (checkRoot(&context, module->types[symbol->typeIndex], host->types[found->typeIndex])) {
+                continue;
+            }
+            mismatch.reason = (SwtisLinkReason) context.failure.reason;
+            mismatch.moduleTypeIndex = context.failure.moduleTypeIndex;
+            mismatch.hostTypeIndex = context.failure.hostTypeIndex;
+            mismatch.memberIndex = context.failure.memberIndex;
+        }
+
+        if (mismatchCount < maxMismatchCount) {
+            outMismatches[mismatchCount] = mismatch;
+        }
+        mismatchCount++;
+    }
+
+    tc_free(context.assumedKeys);
+    tc_free(context.pairs);
+    destroyHashes(&context.hostHashes);
+    destroyHashes(&context.moduleHashes);
+    tc_free(sortedHostSymbols);
+
+    return (int) mismatchCount;
+}
@@ -0,0 +1,247 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <imprint/allocator.h>
+#include <pthread.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo-serialize/deserialize_internal.h>
+#include <swamp-typeinfo-serialize/loader.h>
+#include <swamp-typeinfo/chunk.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <tiny-libc/tiny_libc.h>
+#include <unistd.h>
+
+typedef struct BlockReader {
+    int fd;
+    uint8_t* octets;
+    size_t octetCount;
+    size_t blockSize;
+    pthread_mutex_t mutex;
+    pthread_cond_t arrived;
+    size_t availableCount;
+    int isDone;
+    int isCancelled;
+    int error;
+    uint64_t ioNanoseconds;
+} BlockReader;
+
+static uint64_t nowNanoseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+static int openFile(const char* path, int* outFd, size_t* outOctetCount)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        CLOG_SOFT_ERROR("loader: could not open '%s' (%d)", path, errno)
+        return -1;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        CLOG_SOFT_ERROR("loader: '%s' is empty or can not be read", path)
+        close(fd);
+        return -1;
+    }
+
+    *outFd = fd;
+    *outOctetCount = (size_t) info.st_size;
+
+    return 0;
+}
+
+static int loadMapped(const char* path, SwtiChunk* target, ImprintAllocator* allocator,
+                      const SwtisDeserializeOptions* deserializeOptions, SwtisLoadStats* stats)
+{
+    uint64_t start = nowNanoseconds();
+    int fd;
+    size_t octetCount;
+
+    if (openFile(path, &fd, &octetCount) != 0) {
+        return -1;
+    }
+
+    void* octets = mmap(0, octetCount, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (octets == MAP_FAILED) {
+        CLOG_SOFT_ERROR("loader: could not map '%s' (%d)", path, errno)
+        return -1;
+    }
+
+    // Start reading the whole file in the background, in order
+    madvise(octets, octetCount, MADV_SEQUENTIAL);
+    madvise(octets, octetCount, MADV_WILLNEED);
+
+    uint64_t mapped = nowNanoseconds();
+    int result = swtisDeserializeWithOptions((const uint8_t*) octets, octetCount, target, allocator,
+                                             deserializeOptions);
+    uint64_t decoded = nowNanoseconds();
+
+    munmap(octets, octetCount);
+
+    stats->ioNanoseconds = mapped - start;
+    stats->decodeNanoseconds = decoded - mapped;
+    stats->octetCount = octetCount;
+
+    return result;
+}
+
+static void* readBlocks(void* argument)
+{
+    BlockReader* reader = (BlockReader*) argument;
+    size_t pos = 0;
+    int error = 0;
+
+    while (pos < reader->octetCount) {
+        size_t blockSize = reader->octetCount - pos < reader->blockSize ? reader->octetCount - pos : reader->blockSize;
+        uint64_t before = nowNanoseconds();
+        ssize_t octetsRead = read(reader->fd, reader->octets + pos, blockSize);
+        reader->ioNanoseconds += nowNanoseconds() - before;
+        if (octetsRead < 0 && errno == EINTR) {
+            continue;
+        }
+        if (octetsRead <= 0) {
+            error = -1;
+            break;
+        }
+        pos += (size_t) octetsRead;
+
+        pthread_mutex_lock(&reader->mutex);
+        reader->availableCount = pos;
+        int isCancelled = reader->isCancelled;
+        pthread_cond_signal(&reader->arrived);
+        pthread_mutex_unlock(&reader->mutex);
+        if (isCancelled) {
+            break;
+        }
+    }
+
+    pthread_mutex_lock(&reader->mutex);
+    reader->error = error;
+    reader->isDone = 1;
+    pthread_cond_signal(&reader->arrived);
+    pthread_mutex_unlock(&reader->mutex);
+
+    return 0;
+}
+
+static int loadBlocks(const char* path, SwtiChunk* target, ImprintAllocator* allocator, size_t blockSize,
+                      const SwtisDeserializeOptions* deserializeOptions, SwtisLoadStats* stats)
+{
+    uint64_t start = nowNanoseconds();
+    BlockReader reader;
+
+    if (openFile(path, &reader.fd, &reader.octetCount) != 0) {
+        return -1;
+    }
+
+    reader.octets = tc_malloc(reader.octetCount);
+    if (reader.octets == 0) {
+        CLOG_SOFT_ERROR("loader: out of memory for the %zu octets of '%s'", reader.octetCount, path)
+        close(reader.fd);
+        return -7;
+    }
+    reader.blockSize = blockSize;
+    reader.availableCount = 0;
+    reader.isDone = 0;
+    reader.isCancelled = 0;
+    reader.error = 0;
+    reader.ioNanoseconds = nowNanoseconds() - start;
+    pthread_mutex_init(&reader.mutex, 0);
+    pthread_cond_init(&reader.arrived, 0);
+
+    pthread_t thread;
+    int hasThread = pthread_create(&thread, 0, readBlocks, &reader) == 0;
+    if (!hasThread) {
+        // Read everything on this thread instead
+        readBlocks(&reader);
+    }
+
+    SwtisDeserializeProgress progress;
+    swtisDeserializeProgressInit(&progress, target, allocator, deserializeOptions);
+
+    uint64_t decodeNanoseconds = 0;
+    size_t availableCount = 0;
+    int result;
+
+    for (;;) {
+        pthread_mutex_lock(&reader.mutex);
+        while (reader.availableCount == availableCount && !reader.isDone) {
+            pthread_cond_wait(&reader.arrived, &reader.mutex);
+        }
+        availableCount = reader.availableCount;
+        int isDone = reader.isDone;
+        int readError = reader.error;
+        pthread_mutex_unlock(&reader.mutex);
+
+        uint64_t before = nowNanoseconds();
+        result = swtisDeserializeProgressFeed(&progress, reader.octets, availableCount);
+        decodeNanoseconds += nowNanoseconds() - before;
+
+        if (result != 0) {
+            break;
+        }
+        if (isDone) {
+            CLOG_SOFT_ERROR("loader: '%s' ended before the last type (%d)", path, readError)
+            result = readError != 0 ? readError : -1;
+            break;
+        }
+    }
+
+    if (result == 1) {
+        uint64_t before = nowNanoseconds();
+        result = swtisDeserializeProgressFinish(&progress);
+        decodeNanoseconds += nowNanoseconds() - before;
+    }
+
+    if (hasThread) {
+        pthread_mutex_lock(&reader.mutex);
+        reader.isCancelled = 1;
+        pthread_mutex_unlock(&reader.mutex);
+        pthread_join(thread, 0);
+    }
+
+    pthread_cond_destroy(&reader.arrived);
+    pthread_mutex_destroy(&reader.mutex);
+    close(reader.fd);
+    tc_free(reader.octets);
+
+    stats->ioNanoseconds = reader.ioNanoseconds;
+    stats->decodeNanoseconds = decodeNanoseconds;
+    stats->octetCount = reader.octetCount;
+
+    return result;
+}
+
+int swtisLoadFile(const char* path, SwtiChunk* target, ImprintAllocator* allocator, const SwtisLoadOptions* options,
+                  SwtisLoadStats* outStats)
+{
+    SwtisLoadStats stats;
+    tc_mem_clear_type(&stats);
+
+    uint64_t start = nowNanoseconds();
+    int result;
+
+    if (options != 0 && options->mode == SwtisLoadModeBlocks) {
+        size_t blockSize = options->blockSize != 0 ? options->blockSize : SWTIS_LOAD_DEFAULT_BLOCK_SIZE;
+        result = loadBlocks(path, target, allocator, blockSize, options->deserializeOptions, &stats);
+    } else {
+        result = loadMapped(path, target, allocator, options != 0 ? options->deserializeOptions : 0, &stats);
+    }
+
+    stats.totalNanoseconds = nowNanoseconds() - start;
+    if (outStats != 0) {
+        *outStats = stats;
+    }
+
+    return result;
+}
@@ -0,0 +1,730 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <imprint/allocator.h>
+#include <string.h>
+#include <swamp-typeinfo-serialize/migrate.h>
+#include <swamp-typeinfo-serialize/value.h>
+#include <swamp-typeinfo-serialize/value_internal.h>
+#include <swamp-typeinfo/chunk.h>
+#include <swamp-typeinfo/typeinfo.h>
+#include <tiny-libc/tiny_libc.h>
+
+typedef struct OpsBuilder {
+    SwtisMigrationOp* ops;
+    size_t opCount;
+    size_t opCapacity;
+    int hasDefaults;
+} OpsBuilder;
+
+static int buildTable(SwtisMigration* self, const SwtiType* oldType, const SwtiMemoryInfo* oldSlot,
+                      const SwtiType* newType, const SwtiMemoryInfo* newSlot, size_t depth,
+                      SwtisMigrationTable** outTable);
+
+static SwtisMigrationOp* addOp(OpsBuilder* builder, SwtisMigrationOpcode opcode, size_t oldOffset, size_t newOffset,
+                               size_t size)
+{
+    if (opcode == SwtisMigrationOpcodeCopy && builder->opCount > 0) {
+        SwtisMigrationOp* last = &builder->ops[builder->opCount - 1];
+        if (last->opcode == SwtisMigrationOpcodeCopy && last->oldOffset + last->size == oldOffset &&
+            last->newOffset + last->size == newOffset) {
+            last->size += (uint32_t) size;
+            return last;
+        }
+    }
+
+    if (builder->opCount == builder->opCapacity) {
+        size_t newCapacity = builder->opCapacity == 0 ? 8 : builder->opCapacity * 2;
+        SwtisMigrationOp* newOps = tc_malloc_type_count(SwtisMigrationOp, newCapacity);
+        if (builder->opCount > 0) {
+            tc_memcpy_octets(newOps, builder->ops, builder->opCount * sizeof(SwtisMigrationOp));
+        }
+        tc_free(builder->ops);
+        builder->ops = newOps;
+        builder->opCapacity = newCapacity;
+    }
+
+    SwtisMigrationOp* op = &builder->ops[builder->opCount++];
+    op->opcode = opcode;
+    op->oldOffset = (uint32_t) oldOffset;
+    op->newOffset = (uint32_t) newOffset;
+    op->size = (uint32_t) size;
+    op->table = 0;
+
+    return op;
+}
+
+static SwtisMigrationOps finishOps(SwtisMigration* self, OpsBuilder* builder)
+{
+    SwtisMigrationOps result;
+    result.opCount = builder->opCount;
+    result.ops = 0;
+
+    if (builder->opCount > 0) {
+        SwtisMigrationOp* ops = IMPRINT_ALLOC_TYPE_COUNT(self->allocator, SwtisMigrationOp, builder->opCount);
+        tc_memcpy_octets(ops, builder->ops, builder->opCount * sizeof(SwtisMigrationOp));
+        result.ops = ops;
+    }
+    tc_free(builder->ops);
+    builder->ops = 0;
+    builder->opCount = 0;
+    builder->opCapacity = 0;
+
+    return result;
+}
+
+static int isReferenceKind(SwtiTypeValue typeValue)
+{
+    switch (typeValue) {
+        case SwtiTypeString:
+        case SwtiTypeBlob:
+        case SwtiTypeFunction:
+        case SwtiTypeAny:
+        case SwtiTypeAnyMatchingTypes:
+        case SwtiTypeUnmanaged:
+        case SwtiTypeRefId:
+            return 1;
+        default:
+            return 0;
+    }
+}
+
+static const SwtiType* listItemType(const SwtiType* type)
+{
+    return type->type == SwtiTypeList ? ((const SwtiListType*) type)->itemType
+                                      : ((const SwtiArrayType*) type)->itemType;
+}
+
+static const SwtiMemoryInfo* listItemSlot(const SwtiType* type)
+{
+    return type->type == SwtiTypeList ? &((const SwtiListType*) type)->memoryInfo
+                                      : &((const SwtiArrayType*) type)->memoryInfo;
+}
+
+/// `oldSlot` and `newSlot` are the memory info of the fields (or list items) that hold the values, see
+/// swtisValueScalarSize().
+static int addFieldOps(SwtisMigration* self, OpsBuilder* builder, const SwtiType* oldType,
+                       const SwtiMemoryInfo* oldSlot, size_t oldOffset, const SwtiType* newType,
+                       const SwtiMemoryInfo* newSlot, size_t newOffset, size_t depth)
+{
+    const SwtiType* oldUnaliased = swtisValueUnalias(oldType);
+    const SwtiType* newUnaliased = swtisValueUnalias(newType);
+    SwtiTypeValue oldKind = oldUnaliased->type == SwtiTypeResourceName ? SwtiTypeInt : oldUnaliased->type;
+    SwtiTypeValue newKind = newUnaliased->type == SwtiTypeResourceName ? SwtiTypeInt : newUnaliased->type;
+    int error;
+
+    if (oldKind != newKind) {
+        int isIntToFixed = oldKind == SwtiTypeInt && newKind == SwtiTypeFixed;
+        int isFixedToInt = oldKind == SwtiTypeFixed && newKind == SwtiTypeInt;
+        if (!isIntToFixed && !isFixedToInt) {
+            builder->hasDefaults = 1;
+            return 0;
+        }
+        size_t oldSize;
+        size_t newSize;
+        if ((error = swtisValueScalarSize(oldUnaliased, oldSlot, &oldSize)) != 0) {
+            return error;
+        }
+        if ((error = swtisValueScalarSize(newUnaliased, newSlot, &newSize)) != 0) {
+            return error;
+        }
+        if (oldSize != newSize) {
+            builder->hasDefaults = 1;
+            return 0;
+        }
+        addOp(builder, isIntToFixed ? SwtisMigrationOpcodeIntToFixed : SwtisMigrationOpcodeFixedToInt, oldOffset,
+              newOffset, oldSize);
+        return 0;
+    }
+
+    if (isReferenceKind(oldKind)) {
+        if (swtisValueCheckReferenceSlot(oldSlot) != 0 || swtisValueCheckReferenceSlot(newSlot) != 0) {
+            CLOG_SOFT_ERROR("migrate: type %d is not held in a host reference", oldUnaliased->index)
+            return -4;
+        }
+        addOp(builder, SwtisMigrationOpcodeCopy, oldOffset, newOffset, sizeof(void*));
+        return 0;
+    }
+
+    if (swtisValueIsScalar(oldKind)) {
+        size_t oldSize;
+        size_t newSize;
+        if ((error = swtisValueScalarSize(oldUnaliased, oldSlot, &oldSize)) != 0) {
+            return error;
+        }
+        if ((error = swtisValueScalarSize(newUnaliased, newSlot, &newSize)) != 0) {
+            return error;
+        }
+        if (oldSize != newSize) {
+            builder->hasDefaults = 1;
+            return 0;
+        }
+        addOp(builder, SwtisMigrationOpcodeCopy, oldOffset, newOffset, oldSize);
+        return 0;
+    }
+
+    SwtisMigrationTable* table;
+
+    switch (oldKind) {
+        case SwtiTypeRecord:
+        case SwtiTypeTuple:
+        case SwtiTypeCustom:
+            if ((error = buildTable(self, oldUnaliased, oldSlot, newUnaliased, newSlot, depth + 1, &table)) != 0) {
+                return error;
+            }
+            if (table->isIdentical) {
+                addOp(builder, SwtisMigrationOpcodeCopy, oldOffset, newOffset, table->oldMemorySize);
+            } else {
+                addOp(builder, SwtisMigrationOpcodeValue, oldOffset, newOffset, 0)->table = table;
+            }
+            return 0;
+        case SwtiTypeList:
+        case SwtiTypeArray: {
+            if (swtisValueCheckReferenceSlot(oldSlot) != 0 || swtisValueCheckReferenceSlot(newSlot) != 0) {
+                CLOG_SOFT_ERROR("migrate: list %d is not held in a host reference", oldUnaliased->index)
+                return -4;
+            }
+            if ((error = buildTable(self, swtisValueUnalias(listItemType(oldUnaliased)), listItemSlot(oldUnaliased),
+                                    swtisValueUnalias(listItemType(newUnaliased)), listItemSlot(newUnaliased),
+                                    depth + 1, &table)) != 0) {
+                return error;
+            }
+            if (table->isIdentical) {
+                // Lists are immutable, so the new value can share it
+                addOp(builder, SwtisMigrationOpcodeCopy, oldOffset, newOffset, sizeof(void*));
+            } else {
+                addOp(builder, SwtisMigrationOpcodeList, oldOffset, newOffset, 0)->table = table;
+            }
+            return 0;
+        }
+        default:
+            builder->hasDefaults = 1;
+            return 0;
+    }
+}
+
+static int isIdentity(const SwtisMigrationOps* ops, size_t memorySize)
+{
+    if (memorySize == 0) {
+        return ops->opCount == 0;
+    }
+
+    return ops->opCount == 1 && ops->ops[0].opcode == SwtisMigrationOpcodeCopy && ops->ops[0].oldOffset == 0 &&
+           ops->ops[0].newOffset == 0 && ops->ops[0].size == memorySize;
+}
+
+static int buildRecordTable(SwtisMigration* self, SwtisMigrationTable* table, const SwtiRecordType* oldRecord,
+                            const SwtiRecordType* newRecord, size_t depth)
+{
+    OpsBuilder builder;
+    tc_mem_clear_type(&builder);
+    int error;
+
+    for (size_t i = 0; i < newRecord->fieldCount; ++i) {
+        const SwtiRecordTypeField* newField = &newRecord->fields[i];
+        const SwtiRecordTypeField* oldField = 0;
+        for (size_t j = 0; j < oldRecord->fieldCount; ++j) {
+            if (strcmp(oldRecord->fields[j].name, newField->name) == 0) {
+                oldField = &oldRecord->fields[j];
+                break;
+            }
+        }
+        if (oldField == 0) {
+            builder.hasDefaults = 1;
+            continue;
+        }
+        if ((error = addFieldOps(self, &builder, oldField->fieldType, &oldField->memoryOffsetInfo.memoryInfo,
+                                 oldField->memoryOffsetInfo.memoryOffset, newField->fieldType,
+                                 &newField->memoryOffsetInfo.memoryInfo, newField->memoryOffsetInfo.memoryOffset,
+                                 depth)) != 0) {
+            tc_free(builder.ops);
+            return error;
+        }
+    }
+
+    int hasDefaults = builder.hasDefaults;
+    table->fields = finishOps(self, &builder);
+    table->isIdentical = !hasDefaults && table->oldMemorySize == table->newMemorySize &&
+                         oldRecord->fieldCount == newRecord->fieldCount &&
+                         isIdentity(&table->fields, table->newMemorySize);
+
+    return 0;
+}
+
+static int buildTupleTable(SwtisMigration* self, SwtisMigrationTable* table, const SwtiTupleType* oldTuple,
+                           const SwtiTupleType* newTuple, size_t depth)
+{
+    OpsBuilder builder;
+    tc_mem_clear_type(&builder);
+    int error;
+
+    for (size_t i = 0; i < newTuple->fieldCount; ++i) {
+        if (i >= oldTuple->fieldCount) {
+            builder.hasDefaults = 1;
+            break;
+        }
+        const SwtiTupleTypeField* oldField = &oldTuple->fields[i];
+        const SwtiTupleTypeField* newField = &newTuple->fields[i];
+        if ((error = addFieldOps(self, &builder, oldField->fieldType, &oldField->memoryOffsetInfo.memoryInfo,
+                                 oldField->memoryOffsetInfo.memoryOffset, newField->fieldType,
+                                 &newField->memoryOffsetInfo.memoryInfo, newField->memoryOffsetInfo.memoryOffset,
+                                 depth)) != 0) {
+            tc_free(builder.ops);
+            return error;
+        }
+    }
+
+    int hasDefaults = builder.hasDefaults;
+    table->fields = finishOps(self, &builder);
+    table->isIdentical = !hasDefaults && table->oldMemorySize == table->newMemorySize &&
+                         oldTuple->fieldCount == newTuple->fieldCount &&
+                         isIdentity(&table->fields, table->newMemorySize);
+
+    return 0;
+}
+
+/// The name of the new variant that `oldVariant` migrates to, the same name unless it is renamed.
+static const char* newVariantName(const SwtisMigration* self, const SwtiCustomType* oldCustom,
+                                  const SwtiCustomTypeVariant* oldVariant)
+{
+    for (size_t i = 0; i < self->variantRenameCount; ++i) {
+        const SwtisMigrationVariantRename* rename = &self->variantRenames[i];
+        if (oldCustom->internal.name != 0 && strcmp(rename->customTypeName, oldCustom->internal.name) == 0 &&
+            strcmp(rename->oldVariantName, oldVariant->name) == 0) {
+            return rename->newVariantName;
+        }
+    }
+
+    return oldVariant->name;
+}
+
+static int buildCustomTable(SwtisMigration* self, SwtisMigrationTable* table, const SwtiCustomType* oldCustom,
+                            const SwtiCustomType* newCustom, size_t depth)
+{
+    if (newCustom->variantCount == 0) {
+        CLOG_SOFT_ERROR("migrate: custom type %s has no variants", newCustom->internal.name)
+        return -3;
+    }
+
+    SwtisMigrationVariant* variants = IMPRINT_ALLOC_TYPE_COUNT(self->allocator, SwtisMigrationVariant,
+                                                               oldCustom->variantCount);
+    int identical = oldCustom->variantCount == newCustom->variantCount &&
+                    table->oldMemorySize == table->newMemorySize;
+    int error;
+
+    for (size_t i = 0; i < oldCustom->variantCount; ++i) {
+        const SwtiCustomTypeVariant* oldVariant = oldCustom->variantTypes[i];
+        const char* newName = newVariantName(self, oldCustom, oldVariant);
+        const SwtiCustomTypeVariant* newVariant = 0;
+        size_t newIndex = 0;
+        for (size_t j = 0; j < newCustom->variantCount; ++j) {
+            if (strcmp(newCustom->variantTypes[j]->name, newName) == 0) {
+                newVariant = newCustom->variantTypes[j];
+                newIndex = j;
+                break;
+            }
+        }
+
+        if (newVariant == 0) {
+            CLOG_SOFT_ERROR("migrate: variant %s.%s has no variant '%s' in the new chunk", oldCustom->internal.name,
+                            oldVariant->name, newName)
+            return -8;
+        }
+
+        OpsBuilder builder;
+        tc_mem_clear_type(&builder);
+
+        for (size_t fieldIndex = 0; fieldIndex < newVariant->paramCount; ++fieldIndex) {
+            if (fieldIndex >= oldVariant->paramCount) {
+                builder.hasDefaults = 1;
+                break;
+            }
+            const SwtiCustomTypeVariantField* oldField = &oldVariant->fields[fieldIndex];
+            const SwtiCustomTypeVariantField* newField = &newVariant->fields[fieldIndex];
+            if ((error = addFieldOps(self, &builder, oldField->fieldType, &oldField->memoryOffsetInfo.memoryInfo,
+                                     oldField->memoryOffsetInfo.memoryOffset, newField->fieldType,
+                                     &newField->memoryOffsetInfo.memoryInfo, newField->memoryOffsetInfo.memoryOffset,
+                                     depth)) != 0) {
+                tc_free(builder.ops);
+                return error;
+            }
+        }
+
+        int hasDefaults = builder.hasDefaults;
+        variants[i].newVariantIndex = (uint8_t) newIndex;
+        variants[i].fields = finishOps(self, &builder);
+
+        if (hasDefaults || newIndex != i || oldVariant->paramCount != newVariant->paramCount) {
+            identical = 0;
+            continue;
+        }
+        for (size_t opIndex = 0; opIndex < variants[i].fields.opCount; ++opIndex) {
+            const SwtisMigrationOp* op = &variants[i].fields.ops[opIndex];
+            if (op->opcode != SwtisMigrationOpcodeCopy || op->oldOffset != op->newOffset) {
+                identical = 0;
+            }
+        }
+    }
+
+    table->variants = variants;
+    table->variantCount = oldCustom->variantCount;
+    table->isIdentical = identical;
+
+    return 0;
+}
+
+static int buildTable(SwtisMigration* self, const SwtiType* oldType, const SwtiMemoryInfo* oldSlot,
+                      const SwtiType* newType, const SwtiMemoryInfo* newSlot, size_t depth,
+                      SwtisMigrationTable** outTable)
+{
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        CLOG_SOFT_ERROR("migrate: type is too deep")
+        return -2;
+    }
+
+    if (oldType->index >= self->oldChunk->typeCount || self->oldChunk->types[oldType->index] != oldType) {
+        CLOG_SOFT_ERROR("migrate: type %d is not part of the old chunk", oldType->index)
+        return -5;
+    }
+
+    for (SwtisMigrationTable* existing = self->tablesByOldIndex[oldType->index]; existing != 0;
+         existing = existing->next) {
+        if (existing->newType == newType) {
+            *outTable = existing;
+            return 0;
+        }
+    }
+
+    size_t oldMemorySize;
+    size_t newMemorySize;
+    int error;
+
+    if ((error = swtisValueMemorySize(oldType, oldSlot, &oldMemorySize)) != 0) {
+        return error;
+    }
+    if ((error = swtisValueMemorySize(newType, newSlot, &newMemorySize)) != 0) {
+        return error;
+    }
+
+    SwtisMigrationTable* table = IMPRINT_ALLOC_TYPE(self->allocator, SwtisMigrationTable);
+    tc_mem_clear_type(table);
+    table->oldType = oldType;
+    table->newType = newType;
+    table->oldMemorySize = oldMemorySize;
+    table->newMemorySize = newMemorySize;
+
+    // Registered before the fields are built, so a list that contains the type itself finds it
+    table->next = self->tablesByOldIndex[oldType->index];
+    self->tablesByOldIndex[oldType->index] = table;
+    table->builtBefore = self->lastBuilt;
+    self->lastBuilt = table;
+
+    if (oldType->type == SwtiTypeRecord && newType->type == SwtiTypeRecord) {
+        error = buildRecordTable(self, table, (const SwtiRecordType*) oldType, (const SwtiRecordType*) newType, depth);
+    } else if (oldType->type == SwtiTypeTuple && newType->type == SwtiTypeTuple) {
+        error = buildTupleTable(self, table, (const SwtiTupleType*) oldType, (const SwtiTupleType*) newType, depth);
+    } else if (oldType->type == SwtiTypeCustom && newType->type == SwtiTypeCustom) {
+        error = buildCustomTable(self, table, (const SwtiCustomType*) oldType, (const SwtiCustomType*) newType, depth);
+    } else {
+        OpsBuilder builder;
+        tc_mem_clear_type(&builder);
+        error = addFieldOps(self, &builder, oldType, oldSlot, 0, newType, newSlot, 0, depth);
+        int hasDefaults = builder.hasDefaults;
+        table->fields = finishOps(self, &builder);
+        table->isIdentical = !hasDefaults && table->oldMemorySize == table->newMemorySize &&
+                             isIdentity(&table->fields, table->newMemorySize);
+    }
+
+    if (error != 0) {
+        return error;
+    }
+
+    *outTable = table;
+
+    return 0;
+}
+
+static int compareNamedTypes(const void* a, const void* b)
+{
+    return strcmp(((const SwtisMigrationNamedType*) a)->name, ((const SwtisMigrationNamedType*) b)->name);
+}
+
+int swtisMigrationInit(SwtisMigration* self, const SwtiChunk* oldChunk, const SwtiChunk* newChunk,
+                       ImprintAllocator* allocator)
+{
+    self->oldChunk = oldChunk;
+    self->newChunk = newChunk;
+    self->allocator = allocator;
+    self->tablesByOldIndex = IMPRINT_ALLOC_TYPE_COUNT(allocator, SwtisMigrationTable*, oldChunk->typeCount + 1);
+    tc_mem_clear_type_n(self->tablesByOldIndex, oldChunk->typeCount + 1);
+    self->variantRenames = 0;
+    self->variantRenameCount = 0;
+    self->lastBuilt = 0;
+
+    self->newNamedTypes = IMPRINT_ALLOC_TYPE_COUNT(allocator, SwtisMigrationNamedType, newChunk->typeCount + 1);
+    self->newNamedTypeCount = 0;
+    for (size_t i = 0; i < newChunk->typeCount; ++i) {
+        const SwtiType* type = newChunk->types[i];
+        if ((type->type != SwtiTypeCustom && type->type != SwtiTypeAlias) || type->name == 0) {
+            continue;
+        }
+        SwtisMigrationNamedType* named = &self->newNamedTypes[self->newNamedTypeCount++];
+        named->name = type->name;
+        named->type = type;
+    }
+
+    qsort(self->newNamedTypes, self->newNamedTypeCount, sizeof(SwtisMigrationNamedType), compareNamedTypes);
+
+    return 0;
+}
+
+/// `renames` must outlive the migration. Only affects the tables prepared after this call.
+void swtisMigrationSetVariantRenames(SwtisMigration* self, const SwtisMigrationVariantRename* renames, size_t count)
+{
+    self->variantRenames = renames;
+    self->variantRenameCount = count;
+}
+
+const SwtiType* swtisMigrationFindNewType(const SwtisMigration* self, const char* name)
+{
+    SwtisMigrationNamedType key;
+    key.name = name;
+    key.type = 0;
+
+    const SwtisMigrationNamedType* found = bsearch(&key, self->newNamedTypes, self->newNamedTypeCount,
+                                                   sizeof(SwtisMigrationNamedType), compareNamedTypes);
+
+    return found != 0 ? found->type : 0;
+}
+
+/// Builds (or finds) the migration table from `oldType` in the old chunk to `newType` in the new chunk.
+int swtisMigrationPrepare(SwtisMigration* self, const SwtiType* oldType, const SwtiType* newType,
+                          const SwtisMigrationTable** outTable)
+{
+    SwtisMigrationTable* table;
+    SwtisMigrationTable* lastBuilt = self->lastBuilt;
+    int error;
+
+    if ((error = buildTable(self, swtisValueUnalias(oldType), 0, swtisValueUnalias(newType), 0, 0, &table)) != 0) {
+        // The tables built along the way can refer to the one that failed, so none of them are kept. Tables are
+        // always added first in their list, so removing them newest first finds each one at the head.
+        while (self->lastBuilt != lastBuilt) {
+            SwtisMigrationTable* built = self->lastBuilt;
+            self->tablesByOldIndex[built->oldType->index] = built->next;
+            self->lastBuilt = built->builtBefore;
+        }
+        return error;
+    }
+
+    *outTable = table;
+
+    return 0;
+}
+
+/// Same as swtisMigrationPrepare(), but finds the new type by the name of the old custom type or alias.
+int swtisMigrationPrepareByName(SwtisMigration* self, const SwtiType* oldType, const SwtisMigrationTable** outTable)
+{
+    const SwtiType* newType = swtisMigrationFindNewType(self, oldType->name);
+    if (newType == 0) {
+        CLOG_SOFT_ERROR("migrate: could not find '%s' in the new chunk", oldType->name)
+        return -4;
+    }
+
+    return swtisMigrationPrepare(self, oldType, newType, outTable);
+}
+
+static int migrateValue(const SwtisMigrationTable* table, const uint8_t* oldValue, uint8_t* newValue,
+                        ImprintAllocator* allocator, size_t depth);
+
+static int migrateList(const SwtisMigrationTable* table, const uint8_t* oldSlot, uint8_t* newSlot,
+                       ImprintAllocator* allocator, size_t depth)
+{
+    const SwtisValueList* oldList;
+    tc_memcpy_octets((void*) &oldList, oldSlot, sizeof(oldList));
+    if (oldList == 0) {
+        return 0;
+    }
+
+    SwtisValueList* newList = IMPRINT_ALLOC_TYPE(allocator, SwtisValueList);
+    uint8_t* items = 0;
+    if (oldList->count != 0) {
+        items = IMPRINT_ALLOC(allocator, oldList->count * table->newMemorySize, "migrated list items");
+    }
+
+    newList->value = items;
+    newList->count = oldList->count;
+    newList->itemSize = table->newMemorySize;
+    newList->itemAlign = oldList->itemAlign;
+
+    const uint8_t* oldItem = (const uint8_t*) oldList->value;
+    int error;
+    for (size_t i = 0; i < oldList->count; ++i) {
+        if ((error = migrateValue(table, oldItem, items + i * table->newMemorySize, allocator, depth + 1)) != 0) {
+            return error;
+        }
+        oldItem += oldList->itemSize;
+    }
+
+    const SwtisValueList* constList = newList;
+    tc_memcpy_octets(newSlot, (const void*) &constList, sizeof(constList));
+
+    return 0;
+}
+
+static int64_t readSigned(const uint8_t* source, size_t size)
+{
+    switch (size) {
+        case 1:
+            return (int8_t) source[0];
+        case 2: {
+            int16_t value;
+            tc_memcpy_octets(&value, source, sizeof(value));
+            return value;
+        }
+        case 4: {
+            int32_t value;
+            tc_memcpy_octets(&value, source, sizeof(value));
+            return value;
+        }
+        default: {
+            int64_t value;
+            tc_memcpy_octets(&value, source, sizeof(value));
+            return value;
+        }
+    }
+}
+
+static void writeSigned(uint8_t* target, size_t size, int64_t value)
+{
+    switch (size) {
+        case 1:
+            target[0] = (uint8_t) (int8_t) value;
+            break;
+        case 2: {
+            int16_t narrow = (int16_t) value;
+            tc_memcpy_octets(target, &narrow, sizeof(narrow));
+            break;
+        }
+        case 4: {
+            int32_t narrow = (int32_t) value;
+            tc_memcpy_octets(target, &narrow, sizeof(narrow));
+            break;
+        }
+        default:
+            tc_memcpy_octets(target, &value, sizeof(value));
+            break;
+    }
+}
+
+/// Ints and Fixed are the same size (see addFieldOps()), so only Int to Fixed can go out of range.
+static int intToFixed(const SwtisMigrationOp* op, const uint8_t* oldValue, uint8_t* newValue)
+{
+    int64_t value = readSigned(oldValue + op->oldOffset, op->size);
+    int64_t max = op->size >= 8 ? INT64_MAX : (int64_t) ((UINT64_C(1) << (op->size * 8 - 1)) - 1);
+    int64_t min = -max - 1;
+
+    if (value > max / SWTIS_MIGRATE_FIXED_FACTOR || value < min / SWTIS_MIGRATE_FIXED_FACTOR) {
+        CLOG_SOFT_ERROR("migrate: int %lld does not fit in a fixed of %u octets", (long long) value, op->size)
+        return -7;
+    }
+
+    writeSigned(newValue + op->newOffset, op->size, value * SWTIS_MIGRATE_FIXED_FACTOR);
+
+    return 0;
+}
+
+static int runOps(const SwtisMigrationOps* ops, const uint8_t* oldValue, uint8_t* newValue,
+                  ImprintAllocator* allocator, size_t depth)
+{
+    int error;
+
+    for (size_t i = 0; i < ops->opCount; ++i) {
+        const SwtisMigrationOp* op = &ops->ops[i];
+        switch (op->opcode) {
+            case SwtisMigrationOpcodeCopy:
+                tc_memcpy_octets(newValue + op->newOffset, oldValue + op->oldOffset, op->size);
+                break;
+            case SwtisMigrationOpcodeIntToFixed:
+                if ((error = intToFixed(op, oldValue, newValue)) != 0) {
+                    return error;
+                }
+                break;
+            case SwtisMigrationOpcodeFixedToInt:
+                writeSigned(newValue + op->newOffset, op->size,
+                            readSigned(oldValue + op->oldOffset, op->size) / SWTIS_MIGRATE_FIXED_FACTOR);
+                break;
+            case SwtisMigrationOpcodeValue:
+                if ((error = migrateValue(op->table, oldValue + op->oldOffset, newValue + op->newOffset, allocator,
+                                          depth + 1)) != 0) {
+                    return error;
+                }
+                break;
+            case SwtisMigrationOpcodeList:
+                if ((error = migrateList(op->table, oldValue + op->oldOffset, newValue + op->newOffset, allocator,
+                                         depth + 1)) != 0) {
+                    return error;
+                }
+                break;
+        }
+    }
+
+    return 0;
+}
+
+static int migrateValue(const SwtisMigrationTable* table, const uint8_t* oldValue, uint8_t* newValue,
+                        ImprintAllocator* allocator, size_t depth)
+{
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        CLOG_SOFT_ERROR("migrate: value is too deep")
+        return -2;
+    }
+
+    if (table->isIdentical) {
+        tc_memcpy_octets(newValue, oldValue, table->newMemorySize);
+        return 0;
+    }
+
+    tc_mem_clear(newValue, table->newMemorySize);
+
+    if (table->variants == 0) {
+        return runOps(&table->fields, oldValue, newValue, allocator, depth);
+    }
+
+    uint8_t oldVariantIndex = oldValue[0];
+    if (oldVariantIndex >= table->variantCount) {
+        CLOG_SOFT_ERROR("migrate: illegal variant %d", oldVariantIndex)
+        return -6;
+    }
+
+    const SwtisMigrationVariant* variant = &table->variants[oldVariantIndex];
+    newValue[0] = variant->newVariantIndex;
+
+    return runOps(&variant->fields, oldValue, newValue, allocator, depth);
+}
+
+/// Migrates `count` values stored back to back. Lists that need migration are allocated from `allocator`,
+/// everything else that is immutable (strings, blobs, unchanged lists) is shared with the old values.
+int swtisMigrateValues(const SwtisMigrationTable* table, const void* oldValues, size_t count, void* newValues,
+                       ImprintAllocator* allocator)
+{
+    const uint8_t* oldValue = (const uint8_t*) oldValues;
+    uint8_t* newValue = (uint8_t*) newValues;
+
+    if (table->isIdentical) {
+        tc_memcpy_octets(newValue, oldValue, count * table->newMemorySize);
+        return 0;
+    }
+
+    int error;
+    for (size_t i = 0; i < count; ++i) {
+        if ((error = migrateValue(table, oldValue, newValue, allocator, 0)) != 0) {
+            return error;
+        }
+        oldValue += table->oldMemorySize;
+        newValue += table->newMemorySize;
+    }
+
+    return 0;
+}
@@ -0,0 +1,204 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <swamp-typeinfo-serialize/format.h>
+#include <swamp-typeinfo-serialize/names.h>
+#include <swamp-typeinfo-serialize/sections_internal.h>
+#include <swamp-typeinfo/chunk.h>
+#include <swamp-typeinfo/typeinfo.h>
+#include <sys/mman.h>
+#include <tiny-libc/tiny_libc.h>
+#include <unistd.h>
+
+static void clear(SwtisNames* self, const SwtiChunk* chunk)
+{
+    self->chunk = chunk;
+    self->octets = 0;
+    self->octetCount = 0;
+    self->firstNameIndices = 0;
+    self->nameOffsets = 0;
+    self->fd = -1;
+    self->fileOffset = 0;
+    self->mapping = 0;
+    self->mappingSize = 0;
+}
+
+int swtisNamesInit(SwtisNames* self, const SwtiChunk* chunk, const uint8_t* octets, size_t octetCount)
+{
+    clear(self, chunk);
+
+    SwtisSectionDirectory directory;
+    int error;
+    if ((error = swtisSectionDirectoryRead(&directory, octets, octetCount)) != 0) {
+        return error == -1 ? -6 : error;
+    }
+
+    const SwtisSection* names = swtisSectionDirectoryFind(&directory, SWTIS_SECTION_NAMES);
+    if (names == 0) {
+        return -1;
+    }
+
+    if ((size_t) names->offset + names->octetCount > octetCount) {
+        CLOG_SOFT_ERROR("names: section ends after the typeinfo")
+        return -6;
+    }
+
+    self->octets = octets + names->offset;
+    self->octetCount = names->octetCount;
+
+    return 0;
+}
+
+int swtisNamesInitFromFile(SwtisNames* self, const SwtiChunk* chunk, const char* path)
+{
+    clear(self, chunk);
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        CLOG_SOFT_ERROR("names: could not open '%s' (%d)", path, errno)
+        return -1;
+    }
+
+    uint8_t header[SWTIS_SECTIONS_HEADER_OCTET_COUNT + 1 + SWTIS_SECTIONS_MAX_COUNT * SWTIS_SECTIONS_ENTRY_OCTET_COUNT];
+    ssize_t octetsRead = pread(fd, header, sizeof(header), 0);
+
+    SwtisSectionDirectory directory;
+    int error;
+    if (octetsRead <= 0 || (error = swtisSectionDirectoryRead(&directory, header, (size_t) octetsRead)) != 0) {
+        CLOG_SOFT_ERROR("names: could not read the section directory of '%s'", path)
+        close(fd);
+        return -6;
+    }
+
+    const SwtisSection* names = swtisSectionDirectoryFind(&directory, SWTIS_SECTION_NAMES);
+    if (names == 0) {
+        close(fd);
+        return -1;
+    }
+
+    self->fd = fd;
+    self->fileOffset = names->offset;
+    self->octetCount = names->octetCount;
+
+    return 0;
+}
+
+void swtisNamesDestroy(SwtisNames* self)
+{
+    if (self->mapping != 0) {
+        munmap(self->mapping, self->mappingSize);
+    }
+    if (self->fd >= 0) {
+        close(self->fd);
+    }
+    tc_free(self->firstNameIndices);
+    tc_free(self->nameOffsets);
+    clear(self, 0);
+}
+
+static int mapIn(SwtisNames* self)
+{
+    if (self->octets != 0) {
+        return 0;
+    }
+
+    if (self->fd < 0) {
+        return -1;
+    }
+
+    // mmap needs a page aligned file offset
+    size_t pageSize = (size_t) sysconf(_SC_PAGESIZE);
+    size_t alignedOffset = self->fileOffset - self->fileOffset % pageSize;
+    size_t mappingSize = self->fileOffset - alignedOffset + self->octetCount;
+
+    void* mapping = mmap(0, mappingSize, PROT_READ, MAP_PRIVATE, self->fd, (off_t) alignedOffset);
+    if (mapping == MAP_FAILED) {
+        CLOG_SOFT_ERROR("names: could not map the names section (%d)", errno)
+        return -1;
+    }
+
+    self->mapping = mapping;
+    self->mappingSize = mappingSize;
+    self->octets = (const uint8_t*) mapping + (self->fileOffset - alignedOffset);
+
+    return 0;
+}
+
+static int prepare(SwtisNames* self)
+{
+    if (self->firstNameIndices != 0) {
+        return 0;
+    }
+
+    if (mapIn(self) != 0) {
+        return -1;
+    }
+
+    size_t typeCount = self->chunk->typeCount;
+    uint16_t* firstNameIndices = tc_malloc_type_count(uint16_t, typeCount + 1);
+    size_t nameCount = 0;
+    for (size_t i = 0; i < typeCount; ++i) {
+        firstNameIndices[i] = (uint16_t) nameCount;
+        nameCount += swtisSectionNameCount(self->chunk->types[i]);
+    }
+    firstNameIndices[typeCount] = (uint16_t) nameCount;
+
+    uint32_t* nameOffsets = tc_malloc_type_count(uint32_t, nameCount + 1);
+    int foundCount = swtisSectionNamesFind(self->octets, self->octetCount, nameOffsets, nameCount);
+    if (foundCount < 0 || (size_t) foundCount != nameCount) {
+        CLOG_SOFT_ERROR("names: names section does not match the chunk")
+        tc_free(nameOffsets);
+        tc_free(firstNameIndices);
+        return -6;
+    }
+
+    self->firstNameIndices = firstNameIndices;
+    self->nameOffsets = nameOffsets;
+
+    return 0;
+}
+
+static const char* nameOf(SwtisNames* self, size_t typeIndex, size_t index)
+{
+    if (prepare(self) != 0) {
+        return 0;
+    }
+
+    size_t nameIndex = self->firstNameIndices[typeIndex] + index;
+    if (nameIndex >= self->firstNameIndices[typeIndex + 1]) {
+        return 0;
+    }
+
+    return (const char*) self->octets + self->nameOffsets[nameIndex];
+}
+
+const char* swtisNamesType(SwtisNames* self, size_t typeIndex)
+{
+    if (typeIndex >= self->chunk->typeCount || self->chunk->types[typeIndex]->type == SwtiTypeRecord) {
+        return 0;
+    }
+
+    return nameOf(self, typeIndex, 0);
+}
+
+const char* swtisNamesRecordField(SwtisNames* self, size_t typeIndex, size_t fieldIndex)
+{
+    if (typeIndex >= self->chunk->typeCount || self->chunk->types[typeIndex]->type != SwtiTypeRecord) {
+        return 0;
+    }
+
+    return nameOf(self, typeIndex, fieldIndex);
+}
+
+int swtisNamesApply(SwtisNames* self, SwtiChunk* chunk)
+{
+    if (mapIn(self) != 0) {
+        return -1;
+    }
+
+    return swtisSectionNamesApply(chunk, self->octets, self->octetCount, 0);
+}
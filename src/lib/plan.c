@@ -0,0 +1,692 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <flood/in_stream.h>
+#include <flood/out_stream.h>
+#include <imprint/allocator.h>
+#include <swamp-typeinfo-serialize/plan.h>
+#include <swamp-typeinfo-serialize/value.h>
+#include <swamp-typeinfo-serialize/value_internal.h>
+#include <swamp-typeinfo/chunk.h>
+#include <swamp-typeinfo/typeinfo.h>
+#include <tiny-libc/tiny_libc.h>
+
+typedef struct PlanBuilder {
+    SwtisPlanCache* cache;
+    SwtisPlanOp* ops;
+    size_t opCount;
+    size_t opCapacity;
+    uint32_t* jumps;
+    size_t jumpCount;
+    size_t jumpCapacity;
+    size_t mergeBarrier;
+    size_t depth;
+    struct PlanJournal* journal;
+} PlanBuilder;
+
+/// The type indices of the plans inserted since the top level compile started. A failed compile removes all of them,
+/// since the plans compiled further down can refer to the plan that failed.
+typedef struct PlanJournal {
+    uint16_t* indices;
+    size_t count;
+    size_t capacity;
+} PlanJournal;
+
+static int compilePlan(SwtisPlanCache* cache, const SwtiType* type, const SwtiMemoryInfo* slot, PlanJournal* journal,
+                       const SwtisPlan** outPlan);
+
+static void* grow(void* items, size_t count, size_t* capacity, size_t itemSize)
+{
+    if (count < *capacity) {
+        return items;
+    }
+
+    size_t newCapacity = *capacity == 0 ? 16 : *capacity * 2;
+    void* newItems = tc_malloc(newCapacity * itemSize);
+    if (count > 0) {
+        tc_memcpy_octets(newItems, items, count * itemSize);
+    }
+    tc_free(items);
+    *capacity = newCapacity;
+
+    return newItems;
+}
+
+static SwtisPlanOp* emit(PlanBuilder* builder, SwtisPlanOpcode opcode, size_t offset, size_t size)
+{
+    builder->ops = grow(builder->ops, builder->opCount, &builder->opCapacity, sizeof(SwtisPlanOp));
+    SwtisPlanOp* op = &builder->ops[builder->opCount++];
+    op->opcode = opcode;
+    op->offset = (uint32_t) offset;
+    op->size = (uint32_t) size;
+    op->target = 0;
+    op->itemPlan = 0;
+
+    return op;
+}
+
+static void emitScalar(PlanBuilder* builder, size_t offset, size_t size)
+{
+#if SWTIS_VALUE_HOST_IS_LITTLE_ENDIAN
+    if (builder->opCount > builder->mergeBarrier) {
+        SwtisPlanOp* last = &builder->ops[builder->opCount - 1];
+        if (last->opcode == SwtisPlanOpcodeCopy && last->offset + last->size == offset) {
+            last->size += (uint32_t) size;
+            return;
+        }
+    }
+    emit(builder, SwtisPlanOpcodeCopy, offset, size);
+#else
+    emit(builder, size == 1 ? SwtisPlanOpcodeCopy : SwtisPlanOpcodeScalar, offset, size);
+#endif
+}
+
+static int emitType(PlanBuilder* builder, const SwtiType* type, const SwtiMemoryInfo* slot, size_t offset);
+
+static int emitCustom(PlanBuilder* builder, const SwtiCustomType* custom, size_t offset)
+{
+    int error;
+
+    SwtisPlanOp* variantOp = emit(builder, SwtisPlanOpcodeVariant, offset, custom->variantCount);
+    size_t jumpStart = builder->jumpCount;
+    variantOp->target = (uint32_t) jumpStart;
+
+    for (size_t i = 0; i < custom->variantCount; ++i) {
+        builder->jumps = grow(builder->jumps, builder->jumpCount, &builder->jumpCapacity, sizeof(uint32_t));
+        builder->jumps[builder->jumpCount++] = 0;
+    }
+
+    size_t* exitJumps = tc_malloc_type_count(size_t, custom->variantCount + 1);
+
+    for (size_t i = 0; i < custom->variantCount; ++i) {
+        builder->jumps[jumpStart + i] = (uint32_t) builder->opCount;
+        builder->mergeBarrier = builder->opCount;
+        const SwtiCustomTypeVariant* variant = custom->variantTypes[i];
+        for (size_t fieldIndex = 0; fieldIndex < variant->paramCount; ++fieldIndex) {
+            const SwtiCustomTypeVariantField* field = &variant->fields[fieldIndex];
+            if ((error = emitType(builder, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                  offset + field->memoryOffsetInfo.memoryOffset)) != 0) {
+                tc_free(exitJumps);
+                return error;
+            }
+        }
+        exitJumps[i] = builder->opCount;
+        emit(builder, SwtisPlanOpcodeJump, 0, 0);
+    }
+
+    for (size_t i = 0; i < custom->variantCount; ++i) {
+        builder->ops[exitJumps[i]].target = (uint32_t) builder->opCount;
+    }
+    tc_free(exitJumps);
+
+    builder->mergeBarrier = builder->opCount;
+
+    return 0;
+}
+
+static int emitType(PlanBuilder* builder, const SwtiType* type, const SwtiMemoryInfo* slot, size_t offset)
+{
+    if (++builder->depth > SWTIS_VALUE_MAX_DEPTH) {
+        CLOG_SOFT_ERROR("plan: type is too deep")
+        return -2;
+    }
+
+    type = swtisValueUnalias(type);
+    int error = 0;
+
+    switch (type->type) {
+        case SwtiTypeInt:
+        case SwtiTypeFixed:
+        case SwtiTypeBoolean:
+        case SwtiTypeChar:
+        case SwtiTypeResourceName: {
+            size_t size;
+            if ((error = swtisValueScalarSize(type, slot, &size)) == 0) {
+                emitScalar(builder, offset, size);
+            }
+            break;
+        }
+        case SwtiTypeString:
+        case SwtiTypeBlob:
+            if (swtisValueCheckReferenceSlot(slot) != 0) {
+                CLOG_SOFT_ERROR("plan: type %d is held in %d octets, the host needs %zu for a reference", type->index,
+                                slot->memorySize, sizeof(void*))
+                error = -4;
+                break;
+            }
+            emit(builder, type->type == SwtiTypeString ? SwtisPlanOpcodeString : SwtisPlanOpcodeBlob, offset, 0);
+            break;
+        case SwtiTypeList:
+        case SwtiTypeArray: {
+            const SwtiType* itemType;
+            SwtiMemoryInfo itemInfo;
+            if (type->type == SwtiTypeList) {
+                itemType = ((const SwtiListType*) type)->itemType;
+                itemInfo = ((const SwtiListType*) type)->memoryInfo;
+            } else {
+                itemType = ((const SwtiArrayType*) type)->itemType;
+                itemInfo = ((const SwtiArrayType*) type)->memoryInfo;
+            }
+            if (swtisValueCheckReferenceSlot(slot) != 0) {
+                CLOG_SOFT_ERROR("plan: type %d is held in %d octets, the host needs %zu for a reference", type->index,
+                                slot->memorySize, sizeof(void*))
+                error = -4;
+                break;
+            }
+            const SwtisPlan* itemPlan;
+            if ((error = compilePlan(builder->cache, itemType, &itemInfo, builder->journal, &itemPlan)) != 0) {
+                break;
+            }
+            if (itemPlan->memorySize != itemInfo.memorySize) {
+                // The plan of a scalar is shared by every list of it, so all of them must agree on the size
+                CLOG_SOFT_ERROR("plan: list %d has items of %d octets, but type %d is %zu octets", type->index,
+                                itemInfo.memorySize, itemType->index, itemPlan->memorySize)
+                error = -6;
+                break;
+            }
+            SwtisPlanOp* op = emit(builder, SwtisPlanOpcodeList, offset, itemInfo.memorySize);
+            op->target = itemInfo.memoryAlign;
+            op->itemPlan = itemPlan;
+            break;
+        }
+        case SwtiTypeRecord: {
+            const SwtiRecordType* record = (const SwtiRecordType*) type;
+            for (size_t i = 0; i < record->fieldCount && error == 0; ++i) {
+                const SwtiRecordTypeField* field = &record->fields[i];
+                error = emitType(builder, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                 offset + field->memoryOffsetInfo.memoryOffset);
+            }
+            break;
+        }
+        case SwtiTypeTuple: {
+            const SwtiTupleType* tuple = (const SwtiTupleType*) type;
+            for (size_t i = 0; i < tuple->fieldCount && error == 0; ++i) {
+                const SwtiTupleTypeField* field = &tuple->fields[i];
+                error = emitType(builder, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                 offset + field->memoryOffsetInfo.memoryOffset);
+            }
+            break;
+        }
+        case SwtiTypeCustom:
+            error = emitCustom(builder, (const SwtiCustomType*) type, offset);
+            break;
+        default:
+            CLOG_SOFT_ERROR("plan: can not serialize values of type %d", type->type)
+            error = -1;
+            break;
+    }
+
+    builder->depth--;
+
+    return error;
+}
+
+static void journalAdd(PlanJournal* journal, uint16_t index)
+{
+    journal->indices = grow(journal->indices, journal->count, &journal->capacity, sizeof(uint16_t));
+    journal->indices[journal->count++] = index;
+}
+
+static int compilePlan(SwtisPlanCache* cache, const SwtiType* type, const SwtiMemoryInfo* slot, PlanJournal* journal,
+                       const SwtisPlan** outPlan)
+{
+    if (type->index >= cache->chunk->typeCount || cache->chunk->types[type->index] != type) {
+        CLOG_SOFT_ERROR("plan: type %d is not part of the chunk", type->index)
+        return -5;
+    }
+
+    if (cache->plans[type->index] != 0) {
+        // Either done or being compiled further up (a list containing itself), both can be referenced
+        *outPlan = cache->plans[type->index];
+        return 0;
+    }
+
+    size_t memorySize;
+    int error;
+    if ((error = swtisValueMemorySize(type, slot, &memorySize)) != 0) {
+        return error;
+    }
+
+    SwtisPlan* plan = IMPRINT_ALLOC_TYPE(cache->allocator, SwtisPlan);
+    tc_mem_clear_type(plan);
+    plan->type = type;
+    plan->memorySize = memorySize;
+    plan->minimumWireSize = swtisValueMinimumWireSize(type, slot);
+    cache->plans[type->index] = plan;
+    journalAdd(journal, type->index);
+
+    PlanBuilder builder;
+    tc_mem_clear_type(&builder);
+    builder.cache = cache;
+    builder.journal = journal;
+
+    error = emitType(&builder, type, slot, 0);
+    emit(&builder, SwtisPlanOpcodeEnd, 0, 0);
+
+    if (error != 0) {
+        tc_free(builder.ops);
+        tc_free(builder.jumps);
+        return error;
+    }
+
+    SwtisPlanOp* ops = IMPRINT_ALLOC_TYPE_COUNT(cache->allocator, SwtisPlanOp, builder.opCount);
+    tc_memcpy_octets(ops, builder.ops, builder.opCount * sizeof(SwtisPlanOp));
+    uint32_t* jumps = 0;
+    if (builder.jumpCount > 0) {
+        jumps = IMPRINT_ALLOC_TYPE_COUNT(cache->allocator, uint32_t, builder.jumpCount);
+        tc_memcpy_octets(jumps, builder.jumps, builder.jumpCount * sizeof(uint32_t));
+    }
+    tc_free(builder.ops);
+    tc_free(builder.jumps);
+
+    plan->ops = ops;
+    plan->opCount = builder.opCount;
+    plan->jumpTable = jumps;
+    plan->jumpTableCount = builder.jumpCount;
+
+    plan->isFlat = 1;
+    plan->flatWireSize = 0;
+    for (size_t i = 0; i + 1 < plan->opCount; ++i) {
+        if (ops[i].opcode != SwtisPlanOpcodeCopy) {
+            plan->isFlat = 0;
+            break;
+        }
+        plan->flatWireSize += ops[i].size;
+    }
+    plan->isContiguous = plan->isFlat && plan->opCount == 2 && ops[0].offset == 0 &&
+                         plan->flatWireSize == plan->memorySize;
+
+    *outPlan = plan;
+
+    return 0;
+}
+
+int swtisPlanCacheInit(SwtisPlanCache* self, const SwtiChunk* chunk, ImprintAllocator* allocator)
+{
+    self->chunk = chunk;
+    self->allocator = allocator;
+    self->plans = IMPRINT_ALLOC_TYPE_COUNT(allocator, SwtisPlan*, chunk->typeCount + 1);
+    tc_mem_clear_type_n(self->plans, chunk->typeCount + 1);
+
+    return 0;
+}
+
+int swtisPlanCacheGet(SwtisPlanCache* self, const SwtiType* type, const SwtisPlan** outPlan)
+{
+    if (type->index < self->chunk->typeCount && self->plans[type->index] != 0) {
+        *outPlan = self->plans[type->index];
+        return 0;
+    }
+
+    PlanJournal journal;
+    tc_mem_clear_type(&journal);
+
+    int error = compilePlan(self, type, 0, &journal, outPlan);
+    if (error != 0) {
+        for (size_t i = 0; i < journal.count; ++i) {
+            self->plans[journal.indices[i]] = 0;
+        }
+    }
+    tc_free(journal.indices);
+
+    return error;
+}
+
+/// Compiles the plans for all types that have values (skipping functions, variants etc.).
+int swtisPlanCacheCompileAll(SwtisPlanCache* self)
+{
+    for (size_t i = 0; i < self->chunk->typeCount; ++i) {
+        const SwtiType* type = self->chunk->types[i];
+        switch (swtisValueUnalias(type)->type) {
+            case SwtiTypeFunction:
+            case SwtiTypeCustomVariant:
+            case SwtiTypeAny:
+            case SwtiTypeAnyMatchingTypes:
+            case SwtiTypeUnmanaged:
+            case SwtiTypeRefId:
+            case SwtiTypeAlias:
+                continue;
+            default:
+                break;
+        }
+        const SwtisPlan* plan;
+        int error;
+        if ((error = swtisPlanCacheGet(self, type, &plan)) != 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+static const void* readPointer(const uint8_t* source)
+{
+    const void* pointer;
+    tc_memcpy_octets((void*) &pointer, source, sizeof(pointer));
+    return pointer;
+}
+
+static void writePointer(uint8_t* target, const void* pointer)
+{
+    tc_memcpy_octets(target, (const void*) &pointer, sizeof(pointer));
+}
+
+static int writeCount(FldOutStream* stream, size_t count)
+{
+    if (count > 0xffffffff) {
+        return -5;
+    }
+    uint8_t octets[4];
+    swtisValueWriteUInt32(octets, (uint32_t) count);
+    return fldOutStreamWriteOctets(stream, octets, 4);
+}
+
+static int writeValues(const SwtisPlan* plan, FldOutStream* stream, const uint8_t* source, size_t count,
+                       size_t stride, size_t depth);
+
+static int runWrite(const SwtisPlan* plan, FldOutStream* stream, const uint8_t* source, size_t depth)
+{
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        CLOG_SOFT_ERROR("plan: value is too deep")
+        return -2;
+    }
+
+    const SwtisPlanOp* ops = plan->ops;
+    const SwtisPlanOp* op = ops;
+    int error;
+
+    for (;;) {
+        switch (op->opcode) {
+            case SwtisPlanOpcodeCopy:
+                if ((error = fldOutStreamWriteOctets(stream, source + op->offset, op->size)) != 0) {
+                    return error;
+                }
+                break;
+            case SwtisPlanOpcodeScalar: {
+                uint8_t octets[8];
+                swtisValueCopyScalar(octets, source + op->offset, op->size);
+                if ((error = fldOutStreamWriteOctets(stream, octets, op->size)) != 0) {
+                    return error;
+                }
+                break;
+            }
+            case SwtisPlanOpcodeString: {
+                const SwtisValueString* string = readPointer(source + op->offset);
+                size_t count = string != 0 ? string->characterCount : 0;
+                if ((error = writeCount(stream, count)) != 0) {
+                    return error;
+                }
+                if (count != 0 &&
+                    (error = fldOutStreamWriteOctets(stream, (const uint8_t*) string->characters, count)) != 0) {
+                    return error;
+                }
+                break;
+            }
+            case SwtisPlanOpcodeBlob: {
+                const SwtisValueBlob* blob = readPointer(source + op->offset);
+                size_t count = blob != 0 ? blob->octetCount : 0;
+                if ((error = writeCount(stream, count)) != 0) {
+                    return error;
+                }
+                if (count != 0 && (error = fldOutStreamWriteOctets(stream, blob->octets, count)) != 0) {
+                    return error;
+                }
+                break;
+            }
+            case SwtisPlanOpcodeList: {
+                const SwtisValueList* list = readPointer(source + op->offset);
+                size_t count = list != 0 ? list->count : 0;
+                if ((error = writeCount(stream, count)) != 0) {
+                    return error;
+                }
+                if (count != 0 && (error = writeValues(op->itemPlan, stream, (const uint8_t*) list->value, count,
+                                                       op->size, depth + 1)) != 0) {
+                    return error;
+                }
+                break;
+            }
+            case SwtisPlanOpcodeVariant: {
+                uint8_t variantIndex = source[op->offset];
+                if (variantIndex >= op->size) {
+                    CLOG_SOFT_ERROR("plan: illegal variant %d", variantIndex)
+                    return -6;
+                }
+                if ((error = fldOutStreamWriteUInt8(stream, variantIndex)) != 0) {
+                    return error;
+                }
+                op = ops + plan->jumpTable[op->target + variantIndex];
+                continue;
+            }
+            case SwtisPlanOpcodeJump:
+                op = ops + op->target;
+                continue;
+            case SwtisPlanOpcodeEnd:
+                return 0;
+        }
+        op++;
+    }
+}
+
+static int writeValues(const SwtisPlan* plan, FldOutStream* stream, const uint8_t* source, size_t count,
+                       size_t stride, size_t depth)
+{
+    int error;
+
+    if (plan->isContiguous && stride == plan->memorySize) {
+        // A single span that covers the whole value and no padding between values
+        return fldOutStreamWriteOctets(stream, source, count * stride);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if ((error = runWrite(plan, stream, source, depth)) != 0) {
+            return error;
+        }
+        source += stride;
+    }
+
+    return 0;
+}
+
+static int runRead(const SwtisPlan* plan, FldInStream* stream, uint8_t* target, ImprintAllocator* allocator,
+                   size_t depth);
+
+static int readCount(FldInStream* stream, uint32_t* count)
+{
+    uint8_t octets[4];
+    int error;
+    if ((error = fldInStreamReadOctets(stream, octets, 4)) != 0) {
+        return error;
+    }
+    *count = swtisValueReadUInt32(octets);
+    return 0;
+}
+
+static int readOctets(FldInStream* stream, uint8_t** outOctets, uint32_t* outCount, ImprintAllocator* allocator)
+{
+    int error;
+    if ((error = readCount(stream, outCount)) != 0) {
+        return error;
+    }
+
+    if (*outCount > stream->size - stream->pos) {
+        return -7;
+    }
+
+    uint8_t* octets = IMPRINT_ALLOC(allocator, *outCount + 1, "plan octets");
+    if ((error = fldInStreamReadOctets(stream, octets, *outCount)) != 0) {
+        return error;
+    }
+    octets[*outCount] = 0;
+    *outOctets = octets;
+
+    return 0;
+}
+
+static int readList(const SwtisPlanOp* op, FldInStream* stream, uint8_t* target, ImprintAllocator* allocator,
+                    size_t depth)
+{
+    uint32_t count;
+    int error;
+    if ((error = readCount(stream, &count)) != 0) {
+        return error;
+    }
+
+    const SwtisPlan* itemPlan = op->itemPlan;
+    size_t itemWireSize = itemPlan->minimumWireSize;
+    size_t remaining = stream->size - stream->pos;
+    if (itemWireSize != 0 ? count > remaining / itemWireSize : count > SWTIS_VALUE_MAX_EMPTY_ITEM_COUNT) {
+        CLOG_SOFT_ERROR("plan: list count %u is more than the stream can hold", count)
+        return -7;
+    }
+
+    size_t stride = op->size;
+    SwtisValueList* list = IMPRINT_ALLOC_TYPE(allocator, SwtisValueList);
+    uint8_t* items = 0;
+    if (count != 0) {
+        items = IMPRINT_ALLOC(allocator, count * stride, "plan list items");
+        tc_mem_clear(items, count * stride);
+    }
+    list->value = items;
+    list->count = count;
+    list->itemSize = stride;
+    list->itemAlign = op->target;
+
+    if (itemPlan->isContiguous && stride == itemPlan->memorySize) {
+        // Tightly packed scalars, the wire format is the memory layout
+        if ((error = fldInStreamReadOctets(stream, items, count * stride)) != 0) {
+            return error;
+        }
+    } else {
+        for (size_t i = 0; i < count; ++i) {
+            if ((error = runRead(itemPlan, stream, items + i * stride, allocator, depth + 1)) != 0) {
+                return error;
+            }
+        }
+    }
+
+    writePointer(target + op->offset, list);
+
+    return 0;
+}
+
+static int runRead(const SwtisPlan* plan, FldInStream* stream, uint8_t* target, ImprintAllocator* allocator,
+                   size_t depth)
+{
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        CLOG_SOFT_ERROR("plan: value is too deep")
+        return -2;
+    }
+
+    const SwtisPlanOp* ops = plan->ops;
+    const SwtisPlanOp* op = ops;
+    int error;
+
+    for (;;) {
+        switch (op->opcode) {
+            case SwtisPlanOpcodeCopy:
+                if ((error = fldInStreamReadOctets(stream, target + op->offset, op->size)) != 0) {
+                    return error;
+                }
+                break;
+            case SwtisPlanOpcodeScalar: {
+                uint8_t octets[8];
+                if ((error = fldInStreamReadOctets(stream, octets, op->size)) != 0) {
+                    return error;
+                }
+                swtisValueCopyScalar(target + op->offset, octets, op->size);
+                break;
+            }
+            case SwtisPlanOpcodeString: {
+                uint8_t* characters;
+                uint32_t count;
+                if ((error = readOctets(stream, &characters, &count, allocator)) != 0) {
+                    return error;
+                }
+                SwtisValueString* string = IMPRINT_ALLOC_TYPE(allocator, SwtisValueString);
+                string->characters = (const char*) characters;
+                string->characterCount = count;
+                writePointer(target + op->offset, string);
+                break;
+            }
+            case SwtisPlanOpcodeBlob: {
+                uint8_t* octets;
+                uint32_t count;
+                if ((error = readOctets(stream, &octets, &count, allocator)) != 0) {
+                    return error;
+                }
+                SwtisValueBlob* blob = IMPRINT_ALLOC_TYPE(allocator, SwtisValueBlob);
+                blob->octets = octets;
+                blob->octetCount = count;
+                writePointer(target + op->offset, blob);
+                break;
+            }
+            case SwtisPlanOpcodeList:
+                if ((error = readList(op, stream, target, allocator, depth)) != 0) {
+                    return error;
+                }
+                break;
+            case SwtisPlanOpcodeVariant: {
+                uint8_t variantIndex;
+                if ((error = fldInStreamReadUInt8(stream, &variantIndex)) != 0) {
+                    return error;
+                }
+                if (variantIndex >= op->size) {
+                    CLOG_SOFT_ERROR("plan: illegal variant %d", variantIndex)
+                    return -6;
+                }
+                target[op->offset] = variantIndex;
+                op = ops + plan->jumpTable[op->target + variantIndex];
+                continue;
+            }
+            case SwtisPlanOpcodeJump:
+                op = ops + op->target;
+                continue;
+            case SwtisPlanOpcodeEnd:
+                return 0;
+        }
+        op++;
+    }
+}
+
+/// Same wire format as swtisSerializeValue(). Returns the number of octets written.
+int swtisPlanSerializeValue(const SwtisPlan* plan, FldOutStream* stream, const void* value)
+{
+    size_t tell = stream->pos;
+    int error;
+
+    if ((error = runWrite(plan, stream, (const uint8_t*) value, 0)) != 0) {
+        return error;
+    }
+
+    return (int) (stream->pos - tell);
+}
+
+/// Writes `count` values that are `stride` octets apart in memory, one after the other.
+int swtisPlanSerializeValues(const SwtisPlan* plan, FldOutStream* stream, const void* values, size_t count,
+                             size_t stride)
+{
+    size_t tell = stream->pos;
+    int error;
+
+    if ((error = writeValues(plan, stream, (const uint8_t*) values, count, stride, 0)) != 0) {
+        return error;
+    }
+
+    return (int) (stream->pos - tell);
+}
+
+/// Same wire format as swtisDeserializeValue(). Returns the number of octets read.
+int swtisPlanDeserializeValue(const SwtisPlan* plan, FldInStream* stream, void* target, ImprintAllocator* allocator)
+{
+    size_t tell = stream->pos;
+    int error;
+
+    tc_mem_clear(target, plan->memorySize);
+    if ((error = runRead(plan, stream, (uint8_t*) target, allocator, 0)) != 0) {
+        return error;
+    }
+
+    return (int) (stream->pos - tell);
+}
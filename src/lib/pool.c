@@ -0,0 +1,143 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <swamp-typeinfo-serialize/pool_internal.h>
+
+/// The task range of a worker, begin in the high and end in the low 32 bits, so it can be changed with a single
+/// compare and swap. Padded so that workers do not share cache lines.
+typedef struct PoolWorker {
+    _Atomic uint64_t range;
+    uint8_t padding[56];
+} PoolWorker;
+
+typedef struct Pool {
+    PoolWorker workers[SWTIS_POOL_MAX_THREAD_COUNT];
+    size_t workerCount;
+    SwtisPoolTaskFn taskFn;
+    void* userData;
+} Pool;
+
+typedef struct PoolThread {
+    Pool* pool;
+    size_t workerIndex;
+} PoolThread;
+
+static uint64_t packRange(uint32_t begin, uint32_t end)
+{
+    return ((uint64_t) begin << 32) | end;
+}
+
+static int takeOwn(PoolWorker* worker, size_t* outTaskIndex)
+{
+    uint64_t range = atomic_load(&worker->range);
+    for (;;) {
+        uint32_t begin = (uint32_t) (range >> 32);
+        uint32_t end = (uint32_t) range;
+        if (begin >= end) {
+            return 0;
+        }
+        if (atomic_compare_exchange_weak(&worker->range, &range, packRange(begin + 1, end))) {
+            *outTaskIndex = begin;
+            return 1;
+        }
+    }
+}
+
+static int steal(Pool* pool, size_t workerIndex)
+{
+    for (size_t i = 1; i < pool->workerCount; ++i) {
+        PoolWorker* victim = &pool->workers[(workerIndex + i) % pool->workerCount];
+        uint64_t range = atomic_load(&victim->range);
+        for (;;) {
+            uint32_t begin = (uint32_t) (range >> 32);
+            uint32_t end = (uint32_t) range;
+            if (begin >= end) {
+                break;
+            }
+            uint32_t half = (end - begin + 1) / 2;
+            if (atomic_compare_exchange_weak(&victim->range, &range, packRange(begin, end - half))) {
+                atomic_store(&pool->workers[workerIndex].range, packRange(end - half, end));
+                return 1;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static void runWorker(Pool* pool, size_t workerIndex)
+{
+    size_t taskIndex;
+
+    do {
+        while (takeOwn(&pool->workers[workerIndex], &taskIndex)) {
+            pool->taskFn(pool->userData, taskIndex, workerIndex);
+        }
+    } while (steal(pool, workerIndex));
+}
+
+static void* threadMain(void* argument)
+{
+    PoolThread* thread = (PoolThread*) argument;
+    runWorker(thread->pool, thread->workerIndex);
+    return 0;
+}
+
+int swtisPoolRun(size_t taskCount, size_t threadCount, SwtisPoolTaskFn taskFn, void* userData)
+{
+    if (taskCount > 0xffffffff) {
+        return -2;
+    }
+
+    if (threadCount > SWTIS_POOL_MAX_THREAD_COUNT) {
+        threadCount = SWTIS_POOL_MAX_THREAD_COUNT;
+    }
+    if (threadCount > taskCount) {
+        threadCount = taskCount;
+    }
+
+    if (threadCount <= 1) {
+        for (size_t i = 0; i < taskCount; ++i) {
+            taskFn(userData, i, 0);
+        }
+        return 0;
+    }
+
+    Pool pool;
+    pool.workerCount = threadCount;
+    pool.taskFn = taskFn;
+    pool.userData = userData;
+
+    for (size_t i = 0; i < threadCount; ++i) {
+        uint32_t begin = (uint32_t) (taskCount * i / threadCount);
+        uint32_t end = (uint32_t) (taskCount * (i + 1) / threadCount);
+        atomic_init(&pool.workers[i].range, packRange(begin, end));
+    }
+
+    PoolThread threads[SWTIS_POOL_MAX_THREAD_COUNT];
+    pthread_t handles[SWTIS_POOL_MAX_THREAD_COUNT];
+    size_t startedCount = 0;
+
+    for (size_t i = 1; i < threadCount; ++i) {
+        threads[i].pool = &pool;
+        threads[i].workerIndex = i;
+        if (pthread_create(&handles[i], 0, threadMain, &threads[i]) != 0) {
+            CLOG_SOFT_ERROR("pool: could not start thread %zu, continuing with fewer", i)
+            break;
+        }
+        startedCount++;
+    }
+
+    // Workers that did not start still have their ranges, which are stolen by the others
+    runWorker(&pool, 0);
+
+    for (size_t i = 1; i <= startedCount; ++i) {
+        pthread_join(handles[i], 0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,218 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <imprint/linear_allocator.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo-serialize/reload.h>
+#include <swamp-typeinfo/chunk.h>
+#include <tiny-libc/tiny_libc.h>
+
+#define SWTIS_RELOAD_CACHE_LINE_OCTET_COUNT (64)
+
+/// Aligned to a cache line, so readers entering and leaving do not slow each other down.
+struct SwtisReloadReader {
+    // Epoch when the reader entered, zero while it is not entered
+    _Alignas(SWTIS_RELOAD_CACHE_LINE_OCTET_COUNT) _Atomic uint64_t epoch;
+    _Atomic int isRegistered;
+    SwtisReloader* owner;
+};
+
+_Static_assert(sizeof(struct SwtisReloadReader) == SWTIS_RELOAD_CACHE_LINE_OCTET_COUNT,
+               "a reader must fill exactly one cache line");
+
+typedef struct SwtisReloadArena {
+    uint8_t* memory;
+    size_t memorySize;
+    // Kept for lazy names
+    uint8_t* octets;
+    size_t octetCapacity;
+    SwtiChunk chunk;
+    // The epoch that started when it stopped being current, zero if no reader can be using it
+    uint64_t retiredEpoch;
+} SwtisReloadArena;
+
+struct SwtisReloader {
+    SwtisReloadArena arenas[2];
+    SwtisReloadArena* _Atomic current;
+    _Atomic uint64_t epoch;
+    _Atomic uint64_t generation;
+    SwtisReloadReader* readers;
+    size_t maxReaderCount;
+    SwtisDeserializeOptions deserializeOptions;
+    int hasDeserializeOptions;
+};
+
+SwtisReloader* swtisReloaderCreate(const SwtisReloaderOptions* options)
+{
+    if (options->maxReaderCount == 0) {
+        CLOG_SOFT_ERROR("swtisReloader: maxReaderCount must be at least one")
+        return 0;
+    }
+
+    if (options->deserializeOptions != 0 &&
+        (options->deserializeOptions->dependents != 0 || options->deserializeOptions->unmanagedTable != 0)) {
+        CLOG_SOFT_ERROR("swtisReloader: dependents and unmanaged tables can not be shared between chunks")
+        return 0;
+    }
+
+    SwtisReloader* self = tc_malloc_type(SwtisReloader);
+    tc_mem_clear_type(self);
+
+    // malloc() only aligns for the largest scalar. The size is a multiple of the alignment, as aligned_alloc() needs.
+    self->readers = aligned_alloc(_Alignof(SwtisReloadReader), sizeof(SwtisReloadReader) * options->maxReaderCount);
+    if (self->readers == 0) {
+        CLOG_SOFT_ERROR("swtisReloader: out of memory for %zu readers", options->maxReaderCount)
+        tc_free(self);
+        return 0;
+    }
+    tc_mem_clear_type_n(self->readers, options->maxReaderCount);
+    for (size_t i = 0; i < options->maxReaderCount; ++i) {
+        atomic_init(&self->readers[i].epoch, 0);
+        atomic_init(&self->readers[i].isRegistered, 0);
+        self->readers[i].owner = self;
+    }
+    self->maxReaderCount = options->maxReaderCount;
+
+    if (options->deserializeOptions != 0) {
+        self->deserializeOptions = *options->deserializeOptions;
+        self->hasDeserializeOptions = 1;
+    }
+
+    atomic_init(&self->current, 0);
+    // Zero means not entered, so the epochs start at one
+    atomic_init(&self->epoch, 1);
+    atomic_init(&self->generation, 0);
+
+    return self;
+}
+
+void swtisReloaderDestroy(SwtisReloader* self)
+{
+    for (size_t i = 0; i < self->maxReaderCount; ++i) {
+        if (atomic_load(&self->readers[i].isRegistered)) {
+            CLOG_ERROR("swtisReloader: destroyed while a reader is still registered")
+        }
+    }
+
+    for (size_t i = 0; i < 2; ++i) {
+        tc_free(self->arenas[i].memory);
+        tc_free(self->arenas[i].octets);
+    }
+
+    free(self->readers);
+    tc_free(self);
+}
+
+static SwtisReloadArena* freeArena(SwtisReloader* self)
+{
+    SwtisReloadArena* current = atomic_load_explicit(&self->current, memory_order_relaxed);
+
+    return current == &self->arenas[0] ? &self->arenas[1] : &self->arenas[0];
+}
+
+int swtisReloaderCollect(SwtisReloader* self)
+{
+    SwtisReloadArena* arena = freeArena(self);
+    if (arena->retiredEpoch == 0) {
+        return 1;
+    }
+
+    // Readers that entered before the retiring epoch might have loaded the previous chunk
+    for (size_t i = 0; i < self->maxReaderCount; ++i) {
+        uint64_t readerEpoch = atomic_load(&self->readers[i].epoch);
+        if (readerEpoch != 0 && readerEpoch < arena->retiredEpoch) {
+            return 0;
+        }
+    }
+
+    arena->retiredEpoch = 0;
+
+    return 1;
+}
+
+int swtisReloaderReload(SwtisReloader* self, const uint8_t* octets, size_t octetCount)
+{
+    if (!swtisReloaderCollect(self)) {
+        return -4;
+    }
+
+    SwtisReloadArena* arena = freeArena(self);
+
+    // The arenas only grow, so reloads of about the same size do not allocate
+    size_t memorySize = octetCount * SWTIS_RELOAD_MEMORY_FACTOR;
+    if (arena->memorySize < memorySize) {
+        tc_free(arena->memory);
+        arena->memory = tc_malloc(memorySize);
+        arena->memorySize = memorySize;
+    }
+    if (arena->octetCapacity < octetCount) {
+        tc_free(arena->octets);
+        arena->octets = tc_malloc(octetCount);
+        arena->octetCapacity = octetCount;
+    }
+    tc_memcpy_octets(arena->octets, octets, octetCount);
+
+    ImprintLinearAllocator allocator;
+    imprintLinearAllocatorInit(&allocator, arena->memory, arena->memorySize, "swtisReloader");
+    int result = swtisDeserializeWithOptions(arena->octets, octetCount, &arena->chunk, &allocator.info,
+                                             self->hasDeserializeOptions ? &self->deserializeOptions : 0);
+    if (result < 0) {
+        CLOG_SOFT_ERROR("swtisReloader: could not deserialize %d", result)
+        return result;
+    }
+
+    // Readers that see the new epoch are guaranteed to see the new chunk
+    SwtisReloadArena* previous = atomic_exchange(&self->current, arena);
+    uint64_t newEpoch = atomic_fetch_add(&self->epoch, 1) + 1;
+    if (previous != 0) {
+        previous->retiredEpoch = newEpoch;
+    }
+
+    atomic_fetch_add_explicit(&self->generation, 1, memory_order_relaxed);
+
+    return result;
+}
+
+uint64_t swtisReloaderGeneration(SwtisReloader* self)
+{
+    return atomic_load_explicit(&self->generation, memory_order_relaxed);
+}
+
+int swtisReloadReaderRegister(SwtisReloader* self, SwtisReloadReader** outReader)
+{
+    for (size_t i = 0; i < self->maxReaderCount; ++i) {
+        int expected = 0;
+        if (atomic_compare_exchange_strong(&self->readers[i].isRegistered, &expected, 1)) {
+            *outReader = &self->readers[i];
+            return 0;
+        }
+    }
+
+    CLOG_SOFT_ERROR("swtisReloader: all %zu readers are registered", self->maxReaderCount)
+    return -4;
+}
+
+void swtisReloadReaderUnregister(SwtisReloadReader* reader)
+{
+    atomic_store(&reader->epoch, 0);
+    atomic_store(&reader->isRegistered, 0);
+}
+
+const SwtiChunk* swtisReloadReaderEnter(SwtisReloadReader* reader)
+{
+    // Sequentially consistent, so either the reloader sees this epoch when collecting, or the chunk loaded below is
+    // the one it published
+    atomic_store(&reader->epoch, atomic_load(&reader->owner->epoch));
+    SwtisReloadArena* arena = atomic_load(&reader->owner->current);
+
+    return arena != 0 ? &arena->chunk : 0;
+}
+
+void swtisReloadReaderLeave(SwtisReloadReader* reader)
+{
+    atomic_store_explicit(&reader->epoch, 0, memory_order_release);
+}
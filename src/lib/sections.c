@@ -0,0 +1,166 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <imprint/allocator.h>
+#include <swamp-typeinfo-serialize/format.h>
+#include <swamp-typeinfo-serialize/sections_internal.h>
+#include <swamp-typeinfo/chunk.h>
+#include <swamp-typeinfo/typeinfo.h>
+#include <tiny-libc/tiny_libc.h>
+
+static uint32_t readUInt32(const uint8_t* octets)
+{
+    return ((uint32_t) octets[0] << 24) | ((uint32_t) octets[1] << 16) | ((uint32_t) octets[2] << 8) | octets[3];
+}
+
+int swtisSectionDirectoryRead(SwtisSectionDirectory* self, const uint8_t* octets, size_t octetCount)
+{
+    if (octetCount < SWTIS_SECTIONS_HEADER_OCTET_COUNT + 1) {
+        return -1;
+    }
+
+    if (!(octets[3] & SWTIS_FORMAT_FLAG_SECTIONED)) {
+        CLOG_SOFT_ERROR("sections: typeinfo is not sectioned")
+        return -5;
+    }
+
+    size_t sectionCount = octets[SWTIS_SECTIONS_HEADER_OCTET_COUNT];
+    if (sectionCount > SWTIS_SECTIONS_MAX_COUNT) {
+        CLOG_SOFT_ERROR("sections: too many sections %zu", sectionCount)
+        return -6;
+    }
+
+    size_t directoryEnd = SWTIS_SECTIONS_HEADER_OCTET_COUNT + 1 + sectionCount * SWTIS_SECTIONS_ENTRY_OCTET_COUNT;
+    if (octetCount < directoryEnd) {
+        return -1;
+    }
+
+    self->sectionCount = sectionCount;
+    self->octetCount = directoryEnd;
+    self->totalOctetCount = directoryEnd;
+
+    const uint8_t* p = octets + SWTIS_SECTIONS_HEADER_OCTET_COUNT + 1;
+    for (size_t i = 0; i < sectionCount; ++i) {
+        SwtisSection* section = &self->sections[i];
+        section->id = p[0];
+        section->offset = readUInt32(p + 1);
+        section->octetCount = readUInt32(p + 5);
+        p += SWTIS_SECTIONS_ENTRY_OCTET_COUNT;
+
+        if (section->offset < directoryEnd) {
+            CLOG_SOFT_ERROR("sections: section %d overlaps the directory", section->id)
+            return -6;
+        }
+
+        size_t sectionEnd = (size_t) section->offset + section->octetCount;
+        if (sectionEnd > self->totalOctetCount) {
+            self->totalOctetCount = sectionEnd;
+        }
+    }
+
+    return 0;
+}
+
+const SwtisSection* swtisSectionDirectoryFind(const SwtisSectionDirectory* self, uint8_t id)
+{
+    for (size_t i = 0; i < self->sectionCount; ++i) {
+        if (self->sections[i].id == id) {
+            return &self->sections[i];
+        }
+    }
+
+    return 0;
+}
+
+size_t swtisSectionNameCount(const SwtiType* type)
+{
+    switch (type->type) {
+        case SwtiTypeCustom:
+        case SwtiTypeCustomVariant:
+        case SwtiTypeAlias:
+        case SwtiTypeUnmanaged:
+            return 1;
+        case SwtiTypeRecord:
+            return ((const SwtiRecordType*) type)->fieldCount;
+        default:
+            return 0;
+    }
+}
+
+const char** swtisSectionNameAt(SwtiType* type, size_t index)
+{
+    switch (type->type) {
+        case SwtiTypeCustomVariant:
+            return &((SwtiCustomTypeVariant*) type)->name;
+        case SwtiTypeRecord:
+            return (const char**) &((SwtiRecordType*) type)->fields[index].name;
+        default:
+            return &type->name;
+    }
+}
+
+int swtisSectionNamesFind(const uint8_t* octets, size_t octetCount, uint32_t* outOffsets, size_t maxCount)
+{
+    if (octetCount < 2) {
+        return -6;
+    }
+
+    size_t nameCount = ((size_t) octets[0] << 8) | octets[1];
+    if (nameCount > maxCount) {
+        CLOG_SOFT_ERROR("sections: expected at most %zu names, but got %zu", maxCount, nameCount)
+        return -6;
+    }
+
+    size_t pos = 2;
+    for (size_t i = 0; i < nameCount; ++i) {
+        outOffsets[i] = (uint32_t) pos;
+        while (pos < octetCount && octets[pos] != 0) {
+            pos++;
+        }
+        if (pos == octetCount) {
+            CLOG_SOFT_ERROR("sections: name %zu ends after the names section", i)
+            return -6;
+        }
+        pos++;
+    }
+
+    return (int) nameCount;
+}
+
+int swtisSectionNamesApply(SwtiChunk* chunk, const uint8_t* octets, size_t octetCount, ImprintAllocator* allocator)
+{
+    size_t expectedCount = 0;
+    for (size_t i = 0; i < chunk->typeCount; ++i) {
+        expectedCount += swtisSectionNameCount(chunk->types[i]);
+    }
+
+    uint32_t* offsets = tc_malloc_type_count(uint32_t, expectedCount + 1);
+    int nameCount = swtisSectionNamesFind(octets, octetCount, offsets, expectedCount);
+    if (nameCount < 0 || (size_t) nameCount != expectedCount) {
+        tc_free(offsets);
+        CLOG_SOFT_ERROR("sections: names section does not match the types")
+        return -6;
+    }
+
+    size_t nameIndex = 0;
+    for (size_t i = 0; i < chunk->typeCount; ++i) {
+        SwtiType* type = (SwtiType*) chunk->types[i];
+        size_t typeNameCount = swtisSectionNameCount(type);
+        for (size_t j = 0; j < typeNameCount; ++j) {
+            const char* name = (const char*) octets + offsets[nameIndex++];
+            if (allocator != 0) {
+                size_t length = tc_strlen(name);
+                char* copy = IMPRINT_ALLOC(allocator, length + 1, "name");
+                tc_memcpy_octets(copy, name, length + 1);
+                name = copy;
+            }
+            *swtisSectionNameAt(type, j) = name;
+        }
+    }
+
+    tc_free(offsets);
+
+    return 0;
+}
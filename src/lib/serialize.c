@@ -4,14 +4,36 @@
  *--------------------------------------------------------------------------------------------*/
 #include <flood/out_stream.h>
 #include <swamp-typeinfo/chunk.h>
+#include <swamp-typeinfo-serialize/codec_internal.h>
+#include <swamp-typeinfo-serialize/crc32c_internal.h>
+#include <swamp-typeinfo-serialize/format.h>
+#include <swamp-typeinfo-serialize/pool_internal.h>
+#include <swamp-typeinfo-serialize/sections_internal.h>
 #include <swamp-typeinfo-serialize/serialize.h>
+#include <swamp-typeinfo-serialize/serialize_internal.h>
 #include <swamp-typeinfo/typeinfo.h>
 #include <tiny-libc/tiny_libc.h>
 #include <clog/clog.h>
 #include <swamp-typeinfo-serialize/version.h>
 
-static int writeString(FldOutStream *stream, const char *outString)
+// Types are sized and written in blocks of this many types per task
+#define SWTIS_SERIALIZE_BLOCK_TYPE_COUNT (256)
+
+typedef struct SerializeContext
+{
+    FldOutStream *stream;
+    uint8_t formatFlags;
+    size_t threadCount;
+} SerializeContext;
+
+static int writeString(SerializeContext *context, const char *outString)
 {
+    if (context->formatFlags & SWTIS_FORMAT_FLAG_SECTIONED)
+    {
+        return 0;
+    }
+
+    FldOutStream *stream = context->stream;
     int error;
     uint8_t count = tc_strlen(outString);
     if ((error = fldOutStreamWriteUInt8(stream, count)) != 0)
@@ -27,9 +49,24 @@ static int writeString(FldOutStream *stream, const char *outString)
     return 0;
 }
 
-static int writeTypeRef(FldOutStream *stream, const SwtiType *type)
+/// A cleared reference is only written where the reader accepts it, see SWTIS_CODEC_CLEARED_TYPE_REF.
+static int writeTypeRef(FldOutStream *stream, const SwtiType *type, int isStrict)
 {
-    uint8_t index = type->index;
+    uint16_t index;
+    if (type == 0)
+    {
+        if (isStrict)
+        {
+            CLOG_SOFT_ERROR("serialize: a type refers to nothing")
+            return -3;
+        }
+        index = SWTIS_CODEC_CLEARED_TYPE_REF;
+    }
+    else
+    {
+        index = type->index;
+    }
+
     int error;
     if ((error = fldOutStreamWriteUInt16(stream, index)) != 0)
     {
@@ -39,18 +76,18 @@ static int writeTypeRef(FldOutStream *stream, const SwtiType *type)
     return 0;
 }
 
-static int writeTypeRefs(FldOutStream *stream, const SwtiType **types, size_t count)
+static int writeTypeRefs(FldOutStream *stream, const SwtiType **types, size_t count, int isStrict)
 {
     int error;
 
-    if ((error = fldOutStreamWriteUInt8(stream, count)) != 0)
+    if ((error = fldOutStreamWriteUInt8(stream, (uint8_t)count)) != 0)
     {
         return error;
     }
 
-    for (uint8_t i = 0; i < count; i++)
+    for (uint8_t i = 0; i < (uint8_t)count; i++)
     {
-        if ((error = writeTypeRef(stream, types[i])) != 0)
+        if ((error = writeTypeRef(stream, types[i], isStrict)) != 0)
         {
             return error;
         }
@@ -70,293 +107,460 @@ static int writeMemoryOffset(FldOutStream *stream, uint16_t offset)
     return 0;
 }
 
-static int writeVariant(FldOutStream *stream, const SwtiCustomTypeVariant *variant)
+static int writeMemoryInfo(SerializeContext *context, const SwtiMemoryInfo *memoryInfo)
 {
-    writeString(stream, variant->name);
+    if (context->formatFlags & SWTIS_FORMAT_FLAG_LAYOUT_OMITTED)
+    {
+        return 0;
+    }
 
-    for (size_t i = 0; i < variant->paramCount; ++i)
+    int error;
+    if ((error = fldOutStreamWriteUInt16(context->stream, memoryInfo->memorySize)) != 0)
     {
-        writeTypeRef(stream, variant->fields[i].fieldType);
-        writeMemoryOffset(stream, variant->fields[i].memoryOffsetInfo.memoryOffset);
+        return error;
     }
 
-    return 0;
+    return fldOutStreamWriteUInt8(context->stream, memoryInfo->memoryAlign);
 }
 
-static int writeVariants(FldOutStream *stream, const SwtiCustomType *custom)
+static int writeMemoryOffsetInfo(SerializeContext *context, const SwtiMemoryOffsetInfo *memoryOffsetInfo)
 {
-    int error;
-
-    if ((error = fldOutStreamWriteUInt8(stream, custom->variantCount)) != 0)
+    if (context->formatFlags & SWTIS_FORMAT_FLAG_LAYOUT_OMITTED)
     {
-        return error;
+        return 0;
     }
 
-    for (uint8_t i = 0; i < custom->variantCount; i++)
+    int error;
+    if ((error = writeMemoryOffset(context->stream, memoryOffsetInfo->memoryOffset)) != 0)
     {
-        if ((error = writeVariant(stream, (const SwtiCustomTypeVariant *)&custom->variantTypes[i])) != 0)
-        {
-            return error;
-        }
+        return error;
     }
 
-    return 0;
+    return writeMemoryInfo(context, &memoryOffsetInfo->memoryInfo);
 }
 
-static int writeCustomType(FldOutStream *stream, const SwtiCustomType *custom)
+#define WRITE_CHECK(expression)            \
+    if ((error = (expression)) != 0)       \
+    {                                      \
+        return error;                      \
+    }
+
+#define WRITE_NAME(self, member) WRITE_CHECK(writeString(context, (self)->member))
+#define WRITE_EMPTY_NAME(self, member)
+#define WRITE_MEMORY_INFO(self, member) WRITE_CHECK(writeMemoryInfo(context, &(self)->member))
+#define WRITE_MEMORY_OFFSET_INFO(self, member) WRITE_CHECK(writeMemoryOffsetInfo(context, &(self)->member))
+#define WRITE_OWNER(self, member, Pointer, ACCEPT) \
+    WRITE_CHECK(writeTypeRef(context->stream, (const SwtiType *)(self)->member, ACCEPT##_STRICT))
+#define WRITE_REF WRITE_OWNER
+#define WRITE_REFS(self, member, count, Pointer, ACCEPT) \
+    WRITE_CHECK(writeTypeRefs(context->stream, (const SwtiType **)(self)->member, (self)->count, ACCEPT##_STRICT))
+#define WRITE_U16(self, member) WRITE_CHECK(fldOutStreamWriteUInt16(context->stream, (self)->member))
+#define WRITE_ITEMS(self, member, count, Item, item, ...)                              \
+    WRITE_CHECK(fldOutStreamWriteUInt8(context->stream, (uint8_t)(self)->count))       \
+    for (uint8_t item##Index = 0; item##Index < (uint8_t)(self)->count; ++item##Index) \
+    {                                                                                  \
+        const Item *item = &(self)->member[item##Index];                               \
+        __VA_ARGS__                                                                    \
+    }
+
+#define WRITE_KIND(typeValue, Struct, LAYOUT)       \
+    case typeValue:                                 \
+    {                                               \
+        const Struct *self = (const Struct *)type;  \
+        SWTIS_CODEC_EXPAND(LAYOUT, WRITE)           \
+        return 0;                                   \
+    }
+#define WRITE_BARE(typeValue) \
+    case typeValue:           \
+        return 0;
+
+/// Expanded from the layouts in codec_internal.h.
+static int writeType(SerializeContext *context, const SwtiType *type)
 {
     int error;
-
-    if ((error = writeString(stream, custom->internal.name)) != 0)
+    if ((error = fldOutStreamWriteUInt8(context->stream, type->type)) != 0)
     {
         return error;
     }
 
-    if ((error = writeVariants(stream, custom)) != 0)
+    switch (type->type)
     {
-        return error;
+        SWTIS_CODEC_KINDS(WRITE_KIND, WRITE_BARE)
+    default:
+        break;
     }
 
-    return 0;
+    CLOG_ERROR("Unknown type %d", type->type);
+    return -99;
 }
 
-static int writeRecordField(FldOutStream *stream, const SwtiRecordTypeField *field)
+static size_t stringOctetCount(uint8_t formatFlags, const char *s)
 {
-    int error;
-    if ((error = writeString(stream, field->name)) != 0)
+    if (formatFlags & SWTIS_FORMAT_FLAG_SECTIONED)
     {
-        return error;
+        return 0;
     }
 
-    return writeTypeRef(stream, field->fieldType);
+    // Same truncation as writeString()
+    return 1 + (uint8_t)tc_strlen(s);
 }
 
-static int writeRecordFields(FldOutStream *stream, const SwtiRecordType *record)
+#define SIZE_NAME(self, member) octetCount += stringOctetCount(formatFlags, (self)->member);
+#define SIZE_EMPTY_NAME(self, member)
+#define SIZE_MEMORY_INFO(self, member) octetCount += memoryInfoSize;
+#define SIZE_MEMORY_OFFSET_INFO(self, member) octetCount += memoryOffsetInfoSize;
+#define SIZE_OWNER(self, member, Pointer, ACCEPT) octetCount += 2;
+#define SIZE_REF SIZE_OWNER
+#define SIZE_REFS(self, member, count, Pointer, ACCEPT) octetCount += 1 + (size_t)(uint8_t)(self)->count * 2;
+#define SIZE_U16(self, member) octetCount += 2;
+#define SIZE_ITEMS(self, member, count, Item, item, ...)                               \
+    octetCount += 1;                                                                   \
+    for (uint8_t item##Index = 0; item##Index < (uint8_t)(self)->count; ++item##Index) \
+    {                                                                                  \
+        const Item *item = &(self)->member[item##Index];                               \
+        (void)item;                                                                    \
+        __VA_ARGS__                                                                    \
+    }
+
+#define SIZE_KIND(typeValue, Struct, LAYOUT)        \
+    case typeValue:                                 \
+    {                                               \
+        const Struct *self = (const Struct *)type;  \
+        (void)self;                                 \
+        SWTIS_CODEC_EXPAND(LAYOUT, SIZE)            \
+        return octetCount;                          \
+    }
+#define SIZE_BARE(typeValue) \
+    case typeValue:          \
+        return octetCount;
+
+/// The number of octets writeType() writes for `type`, or zero if the type is unknown.
+size_t swtisSerializeTypeOctetCount(uint8_t formatFlags, const SwtiType *type)
 {
-    int error;
+    size_t memoryInfoSize = (formatFlags & SWTIS_FORMAT_FLAG_LAYOUT_OMITTED) ? 0 : 3;
+    size_t memoryOffsetInfoSize = (formatFlags & SWTIS_FORMAT_FLAG_LAYOUT_OMITTED) ? 0 : 5;
+    size_t octetCount = 1;
 
-    for (uint8_t i = 0; i < record->fieldCount; i++)
+    switch (type->type)
     {
-        if ((error = writeRecordField(stream, &record->fields[i])) != 0)
-        {
-            return error;
-        }
+        SWTIS_CODEC_KINDS(SIZE_KIND, SIZE_BARE)
+    default:
+        return 0;
     }
-
-    return 0;
 }
 
-static int writeRecord(FldOutStream *stream, const SwtiRecordType *record)
+typedef struct ParallelWrite
 {
-    int error;
-    if ((error = fldOutStreamWriteUInt8(stream, record->fieldCount)) != 0)
+    const struct SwtiChunk *source;
+    uint8_t formatFlags;
+    uint8_t *octets;
+    // Offset of each type from `octets`, and the total at the end
+    size_t *offsets;
+    int *blockErrors;
+} ParallelWrite;
+
+static void sizeBlockTask(void *userData, size_t taskIndex, size_t workerIndex)
+{
+    ParallelWrite *parallel = (ParallelWrite *)userData;
+    size_t first = taskIndex * SWTIS_SERIALIZE_BLOCK_TYPE_COUNT;
+    size_t last = first + SWTIS_SERIALIZE_BLOCK_TYPE_COUNT;
+    if (last > parallel->source->typeCount)
     {
-        return error;
+        last = parallel->source->typeCount;
     }
 
-    if ((error = writeRecordFields(stream, record)) != 0)
+    for (size_t i = first; i < last; i++)
     {
-        return error;
+        const SwtiType *item = parallel->source->types[i];
+        if (item->index != i)
+        {
+            parallel->blockErrors[taskIndex] = -2;
+            return;
+        }
+        size_t octetCount = swtisSerializeTypeOctetCount(parallel->formatFlags, item);
+        if (octetCount == 0)
+        {
+            CLOG_ERROR("Unknown type %d", item->type);
+            parallel->blockErrors[taskIndex] = -99;
+            return;
+        }
+        parallel->offsets[i] = octetCount;
     }
-
-    return 0;
 }
 
-static int writeArray(FldOutStream *stream, const SwtiArrayType *array)
+static void writeBlockTask(void *userData, size_t taskIndex, size_t workerIndex)
 {
-    int error;
-    if ((error = writeTypeRef(stream, array->itemType)) != 0)
+    ParallelWrite *parallel = (ParallelWrite *)userData;
+    size_t first = taskIndex * SWTIS_SERIALIZE_BLOCK_TYPE_COUNT;
+    size_t last = first + SWTIS_SERIALIZE_BLOCK_TYPE_COUNT;
+    if (last > parallel->source->typeCount)
     {
-        return error;
+        last = parallel->source->typeCount;
     }
 
-    return 0;
-}
+    FldOutStream stream;
+    size_t octetCount = parallel->offsets[last] - parallel->offsets[first];
+    fldOutStreamInit(&stream, parallel->octets + parallel->offsets[first], octetCount);
+
+    SerializeContext context;
+    context.stream = &stream;
+    context.formatFlags = parallel->formatFlags;
+    context.threadCount = 1;
 
-static int writeList(FldOutStream *stream, const SwtiListType *list)
-{
     int error;
-    if ((error = writeTypeRef(stream, list->itemType)) != 0)
+    for (size_t i = first; i < last; i++)
     {
-        return error;
+        if ((error = writeType(&context, parallel->source->types[i])) != 0)
+        {
+            parallel->blockErrors[taskIndex] = error;
+            return;
+        }
     }
 
-    return 0;
+    if (stream.pos != octetCount)
+    {
+        CLOG_ERROR("types %zu to %zu were sized to %zu octets, but %zu were written", first, last, octetCount, (size_t)stream.pos);
+        parallel->blockErrors[taskIndex] = -6;
+    }
 }
 
-static int writeFunction(FldOutStream *stream, const SwtiFunctionType *fn)
+static int firstBlockError(const int *blockErrors, size_t blockCount)
 {
-    int error;
-    if ((error = writeTypeRefs(stream, fn->parameterTypes, fn->parameterCount)) != 0)
+    for (size_t i = 0; i < blockCount; i++)
     {
-        return error;
+        if (blockErrors[i] != 0)
+        {
+            return blockErrors[i];
+        }
     }
 
     return 0;
 }
 
-static int writeTuple(FldOutStream *stream, const SwtiTupleType *tuple)
+/// Sizes every type in parallel, finds where each one starts and then writes them in parallel straight into the
+/// stream. Gives the same octets as the serial loop in writeTypes().
+static int writeTypesParallel(SerializeContext *context, const struct SwtiChunk *source)
 {
-    int error;
-    if ((error = writeTypeRefs(stream, 0 /*todo*/, tuple->fieldCount)) != 0)
+    FldOutStream *stream = context->stream;
+    size_t blockCount = (source->typeCount + SWTIS_SERIALIZE_BLOCK_TYPE_COUNT - 1) / SWTIS_SERIALIZE_BLOCK_TYPE_COUNT;
+
+    ParallelWrite parallel;
+    parallel.source = source;
+    parallel.formatFlags = context->formatFlags;
+    parallel.octets = stream->octets + stream->pos;
+    parallel.offsets = tc_malloc_type_count(size_t, source->typeCount + 1);
+    parallel.blockErrors = tc_malloc_type_count(int, blockCount);
+    if (parallel.offsets == 0 || parallel.blockErrors == 0)
     {
-        return error;
+        CLOG_SOFT_ERROR("serialize: out of memory for %zu types", source->typeCount)
+        tc_free(parallel.blockErrors);
+        tc_free(parallel.offsets);
+        return -7;
     }
+    tc_mem_clear_type_n(parallel.blockErrors, blockCount);
 
-    return 0;
-}
+    int error = swtisPoolRun(blockCount, context->threadCount, sizeBlockTask, &parallel);
+    if (error == 0)
+    {
+        error = firstBlockError(parallel.blockErrors, blockCount);
+    }
 
-static int writeAlias(FldOutStream *stream, const SwtiAliasType *alias)
-{
-    int error;
-    if ((error = writeString(stream, alias->internal.name)) != 0)
+    if (error == 0)
     {
-        return error;
+        // Exclusive prefix sum, the sizes become offsets
+        size_t offset = 0;
+        for (size_t i = 0; i < source->typeCount; i++)
+        {
+            size_t octetCount = parallel.offsets[i];
+            parallel.offsets[i] = offset;
+            offset += octetCount;
+        }
+        parallel.offsets[source->typeCount] = offset;
+
+        if (offset > stream->size - stream->pos)
+        {
+            error = -1;
+        }
     }
 
-    if ((error = writeTypeRef(stream, alias->targetType)) != 0)
+    if (error == 0)
     {
-        return error;
+        error = swtisPoolRun(blockCount, context->threadCount, writeBlockTask, &parallel);
+        if (error == 0)
+        {
+            error = firstBlockError(parallel.blockErrors, blockCount);
+        }
     }
 
-    return 0;
+    if (error == 0)
+    {
+        size_t octetCount = parallel.offsets[source->typeCount];
+        stream->p += octetCount;
+        stream->pos += octetCount;
+    }
+
+    tc_free(parallel.blockErrors);
+    tc_free(parallel.offsets);
+
+    return error;
 }
 
-static int writeUnmanaged(FldOutStream *stream, const SwtiUnmanagedType *unmanaged)
+static int writeTypes(SerializeContext *context, const struct SwtiChunk *source)
 {
     int error;
-    if ((error = writeString(stream, unmanaged->internal.name)) != 0)
+
+    if (context->threadCount > 1 && source->typeCount >= SWTIS_SERIALIZE_PARALLEL_MIN_TYPE_COUNT)
     {
-        return error;
+        return writeTypesParallel(context, source);
     }
 
-    if ((error = fldOutStreamWriteUInt16(stream, unmanaged->userTypeId)) != 0)
+    for (size_t i = 0; i < source->typeCount; i++)
     {
-        return error;
+        const SwtiType *item = source->types[i];
+        if (item->index != i)
+        {
+            return -2;
+        }
+        if ((error = writeType(context, item)) != 0)
+        {
+            return error;
+        }
     }
 
     return 0;
 }
 
-static int writeType(FldOutStream *stream, const SwtiType *type)
+static int writeNames(FldOutStream *stream, const struct SwtiChunk *source)
 {
     int error;
-    if ((error = fldOutStreamWriteUInt8(stream, type->type)) != 0)
-    {
-        return error;
-    }
+    size_t nameCount = 0;
 
-    error = -99;
-    switch (type->type)
-    {
-    case SwtiTypeCustom:
-    {
-        error = writeCustomType(stream, (const SwtiCustomType *)type);
-        break;
-    }
-    case SwtiTypeFunction:
-    {
-        error = writeFunction(stream, (const SwtiFunctionType *)type);
-        break;
-    }
-    case SwtiTypeAlias:
-    {
-        error = writeAlias(stream, (const SwtiAliasType *)type);
-        break;
-    }
-    case SwtiTypeRecord:
-    {
-        error = writeRecord(stream, (const SwtiRecordType *)type);
-        break;
-    }
-    case SwtiTypeArray:
+    for (size_t i = 0; i < source->typeCount; i++)
     {
-        error = writeArray(stream, (const SwtiArrayType *)type);
-        break;
-    }
-    case SwtiTypeList:
-    {
-        error = writeList(stream, (const SwtiListType *)type);
-        break;
-    }
-    case SwtiTypeUnmanaged:
-    {
-        error = writeUnmanaged(stream, (const SwtiUnmanagedType *)type);
-        break;
+        nameCount += swtisSectionNameCount(source->types[i]);
     }
-    case SwtiTypeTuple:
-    {
-        error = writeTuple(stream, (const SwtiTupleType *)type);
-        break;
-    }
-    case SwtiTypeString:
-    {
-        error = 0;
-        break;
-    }
-    case SwtiTypeInt:
-    {
-        error = 0;
-        break;
-    }
-    case SwtiTypeFixed:
+
+    if (nameCount > 0xffff)
     {
-        error = 0;
-        break;
+        CLOG_SOFT_ERROR("too many names %zu", nameCount)
+        return -6;
     }
-    case SwtiTypeBoolean:
+
+    if ((error = fldOutStreamWriteUInt16(stream, (uint16_t)nameCount)) != 0)
     {
-        error = 0;
-        break;
+        return error;
     }
-    case SwtiTypeBlob:
+
+    for (size_t i = 0; i < source->typeCount; i++)
     {
-        error = 0;
-        break;
+        SwtiType *type = (SwtiType *)source->types[i];
+        for (size_t j = 0; j < swtisSectionNameCount(type); ++j)
+        {
+            const char *name = *swtisSectionNameAt(type, j);
+            if ((error = fldOutStreamWriteOctets(stream, (const uint8_t *)name, tc_strlen(name) + 1)) != 0)
+            {
+                return error;
+            }
+        }
     }
-    case SwtiTypeResourceName:
+
+    return 0;
+}
+
+static int writeSectionEntry(FldOutStream *stream, const SwtisSection *section)
+{
+    int error;
+    if ((error = fldOutStreamWriteUInt8(stream, section->id)) != 0)
     {
-        error = 0;
-        break;
+        return error;
     }
-    case SwtiTypeChar:
+    if ((error = fldOutStreamWriteUInt32(stream, section->offset)) != 0)
     {
-        error = 0;
-        break;
+        return error;
     }
-    case SwtiTypeAny:
+
+    return fldOutStreamWriteUInt32(stream, section->octetCount);
+}
+
+static int writeSections(SerializeContext *context, const struct SwtiChunk *source, int stripNames, int tell)
+{
+    FldOutStream *stream = context->stream;
+    SwtisSection sections[2];
+    size_t sectionCount = stripNames ? 1 : 2;
+    int error;
+
+    if ((error = fldOutStreamWriteUInt8(stream, (uint8_t)sectionCount)) != 0)
     {
-        error = 0;
-        break;
+        return error;
     }
-    case SwtiTypeAnyMatchingTypes:
+
+    // Reserve the directory, it is filled in when the sections have been written
+    size_t directoryPos = stream->pos;
+    for (size_t i = 0; i < sectionCount * SWTIS_SECTIONS_ENTRY_OCTET_COUNT; ++i)
     {
-        error = 0;
-        break;
+        if ((error = fldOutStreamWriteUInt8(stream, 0)) != 0)
+        {
+            return error;
+        }
     }
-    case SwtiTypeCustomVariant:
+
+    sections[0].id = SWTIS_SECTION_TYPES;
+    sections[0].offset = stream->pos - tell;
+    if ((error = writeTypes(context, source)) != 0)
     {
-      error = 0;
-      break;
+        return error;
     }
-    case SwtiTypeRefId:
+    sections[0].octetCount = stream->pos - tell - sections[0].offset;
+
+    if (!stripNames)
     {
-      error = 0;
-      break;
+        sections[1].id = SWTIS_SECTION_NAMES;
+        sections[1].offset = stream->pos - tell;
+        if ((error = writeNames(stream, source)) != 0)
+        {
+            return error;
+        }
+        sections[1].octetCount = stream->pos - tell - sections[1].offset;
     }
-    default:
+
+    size_t endPos = stream->pos;
+    stream->p = stream->octets + directoryPos;
+    stream->pos = directoryPos;
+    for (size_t i = 0; i < sectionCount; ++i)
     {
-        CLOG_ERROR("Unknown type %d", type->type);
-    }
+        if ((error = writeSectionEntry(stream, &sections[i])) != 0)
+        {
+            return error;
+        }
     }
+    stream->p = stream->octets + endPos;
+    stream->pos = endPos;
 
-    return error;
+    return 0;
 }
 
-int swtisSerializeToStream(FldOutStream *stream, const struct SwtiChunk *source)
+int swtisSerializeToStreamWithOptions(FldOutStream *stream, const struct SwtiChunk *source, const SwtisSerializeOptions *options)
 {
     int error;
 
+    SerializeContext context;
+    context.stream = stream;
+    context.formatFlags = options != 0 ? options->formatFlags : 0;
+    context.threadCount = options != 0 ? options->threadCount : 0;
+    int stripNames = options != 0 ? options->stripNames : 0;
+
+    if (context.formatFlags & ~SWTIS_FORMAT_FLAGS_KNOWN)
+    {
+        CLOG_SOFT_ERROR("unknown format flags %02X", context.formatFlags)
+        return -5;
+    }
+
+    if (stripNames && !(context.formatFlags & SWTIS_FORMAT_FLAG_SECTIONED))
+    {
+        CLOG_SOFT_ERROR("names can only be stripped from a sectioned format")
+        return -5;
+    }
+
     int tell = stream->pos;
 
     if ((error = fldOutStreamWriteUInt8(stream, SWTI_SERIALIZE_VERSION_MAJOR)) != 0)
@@ -371,20 +575,34 @@ int swtisSerializeToStream(FldOutStream *stream, const struct SwtiChunk *source)
     {
         return error;
     }
+    if ((error = fldOutStreamWriteUInt8(stream, context.formatFlags)) != 0)
+    {
+        return error;
+    }
 
     if ((error = fldOutStreamWriteUInt16(stream, source->typeCount)) != 0)
     {
         return error;
     }
 
-    for (uint8_t i = 0; i < source->typeCount; i++)
+    if (context.formatFlags & SWTIS_FORMAT_FLAG_SECTIONED)
     {
-        const SwtiType *item = source->types[i];
-        if (item->index != i)
-        {
-            return -2;
-        }
-        if ((error = writeType(stream, item)) != 0)
+        error = writeSections(&context, source, stripNames, tell);
+    }
+    else
+    {
+        error = writeTypes(&context, source);
+    }
+
+    if (error != 0)
+    {
+        return error;
+    }
+
+    if (context.formatFlags & SWTIS_FORMAT_FLAG_CHECKSUM)
+    {
+        uint32_t checksum = swtisCrc32cUpdate(0, stream->octets + tell, stream->pos - tell);
+        if ((error = fldOutStreamWriteUInt32(stream, checksum)) != 0)
         {
             return error;
         }
@@ -395,11 +613,21 @@ int swtisSerializeToStream(FldOutStream *stream, const struct SwtiChunk *source)
     return octetsWritten;
 }
 
-int swtisSerialize(uint8_t *octets, size_t maxCount, const SwtiChunk *source)
+int swtisSerializeToStream(FldOutStream *stream, const struct SwtiChunk *source)
+{
+    return swtisSerializeToStreamWithOptions(stream, source, 0);
+}
+
+int swtisSerializeWithOptions(uint8_t *octets, size_t maxCount, const SwtiChunk *source, const SwtisSerializeOptions *options)
 {
     FldOutStream stream;
 
     fldOutStreamInit(&stream, octets, maxCount);
 
-    return swtisSerializeToStream(&stream, source);
+    return swtisSerializeToStreamWithOptions(&stream, source, options);
+}
+
+int swtisSerialize(uint8_t *octets, size_t maxCount, const SwtiChunk *source)
+{
+    return swtisSerializeWithOptions(octets, maxCount, source, 0);
 }
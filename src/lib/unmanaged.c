@@ -0,0 +1,64 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <imprint/allocator.h>
+#include <swamp-typeinfo-serialize/unmanaged.h>
+#include <swamp-typeinfo/chunk.h>
+#include <swamp-typeinfo/typeinfo.h>
+#include <tiny-libc/tiny_libc.h>
+
+int swtisUnmanagedTableBuild(SwtisUnmanagedTable* target, const SwtiChunk* chunk, ImprintAllocator* allocator)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < chunk->typeCount; ++i) {
+        const SwtiType* type = chunk->types[i];
+        if (type->type == SwtiTypeUnmanaged) {
+            const SwtiUnmanagedType* unmanaged = (const SwtiUnmanagedType*) type;
+            if ((size_t) unmanaged->userTypeId + 1 > count) {
+                count = (size_t) unmanaged->userTypeId + 1;
+            }
+        }
+    }
+
+    target->entries = 0;
+    target->count = 0;
+    if (count == 0) {
+        return 0;
+    }
+
+    SwtisUnmanagedEntry* entries = IMPRINT_ALLOC_TYPE_COUNT(allocator, SwtisUnmanagedEntry, count);
+    tc_mem_clear_type_n(entries, count);
+
+    for (size_t i = 0; i < chunk->typeCount; ++i) {
+        const SwtiType* type = chunk->types[i];
+        if (type->type != SwtiTypeUnmanaged) {
+            continue;
+        }
+        const SwtiUnmanagedType* unmanaged = (const SwtiUnmanagedType*) type;
+        SwtisUnmanagedEntry* entry = &entries[unmanaged->userTypeId];
+        if (entry->type != 0) {
+            CLOG_SOFT_ERROR("swtisUnmanagedTable: types %d and %d both have userTypeId %d", entry->type->internal.index,
+                            type->index, unmanaged->userTypeId)
+            return -6;
+        }
+        entry->type = unmanaged;
+    }
+
+    target->entries = entries;
+    target->count = count;
+
+    return 0;
+}
+
+int swtisUnmanagedTableSetHandler(SwtisUnmanagedTable* self, uint16_t userTypeId, void* handler)
+{
+    if (userTypeId >= self->count || self->entries[userTypeId].type == 0) {
+        return -1;
+    }
+
+    self->entries[userTypeId].handler = handler;
+
+    return 0;
+}
@@ -0,0 +1,572 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <flood/in_stream.h>
+#include <flood/out_stream.h>
+#include <imprint/allocator.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/value.h>
+#include <swamp-typeinfo-serialize/value_internal.h>
+#include <swamp-typeinfo/typeinfo.h>
+#include <tiny-libc/tiny_libc.h>
+
+/// A scalar has no memory info of its own, its size is stored in the `slot` that holds it: the memory offset info of
+/// the field or the memory info of the list. Only a scalar that is not held by anything, the top level value, falls
+/// back to the host profile.
+int swtisValueScalarSize(const SwtiType* type, const SwtiMemoryInfo* slot, size_t* outSize)
+{
+    SwtiMemoryInfo info;
+    int error;
+
+    if (slot != 0) {
+        info = *slot;
+    } else if ((error = swtisLayoutMemoryInfo(type, SWTIS_LAYOUT_PROFILE_HOST, &info)) != 0) {
+        return error;
+    }
+
+    if (info.memorySize == 0) {
+        CLOG_SOFT_ERROR("value: scalar of type %d has no layout", type->index)
+        return -4;
+    }
+
+    if (info.memorySize > 8) {
+        CLOG_SOFT_ERROR("value: scalar of size %d is not supported", info.memorySize)
+        return -3;
+    }
+
+    *outSize = info.memorySize;
+
+    return 0;
+}
+
+/// The memory size of a value of `type` held in `slot`, see swtisValueScalarSize(). Composite types use the memory
+/// info in the chunk and everything else is a reference.
+int swtisValueMemorySize(const SwtiType* type, const SwtiMemoryInfo* slot, size_t* outSize)
+{
+    type = swtisValueUnalias(type);
+
+    switch (type->type) {
+        case SwtiTypeRecord:
+            *outSize = ((const SwtiRecordType*) type)->memoryInfo.memorySize;
+            return 0;
+        case SwtiTypeTuple:
+            *outSize = ((const SwtiTupleType*) type)->memoryInfo.memorySize;
+            return 0;
+        case SwtiTypeCustom:
+            *outSize = ((const SwtiCustomType*) type)->memoryInfo.memorySize;
+            return 0;
+        default:
+            if (swtisValueIsScalar(type->type)) {
+                return swtisValueScalarSize(type, slot, outSize);
+            }
+            *outSize = sizeof(void*);
+            return 0;
+    }
+}
+
+static size_t minimumWireSize(const SwtiType* type, const SwtiMemoryInfo* slot, size_t depth)
+{
+    type = swtisValueUnalias(type);
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        return 0;
+    }
+
+    switch (type->type) {
+        case SwtiTypeString:
+        case SwtiTypeBlob:
+        case SwtiTypeList:
+        case SwtiTypeArray:
+            return 4;
+        case SwtiTypeCustom:
+            return 1;
+        case SwtiTypeRecord: {
+            const SwtiRecordType* record = (const SwtiRecordType*) type;
+            size_t total = 0;
+            for (size_t i = 0; i < record->fieldCount; ++i) {
+                total += minimumWireSize(record->fields[i].fieldType, &record->fields[i].memoryOffsetInfo.memoryInfo,
+                                         depth + 1);
+            }
+            return total;
+        }
+        case SwtiTypeTuple: {
+            const SwtiTupleType* tuple = (const SwtiTupleType*) type;
+            size_t total = 0;
+            for (size_t i = 0; i < tuple->fieldCount; ++i) {
+                total += minimumWireSize(tuple->fields[i].fieldType, &tuple->fields[i].memoryOffsetInfo.memoryInfo,
+                                         depth + 1);
+            }
+            return total;
+        }
+        default: {
+            size_t size = 0;
+            if (swtisValueIsScalar(type->type)) {
+                swtisValueScalarSize(type, slot, &size);
+            }
+            return size;
+        }
+    }
+}
+
+size_t swtisValueMinimumWireSize(const SwtiType* type, const SwtiMemoryInfo* slot)
+{
+    return minimumWireSize(type, slot, 0);
+}
+
+static int listItemInfo(const SwtiType* type, const SwtiType** outItemType, const SwtiMemoryInfo** outItemSlot)
+{
+    const SwtiMemoryInfo* info;
+
+    if (type->type == SwtiTypeList) {
+        const SwtiListType* list = (const SwtiListType*) type;
+        *outItemType = list->itemType;
+        info = &list->memoryInfo;
+    } else {
+        const SwtiArrayType* array = (const SwtiArrayType*) type;
+        *outItemType = array->itemType;
+        info = &array->memoryInfo;
+    }
+
+    if (info->memorySize == 0 && minimumWireSize(*outItemType, 0, 0) != 0) {
+        CLOG_SOFT_ERROR("value: list %d has no item layout", type->index)
+        return -4;
+    }
+
+    *outItemSlot = info;
+
+    return 0;
+}
+
+static const void* readPointer(const uint8_t* source)
+{
+    const void* pointer;
+    tc_memcpy_octets((void*) &pointer, source, sizeof(pointer));
+    return pointer;
+}
+
+static void writePointer(uint8_t* target, const void* pointer)
+{
+    tc_memcpy_octets(target, (const void*) &pointer, sizeof(pointer));
+}
+
+static int writeCount(FldOutStream* stream, size_t count)
+{
+    if (count > 0xffffffff) {
+        return -5;
+    }
+    uint8_t octets[4];
+    swtisValueWriteUInt32(octets, (uint32_t) count);
+    return fldOutStreamWriteOctets(stream, octets, 4);
+}
+
+static int readCount(FldInStream* stream, uint32_t* count)
+{
+    uint8_t octets[4];
+    int error;
+    if ((error = fldInStreamReadOctets(stream, octets, 4)) != 0) {
+        return error;
+    }
+    *count = swtisValueReadUInt32(octets);
+    return 0;
+}
+
+static int writeValue(FldOutStream* stream, const SwtiType* type, const SwtiMemoryInfo* slot, const uint8_t* source,
+                      size_t depth);
+
+static int writeFields(FldOutStream* stream, const SwtiType* owner, const uint8_t* source, size_t depth)
+{
+    int error;
+
+    if (owner->type == SwtiTypeRecord) {
+        const SwtiRecordType* record = (const SwtiRecordType*) owner;
+        for (size_t i = 0; i < record->fieldCount; ++i) {
+            const SwtiRecordTypeField* field = &record->fields[i];
+            if ((error = writeValue(stream, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                    source + field->memoryOffsetInfo.memoryOffset, depth)) != 0) {
+                return error;
+            }
+        }
+    } else {
+        const SwtiTupleType* tuple = (const SwtiTupleType*) owner;
+        for (size_t i = 0; i < tuple->fieldCount; ++i) {
+            const SwtiTupleTypeField* field = &tuple->fields[i];
+            if ((error = writeValue(stream, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                    source + field->memoryOffsetInfo.memoryOffset, depth)) != 0) {
+                return error;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int writeCustom(FldOutStream* stream, const SwtiCustomType* custom, const uint8_t* source, size_t depth)
+{
+    uint8_t variantIndex = source[0];
+    if (variantIndex >= custom->variantCount) {
+        CLOG_SOFT_ERROR("value: illegal variant %d for custom type %s", variantIndex, custom->internal.name)
+        return -6;
+    }
+
+    int error;
+    if ((error = fldOutStreamWriteUInt8(stream, variantIndex)) != 0) {
+        return error;
+    }
+
+    const SwtiCustomTypeVariant* variant = custom->variantTypes[variantIndex];
+    for (size_t i = 0; i < variant->paramCount; ++i) {
+        const SwtiCustomTypeVariantField* field = &variant->fields[i];
+        if ((error = writeValue(stream, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                source + field->memoryOffsetInfo.memoryOffset, depth)) != 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+static int writeList(FldOutStream* stream, const SwtiType* type, const uint8_t* source, size_t depth)
+{
+    const SwtiType* itemType;
+    const SwtiMemoryInfo* itemSlot;
+    int error;
+
+    if ((error = listItemInfo(type, &itemType, &itemSlot)) != 0) {
+        return error;
+    }
+
+    const SwtisValueList* list = readPointer(source);
+    size_t count = list != 0 ? list->count : 0;
+    if ((error = writeCount(stream, count)) != 0) {
+        return error;
+    }
+
+    const uint8_t* item = count != 0 ? (const uint8_t*) list->value : 0;
+    for (size_t i = 0; i < count; ++i) {
+        if ((error = writeValue(stream, itemType, itemSlot, item, depth)) != 0) {
+            return error;
+        }
+        item += itemSlot->memorySize;
+    }
+
+    return 0;
+}
+
+static int checkReferenceSlot(const SwtiType* type, const SwtiMemoryInfo* slot)
+{
+    switch (type->type) {
+        case SwtiTypeString:
+        case SwtiTypeBlob:
+        case SwtiTypeList:
+        case SwtiTypeArray:
+            if (swtisValueCheckReferenceSlot(slot) != 0) {
+                CLOG_SOFT_ERROR("value: type %d is held in %d octets, the host needs %zu for a reference", type->index,
+                                slot->memorySize, sizeof(void*))
+                return -4;
+            }
+            return 0;
+        default:
+            return 0;
+    }
+}
+
+static int writeValue(FldOutStream* stream, const SwtiType* type, const SwtiMemoryInfo* slot, const uint8_t* source,
+                      size_t depth)
+{
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        CLOG_SOFT_ERROR("value: too deep")
+        return -2;
+    }
+
+    type = swtisValueUnalias(type);
+    int error;
+
+    if ((error = checkReferenceSlot(type, slot)) != 0) {
+        return error;
+    }
+
+    switch (type->type) {
+        case SwtiTypeInt:
+        case SwtiTypeFixed:
+        case SwtiTypeBoolean:
+        case SwtiTypeChar:
+        case SwtiTypeResourceName: {
+            size_t size;
+            if ((error = swtisValueScalarSize(type, slot, &size)) != 0) {
+                return error;
+            }
+            uint8_t octets[8];
+            swtisValueCopyScalar(octets, source, size);
+            return fldOutStreamWriteOctets(stream, octets, size);
+        }
+        case SwtiTypeString: {
+            const SwtisValueString* string = readPointer(source);
+            size_t count = string != 0 ? string->characterCount : 0;
+            if ((error = writeCount(stream, count)) != 0) {
+                return error;
+            }
+            return count != 0 ? fldOutStreamWriteOctets(stream, (const uint8_t*) string->characters, count) : 0;
+        }
+        case SwtiTypeBlob: {
+            const SwtisValueBlob* blob = readPointer(source);
+            size_t count = blob != 0 ? blob->octetCount : 0;
+            if ((error = writeCount(stream, count)) != 0) {
+                return error;
+            }
+            return count != 0 ? fldOutStreamWriteOctets(stream, blob->octets, count) : 0;
+        }
+        case SwtiTypeList:
+        case SwtiTypeArray:
+            return writeList(stream, type, source, depth + 1);
+        case SwtiTypeRecord:
+        case SwtiTypeTuple:
+            return writeFields(stream, type, source, depth + 1);
+        case SwtiTypeCustom:
+            return writeCustom(stream, (const SwtiCustomType*) type, source, depth + 1);
+        default:
+            CLOG_SOFT_ERROR("value: can not serialize values of type %d", type->type)
+            return -1;
+    }
+}
+
+static int readValue(FldInStream* stream, const SwtiType* type, const SwtiMemoryInfo* slot, uint8_t* target,
+                     ImprintAllocator* allocator, size_t depth);
+
+static int readFields(FldInStream* stream, const SwtiType* owner, uint8_t* target, ImprintAllocator* allocator,
+                      size_t depth)
+{
+    int error;
+
+    if (owner->type == SwtiTypeRecord) {
+        const SwtiRecordType* record = (const SwtiRecordType*) owner;
+        tc_mem_clear(target, record->memoryInfo.memorySize);
+        for (size_t i = 0; i < record->fieldCount; ++i) {
+            const SwtiRecordTypeField* field = &record->fields[i];
+            if ((error = readValue(stream, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                   target + field->memoryOffsetInfo.memoryOffset, allocator, depth)) != 0) {
+                return error;
+            }
+        }
+    } else {
+        const SwtiTupleType* tuple = (const SwtiTupleType*) owner;
+        tc_mem_clear(target, tuple->memoryInfo.memorySize);
+        for (size_t i = 0; i < tuple->fieldCount; ++i) {
+            const SwtiTupleTypeField* field = &tuple->fields[i];
+            if ((error = readValue(stream, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                                   target + field->memoryOffsetInfo.memoryOffset, allocator, depth)) != 0) {
+                return error;
+            }
+        }
+    }
+
+    return 0;
+}
+
+static int readCustom(FldInStream* stream, const SwtiCustomType* custom, uint8_t* target, ImprintAllocator* allocator,
+                      size_t depth)
+{
+    uint8_t variantIndex;
+    int error;
+
+    if ((error = fldInStreamReadUInt8(stream, &variantIndex)) != 0) {
+        return error;
+    }
+
+    if (variantIndex >= custom->variantCount) {
+        CLOG_SOFT_ERROR("value: illegal variant %d for custom type %s", variantIndex, custom->internal.name)
+        return -6;
+    }
+
+    tc_mem_clear(target, custom->memoryInfo.memorySize);
+    target[0] = variantIndex;
+
+    const SwtiCustomTypeVariant* variant = custom->variantTypes[variantIndex];
+    for (size_t i = 0; i < variant->paramCount; ++i) {
+        const SwtiCustomTypeVariantField* field = &variant->fields[i];
+        if ((error = readValue(stream, field->fieldType, &field->memoryOffsetInfo.memoryInfo,
+                               target + field->memoryOffsetInfo.memoryOffset, allocator, depth)) != 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+static int readOctets(FldInStream* stream, uint32_t count, uint8_t** outOctets, ImprintAllocator* allocator)
+{
+    if (count > stream->size - stream->pos) {
+        return -7;
+    }
+
+    uint8_t* octets = IMPRINT_ALLOC(allocator, count + 1, "value octets");
+    int error;
+    if ((error = fldInStreamReadOctets(stream, octets, count)) != 0) {
+        return error;
+    }
+    octets[count] = 0;
+
+    *outOctets = octets;
+
+    return 0;
+}
+
+static int readList(FldInStream* stream, const SwtiType* type, uint8_t* target, ImprintAllocator* allocator,
+                    size_t depth)
+{
+    const SwtiType* itemType;
+    const SwtiMemoryInfo* itemSlot;
+    int error;
+
+    if ((error = listItemInfo(type, &itemType, &itemSlot)) != 0) {
+        return error;
+    }
+
+    size_t stride = itemSlot->memorySize;
+    uint32_t count;
+    if ((error = readCount(stream, &count)) != 0) {
+        return error;
+    }
+
+    size_t itemWireSize = minimumWireSize(itemType, itemSlot, 0);
+    size_t remaining = stream->size - stream->pos;
+    if (itemWireSize != 0 ? count > remaining / itemWireSize : count > SWTIS_VALUE_MAX_EMPTY_ITEM_COUNT) {
+        CLOG_SOFT_ERROR("value: list count %u is more than the stream can hold", count)
+        return -7;
+    }
+
+    SwtisValueList* list = IMPRINT_ALLOC_TYPE(allocator, SwtisValueList);
+    uint8_t* items = count != 0 ? IMPRINT_ALLOC(allocator, count * stride, "value list items") : 0;
+
+    list->value = items;
+    list->count = count;
+    list->itemSize = stride;
+    list->itemAlign = itemSlot->memoryAlign;
+
+    for (size_t i = 0; i < count; ++i) {
+        if ((error = readValue(stream, itemType, itemSlot, items + i * stride, allocator, depth)) != 0) {
+            return error;
+        }
+    }
+
+    writePointer(target, list);
+
+    return 0;
+}
+
+static int readValue(FldInStream* stream, const SwtiType* type, const SwtiMemoryInfo* slot, uint8_t* target,
+                     ImprintAllocator* allocator, size_t depth)
+{
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        CLOG_SOFT_ERROR("value: too deep")
+        return -2;
+    }
+
+    type = swtisValueUnalias(type);
+    int error;
+
+    if ((error = checkReferenceSlot(type, slot)) != 0) {
+        return error;
+    }
+
+    switch (type->type) {
+        case SwtiTypeInt:
+        case SwtiTypeFixed:
+        case SwtiTypeBoolean:
+        case SwtiTypeChar:
+        case SwtiTypeResourceName: {
+            size_t size;
+            if ((error = swtisValueScalarSize(type, slot, &size)) != 0) {
+                return error;
+            }
+            uint8_t octets[8];
+            if ((error = fldInStreamReadOctets(stream, octets, size)) != 0) {
+                return error;
+            }
+            swtisValueCopyScalar(target, octets, size);
+            return 0;
+        }
+        case SwtiTypeString: {
+            uint32_t count;
+            uint8_t* characters;
+            if ((error = readCount(stream, &count)) != 0) {
+                return error;
+            }
+            if ((error = readOctets(stream, count, &characters, allocator)) != 0) {
+                return error;
+            }
+            SwtisValueString* string = IMPRINT_ALLOC_TYPE(allocator, SwtisValueString);
+            string->characters = (const char*) characters;
+            string->characterCount = count;
+            writePointer(target, string);
+            return 0;
+        }
+        case SwtiTypeBlob: {
+            uint32_t count;
+            uint8_t* octets;
+            if ((error = readCount(stream, &count)) != 0) {
+                return error;
+            }
+            if ((error = readOctets(stream, count, &octets, allocator)) != 0) {
+                return error;
+            }
+            SwtisValueBlob* blob = IMPRINT_ALLOC_TYPE(allocator, SwtisValueBlob);
+            blob->octets = octets;
+            blob->octetCount = count;
+            writePointer(target, blob);
+            return 0;
+        }
+        case SwtiTypeList:
+        case SwtiTypeArray:
+            return readList(stream, type, target, allocator, depth + 1);
+        case SwtiTypeRecord:
+        case SwtiTypeTuple:
+            return readFields(stream, type, target, allocator, depth + 1);
+        case SwtiTypeCustom:
+            return readCustom(stream, (const SwtiCustomType*) type, target, allocator, depth + 1);
+        default:
+            CLOG_SOFT_ERROR("value: can not deserialize values of type %d", type->type)
+            return -1;
+    }
+}
+
+/// Like swtisSerializeValue(), for a value held in `slot` (see swtisValueScalarSize()).
+int swtisValueSerializeInSlot(FldOutStream* stream, const SwtiType* type, const SwtiMemoryInfo* slot,
+                              const void* value)
+{
+    size_t tell = stream->pos;
+    int error;
+
+    if ((error = writeValue(stream, type, slot, (const uint8_t*) value, 0)) != 0) {
+        return error;
+    }
+
+    return (int) (stream->pos - tell);
+}
+
+/// Like swtisDeserializeValue(), for a value held in `slot` (see swtisValueScalarSize()).
+int swtisValueDeserializeInSlot(FldInStream* stream, const SwtiType* type, const SwtiMemoryInfo* slot, void* target,
+                                ImprintAllocator* allocator)
+{
+    size_t tell = stream->pos;
+    int error;
+
+    if ((error = readValue(stream, type, slot, (uint8_t*) target, allocator, 0)) != 0) {
+        return error;
+    }
+
+    return (int) (stream->pos - tell);
+}
+
+/// Writes the value found at `value` in VM memory. Returns the number of octets written.
+int swtisSerializeValue(FldOutStream* stream, const SwtiType* type, const void* value)
+{
+    return swtisValueSerializeInSlot(stream, type, 0, value);
+}
+
+/// Reads a value into `target`, which must be at least the memory size of the type.
+/// Strings, blobs and list items are allocated from `allocator`. Returns the number of octets read.
+int swtisDeserializeValue(FldInStream* stream, const SwtiType* type, void* target, ImprintAllocator* allocator)
+{
+    return swtisValueDeserializeInSlot(stream, type, 0, target, allocator);
+}
@@ -0,0 +1,570 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include <clog/clog.h>
+#include <flood/out_stream.h>
+#include <swamp-typeinfo-serialize/value.h>
+#include <swamp-typeinfo-serialize/value_internal.h>
+#include <swamp-typeinfo-serialize/view.h>
+#include <swamp-typeinfo/typeinfo.h>
+#include <tiny-libc/tiny_libc.h>
+
+static const void* readPointer(const uint8_t* source)
+{
+    const void* pointer;
+    tc_memcpy_octets((void*) &pointer, source, sizeof(pointer));
+    return pointer;
+}
+
+/// `owner` is a record, tuple or custom type variant.
+static size_t fieldCount(const SwtiType* owner)
+{
+    switch (owner->type) {
+        case SwtiTypeRecord:
+            return ((const SwtiRecordType*) owner)->fieldCount;
+        case SwtiTypeTuple:
+            return ((const SwtiTupleType*) owner)->fieldCount;
+        default:
+            return ((const SwtiCustomTypeVariant*) owner)->paramCount;
+    }
+}
+
+/// `outSlot` is the memory info of the field, see swtisValueScalarSize().
+static const SwtiType* fieldAt(const SwtiType* owner, size_t index, size_t* outOffset, const SwtiMemoryInfo** outSlot)
+{
+    const SwtiMemoryOffsetInfo* offsetInfo;
+    const SwtiType* fieldType;
+
+    switch (owner->type) {
+        case SwtiTypeRecord: {
+            const SwtiRecordTypeField* field = &((const SwtiRecordType*) owner)->fields[index];
+            offsetInfo = &field->memoryOffsetInfo;
+            fieldType = field->fieldType;
+            break;
+        }
+        case SwtiTypeTuple: {
+            const SwtiTupleTypeField* field = &((const SwtiTupleType*) owner)->fields[index];
+            offsetInfo = &field->memoryOffsetInfo;
+            fieldType = field->fieldType;
+            break;
+        }
+        default: {
+            const SwtiCustomTypeVariantField* field = &((const SwtiCustomTypeVariant*) owner)->fields[index];
+            offsetInfo = &field->memoryOffsetInfo;
+            fieldType = field->fieldType;
+            break;
+        }
+    }
+
+    *outOffset = offsetInfo->memoryOffset;
+    *outSlot = &offsetInfo->memoryInfo;
+
+    return fieldType;
+}
+
+/// `outItemSlot` is the memory info of the list, the item stride.
+static const SwtiType* listItemType(const SwtiType* type, const SwtiMemoryInfo** outItemSlot)
+{
+    if (type->type == SwtiTypeList) {
+        *outItemSlot = &((const SwtiListType*) type)->memoryInfo;
+        return ((const SwtiListType*) type)->itemType;
+    }
+
+    *outItemSlot = &((const SwtiArrayType*) type)->memoryInfo;
+    return ((const SwtiArrayType*) type)->itemType;
+}
+
+static int fixedWireSize(const SwtiType* type, const SwtiMemoryInfo* slot, size_t* outSize, size_t depth);
+
+static int fixedFieldsSize(const SwtiType* owner, size_t* outSize, size_t depth)
+{
+    size_t count = fieldCount(owner);
+    size_t total = 0;
+
+    for (size_t i = 0; i < count; ++i) {
+        size_t offset;
+        const SwtiMemoryInfo* slot;
+        size_t size;
+        const SwtiType* fieldType = fieldAt(owner, i, &offset, &slot);
+        if (!fixedWireSize(fieldType, slot, &size, depth + 1)) {
+            return 0;
+        }
+        total += size;
+    }
+
+    *outSize = total;
+
+    return 1;
+}
+
+/// Returns 1 if every value of the type has the same wire size.
+static int fixedWireSize(const SwtiType* type, const SwtiMemoryInfo* slot, size_t* outSize, size_t depth)
+{
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        return 0;
+    }
+
+    type = swtisValueUnalias(type);
+
+    switch (type->type) {
+        case SwtiTypeInt:
+        case SwtiTypeFixed:
+        case SwtiTypeBoolean:
+        case SwtiTypeChar:
+        case SwtiTypeResourceName:
+            return swtisValueScalarSize(type, slot, outSize) == 0;
+        case SwtiTypeRecord:
+        case SwtiTypeTuple:
+            return fixedFieldsSize(type, outSize, depth);
+        case SwtiTypeCustom: {
+            const SwtiCustomType* custom = (const SwtiCustomType*) type;
+            size_t payloadSize = 0;
+            for (size_t i = 0; i < custom->variantCount; ++i) {
+                size_t variantSize;
+                if (!fixedFieldsSize(&custom->variantTypes[i]->internal, &variantSize, depth)) {
+                    return 0;
+                }
+                if (i > 0 && variantSize != payloadSize) {
+                    return 0;
+                }
+                payloadSize = variantSize;
+            }
+            *outSize = 1 + payloadSize;
+            return custom->variantCount > 0;
+        }
+        default:
+            return 0;
+    }
+}
+
+static int writeUInt32(FldOutStream* stream, size_t value)
+{
+    if (value > 0xffffffff) {
+        return -5;
+    }
+
+    uint8_t octets[4];
+    swtisValueWriteUInt32(octets, (uint32_t) value);
+
+    return fldOutStreamWriteOctets(stream, octets, 4);
+}
+
+static int writeOctets(FldOutStream* stream, const uint8_t* octets, size_t count)
+{
+    int error;
+    if ((error = writeUInt32(stream, count)) != 0) {
+        return error;
+    }
+
+    return count > 0 ? fldOutStreamWriteOctets(stream, octets, count) : 0;
+}
+
+/// Writes `count` zero offsets, filled in later through a stream opened with openOffsetTable().
+static int reserveOffsetTable(FldOutStream* stream, size_t count)
+{
+    if (count > (stream->size - stream->pos) / 4) {
+        return -1;
+    }
+
+    int error;
+    for (size_t i = 0; i < count; ++i) {
+        if ((error = writeUInt32(stream, 0)) != 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+static void openOffsetTable(FldOutStream* table, const FldOutStream* stream, size_t tablePos, size_t count)
+{
+    fldOutStreamInit(table, stream->octets + tablePos, count * 4);
+}
+
+static int writeView(FldOutStream* stream, const SwtiType* type, const SwtiMemoryInfo* slot, const uint8_t* source,
+                     size_t depth);
+
+static int writeFields(FldOutStream* stream, const SwtiType* owner, const uint8_t* source, size_t depth)
+{
+    size_t count = fieldCount(owner);
+    size_t fixedSize;
+    int hasTable = !fixedFieldsSize(owner, &fixedSize, depth);
+    size_t start = stream->pos;
+    FldOutStream table;
+    int error;
+
+    if (hasTable) {
+        if ((error = reserveOffsetTable(stream, count)) != 0) {
+            return error;
+        }
+        openOffsetTable(&table, stream, start, count);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (hasTable && (error = writeUInt32(&table, stream->pos - start)) != 0) {
+            return error;
+        }
+        size_t offset;
+        const SwtiMemoryInfo* slot;
+        const SwtiType* fieldType = fieldAt(owner, i, &offset, &slot);
+        if ((error = writeView(stream, fieldType, slot, source + offset, depth)) != 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+static int writeList(FldOutStream* stream, const SwtiType* type, const uint8_t* source, size_t depth)
+{
+    const SwtiMemoryInfo* itemSlot;
+    const SwtiType* itemType = listItemType(type, &itemSlot);
+    const SwtisValueList* list = readPointer(source);
+    size_t count = list != 0 ? list->count : 0;
+    size_t start = stream->pos;
+    size_t itemSize;
+    int hasTable = !fixedWireSize(itemType, itemSlot, &itemSize, depth);
+    FldOutStream table;
+    int error;
+
+    if ((error = writeUInt32(stream, count)) != 0) {
+        return error;
+    }
+
+    if (hasTable) {
+        size_t tablePos = stream->pos;
+        if ((error = reserveOffsetTable(stream, count)) != 0) {
+            return error;
+        }
+        openOffsetTable(&table, stream, tablePos, count);
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        if (hasTable && (error = writeUInt32(&table, stream->pos - start)) != 0) {
+            return error;
+        }
+        const uint8_t* item = (const uint8_t*) list->value + i * list->itemSize;
+        if ((error = writeView(stream, itemType, itemSlot, item, depth)) != 0) {
+            return error;
+        }
+    }
+
+    return 0;
+}
+
+static int writeView(FldOutStream* stream, const SwtiType* type, const SwtiMemoryInfo* slot, const uint8_t* source,
+                     size_t depth)
+{
+    if (depth > SWTIS_VALUE_MAX_DEPTH) {
+        CLOG_SOFT_ERROR("view: too deep")
+        return -2;
+    }
+
+    type = swtisValueUnalias(type);
+    int error;
+
+    switch (type->type) {
+        case SwtiTypeString:
+        case SwtiTypeBlob:
+        case SwtiTypeList:
+        case SwtiTypeArray:
+            if (swtisValueCheckReferenceSlot(slot) != 0) {
+                CLOG_SOFT_ERROR("view: type %d is held in %d octets, the host needs %zu for a reference", type->index,
+                                slot->memorySize, sizeof(void*))
+                return -4;
+            }
+            break;
+        default:
+            break;
+    }
+
+    switch (type->type) {
+        case SwtiTypeInt:
+        case SwtiTypeFixed:
+        case SwtiTypeBoolean:
+        case SwtiTypeChar:
+        case SwtiTypeResourceName: {
+            size_t size;
+            if ((error = swtisValueScalarSize(type, slot, &size)) != 0) {
+                return error;
+            }
+            uint8_t octets[8];
+            swtisValueCopyScalar(octets, source, size);
+            return fldOutStreamWriteOctets(stream, octets, size);
+        }
+        case SwtiTypeString: {
+            const SwtisValueString* string = readPointer(source);
+            return string != 0 ? writeOctets(stream, (const uint8_t*) string->characters, string->characterCount)
+                               : writeOctets(stream, 0, 0);
+        }
+        case SwtiTypeBlob: {
+            const SwtisValueBlob* blob = readPointer(source);
+            return blob != 0 ? writeOctets(stream, blob->octets, blob->octetCount) : writeOctets(stream, 0, 0);
+        }
+        case SwtiTypeList:
+        case SwtiTypeArray:
+            return writeList(stream, type, source, depth + 1);
+        case SwtiTypeRecord:
+        case SwtiTypeTuple:
+            return writeFields(stream, type, source, depth + 1);
+        case SwtiTypeCustom: {
+            const SwtiCustomType* custom = (const SwtiCustomType*) type;
+            uint8_t variantIndex = source[0];
+            if (variantIndex >= custom->variantCount) {
+                CLOG_SOFT_ERROR("view: illegal variant %d for custom type %s", variantIndex, custom->internal.name)
+                return -6;
+            }
+            if ((error = fldOutStreamWriteUInt8(stream, variantIndex)) != 0) {
+                return error;
+            }
+            return writeFields(stream, &custom->variantTypes[variantIndex]->internal, source, depth + 1);
+        }
+        default:
+            CLOG_SOFT_ERROR("view: can not serialize values of type %d", type->type)
+            return -1;
+    }
+}
+
+/// Returns the number of octets written.
+int swtisViewSerializeValue(FldOutStream* stream, const SwtiType* type, const void* value)
+{
+    size_t tell = stream->pos;
+    int error;
+
+    if ((error = writeView(stream, type, 0, (const uint8_t*) value, 0)) != 0) {
+        return error;
+    }
+
+    return (int) (stream->pos - tell);
+}
+
+static int initView(SwtisView* self, const SwtiType* type, const SwtiMemoryInfo* slot, const uint8_t* octets,
+                    size_t octetCount)
+{
+    self->type = swtisValueUnalias(type);
+    self->slot = slot;
+    self->octets = octets;
+    self->octetCount = octetCount;
+
+    return 0;
+}
+
+int swtisViewInit(SwtisView* self, const SwtiType* type, const uint8_t* octets, size_t octetCount)
+{
+    return initView(self, type, 0, octets, octetCount);
+}
+
+/// Finds the octet range of field `index` in the record, tuple or variant payload at `octets`.
+static int fieldRange(const SwtiType* owner, const uint8_t* octets, size_t octetCount, size_t index,
+                      SwtisView* outField)
+{
+    size_t count = fieldCount(owner);
+    if (index >= count) {
+        CLOG_SOFT_ERROR("view: field %zu is out of range (%zu)", index, count)
+        return -3;
+    }
+
+    size_t memoryOffset;
+    const SwtiMemoryInfo* slot;
+    const SwtiType* fieldType = fieldAt(owner, index, &memoryOffset, &slot);
+    size_t start;
+    size_t end;
+    size_t fixedSize;
+
+    if (fixedFieldsSize(owner, &fixedSize, 0)) {
+        start = 0;
+        for (size_t i = 0; i < index; ++i) {
+            const SwtiMemoryInfo* beforeSlot;
+            const SwtiType* beforeType = fieldAt(owner, i, &memoryOffset, &beforeSlot);
+            size_t size;
+            fixedWireSize(beforeType, beforeSlot, &size, 0);
+            start += size;
+        }
+        fixedWireSize(fieldType, slot, &end, 0);
+        end += start;
+    } else {
+        size_t tableSize = count * 4;
+        if (tableSize > octetCount) {
+            return -7;
+        }
+        start = swtisValueReadUInt32(octets + index * 4);
+        end = index + 1 < count ? swtisValueReadUInt32(octets + index * 4 + 4) : octetCount;
+        if (start < tableSize) {
+            return -8;
+        }
+    }
+
+    if (start > end || end > octetCount) {
+        CLOG_SOFT_ERROR("view: field %zu is outside of the value", index)
+        return -8;
+    }
+
+    return initView(outField, fieldType, slot, octets + start, end - start);
+}
+
+int swtisViewField(const SwtisView* self, size_t fieldIndex, SwtisView* outField)
+{
+    if (self->type->type != SwtiTypeRecord && self->type->type != SwtiTypeTuple) {
+        CLOG_SOFT_ERROR("view: type %d has no fields", self->type->type)
+        return -1;
+    }
+
+    return fieldRange(self->type, self->octets, self->octetCount, fieldIndex, outField);
+}
+
+int swtisViewFieldByName(const SwtisView* self, const char* name, SwtisView* outField)
+{
+    if (self->type->type != SwtiTypeRecord) {
+        CLOG_SOFT_ERROR("view: type %d has no named fields", self->type->type)
+        return -1;
+    }
+
+    const SwtiRecordType* record = (const SwtiRecordType*) self->type;
+    for (size_t i = 0; i < record->fieldCount; ++i) {
+        if (tc_str_equal(record->fields[i].name, name)) {
+            return fieldRange(self->type, self->octets, self->octetCount, i, outField);
+        }
+    }
+
+    return -3;
+}
+
+int swtisViewVariant(const SwtisView* self, uint8_t* outVariantIndex)
+{
+    if (self->type->type != SwtiTypeCustom) {
+        CLOG_SOFT_ERROR("view: type %d has no variants", self->type->type)
+        return -1;
+    }
+
+    if (self->octetCount < 1) {
+        return -7;
+    }
+
+    const SwtiCustomType* custom = (const SwtiCustomType*) self->type;
+    if (self->octets[0] >= custom->variantCount) {
+        return -6;
+    }
+
+    *outVariantIndex = self->octets[0];
+
+    return 0;
+}
+
+int swtisViewVariantField(const SwtisView* self, size_t fieldIndex, SwtisView* outField)
+{
+    uint8_t variantIndex;
+    int error;
+
+    if ((error = swtisViewVariant(self, &variantIndex)) != 0) {
+        return error;
+    }
+
+    const SwtiCustomType* custom = (const SwtiCustomType*) self->type;
+
+    return fieldRange(&custom->variantTypes[variantIndex]->internal, self->octets + 1, self->octetCount - 1,
+                      fieldIndex, outField);
+}
+
+int swtisViewListCount(const SwtisView* self, size_t* outCount)
+{
+    if (self->type->type != SwtiTypeList && self->type->type != SwtiTypeArray) {
+        CLOG_SOFT_ERROR("view: type %d is not a list", self->type->type)
+        return -1;
+    }
+
+    if (self->octetCount < 4) {
+        return -7;
+    }
+
+    *outCount = swtisValueReadUInt32(self->octets);
+
+    return 0;
+}
+
+int swtisViewListItem(const SwtisView* self, size_t index, SwtisView* outItem)
+{
+    size_t count;
+    int error;
+
+    if ((error = swtisViewListCount(self, &count)) != 0) {
+        return error;
+    }
+
+    if (index >= count) {
+        CLOG_SOFT_ERROR("view: item %zu is out of range (%zu)", index, count)
+        return -3;
+    }
+
+    const SwtiMemoryInfo* itemSlot;
+    const SwtiType* itemType = listItemType(self->type, &itemSlot);
+    size_t available = self->octetCount - 4;
+    size_t itemSize;
+    size_t start;
+    size_t end;
+
+    if (fixedWireSize(itemType, itemSlot, &itemSize, 0)) {
+        if (itemSize != 0 && count > available / itemSize) {
+            return -7;
+        }
+        start = 4 + index * itemSize;
+        end = start + itemSize;
+    } else {
+        if (count > available / 4) {
+            return -7;
+        }
+        size_t tableEnd = 4 + count * 4;
+        start = swtisValueReadUInt32(self->octets + 4 + index * 4);
+        end = index + 1 < count ? swtisValueReadUInt32(self->octets + 4 + index * 4 + 4) : self->octetCount;
+        if (start < tableEnd || start > end || end > self->octetCount) {
+            CLOG_SOFT_ERROR("view: item %zu is outside of the list", index)
+            return -8;
+        }
+    }
+
+    return initView(outItem, itemType, itemSlot, self->octets + start, end - start);
+}
+
+int swtisViewScalar(const SwtisView* self, void* target)
+{
+    if (!swtisValueIsScalar(self->type->type)) {
+        CLOG_SOFT_ERROR("view: type %d is not a scalar", self->type->type)
+        return -1;
+    }
+
+    size_t size;
+    int error;
+    if ((error = swtisValueScalarSize(self->type, self->slot, &size)) != 0) {
+        return error;
+    }
+
+    if (self->octetCount < size) {
+        return -7;
+    }
+
+    swtisValueCopyScalar((uint8_t*) target, self->octets, size);
+
+    return 0;
+}
+
+int swtisViewOctets(const SwtisView* self, const uint8_t** outOctets, size_t* outCount)
+{
+    if (self->type->type != SwtiTypeString && self->type->type != SwtiTypeBlob) {
+        CLOG_SOFT_ERROR("view: type %d is not a string or blob", self->type->type)
+        return -1;
+    }
+
+    if (self->octetCount < 4) {
+        return -7;
+    }
+
+    size_t count = swtisValueReadUInt32(self->octets);
+    if (count > self->octetCount - 4) {
+        return -7;
+    }
+
+    *outOctets = self->octets + 4;
+    *outCount = count;
+
+    return 0;
+}
@@ -0,0 +1,41 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "codegen_fixture.h"
+
+#include <swamp-typeinfo-serialize/serialize.h>
+
+// Writes the serialized fixture chunk to the file given, for swtis-codegen to read.
+int main(int argc, char* argv[])
+{
+    if (argc != 2) {
+        fprintf(stderr, "usage: swtis_codegen_fixture <output.swamp-typeinfo>\n");
+        return 1;
+    }
+
+    swtisTestAllocator();
+    static SwtisTestCodegenFixture fixture;
+    swtisTestCodegenFixtureInit(&fixture);
+
+    static uint8_t octets[4096];
+    int written = swtisSerialize(octets, sizeof(octets), &fixture.chunk);
+    if (written < 0) {
+        fprintf(stderr, "swtis_codegen_fixture: could not serialize (%d)\n", written);
+        return 1;
+    }
+
+    FILE* out = fopen(argv[1], "wb");
+    if (out == 0) {
+        fprintf(stderr, "swtis_codegen_fixture: can not create '%s'\n", argv[1]);
+        return 1;
+    }
+    size_t octetsWritten = fwrite(octets, 1, (size_t) written, out);
+    if (fclose(out) != 0 || octetsWritten != (size_t) written) {
+        fprintf(stderr, "swtis_codegen_fixture: could not write '%s'\n", argv[1]);
+        remove(argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_TESTS_CODEGEN_FIXTURE_H
+#define SWAMP_TYPEINFO_SERIALIZE_TESTS_CODEGEN_FIXTURE_H
+
+#include "utils.h"
+
+#include <swamp-typeinfo-serialize/layout.h>
+
+// The chunk that swtis-codegen is run on, built by codegen_fixture.c and again by the test that compares it with the
+// generated one.
+
+typedef struct SwtisTestCodegenFixture {
+    SwtiIntType intType;
+    SwtiBooleanType boolType;
+    SwtiStringType stringType;
+    SwtiCustomTypeVariant nothingVariant;
+    SwtiCustomTypeVariant justVariant;
+    SwtiCustomTypeVariantField justFields[1];
+    const SwtiCustomTypeVariant* maybeVariants[2];
+    const SwtiType* maybeGenerics[1];
+    SwtiCustomType maybeType;
+    SwtiRecordTypeField recordFields[3];
+    SwtiRecordType recordType;
+    SwtiListType listType;
+    SwtiTupleTypeField tupleFields[2];
+    SwtiTupleType tupleType;
+    SwtiAliasType aliasType;
+    const SwtiType* parameterTypes[2];
+    SwtiFunctionType functionType;
+    SwtiTypeRefIdType refIdType;
+    SwtiUnmanagedType unmanagedType;
+    const SwtiType* types[13];
+    SwtiChunk chunk;
+} SwtisTestCodegenFixture;
+
+#define SWTIS_TEST_CODEGEN_FIXTURE_TYPE_COUNT (13)
+
+/// Every kind that swtis-codegen writes something special for, and names that have to be escaped.
+static void swtisTestCodegenFixtureInit(SwtisTestCodegenFixture* self)
+{
+    swtisTestInitType(&self->intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&self->boolType.internal, SwtiTypeBoolean, "Bool");
+    swtisTestInitType(&self->stringType.internal, SwtiTypeString, "String");
+
+    swtisTestInitType(&self->nothingVariant.internal, SwtiTypeCustomVariant, "Nothing");
+    self->nothingVariant.name = "Nothing";
+    self->nothingVariant.inCustomType = &self->maybeType;
+    self->nothingVariant.fields = 0;
+    self->nothingVariant.paramCount = 0;
+    swtisTestInitType(&self->justVariant.internal, SwtiTypeCustomVariant, "Just");
+    self->justVariant.name = "Just";
+    self->justVariant.inCustomType = &self->maybeType;
+    self->justFields[0].fieldType = &self->intType.internal;
+    self->justVariant.fields = self->justFields;
+    self->justVariant.paramCount = 1;
+    self->maybeVariants[0] = &self->nothingVariant;
+    self->maybeVariants[1] = &self->justVariant;
+    self->maybeGenerics[0] = &self->intType.internal;
+    swtisTestInitType(&self->maybeType.internal, SwtiTypeCustom, "Maybe");
+    self->maybeType.generic.genericTypes = self->maybeGenerics;
+    self->maybeType.generic.genericCount = 1;
+    self->maybeType.variantTypes = self->maybeVariants;
+    self->maybeType.variantCount = 2;
+
+    swtisTestInitType(&self->recordType.internal, SwtiTypeRecord, "Record");
+    self->recordFields[0].name = "a";
+    self->recordFields[0].fieldType = &self->intType.internal;
+    self->recordFields[1].name = "say \"hi\"\\";
+    self->recordFields[1].fieldType = &self->stringType.internal;
+    self->recordFields[2].name = "m\t1";
+    self->recordFields[2].fieldType = &self->maybeType.internal;
+    self->recordType.fields = self->recordFields;
+    self->recordType.fieldCount = 3;
+    swtisTestInitType(&self->listType.internal, SwtiTypeList, "List");
+    self->listType.itemType = &self->recordType.internal;
+
+    swtisTestInitType(&self->tupleType.internal, SwtiTypeTuple, "Tuple");
+    self->tupleFields[0].name = "first";
+    self->tupleFields[0].fieldType = &self->boolType.internal;
+    self->tupleFields[1].name = "second";
+    self->tupleFields[1].fieldType = &self->intType.internal;
+    self->tupleType.fields = self->tupleFields;
+    self->tupleType.fieldCount = 2;
+
+    swtisTestInitType(&self->aliasType.internal, SwtiTypeAlias, "Player\xc3\xa9");
+    self->aliasType.targetType = &self->recordType.internal;
+
+    swtisTestInitType(&self->functionType.internal, SwtiTypeFunction, "Function");
+    self->parameterTypes[0] = &self->intType.internal;
+    self->parameterTypes[1] = &self->boolType.internal;
+    self->functionType.parameterTypes = self->parameterTypes;
+    self->functionType.parameterCount = 2;
+
+    swtisTestInitType(&self->refIdType.internal, SwtiTypeRefId, "TypeRef");
+    self->refIdType.referencedType = &self->aliasType.internal;
+    swtisTestInitType(&self->unmanagedType.internal, SwtiTypeUnmanaged, "Handle");
+    self->unmanagedType.userTypeId = 7;
+
+    // Referred to before they are declared, so the generated source has to declare every type first
+    self->types[0] = &self->refIdType.internal;
+    self->types[1] = &self->aliasType.internal;
+    self->types[2] = &self->listType.internal;
+    self->types[3] = &self->recordType.internal;
+    self->types[4] = &self->maybeType.internal;
+    self->types[5] = &self->nothingVariant.internal;
+    self->types[6] = &self->justVariant.internal;
+    self->types[7] = &self->intType.internal;
+    self->types[8] = &self->boolType.internal;
+    self->types[9] = &self->stringType.internal;
+    self->types[10] = &self->tupleType.internal;
+    self->types[11] = &self->functionType.internal;
+    self->types[12] = &self->unmanagedType.internal;
+    swtisTestInitChunk(&self->chunk, self->types, SWTIS_TEST_CODEGEN_FIXTURE_TYPE_COUNT);
+    swtisLayoutCompute(&self->chunk, SWTIS_LAYOUT_PROFILE_HOST);
+}
+
+#endif
@@ -0,0 +1,107 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/archive.h>
+#include <swamp-typeinfo-serialize/layout.h>
+
+static SwtiIntType intType;
+static SwtiStringType stringType;
+static SwtiRecordTypeField fields[2];
+static SwtiRecordType recordType;
+static const SwtiType* types[3];
+static SwtiChunk chunk;
+
+static void buildChunk(void)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+    swtisTestInitType(&recordType.internal, SwtiTypeRecord, "Player");
+    fields[0].name = "score";
+    fields[0].fieldType = &intType.internal;
+    fields[1].name = "name";
+    fields[1].fieldType = &stringType.internal;
+    recordType.fields = fields;
+    recordType.fieldCount = 2;
+
+    types[0] = &intType.internal;
+    types[1] = &stringType.internal;
+    types[2] = &recordType.internal;
+    swtisTestInitChunk(&chunk, types, 3);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+}
+
+static void testRoundTrip(void)
+{
+    buildChunk();
+
+    SwtisArchiveWriter* writer = swtisArchiveWriterCreate(0);
+    SWTIS_TEST_EXPECT(swtisArchiveWriterAdd(writer, "game", &chunk) == 0)
+    swtisTestInitChunk(&chunk, types, 2);
+    SWTIS_TEST_EXPECT(swtisArchiveWriterAdd(writer, "basics", &chunk) == 0)
+
+    static uint8_t octets[1024];
+    size_t octetCount = swtisArchiveWriterOctetCount(writer);
+    SWTIS_TEST_EXPECT(octetCount <= sizeof(octets))
+    SWTIS_TEST_EXPECT(swtisArchiveWriterWrite(writer, octets, sizeof(octets)) == (int) octetCount)
+    SWTIS_TEST_EXPECT(swtisArchiveWriterWrite(writer, octets, octetCount - 1) < 0)
+    swtisArchiveWriterDestroy(writer);
+
+    SwtisArchive archive;
+    SWTIS_TEST_EXPECT(swtisArchiveInit(&archive, octets, octetCount) == 0)
+    SWTIS_TEST_EXPECT(archive.moduleCount == 2)
+
+    // The index is sorted by name
+    SwtisArchiveModule module;
+    SWTIS_TEST_EXPECT(swtisArchiveModuleAt(&archive, 0, &module) == 0 && strcmp(module.name, "basics") == 0)
+    SWTIS_TEST_EXPECT(swtisArchiveModuleAt(&archive, 1, &module) == 0 && strcmp(module.name, "game") == 0)
+    SWTIS_TEST_EXPECT(swtisArchiveModuleAt(&archive, 2, &module) < 0)
+    SWTIS_TEST_EXPECT(swtisArchiveFind(&archive, "missing", &module) == -1)
+    SwtisArchiveModule basics;
+    SWTIS_TEST_EXPECT(swtisArchiveFind(&archive, "basics", &basics) == 0)
+    SWTIS_TEST_EXPECT(swtisArchiveFind(&archive, "game", &module) == 0 && module.hash != basics.hash)
+
+    SwtiChunk target;
+    SWTIS_TEST_EXPECT(swtisArchiveDeserialize(&archive, &module, &target, swtisTestAllocator(), 0) == 0)
+    SWTIS_TEST_EXPECT(target.typeCount == 3)
+    const SwtiRecordType* record = (const SwtiRecordType*) target.types[2];
+    SWTIS_TEST_EXPECT(record->internal.type == SwtiTypeRecord && record->fieldCount == 2 && strcmp(record->fields[0].name, "score") == 0 &&
+                      strcmp(record->fields[1].name, "name") == 0)
+    SWTIS_TEST_EXPECT(record->fields[1].fieldType == target.types[1])
+
+    swtisArchiveDestroy(&archive);
+
+    // Index entries are checked when they are looked up
+    static const size_t chunkOffsetPosition = SWTIS_ARCHIVE_HEADER_OCTET_COUNT + 4;
+    octets[chunkOffsetPosition] = 0x7f;
+    SWTIS_TEST_EXPECT(swtisArchiveInit(&archive, octets, octetCount) == 0)
+    SWTIS_TEST_EXPECT(swtisArchiveModuleAt(&archive, 0, &module) == -6)
+    SWTIS_TEST_EXPECT(swtisArchiveModuleAt(&archive, 1, &module) == 0)
+
+    octets[0] = 'X';
+    SWTIS_TEST_EXPECT(swtisArchiveInit(&archive, octets, octetCount) == -6)
+}
+
+static void testDuplicateName(void)
+{
+    buildChunk();
+
+    SwtisArchiveWriter* writer = swtisArchiveWriterCreate(0);
+    SWTIS_TEST_EXPECT(swtisArchiveWriterAdd(writer, "game", &chunk) == 0)
+    SWTIS_TEST_EXPECT(swtisArchiveWriterAdd(writer, "game", &chunk) == 0)
+
+    static uint8_t octets[1024];
+    SWTIS_TEST_EXPECT(swtisArchiveWriterWrite(writer, octets, sizeof(octets)) == -6)
+    swtisArchiveWriterDestroy(writer);
+}
+
+int main(void)
+{
+    testRoundTrip();
+    testDuplicateName();
+
+    return swtisTestResult("archive");
+}
@@ -0,0 +1,179 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <flood/in_stream.h>
+#include <flood/out_stream.h>
+#include <string.h>
+#include <swamp-typeinfo-serialize/bitpack.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/value.h>
+
+typedef struct Item {
+    int32_t a;
+    uint8_t b;
+    const SwtisValueString* name;
+} Item;
+
+static const void* readPointer(const uint8_t* source)
+{
+    const void* pointer;
+    memcpy((void*) &pointer, source, sizeof(pointer));
+    return pointer;
+}
+
+/// Empty records and single variant custom types without fields take no bits, a list of them is only the count.
+static void testListsOfItemsWithoutBits(void)
+{
+    static SwtiRecordType emptyType;
+    static SwtiListType emptyListType;
+    static SwtiCustomTypeVariant variant;
+    static const SwtiCustomTypeVariant* variants[1];
+    static SwtiCustomType unitType;
+    static SwtiListType unitListType;
+    static const SwtiType* types[5];
+    SwtiChunk chunk;
+
+    swtisTestInitType(&emptyType.internal, SwtiTypeRecord, "Empty");
+    emptyType.fields = 0;
+    emptyType.fieldCount = 0;
+    swtisTestInitType(&emptyListType.internal, SwtiTypeList, "List");
+    emptyListType.itemType = &emptyType.internal;
+    swtisTestInitType(&variant.internal, SwtiTypeCustomVariant, "Unit");
+    variant.name = "Unit";
+    variant.inCustomType = &unitType;
+    variant.fields = 0;
+    variant.paramCount = 0;
+    variants[0] = &variant;
+    swtisTestInitType(&unitType.internal, SwtiTypeCustom, "Unit");
+    unitType.generic.genericTypes = 0;
+    unitType.generic.genericCount = 0;
+    unitType.variantTypes = variants;
+    unitType.variantCount = 1;
+    swtisTestInitType(&unitListType.internal, SwtiTypeList, "List");
+    unitListType.itemType = &unitType.internal;
+
+    types[0] = &emptyType.internal;
+    types[1] = &emptyListType.internal;
+    types[2] = &unitType.internal;
+    types[3] = &variant.internal;
+    types[4] = &unitListType.internal;
+    swtisTestInitChunk(&chunk, types, 5);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+
+    const SwtiType* listTypes[2] = {&emptyListType.internal, &unitListType.internal};
+    for (size_t i = 0; i < 2; ++i) {
+        static uint8_t items[1000];
+        memset(items, 0, sizeof(items));
+        SwtisValueList list = {items, 1000, 1, 1};
+        const SwtisValueList* listPointer = &list;
+
+        uint8_t octets[16];
+        FldOutStream outStream;
+        fldOutStreamInit(&outStream, octets, sizeof(octets));
+        int written = swtisBitPackSerializeValue(&outStream, listTypes[i], &listPointer);
+        SWTIS_TEST_EXPECT(written == 3)
+
+        uint8_t target[sizeof(void*)];
+        FldInStream inStream;
+        fldInStreamInit(&inStream, octets, (size_t) written);
+        SWTIS_TEST_EXPECT(swtisBitPackDeserializeValue(&inStream, listTypes[i], target, swtisTestAllocator()) ==
+                          written)
+        const SwtisValueList* readBack = readPointer(target);
+        SWTIS_TEST_EXPECT(readBack->count == 1000)
+
+        // Far more than any sane list, and it would not cost a single octet more
+        static const uint8_t tooMany[] = {0xff, 0xff, 0xff, 0xff, 0xff};
+        fldInStreamInit(&inStream, tooMany, sizeof(tooMany));
+        SWTIS_TEST_EXPECT(swtisBitPackDeserializeValue(&inStream, listTypes[i], target, swtisTestAllocator()) == -7)
+    }
+}
+
+static void testRoundTrip(void)
+{
+    static SwtiIntType intType;
+    static SwtiBooleanType boolType;
+    static SwtiStringType stringType;
+    static SwtiRecordTypeField fields[3];
+    static SwtiRecordType record;
+    static SwtiListType list;
+    static const SwtiType* types[5];
+    SwtiChunk chunk;
+
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&boolType.internal, SwtiTypeBoolean, "Bool");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+    swtisTestInitType(&record.internal, SwtiTypeRecord, "Item");
+    fields[0].name = "a";
+    fields[0].fieldType = &intType.internal;
+    fields[1].name = "b";
+    fields[1].fieldType = &boolType.internal;
+    fields[2].name = "name";
+    fields[2].fieldType = &stringType.internal;
+    record.fields = fields;
+    record.fieldCount = 3;
+    swtisTestInitType(&list.internal, SwtiTypeList, "List");
+    list.itemType = &record.internal;
+
+    types[0] = &intType.internal;
+    types[1] = &boolType.internal;
+    types[2] = &stringType.internal;
+    types[3] = &record.internal;
+    types[4] = &list.internal;
+    swtisTestInitChunk(&chunk, types, 5);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+    SWTIS_TEST_EXPECT(record.memoryInfo.memorySize == sizeof(Item))
+
+    enum { ItemCount = 100 };
+    static Item items[ItemCount];
+    static SwtisValueString names[3] = {{"", 0}, {"a", 1}, {"item", 4}};
+    for (size_t i = 0; i < ItemCount; ++i) {
+        items[i].a = (int32_t) i - 50;
+        items[i].b = (uint8_t) (i & 1);
+        items[i].name = &names[i % 3];
+    }
+    items[0].a = -0x7fffffff - 1;
+    SwtisValueList value = {items, ItemCount, sizeof(Item), sizeof(void*)};
+    const SwtisValueList* valuePointer = &value;
+
+    static uint8_t octets[2048];
+    FldOutStream outStream;
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    int written = swtisBitPackSerializeValue(&outStream, &list.internal, &valuePointer);
+    SWTIS_TEST_EXPECT(written > 0)
+
+    // The byte aligned format of the same list is 1069 octets, the bit packed one 374
+    static uint8_t aligned[2048];
+    fldOutStreamInit(&outStream, aligned, sizeof(aligned));
+    SWTIS_TEST_EXPECT(swtisSerializeValue(&outStream, &list.internal, &valuePointer) == 1069)
+    SWTIS_TEST_EXPECT(written == 374)
+
+    const SwtisValueList* readBack = 0;
+    FldInStream inStream;
+    fldInStreamInit(&inStream, octets, (size_t) written);
+    SWTIS_TEST_EXPECT(swtisBitPackDeserializeValue(&inStream, &list.internal, &readBack, swtisTestAllocator()) ==
+                      written)
+    SWTIS_TEST_EXPECT(readBack != 0 && readBack->count == ItemCount)
+    const Item* readItems = readBack->value;
+    for (size_t i = 0; i < ItemCount; ++i) {
+        SWTIS_TEST_EXPECT(readItems[i].a == items[i].a && readItems[i].b == items[i].b &&
+                          readItems[i].name->characterCount == items[i].name->characterCount &&
+                          memcmp(readItems[i].name->characters, items[i].name->characters,
+                                 items[i].name->characterCount) == 0)
+    }
+
+    for (size_t cut = 0; cut < (size_t) written; cut += 7) {
+        fldInStreamInit(&inStream, octets, cut);
+        SWTIS_TEST_EXPECT(swtisBitPackDeserializeValue(&inStream, &list.internal, &readBack, swtisTestAllocator()) < 0)
+    }
+}
+
+int main(void)
+{
+    testListsOfItemsWithoutBits();
+    testRoundTrip();
+
+    return swtisTestResult("bitpack");
+}
@@ -0,0 +1,102 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+extern "C" {
+#include "utils.h"
+
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo-serialize/serialize.h>
+}
+
+#include <cstring>
+#include <swamp-typeinfo-serialize/builder.hpp>
+
+struct Vec2 {
+    int32_t x;
+    int32_t y;
+};
+
+struct Player {
+    int32_t score;
+    bool alive;
+    Vec2 position;
+    swtis::Fixed speed;
+    char32_t initial;
+};
+
+struct Handle;
+
+template <>
+struct swtis::Describe<Vec2> {
+    static constexpr const char* name = "Vec2";
+    static constexpr auto fields = swtis::fields(SWTIS_FIELD(Vec2, x), SWTIS_FIELD(Vec2, y));
+};
+
+template <>
+struct swtis::Describe<Player> {
+    static constexpr const char* name = "Player";
+    static constexpr auto fields = swtis::fields(SWTIS_FIELD(Player, score), SWTIS_FIELD(Player, alive),
+                                                 SWTIS_FIELD(Player, position), SWTIS_FIELD(Player, speed),
+                                                 SWTIS_FIELD(Player, initial));
+};
+
+template <>
+struct swtis::Describe<Handle> {
+    static constexpr const char* name = "Handle";
+    static constexpr uint16_t userTypeId = 3;
+};
+
+using HostTypes = swtis::Typeinfo<Player, Handle>;
+
+static_assert(HostTypes::octets[0] == SWTI_SERIALIZE_VERSION_MAJOR, "built at compile time");
+
+static const SwtiRecordType* recordOf(const SwtiChunk& chunk, uint16_t aliasIndex)
+{
+    const SwtiType* alias = chunk.types[aliasIndex];
+    SWTIS_TEST_EXPECT(alias->type == SwtiTypeAlias)
+    const SwtiType* target = reinterpret_cast<const SwtiAliasType*>(alias)->targetType;
+    SWTIS_TEST_EXPECT(target->type == SwtiTypeRecord)
+    return reinterpret_cast<const SwtiRecordType*>(target);
+}
+
+/// The chunk has the layout of the C++ compiler, and serializes back to the octets that were built.
+static void testRoundTrip()
+{
+    SwtiChunk chunk;
+    int octetCount = static_cast<int>(HostTypes::octets.size());
+    SWTIS_TEST_EXPECT(swtisDeserialize(HostTypes::octets.data(), HostTypes::octets.size(), &chunk,
+                                       swtisTestAllocator()) == octetCount)
+
+    const SwtiRecordType* player = recordOf(chunk, HostTypes::indexOf<Player>());
+    SWTIS_TEST_EXPECT(std::strcmp(chunk.types[HostTypes::indexOf<Player>()]->name, "Player") == 0)
+    SWTIS_TEST_EXPECT(player->memoryInfo.memorySize == sizeof(Player) && player->memoryInfo.memoryAlign == alignof(Player))
+    SWTIS_TEST_EXPECT(player->fieldCount == 5)
+    const size_t offsets[5] = {offsetof(Player, score), offsetof(Player, alive), offsetof(Player, position),
+                               offsetof(Player, speed), offsetof(Player, initial)};
+    const SwtiTypeValue kinds[5] = {SwtiTypeInt, SwtiTypeBoolean, SwtiTypeRecord, SwtiTypeFixed, SwtiTypeChar};
+    for (size_t i = 0; i < 5; ++i) {
+        SWTIS_TEST_EXPECT(player->fields[i].memoryOffsetInfo.memoryOffset == offsets[i])
+        SWTIS_TEST_EXPECT(player->fields[i].fieldType->type == kinds[i])
+    }
+    SWTIS_TEST_EXPECT(std::strcmp(player->fields[2].name, "position") == 0)
+    // Fields refer to the record itself, not to the alias with its name
+    const SwtiRecordType* vec2 = recordOf(chunk, HostTypes::indexOf<Vec2>());
+    SWTIS_TEST_EXPECT(player->fields[2].fieldType == &vec2->internal)
+    SWTIS_TEST_EXPECT(vec2->memoryInfo.memorySize == sizeof(Vec2) && vec2->fieldCount == 2)
+
+    const SwtiType* handle = chunk.types[HostTypes::indexOf<Handle>()];
+    SWTIS_TEST_EXPECT(handle->type == SwtiTypeUnmanaged &&
+                      reinterpret_cast<const SwtiUnmanagedType*>(handle)->userTypeId == 3)
+
+    static uint8_t again[1024];
+    SWTIS_TEST_EXPECT(swtisSerialize(again, sizeof(again), &chunk) == octetCount)
+    SWTIS_TEST_EXPECT(std::memcmp(again, HostTypes::octets.data(), HostTypes::octets.size()) == 0)
+}
+
+int main()
+{
+    testRoundTrip();
+
+    return swtisTestResult("builder");
+}
@@ -0,0 +1,155 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/cache.h>
+#include <swamp-typeinfo-serialize/serialize.h>
+
+typedef struct Blob {
+    uint8_t octets[64];
+    size_t octetCount;
+} Blob;
+
+static SwtiIntType intType;
+static SwtiBooleanType boolType;
+static SwtiStringType stringType;
+static const SwtiType* types[3];
+
+/// Three different blobs, with the first one, two and three types.
+static Blob blobs[3];
+
+static void buildBlobs(void)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&boolType.internal, SwtiTypeBoolean, "Bool");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+    types[0] = &intType.internal;
+    types[1] = &boolType.internal;
+    types[2] = &stringType.internal;
+
+    for (size_t i = 0; i < 3; ++i) {
+        SwtiChunk chunk;
+        swtisTestInitChunk(&chunk, types, i + 1);
+        int written = swtisSerialize(blobs[i].octets, sizeof(blobs[i].octets), &chunk);
+        SWTIS_TEST_EXPECT(written > 0)
+        blobs[i].octetCount = (size_t) written;
+    }
+}
+
+static int acquire(SwtisCache* cache, size_t blobIndex, SwtisCacheEntry** outEntry)
+{
+    return swtisCacheAcquire(cache, blobs[blobIndex].octets, blobs[blobIndex].octetCount, outEntry);
+}
+
+static void testHitsAndEntryLimit(void)
+{
+    SwtisCacheOptions options;
+    memset(&options, 0, sizeof(options));
+    options.maxEntryCount = 2;
+    options.memoryBudget = 1024 * 1024;
+    SwtisCache* cache = swtisCacheCreate(&options);
+
+    SwtisCacheEntry* first;
+    SwtisCacheEntry* again;
+    SwtisCacheEntry* second;
+    SWTIS_TEST_EXPECT(acquire(cache, 0, &first) == 0)
+    SWTIS_TEST_EXPECT(swtisCacheEntryChunk(first)->typeCount == 1)
+    SWTIS_TEST_EXPECT(acquire(cache, 0, &again) == 0 && again == first)
+    SWTIS_TEST_EXPECT(acquire(cache, 1, &second) == 0 && second != first)
+    SWTIS_TEST_EXPECT(swtisCacheEntryChunk(second)->typeCount == 2)
+
+    // Every entry is acquired, so there is nothing to evict
+    SwtisCacheEntry* third;
+    SWTIS_TEST_EXPECT(acquire(cache, 2, &third) == -4)
+
+    SwtisCacheStats stats;
+    swtisCacheStats(cache, &stats);
+    SWTIS_TEST_EXPECT(stats.entryCount == 2 && stats.hitCount == 1 && stats.missCount == 3 &&
+                      stats.evictionCount == 0)
+
+    // The first blob was used longest ago
+    swtisCacheRelease(cache, first);
+    swtisCacheRelease(cache, again);
+    swtisCacheRelease(cache, second);
+    SWTIS_TEST_EXPECT(acquire(cache, 2, &third) == 0 && swtisCacheEntryChunk(third)->typeCount == 3)
+    SWTIS_TEST_EXPECT(acquire(cache, 1, &second) == 0)
+    swtisCacheStats(cache, &stats);
+    SWTIS_TEST_EXPECT(stats.entryCount == 2 && stats.hitCount == 2 && stats.missCount == 4 &&
+                      stats.evictionCount == 1)
+
+    swtisCacheRelease(cache, second);
+    swtisCacheRelease(cache, third);
+    swtisCacheDestroy(cache);
+}
+
+static void testMemoryBudget(void)
+{
+    SwtisCacheOptions options;
+    memset(&options, 0, sizeof(options));
+    options.maxEntryCount = 8;
+    options.memoryBudget = blobs[2].octetCount * SWTIS_CACHE_MEMORY_FACTOR;
+    SwtisCache* cache = swtisCacheCreate(&options);
+
+    SwtisCacheEntry* entry;
+    SWTIS_TEST_EXPECT(acquire(cache, 2, &entry) == 0)
+    swtisCacheRelease(cache, entry);
+    SWTIS_TEST_EXPECT(acquire(cache, 0, &entry) == 0)
+    swtisCacheRelease(cache, entry);
+
+    SwtisCacheStats stats;
+    swtisCacheStats(cache, &stats);
+    SWTIS_TEST_EXPECT(stats.entryCount == 1 && stats.evictionCount == 1 && stats.memoryUsed <= options.memoryBudget)
+
+    // The acquired entry can not be evicted, so the next miss does not fit
+    SwtisCacheEntry* held;
+    SWTIS_TEST_EXPECT(acquire(cache, 0, &held) == 0)
+    SWTIS_TEST_EXPECT(acquire(cache, 2, &entry) == -5)
+    swtisCacheStats(cache, &stats);
+    SWTIS_TEST_EXPECT(stats.entryCount == 1 && stats.memoryUsed <= options.memoryBudget)
+    swtisCacheRelease(cache, held);
+    SWTIS_TEST_EXPECT(acquire(cache, 2, &entry) == 0)
+    swtisCacheRelease(cache, entry);
+
+    swtisCacheDestroy(cache);
+
+    // A chunk larger than the whole budget is never cached
+    options.memoryBudget = blobs[2].octetCount * SWTIS_CACHE_MEMORY_FACTOR - 1;
+    cache = swtisCacheCreate(&options);
+    SWTIS_TEST_EXPECT(acquire(cache, 2, &entry) == -5)
+    swtisCacheStats(cache, &stats);
+    SWTIS_TEST_EXPECT(stats.entryCount == 0 && stats.memoryUsed == 0)
+    swtisCacheDestroy(cache);
+}
+
+static void testBadBlob(void)
+{
+    SwtisCacheOptions options;
+    memset(&options, 0, sizeof(options));
+    options.maxEntryCount = 2;
+    options.memoryBudget = 1024 * 1024;
+    SwtisCache* cache = swtisCacheCreate(&options);
+
+    SwtisCacheEntry* entry;
+    SWTIS_TEST_EXPECT(swtisCacheAcquire(cache, blobs[2].octets, blobs[2].octetCount - 1, &entry) < 0)
+
+    SwtisCacheStats stats;
+    swtisCacheStats(cache, &stats);
+    SWTIS_TEST_EXPECT(stats.entryCount == 0 && stats.memoryUsed == 0)
+
+    swtisCacheDestroy(cache);
+}
+
+int main(void)
+{
+    // The cache has its own memory, this only sets up the logging
+    swtisTestAllocator();
+    buildBlobs();
+    testHitsAndEntryLimit();
+    testMemoryBudget();
+    testBadBlob();
+
+    return swtisTestResult("cache");
+}
@@ -0,0 +1,121 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+extern "C" {
+#include "utils.h"
+}
+
+#include <string>
+#include <swamp-typeinfo-serialize/builder.hpp>
+#include <swamp-typeinfo-serialize/chunk.hpp>
+#include <vector>
+
+struct Vec2 {
+    int32_t x;
+    int32_t y;
+};
+
+struct Handle;
+
+template <>
+struct swtis::Describe<Vec2> {
+    static constexpr const char* name = "Vec2";
+    static constexpr auto fields = swtis::fields(SWTIS_FIELD(Vec2, x), SWTIS_FIELD(Vec2, y));
+};
+
+template <>
+struct swtis::Describe<Handle> {
+    static constexpr const char* name = "Handle";
+    static constexpr uint16_t userTypeId = 3;
+};
+
+using HostTypes = swtis::Typeinfo<Vec2, Handle>;
+
+static std::vector<std::string> used;
+
+static void use(std::string_view recordName, std::string_view fieldName)
+{
+    used.emplace_back(std::string(recordName) + "." + std::string(fieldName));
+}
+
+/// The usage in the chunk.hpp comment, as it is written there.
+static void testHeaderExample()
+{
+    const auto& octets = HostTypes::octets;
+
+    swtis::Chunk chunk;
+    int error = swtis::Chunk::deserialize(std::as_bytes(std::span(octets)), chunk);
+    for (const SwtiType* type : chunk.types()) {
+        swtis::visit(*type, swtis::Overloaded{
+            [&](const SwtiRecordType& record) { use(chunk.name(record.internal), chunk.fieldName(record, 0)); },
+            [](const SwtiType&) {},
+        });
+    }
+
+    SWTIS_TEST_EXPECT(error == 0)
+    // Records have no name on the wire
+    SWTIS_TEST_EXPECT(used.size() == 1 && used[0].ends_with(".x"))
+}
+
+static void testVisit()
+{
+    swtis::Chunk chunk;
+    SWTIS_TEST_EXPECT(swtis::Chunk::deserialize(std::as_bytes(std::span(HostTypes::octets)), chunk) == 0)
+    SWTIS_TEST_EXPECT(chunk.size() == 4)
+
+    // A generic fallback gets each kind as its own struct
+    std::vector<size_t> sizes;
+    for (const SwtiType* type : chunk.types()) {
+        sizes.push_back(swtis::visit(*type, [](const auto& typed) { return sizeof(typed); }));
+    }
+    SWTIS_TEST_EXPECT(sizes.size() == 4 && sizes[0] == sizeof(SwtiRecordType) && sizes[1] == sizeof(SwtiAliasType) &&
+                      sizes[2] == sizeof(SwtiIntType) && sizes[3] == sizeof(SwtiUnmanagedType))
+
+    const SwtiType& alias = *chunk[HostTypes::indexOf<Vec2>()];
+    std::string_view aliasName = swtis::visit(alias, swtis::Overloaded{
+        [&](const SwtiAliasType& typed) { return chunk.name(typed.internal); },
+        [](const SwtiType&) { return std::string_view{}; },
+    });
+    SWTIS_TEST_EXPECT(aliasName == "Vec2")
+
+    const SwtiType& handle = *chunk[HostTypes::indexOf<Handle>()];
+    SWTIS_TEST_EXPECT(swtis::visit(handle, swtis::Overloaded{
+                          [](const SwtiUnmanagedType& typed) { return static_cast<int>(typed.userTypeId); },
+                          [](const SwtiType&) { return -1; },
+                      }) == 3)
+    SWTIS_TEST_EXPECT(swtis::visit(alias, swtis::Overloaded{
+                          [](const SwtiUnmanagedType& typed) { return static_cast<int>(typed.userTypeId); },
+                          [](const SwtiType&) { return -1; },
+                      }) == -1)
+}
+
+static void testMove()
+{
+    swtis::Chunk chunk;
+    SWTIS_TEST_EXPECT(swtis::Chunk::deserialize(std::as_bytes(std::span(HostTypes::octets)), chunk) == 0)
+    const SwtiType* first = chunk[0];
+
+    swtis::Chunk moved(std::move(chunk));
+    SWTIS_TEST_EXPECT(chunk.size() == 0 && moved.size() == 4 && moved[0] == first)
+    SWTIS_TEST_EXPECT(moved.fieldName(*reinterpret_cast<const SwtiRecordType*>(moved[0]), 1) == "y")
+
+    swtis::Chunk assigned;
+    assigned = std::move(moved);
+    SWTIS_TEST_EXPECT(moved.size() == 0 && assigned.size() == 4 && assigned[0] == first)
+
+    // Left empty on error
+    SWTIS_TEST_EXPECT(swtis::Chunk::deserialize(std::as_bytes(std::span(HostTypes::octets).first(5)), assigned) < 0)
+    SWTIS_TEST_EXPECT(assigned.size() == 0)
+}
+
+int main()
+{
+    // The chunks have their own memory, this only sets up the logging
+    swtisTestAllocator();
+    testHeaderExample();
+    testVisit();
+    testMove();
+
+    return swtisTestResult("chunk");
+}
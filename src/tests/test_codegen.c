@@ -0,0 +1,75 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "codegen_fixture.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/serialize.h>
+
+// Generated by swtis-codegen from the fixture, see CMakeLists.txt
+extern const SwtiChunk swtisTestGeneratedChunk;
+
+static SwtisTestCodegenFixture fixture;
+
+/// The generated chunk is the fixture, without any deserialization or fixup.
+static void testSameAsFixture(void)
+{
+    const SwtiChunk* generated = &swtisTestGeneratedChunk;
+    SWTIS_TEST_EXPECT(generated->typeCount == SWTIS_TEST_CODEGEN_FIXTURE_TYPE_COUNT)
+
+    for (size_t i = 0; i < generated->typeCount; ++i) {
+        SWTIS_TEST_EXPECT(generated->types[i]->type == fixture.types[i]->type)
+        SWTIS_TEST_EXPECT(generated->types[i]->index == i)
+    }
+
+    static uint8_t expected[4096];
+    static uint8_t octets[4096];
+    int expectedWritten = swtisSerialize(expected, sizeof(expected), &fixture.chunk);
+    int written = swtisSerialize(octets, sizeof(octets), generated);
+    SWTIS_TEST_EXPECT(written > 0 && written == expectedWritten)
+    SWTIS_TEST_EXPECT(memcmp(octets, expected, (size_t) written) == 0)
+
+    SWTIS_TEST_EXPECT(swtisLayoutValidate(generated, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+}
+
+/// References point into the generated chunk, and escaped names come out as they went in.
+static void testReferences(void)
+{
+    const SwtiChunk* generated = &swtisTestGeneratedChunk;
+
+    const SwtiTypeRefIdType* refId = (const SwtiTypeRefIdType*) generated->types[0];
+    SWTIS_TEST_EXPECT(refId->referencedType == generated->types[1])
+    const SwtiAliasType* alias = (const SwtiAliasType*) generated->types[1];
+    SWTIS_TEST_EXPECT(alias->targetType == generated->types[3])
+    SWTIS_TEST_EXPECT(strcmp(alias->internal.name, fixture.aliasType.internal.name) == 0)
+
+    const SwtiRecordType* record = (const SwtiRecordType*) generated->types[3];
+    SWTIS_TEST_EXPECT(record->fieldCount == 3)
+    for (size_t i = 0; i < record->fieldCount; ++i) {
+        SWTIS_TEST_EXPECT(strcmp(record->fields[i].name, fixture.recordFields[i].name) == 0)
+        SWTIS_TEST_EXPECT(record->fields[i].memoryOffsetInfo.memoryOffset ==
+                          fixture.recordFields[i].memoryOffsetInfo.memoryOffset)
+    }
+    SWTIS_TEST_EXPECT(record->fields[2].fieldType == generated->types[4])
+
+    const SwtiCustomType* maybe = (const SwtiCustomType*) generated->types[4];
+    SWTIS_TEST_EXPECT(maybe->variantCount == 2 && maybe->variantTypes[1] == (const void*) generated->types[6])
+    SWTIS_TEST_EXPECT(maybe->variantTypes[1]->inCustomType == maybe)
+    SWTIS_TEST_EXPECT(maybe->generic.genericCount == 1 && maybe->generic.genericTypes[0] == generated->types[7])
+
+    const SwtiFunctionType* function = (const SwtiFunctionType*) generated->types[11];
+    SWTIS_TEST_EXPECT(function->parameterCount == 2 && function->parameterTypes[1] == generated->types[8])
+    SWTIS_TEST_EXPECT(((const SwtiUnmanagedType*) generated->types[12])->userTypeId == 7)
+}
+
+int main(void)
+{
+    swtisTestAllocator();
+    swtisTestCodegenFixtureInit(&fixture);
+    testSameAsFixture();
+    testReferences();
+
+    return swtisTestResult("codegen");
+}
@@ -0,0 +1,185 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <flood/in_stream.h>
+#include <flood/out_stream.h>
+#include <string.h>
+#include <swamp-typeinfo-serialize/columnar.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/value.h>
+
+typedef struct Row {
+    int32_t id;
+    uint8_t on;
+    const SwtisValueString* name;
+    uint32_t letter;
+} Row;
+
+static SwtiIntType intType;
+static SwtiBooleanType boolType;
+static SwtiStringType stringType;
+static SwtiCharType charType;
+static SwtiRecordTypeField fields[4];
+static SwtiRecordType rowType;
+static const SwtiType* types[5];
+static SwtiChunk chunk;
+
+static void buildChunk(const SwtisLayoutProfile* profile)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&boolType.internal, SwtiTypeBoolean, "Bool");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+    swtisTestInitType(&charType.internal, SwtiTypeChar, "Char");
+    swtisTestInitType(&rowType.internal, SwtiTypeRecord, "Row");
+    fields[0].name = "id";
+    fields[0].fieldType = &intType.internal;
+    fields[1].name = "on";
+    fields[1].fieldType = &boolType.internal;
+    fields[2].name = "name";
+    fields[2].fieldType = &stringType.internal;
+    fields[3].name = "letter";
+    fields[3].fieldType = &charType.internal;
+    rowType.fields = fields;
+    rowType.fieldCount = 4;
+
+    types[0] = &intType.internal;
+    types[1] = &boolType.internal;
+    types[2] = &stringType.internal;
+    types[3] = &charType.internal;
+    types[4] = &rowType.internal;
+    swtisTestInitChunk(&chunk, types, 5);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, profile) == 0)
+}
+
+static int rowsEqual(const Row* a, const Row* b, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        if (a[i].id != b[i].id || a[i].on != b[i].on || a[i].letter != b[i].letter ||
+            a[i].name->characterCount != b[i].name->characterCount ||
+            memcmp(a[i].name->characters, b[i].name->characters, a[i].name->characterCount) != 0) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/// Int is 8 octets in this profile, too wide for the int32 encodings, so the id column is written as values and
+/// must use the size of the field and not the host size.
+static void testWideIntProfile(void)
+{
+    SwtisLayoutProfile wide = *SWTIS_LAYOUT_PROFILE_HOST;
+    wide.intInfo.memorySize = 8;
+    wide.intInfo.memoryAlign = 8;
+    buildChunk(&wide);
+
+    enum { RowCount = 4 };
+    size_t stride = rowType.memoryInfo.memorySize;
+    size_t idOffset = fields[0].memoryOffsetInfo.memoryOffset;
+    SwtisValueString name = {"n", 1};
+    static uint8_t rows[RowCount * 64];
+    static uint8_t readBack[RowCount * 64];
+    memset(rows, 0, sizeof(rows));
+    for (size_t i = 0; i < RowCount; ++i) {
+        int64_t id = (int64_t) i * 0x100000001;
+        const SwtisValueString* namePointer = &name;
+        memcpy(rows + i * stride + idOffset, &id, sizeof(id));
+        memcpy(rows + i * stride + fields[2].memoryOffsetInfo.memoryOffset, &namePointer, sizeof(namePointer));
+    }
+
+    static uint8_t octets[1024];
+    FldOutStream outStream;
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    int written = swtisColumnarEncode(&outStream, &rowType, rows, RowCount);
+    SWTIS_TEST_EXPECT(written > 0)
+
+    size_t count = 0;
+    FldInStream inStream;
+    fldInStreamInit(&inStream, octets, (size_t) written);
+    SWTIS_TEST_EXPECT(swtisColumnarDecode(&inStream, &rowType, readBack, RowCount, &count, swtisTestAllocator()) ==
+                      written)
+    for (size_t i = 0; i < RowCount; ++i) {
+        int64_t id;
+        memcpy(&id, readBack + i * stride + idOffset, sizeof(id));
+        SWTIS_TEST_EXPECT(id == (int64_t) i * 0x100000001)
+    }
+}
+
+/// The string column does not fit in any first guess of the column size, it must still be written in full.
+static void testLongString(void)
+{
+    static char characters[1000];
+    memset(characters, 'x', sizeof(characters));
+    SwtisValueString name = {characters, sizeof(characters)};
+    Row row = {42, 1, &name, 'q'};
+
+    static uint8_t octets[2048];
+    FldOutStream outStream;
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    int written = swtisColumnarEncode(&outStream, &rowType, &row, 1);
+    SWTIS_TEST_EXPECT(written > 1000)
+
+    Row readBack;
+    size_t count = 0;
+    FldInStream inStream;
+    fldInStreamInit(&inStream, octets, (size_t) written);
+    SWTIS_TEST_EXPECT(swtisColumnarDecode(&inStream, &rowType, &readBack, 1, &count, swtisTestAllocator()) == written)
+    SWTIS_TEST_EXPECT(count == 1 && rowsEqual(&row, &readBack, 1))
+
+    // The target stream is too small, that is an error and not a crash
+    fldOutStreamInit(&outStream, octets, 500);
+    SWTIS_TEST_EXPECT(swtisColumnarEncode(&outStream, &rowType, &row, 1) < 0)
+}
+
+static void testRoundTrip(void)
+{
+    enum { RowCount = 300 };
+    static Row rows[RowCount];
+    static Row readBack[RowCount];
+    static SwtisValueString names[3] = {{"a", 1}, {"", 0}, {"longer name", 11}};
+
+    for (size_t i = 0; i < RowCount; ++i) {
+        rows[i].id = (int32_t) (i * 7) - 1000;
+        rows[i].on = (uint8_t) (i % 3 == 0);
+        rows[i].name = &names[i % 3];
+        rows[i].letter = 'a' + (uint32_t) (i % 5);
+    }
+
+    static uint8_t octets[16 * 1024];
+    FldOutStream outStream;
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    int written = swtisColumnarEncode(&outStream, &rowType, rows, RowCount);
+    SWTIS_TEST_EXPECT(written > 0)
+
+    size_t count = 0;
+    FldInStream inStream;
+    fldInStreamInit(&inStream, octets, (size_t) written);
+    SWTIS_TEST_EXPECT(swtisColumnarDecode(&inStream, &rowType, readBack, RowCount, &count, swtisTestAllocator()) ==
+                      written)
+    SWTIS_TEST_EXPECT(count == RowCount && rowsEqual(rows, readBack, RowCount))
+
+    for (size_t cut = 0; cut < (size_t) written; cut += 11) {
+        fldInStreamInit(&inStream, octets, cut);
+        SWTIS_TEST_EXPECT(swtisColumnarDecode(&inStream, &rowType, readBack, RowCount, &count,
+                                              swtisTestAllocator()) < 0)
+    }
+
+    fldInStreamInit(&inStream, octets, (size_t) written);
+    SWTIS_TEST_EXPECT(swtisColumnarDecode(&inStream, &rowType, readBack, RowCount - 1, &count,
+                                          swtisTestAllocator()) == -7)
+}
+
+int main(void)
+{
+    testWideIntProfile();
+
+    buildChunk(SWTIS_LAYOUT_PROFILE_HOST);
+    SWTIS_TEST_EXPECT(rowType.memoryInfo.memorySize == sizeof(Row))
+    testLongString();
+    testRoundTrip();
+
+    return swtisTestResult("columnar");
+}
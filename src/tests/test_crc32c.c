@@ -0,0 +1,60 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/crc32c_internal.h>
+
+/// The check value of CRC-32C, and the iSCSI test vectors from RFC 3720 B.4.
+static void testKnownValues(void)
+{
+    const uint8_t* digits = (const uint8_t*) "123456789";
+    SWTIS_TEST_EXPECT(swtisCrc32cUpdatePortable(0, digits, 9) == 0xe3069283u)
+    SWTIS_TEST_EXPECT(swtisCrc32cUpdate(0, digits, 9) == 0xe3069283u)
+
+    uint8_t octets[32];
+    memset(octets, 0, sizeof(octets));
+    SWTIS_TEST_EXPECT(swtisCrc32cUpdatePortable(0, octets, 32) == 0x8a9136aau)
+    memset(octets, 0xff, sizeof(octets));
+    SWTIS_TEST_EXPECT(swtisCrc32cUpdatePortable(0, octets, 32) == 0x62a8ab43u)
+    for (size_t i = 0; i < 32; ++i) {
+        octets[i] = (uint8_t) i;
+    }
+    SWTIS_TEST_EXPECT(swtisCrc32cUpdatePortable(0, octets, 32) == 0x46dd794eu)
+
+    SWTIS_TEST_EXPECT(swtisCrc32cUpdatePortable(0, octets, 0) == 0)
+}
+
+/// Every start alignment and length, so the unaligned head, the eight octet steps and the tail are all covered, and
+/// split updates give the same result as one.
+static void testPortableMatchesDispatched(void)
+{
+    static uint8_t octets[300];
+    uint32_t state = 1;
+    for (size_t i = 0; i < sizeof(octets); ++i) {
+        state = state * 1664525u + 1013904223u;
+        octets[i] = (uint8_t) (state >> 24);
+    }
+
+    for (size_t start = 0; start < 8; ++start) {
+        for (size_t count = 0; count + start <= sizeof(octets); count += 7) {
+            uint32_t portable = swtisCrc32cUpdatePortable(0, octets + start, count);
+            SWTIS_TEST_EXPECT(portable == swtisCrc32cUpdate(0, octets + start, count))
+
+            size_t half = count / 2;
+            uint32_t split = swtisCrc32cUpdatePortable(0, octets + start, half);
+            SWTIS_TEST_EXPECT(swtisCrc32cUpdatePortable(split, octets + start + half, count - half) == portable)
+        }
+    }
+}
+
+int main(void)
+{
+    swtisTestAllocator();
+    testKnownValues();
+    testPortableMatchesDispatched();
+
+    return swtisTestResult("crc32c");
+}
@@ -0,0 +1,132 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <flood/in_stream.h>
+#include <flood/out_stream.h>
+#include <string.h>
+#include <swamp-typeinfo-serialize/delta.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/value.h>
+
+static SwtiIntType intType;
+static SwtiBooleanType boolType;
+static SwtiStringType stringType;
+static SwtiRecordTypeField fields[3];
+static SwtiRecordType recordType;
+static const SwtiType* types[4];
+static SwtiChunk chunk;
+
+static void buildChunk(const SwtisLayoutProfile* profile)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&boolType.internal, SwtiTypeBoolean, "Bool");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+    swtisTestInitType(&recordType.internal, SwtiTypeRecord, "Record");
+    fields[0].name = "a";
+    fields[0].fieldType = &intType.internal;
+    fields[1].name = "b";
+    fields[1].fieldType = &boolType.internal;
+    fields[2].name = "s";
+    fields[2].fieldType = &stringType.internal;
+    recordType.fields = fields;
+    recordType.fieldCount = 3;
+
+    types[0] = &intType.internal;
+    types[1] = &boolType.internal;
+    types[2] = &stringType.internal;
+    types[3] = &recordType.internal;
+    swtisTestInitChunk(&chunk, types, 4);
+
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, profile) == 0)
+}
+
+static void writePointer(uint8_t* target, const void* pointer)
+{
+    memcpy(target, (const void*) &pointer, sizeof(pointer));
+}
+
+static void writeRecord(uint8_t* target, int64_t a, uint8_t b, const SwtisValueString* s)
+{
+    memset(target, 0, recordType.memoryInfo.memorySize);
+    memcpy(target + fields[0].memoryOffsetInfo.memoryOffset, &a, sizeof(a));
+    target[fields[1].memoryOffsetInfo.memoryOffset] = b;
+    writePointer(target + fields[2].memoryOffsetInfo.memoryOffset, s);
+}
+
+/// Int is 8 octets in this profile. A change in the upper half must be found and written in full.
+static void testWideIntProfile(void)
+{
+    SwtisLayoutProfile wide = *SWTIS_LAYOUT_PROFILE_HOST;
+    wide.intInfo.memorySize = 8;
+    wide.intInfo.memoryAlign = 8;
+    buildChunk(&wide);
+
+    SwtisValueString name = {"name", 4};
+    uint8_t baseline[64];
+    uint8_t value[64];
+    writeRecord(baseline, 1, 0, &name);
+    writeRecord(value, 1 + 0x100000000, 0, &name);
+    SWTIS_TEST_EXPECT(!swtisDeltaValuesEqual(&recordType.internal, baseline, value))
+
+    uint8_t octets[64];
+    FldOutStream outStream;
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    int written = swtisDeltaSerializeValue(&outStream, &recordType.internal, baseline, value);
+    SWTIS_TEST_EXPECT(written == 1 + 8)
+
+    uint8_t target[64];
+    memcpy(target, baseline, sizeof(target));
+    FldInStream inStream;
+    fldInStreamInit(&inStream, octets, (size_t) written);
+    SWTIS_TEST_EXPECT(swtisDeltaApplyValue(&inStream, &recordType.internal, target, swtisTestAllocator()) == written)
+    SWTIS_TEST_EXPECT(swtisDeltaValuesEqual(&recordType.internal, target, value))
+}
+
+static void testRoundTrip(void)
+{
+    buildChunk(SWTIS_LAYOUT_PROFILE_HOST);
+
+    SwtisValueString before = {"before", 6};
+    SwtisValueString after = {"after", 5};
+    SwtisValueString sameAsBefore = {"before", 6};
+    uint8_t baseline[64];
+    uint8_t value[64];
+
+    // Strings are compared by content, so nothing has changed
+    writeRecord(baseline, 3, 1, &before);
+    writeRecord(value, 3, 1, &sameAsBefore);
+    uint8_t octets[64];
+    FldOutStream outStream;
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    SWTIS_TEST_EXPECT(swtisDeltaSerializeValue(&outStream, &recordType.internal, baseline, value) == 1)
+    SWTIS_TEST_EXPECT(octets[0] == 0)
+
+    writeRecord(value, 3, 0, &after);
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    int written = swtisDeltaSerializeValue(&outStream, &recordType.internal, baseline, value);
+    SWTIS_TEST_EXPECT(written == 1 + 1 + 4 + 5)
+    SWTIS_TEST_EXPECT(octets[0] == 6)
+
+    uint8_t target[64];
+    memcpy(target, baseline, sizeof(target));
+    FldInStream inStream;
+    fldInStreamInit(&inStream, octets, (size_t) written);
+    SWTIS_TEST_EXPECT(swtisDeltaApplyValue(&inStream, &recordType.internal, target, swtisTestAllocator()) == written)
+    SWTIS_TEST_EXPECT(swtisDeltaValuesEqual(&recordType.internal, target, value))
+
+    // A mask that mentions a fourth field is rejected
+    static const uint8_t badMask[] = {8};
+    fldInStreamInit(&inStream, badMask, sizeof(badMask));
+    SWTIS_TEST_EXPECT(swtisDeltaApplyValue(&inStream, &recordType.internal, target, swtisTestAllocator()) == -8)
+}
+
+int main(void)
+{
+    testWideIntProfile();
+    testRoundTrip();
+
+    return swtisTestResult("delta");
+}
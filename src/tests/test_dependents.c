@@ -0,0 +1,146 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/dependents.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/serialize.h>
+
+static SwtiIntType intType;
+static SwtiBooleanType boolType;
+static SwtiStringType stringType;
+static SwtiCustomTypeVariant nothingVariant;
+static SwtiCustomTypeVariant justVariant;
+static SwtiCustomTypeVariantField justFields[1];
+static const SwtiCustomTypeVariant* maybeVariants[2];
+static const SwtiType* maybeGenerics[1];
+static SwtiCustomType maybeType;
+static SwtiRecordTypeField fields[2];
+static SwtiRecordType recordType;
+static SwtiListType listType;
+static const SwtiType* types[8];
+static SwtiChunk chunk;
+
+/// Int 0, Bool 1, String 2, Nothing 3, Just Int 4, Maybe Bool 5, { a : Int, m : Maybe } 6, List of the record 7.
+static void buildChunk(void)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&boolType.internal, SwtiTypeBoolean, "Bool");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+
+    swtisTestInitType(&nothingVariant.internal, SwtiTypeCustomVariant, "Nothing");
+    nothingVariant.name = "Nothing";
+    nothingVariant.inCustomType = &maybeType;
+    nothingVariant.fields = 0;
+    nothingVariant.paramCount = 0;
+    swtisTestInitType(&justVariant.internal, SwtiTypeCustomVariant, "Just");
+    justVariant.name = "Just";
+    justVariant.inCustomType = &maybeType;
+    justFields[0].fieldType = &intType.internal;
+    justVariant.fields = justFields;
+    justVariant.paramCount = 1;
+    maybeVariants[0] = &nothingVariant;
+    maybeVariants[1] = &justVariant;
+    maybeGenerics[0] = &boolType.internal;
+    swtisTestInitType(&maybeType.internal, SwtiTypeCustom, "Maybe");
+    maybeType.generic.genericTypes = maybeGenerics;
+    maybeType.generic.genericCount = 1;
+    maybeType.variantTypes = maybeVariants;
+    maybeType.variantCount = 2;
+
+    swtisTestInitType(&recordType.internal, SwtiTypeRecord, "Record");
+    fields[0].name = "a";
+    fields[0].fieldType = &intType.internal;
+    fields[1].name = "m";
+    fields[1].fieldType = &maybeType.internal;
+    recordType.fields = fields;
+    recordType.fieldCount = 2;
+    swtisTestInitType(&listType.internal, SwtiTypeList, "List");
+    listType.itemType = &recordType.internal;
+
+    types[0] = &intType.internal;
+    types[1] = &boolType.internal;
+    types[2] = &stringType.internal;
+    types[3] = &nothingVariant.internal;
+    types[4] = &justVariant.internal;
+    types[5] = &maybeType.internal;
+    types[6] = &recordType.internal;
+    types[7] = &listType.internal;
+    swtisTestInitChunk(&chunk, types, 8);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+}
+
+static int directEquals(const SwtisDependents* dependents, size_t typeIndex, const uint16_t* expected,
+                        size_t expectedCount)
+{
+    const uint16_t* indices;
+    size_t count;
+    if (swtisDependentsDirect(dependents, typeIndex, &indices, &count) != 0 || count != expectedCount) {
+        return 0;
+    }
+
+    return expectedCount == 0 || memcmp(indices, expected, expectedCount * sizeof(uint16_t)) == 0;
+}
+
+static void testDependents(void)
+{
+    static uint8_t octets[1024];
+    int written = swtisSerialize(octets, sizeof(octets), &chunk);
+    SWTIS_TEST_EXPECT(written > 0)
+
+    SwtisDependents dependents;
+    SwtisDeserializeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.dependents = &dependents;
+    SwtiChunk target;
+    SWTIS_TEST_EXPECT(swtisDeserializeWithOptions(octets, (size_t) written, &target, swtisTestAllocator(), &options) ==
+                      written)
+    SWTIS_TEST_EXPECT(dependents.typeCount == 8)
+
+    // Variants do not depend on their custom type, they only belong to it
+    static const uint16_t ofInt[] = {4, 6};
+    static const uint16_t ofBool[] = {5};
+    static const uint16_t ofNothing[] = {5};
+    static const uint16_t ofJust[] = {5};
+    static const uint16_t ofMaybe[] = {6};
+    static const uint16_t ofRecord[] = {7};
+    SWTIS_TEST_EXPECT(directEquals(&dependents, 0, ofInt, 2))
+    SWTIS_TEST_EXPECT(directEquals(&dependents, 1, ofBool, 1))
+    SWTIS_TEST_EXPECT(directEquals(&dependents, 2, 0, 0))
+    SWTIS_TEST_EXPECT(directEquals(&dependents, 3, ofNothing, 1))
+    SWTIS_TEST_EXPECT(directEquals(&dependents, 4, ofJust, 1))
+    SWTIS_TEST_EXPECT(directEquals(&dependents, 5, ofMaybe, 1))
+    SWTIS_TEST_EXPECT(directEquals(&dependents, 6, ofRecord, 1))
+    SWTIS_TEST_EXPECT(directEquals(&dependents, 7, 0, 0))
+    const uint16_t* indices;
+    size_t count;
+    SWTIS_TEST_EXPECT(swtisDependentsDirect(&dependents, 8, &indices, &count) == -3)
+
+    // Breadth first, the closest dependents come first
+    uint16_t found[8];
+    static const uint16_t changedInt[] = {0};
+    static const uint16_t transitiveOfInt[] = {4, 6, 5, 7};
+    SWTIS_TEST_EXPECT(swtisDependentsTransitive(&dependents, changedInt, 1, found, 8) == 4)
+    SWTIS_TEST_EXPECT(memcmp(found, transitiveOfInt, sizeof(transitiveOfInt)) == 0)
+    SWTIS_TEST_EXPECT(swtisDependentsTransitive(&dependents, changedInt, 1, found, 3) == -4)
+
+    static const uint16_t changedNothingAndBool[] = {3, 1};
+    static const uint16_t transitiveOfNothingAndBool[] = {5, 6, 7};
+    SWTIS_TEST_EXPECT(swtisDependentsTransitive(&dependents, changedNothingAndBool, 2, found, 8) == 3)
+    SWTIS_TEST_EXPECT(memcmp(found, transitiveOfNothingAndBool, sizeof(transitiveOfNothingAndBool)) == 0)
+
+    static const uint16_t changedOutOfRange[] = {8};
+    SWTIS_TEST_EXPECT(swtisDependentsTransitive(&dependents, changedOutOfRange, 1, found, 8) == -3)
+}
+
+int main(void)
+{
+    buildChunk();
+    testDependents();
+
+    return swtisTestResult("dependents");
+}
@@ -0,0 +1,319 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo-serialize/deserialize_internal.h>
+#include <swamp-typeinfo-serialize/format.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/sections_internal.h>
+#include <swamp-typeinfo-serialize/serialize.h>
+
+static SwtiIntType intType;
+static SwtiBooleanType boolType;
+static SwtiStringType stringType;
+static SwtiCustomTypeVariant nothingVariant;
+static SwtiCustomTypeVariant justVariant;
+static SwtiCustomTypeVariantField justFields[1];
+static const SwtiCustomTypeVariant* maybeVariants[2];
+static SwtiCustomType maybeType;
+static SwtiRecordTypeField fields[4];
+static SwtiRecordType recordType;
+static SwtiListType listType;
+static const SwtiType* types[8];
+static SwtiChunk chunk;
+
+static void buildChunk(void)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&boolType.internal, SwtiTypeBoolean, "Bool");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+
+    swtisTestInitType(&nothingVariant.internal, SwtiTypeCustomVariant, "Nothing");
+    nothingVariant.name = "Nothing";
+    nothingVariant.inCustomType = &maybeType;
+    nothingVariant.fields = 0;
+    nothingVariant.paramCount = 0;
+    swtisTestInitType(&justVariant.internal, SwtiTypeCustomVariant, "Just");
+    justVariant.name = "Just";
+    justVariant.inCustomType = &maybeType;
+    justFields[0].fieldType = &intType.internal;
+    justVariant.fields = justFields;
+    justVariant.paramCount = 1;
+    maybeVariants[0] = &nothingVariant;
+    maybeVariants[1] = &justVariant;
+    swtisTestInitType(&maybeType.internal, SwtiTypeCustom, "Maybe");
+    maybeType.generic.genericTypes = 0;
+    maybeType.generic.genericCount = 0;
+    maybeType.variantTypes = maybeVariants;
+    maybeType.variantCount = 2;
+
+    swtisTestInitType(&recordType.internal, SwtiTypeRecord, "Record");
+    fields[0].name = "a";
+    fields[0].fieldType = &intType.internal;
+    fields[1].name = "b";
+    fields[1].fieldType = &boolType.internal;
+    fields[2].name = "s";
+    fields[2].fieldType = &stringType.internal;
+    fields[3].name = "m";
+    fields[3].fieldType = &maybeType.internal;
+    recordType.fields = fields;
+    recordType.fieldCount = 4;
+    swtisTestInitType(&listType.internal, SwtiTypeList, "List");
+    listType.itemType = &recordType.internal;
+
+    types[0] = &intType.internal;
+    types[1] = &boolType.internal;
+    types[2] = &stringType.internal;
+    types[3] = &nothingVariant.internal;
+    types[4] = &justVariant.internal;
+    types[5] = &maybeType.internal;
+    types[6] = &recordType.internal;
+    types[7] = &listType.internal;
+    swtisTestInitChunk(&chunk, types, 8);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+}
+
+/// Feeds one more octet at a time. Returns what the last feed returned and the octet count it was given.
+static int feedOctetByOctetWithOptions(const uint8_t* octets, size_t octetCount, SwtiChunk* target,
+                                       size_t* outFedCount, const SwtisDeserializeOptions* options)
+{
+    SwtisDeserializeProgress progress;
+    swtisDeserializeProgressInit(&progress, target, swtisTestAllocator(), options);
+
+    int result = 0;
+    size_t fedCount = 0;
+    while (result == 0 && fedCount <= octetCount) {
+        result = swtisDeserializeProgressFeed(&progress, octets, fedCount);
+        fedCount++;
+    }
+    *outFedCount = fedCount - 1;
+
+    if (result == 1) {
+        result = swtisDeserializeProgressFinish(&progress);
+    }
+
+    return result;
+}
+
+static int feedOctetByOctet(const uint8_t* octets, size_t octetCount, SwtiChunk* target, size_t* outFedCount)
+{
+    return feedOctetByOctetWithOptions(octets, octetCount, target, outFedCount, 0);
+}
+
+static void testRoundTrip(uint8_t formatFlags)
+{
+    SwtisSerializeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.formatFlags = formatFlags;
+
+    static uint8_t octets[1024];
+    int written = swtisSerializeWithOptions(octets, sizeof(octets), &chunk, &options);
+    SWTIS_TEST_EXPECT(written > 0)
+
+    SwtiChunk target;
+    SWTIS_TEST_EXPECT(swtisDeserialize(octets, (size_t) written, &target, swtisTestAllocator()) == written)
+    SWTIS_TEST_EXPECT(target.typeCount == chunk.typeCount)
+
+    size_t fedCount;
+    SWTIS_TEST_EXPECT(feedOctetByOctet(octets, (size_t) written, &target, &fedCount) == written)
+    SWTIS_TEST_EXPECT(fedCount == (size_t) written)
+    SWTIS_TEST_EXPECT(target.typeCount == chunk.typeCount)
+
+    static uint8_t again[1024];
+    SWTIS_TEST_EXPECT(swtisSerializeWithOptions(again, sizeof(again), &target, &options) == written)
+    SWTIS_TEST_EXPECT(memcmp(octets, again, (size_t) written) == 0)
+}
+
+static void writeUInt32(uint8_t* target, uint32_t value)
+{
+    target[0] = (uint8_t) (value >> 24);
+    target[1] = (uint8_t) (value >> 16);
+    target[2] = (uint8_t) (value >> 8);
+    target[3] = (uint8_t) value;
+}
+
+/// The types must end exactly where the types section ends, for both the blocking and the progressive reader.
+static void testTypesSectionSizeMismatch(void)
+{
+    SwtisSerializeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.formatFlags = SWTIS_FORMAT_FLAG_SECTIONED;
+
+    static uint8_t octets[1024];
+    int written = swtisSerializeWithOptions(octets, sizeof(octets), &chunk, &options);
+    SWTIS_TEST_EXPECT(written > 0)
+
+    SwtisSectionDirectory directory;
+    SWTIS_TEST_EXPECT(swtisSectionDirectoryRead(&directory, octets, (size_t) written) == 0)
+    const SwtisSection* section = swtisSectionDirectoryFind(&directory, SWTIS_SECTION_TYPES);
+    SWTIS_TEST_EXPECT(section != 0)
+    uint8_t* entry = octets + SWTIS_SECTIONS_HEADER_OCTET_COUNT + 1 +
+                     (size_t) (section - directory.sections) * SWTIS_SECTIONS_ENTRY_OCTET_COUNT;
+    uint32_t octetCount = section->octetCount;
+
+    // One octet too few and one too many
+    const uint32_t wrongCounts[2] = {octetCount - 1, octetCount + 1};
+    for (size_t i = 0; i < 2; ++i) {
+        writeUInt32(entry + 5, wrongCounts[i]);
+
+        SwtiChunk target;
+        SWTIS_TEST_EXPECT(swtisDeserialize(octets, (size_t) written, &target, swtisTestAllocator()) == -6)
+        size_t fedCount;
+        SWTIS_TEST_EXPECT(feedOctetByOctet(octets, (size_t) written, &target, &fedCount) == -6)
+    }
+
+    writeUInt32(entry + 5, octetCount);
+}
+
+/// Reading through the bounds checked stream gives the same chunk as reading measured types, and both reject every
+/// truncation of the typeinfo.
+static void testCheckedReads(uint8_t formatFlags)
+{
+    SwtisSerializeOptions serializeOptions;
+    memset(&serializeOptions, 0, sizeof(serializeOptions));
+    serializeOptions.formatFlags = formatFlags;
+
+    static uint8_t octets[1024];
+    int written = swtisSerializeWithOptions(octets, sizeof(octets), &chunk, &serializeOptions);
+    SWTIS_TEST_EXPECT(written > 0)
+
+    static uint8_t again[2][1024];
+    for (int checkedReads = 0; checkedReads <= 1; ++checkedReads) {
+        SwtisDeserializeOptions options;
+        memset(&options, 0, sizeof(options));
+        options.checkedReads = checkedReads;
+
+        SwtiChunk target;
+        SWTIS_TEST_EXPECT(swtisDeserializeWithOptions(octets, (size_t) written, &target, swtisTestAllocator(),
+                                                      &options) == written)
+        SWTIS_TEST_EXPECT(target.typeCount == chunk.typeCount)
+        for (size_t i = 0; i < target.typeCount; ++i) {
+            SWTIS_TEST_EXPECT(target.types[i]->type == chunk.types[i]->type && target.types[i]->index == i)
+        }
+        SWTIS_TEST_EXPECT(swtisSerializeWithOptions(again[checkedReads], sizeof(again[checkedReads]), &target,
+                                                    &serializeOptions) == written)
+
+        size_t fedCount;
+        SWTIS_TEST_EXPECT(feedOctetByOctetWithOptions(octets, (size_t) written, &target, &fedCount, &options) ==
+                          written)
+        static uint8_t fed[1024];
+        SWTIS_TEST_EXPECT(swtisSerializeWithOptions(fed, sizeof(fed), &target, &serializeOptions) == written)
+        SWTIS_TEST_EXPECT(memcmp(fed, again[checkedReads], (size_t) written) == 0)
+
+        for (size_t count = 0; count < (size_t) written; ++count) {
+            SWTIS_TEST_EXPECT(swtisDeserializeWithOptions(octets, count, &target, swtisTestAllocator(), &options) < 0)
+        }
+    }
+
+    SWTIS_TEST_EXPECT(memcmp(again[0], again[1], (size_t) written) == 0)
+    SWTIS_TEST_EXPECT(memcmp(again[0], octets, (size_t) written) == 0)
+}
+
+/// Any octet of the CRC-32C footer that is changed fails both readers with -7.
+static void testChecksumFooterMismatch(void)
+{
+    SwtisSerializeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.formatFlags = SWTIS_FORMAT_FLAG_SECTIONED | SWTIS_FORMAT_FLAG_CHECKSUM;
+
+    static uint8_t octets[1024];
+    int written = swtisSerializeWithOptions(octets, sizeof(octets), &chunk, &options);
+    SWTIS_TEST_EXPECT(written > 4)
+
+    for (size_t i = (size_t) written - 4; i < (size_t) written; ++i) {
+        octets[i] ^= 0x01;
+
+        SwtiChunk target;
+        SWTIS_TEST_EXPECT(swtisDeserialize(octets, (size_t) written, &target, swtisTestAllocator()) == -7)
+        size_t fedCount;
+        SWTIS_TEST_EXPECT(feedOctetByOctet(octets, (size_t) written, &target, &fedCount) == -7)
+
+        octets[i] ^= 0x01;
+    }
+
+    SwtiChunk target;
+    SWTIS_TEST_EXPECT(swtisDeserialize(octets, (size_t) written, &target, swtisTestAllocator()) == written)
+}
+
+/// Returns the position of the only octet that differs, the low octet of the type index that was changed.
+static size_t findDifference(const uint8_t* octets, const uint8_t* other, int written, int otherWritten)
+{
+    SWTIS_TEST_EXPECT(written > 0 && written == otherWritten)
+
+    size_t position = 0;
+    size_t differenceCount = 0;
+    for (size_t i = 0; i < (size_t) written; ++i) {
+        if (octets[i] != other[i]) {
+            position = i;
+            differenceCount++;
+        }
+    }
+    SWTIS_TEST_EXPECT(differenceCount == 1)
+
+    return position;
+}
+
+/// Generic parameters that can not be resolved are cleared and ones that are variants are kept, as they always were.
+/// The variants of a custom type must still be variants.
+static void testGenericReferences(void)
+{
+    const SwtiType* generics[1];
+    maybeType.generic.genericTypes = generics;
+    maybeType.generic.genericCount = 1;
+
+    static uint8_t octets[1024];
+    static uint8_t other[1024];
+    generics[0] = &boolType.internal;
+    int otherWritten = swtisSerialize(other, sizeof(other), &chunk);
+    generics[0] = &intType.internal;
+    int written = swtisSerialize(octets, sizeof(octets), &chunk);
+    size_t position = findDifference(octets, other, written, otherWritten);
+
+    SwtiChunk target;
+    SWTIS_TEST_EXPECT(swtisDeserialize(octets, (size_t) written, &target, swtisTestAllocator()) == written)
+    const SwtiCustomType* custom = (const SwtiCustomType*) target.types[5];
+    SWTIS_TEST_EXPECT(custom->generic.genericTypes[0] == target.types[0])
+
+    octets[position] = 0xff;
+    SWTIS_TEST_EXPECT(swtisDeserialize(octets, (size_t) written, &target, swtisTestAllocator()) == written)
+    custom = (const SwtiCustomType*) target.types[5];
+    SWTIS_TEST_EXPECT(custom->generic.genericTypes[0] == 0)
+
+    octets[position] = 4;
+    SWTIS_TEST_EXPECT(swtisDeserialize(octets, (size_t) written, &target, swtisTestAllocator()) == written)
+    custom = (const SwtiCustomType*) target.types[5];
+    SWTIS_TEST_EXPECT(custom->generic.genericTypes[0] == target.types[4])
+
+    maybeType.generic.genericTypes = 0;
+    maybeType.generic.genericCount = 0;
+
+    maybeVariants[1] = &nothingVariant;
+    otherWritten = swtisSerialize(other, sizeof(other), &chunk);
+    maybeVariants[1] = &justVariant;
+    written = swtisSerialize(octets, sizeof(octets), &chunk);
+    position = findDifference(octets, other, written, otherWritten);
+
+    octets[position] = 0;
+    SWTIS_TEST_EXPECT(swtisDeserialize(octets, (size_t) written, &target, swtisTestAllocator()) == -46)
+}
+
+int main(void)
+{
+    buildChunk();
+    testRoundTrip(0);
+    testRoundTrip(SWTIS_FORMAT_FLAG_LAYOUT_OMITTED);
+    testRoundTrip(SWTIS_FORMAT_FLAG_SECTIONED);
+    testRoundTrip(SWTIS_FORMAT_FLAG_SECTIONED | SWTIS_FORMAT_FLAG_CHECKSUM);
+    testCheckedReads(0);
+    testCheckedReads(SWTIS_FORMAT_FLAG_LAYOUT_OMITTED);
+    testCheckedReads(SWTIS_FORMAT_FLAG_SECTIONED | SWTIS_FORMAT_FLAG_CHECKSUM);
+    testTypesSectionSizeMismatch();
+    testChecksumFooterMismatch();
+    testGenericReferences();
+
+    return swtisTestResult("deserialize");
+}
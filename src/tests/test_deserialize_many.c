@@ -0,0 +1,131 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/dependents.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo-serialize/deserialize_many.h>
+#include <swamp-typeinfo-serialize/serialize.h>
+
+enum { BlobCount = 40 };
+
+static SwtiIntType intType;
+static SwtiBooleanType boolType;
+static SwtiStringType stringType;
+static const SwtiType* types[3];
+
+static uint8_t blobOctets[BlobCount][64];
+static SwtisBlob blobs[BlobCount];
+static uint8_t memory[BlobCount * 64 * SWTIS_DESERIALIZE_MANY_MEMORY_FACTOR * 2];
+
+/// Blob `i` has the first `i % 3 + 1` types, so the blobs are of different sizes.
+static void buildBlobs(void)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&boolType.internal, SwtiTypeBoolean, "Bool");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+    types[0] = &intType.internal;
+    types[1] = &boolType.internal;
+    types[2] = &stringType.internal;
+
+    for (size_t i = 0; i < BlobCount; ++i) {
+        SwtiChunk chunk;
+        swtisTestInitChunk(&chunk, types, i % 3 + 1);
+        int written = swtisSerialize(blobOctets[i], sizeof(blobOctets[i]), &chunk);
+        SWTIS_TEST_EXPECT(written > 0)
+        blobs[i].octets = blobOctets[i];
+        blobs[i].octetCount = (size_t) written;
+    }
+}
+
+typedef struct LinkCall {
+    size_t callCount;
+    size_t chunkCount;
+    int result;
+} LinkCall;
+
+static int linkChunks(void* userData, SwtiChunk* chunks, size_t chunkCount)
+{
+    LinkCall* call = (LinkCall*) userData;
+    call->callCount++;
+    call->chunkCount = chunkCount;
+
+    return call->result;
+}
+
+static void initOptions(SwtisDeserializeManyOptions* options, LinkCall* call, int* results)
+{
+    memset(options, 0, sizeof(*options));
+    options->memory = memory;
+    options->memorySize = sizeof(memory);
+    options->link = linkChunks;
+    options->linkUserData = call;
+    options->outResults = results;
+    memset(call, 0, sizeof(*call));
+}
+
+static void testThreadCounts(void)
+{
+    const size_t threadCounts[3] = {1, 4, 16};
+    for (size_t t = 0; t < 3; ++t) {
+        SwtisDeserializeManyOptions options;
+        LinkCall call;
+        int results[BlobCount];
+        initOptions(&options, &call, results);
+
+        SwtiChunk chunks[BlobCount];
+        SWTIS_TEST_EXPECT(swtisDeserializeMany(blobs, BlobCount, chunks, threadCounts[t], &options) == 0)
+        SWTIS_TEST_EXPECT(call.callCount == 1 && call.chunkCount == BlobCount)
+        for (size_t i = 0; i < BlobCount; ++i) {
+            SWTIS_TEST_EXPECT(results[i] == (int) blobs[i].octetCount)
+            SWTIS_TEST_EXPECT(chunks[i].typeCount == i % 3 + 1 && chunks[i].types[i % 3]->type == types[i % 3]->type)
+        }
+    }
+}
+
+static void testErrors(void)
+{
+    SwtisDeserializeManyOptions options;
+    LinkCall call;
+    int results[BlobCount];
+    SwtiChunk chunks[BlobCount];
+
+    // The other blobs still load, and link is not called
+    initOptions(&options, &call, results);
+    blobs[7].octetCount--;
+    int result = swtisDeserializeMany(blobs, BlobCount, chunks, 4, &options);
+    blobs[7].octetCount++;
+    SWTIS_TEST_EXPECT(result < 0 && result == results[7])
+    SWTIS_TEST_EXPECT(results[6] == (int) blobs[6].octetCount && results[8] == (int) blobs[8].octetCount)
+    SWTIS_TEST_EXPECT(call.callCount == 0)
+
+    initOptions(&options, &call, results);
+    call.result = -99;
+    SWTIS_TEST_EXPECT(swtisDeserializeMany(blobs, BlobCount, chunks, 4, &options) == -99)
+
+    initOptions(&options, &call, results);
+    options.memorySize = BlobCount * SWTIS_DESERIALIZE_MANY_MEMORY_FACTOR;
+    SWTIS_TEST_EXPECT(swtisDeserializeMany(blobs, BlobCount, chunks, 4, &options) == -3)
+
+    SwtisDependents dependents;
+    SwtisDeserializeOptions deserializeOptions;
+    memset(&deserializeOptions, 0, sizeof(deserializeOptions));
+    deserializeOptions.dependents = &dependents;
+    initOptions(&options, &call, results);
+    options.deserializeOptions = &deserializeOptions;
+    SWTIS_TEST_EXPECT(swtisDeserializeMany(blobs, BlobCount, chunks, 4, &options) == -2)
+}
+
+int main(void)
+{
+    // The blobs are loaded into `memory`, this only sets up the logging
+    swtisTestAllocator();
+    buildBlobs();
+    testThreadCounts();
+    testErrors();
+
+    return swtisTestResult("deserialize_many");
+}
@@ -0,0 +1,178 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo-serialize/format.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/serialize.h>
+
+static SwtiIntType intType;
+static SwtiBooleanType boolType;
+static SwtiStringType stringType;
+static SwtiCustomTypeVariant nothingVariant;
+static SwtiCustomTypeVariant justVariant;
+static SwtiCustomTypeVariantField justFields[1];
+static const SwtiCustomTypeVariant* maybeVariants[2];
+static SwtiCustomType maybeType;
+static SwtiRecordTypeField fields[4];
+static SwtiRecordType recordType;
+static SwtiListType listType;
+static const SwtiType* types[8];
+static SwtiChunk chunk;
+
+/// { b : Bool, a : Int, s : String, m : Maybe Int } and a List of it.
+static void buildChunk(void)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&boolType.internal, SwtiTypeBoolean, "Bool");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+
+    swtisTestInitType(&nothingVariant.internal, SwtiTypeCustomVariant, "Nothing");
+    nothingVariant.name = "Nothing";
+    nothingVariant.inCustomType = &maybeType;
+    nothingVariant.fields = 0;
+    nothingVariant.paramCount = 0;
+    swtisTestInitType(&justVariant.internal, SwtiTypeCustomVariant, "Just");
+    justVariant.name = "Just";
+    justVariant.inCustomType = &maybeType;
+    justFields[0].fieldType = &intType.internal;
+    justVariant.fields = justFields;
+    justVariant.paramCount = 1;
+    maybeVariants[0] = &nothingVariant;
+    maybeVariants[1] = &justVariant;
+    swtisTestInitType(&maybeType.internal, SwtiTypeCustom, "Maybe");
+    maybeType.generic.genericTypes = 0;
+    maybeType.generic.genericCount = 0;
+    maybeType.variantTypes = maybeVariants;
+    maybeType.variantCount = 2;
+
+    swtisTestInitType(&recordType.internal, SwtiTypeRecord, "Record");
+    fields[0].name = "b";
+    fields[0].fieldType = &boolType.internal;
+    fields[1].name = "a";
+    fields[1].fieldType = &intType.internal;
+    fields[2].name = "s";
+    fields[2].fieldType = &stringType.internal;
+    fields[3].name = "m";
+    fields[3].fieldType = &maybeType.internal;
+    recordType.fields = fields;
+    recordType.fieldCount = 4;
+    swtisTestInitType(&listType.internal, SwtiTypeList, "List");
+    listType.itemType = &recordType.internal;
+
+    types[0] = &intType.internal;
+    types[1] = &boolType.internal;
+    types[2] = &stringType.internal;
+    types[3] = &nothingVariant.internal;
+    types[4] = &justVariant.internal;
+    types[5] = &maybeType.internal;
+    types[6] = &recordType.internal;
+    types[7] = &listType.internal;
+    swtisTestInitChunk(&chunk, types, 8);
+}
+
+static int memoryInfoEquals(SwtiMemoryInfo a, SwtiMemoryInfo b)
+{
+    return a.memorySize == b.memorySize && a.memoryAlign == b.memoryAlign;
+}
+
+static void testCompute(void)
+{
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, &swtisLayoutProfile32) == 0)
+    // b at 0, a at 4, s at 8, m (tag and Int) at 12
+    SWTIS_TEST_EXPECT(fields[0].memoryOffsetInfo.memoryOffset == 0)
+    SWTIS_TEST_EXPECT(fields[1].memoryOffsetInfo.memoryOffset == 4)
+    SWTIS_TEST_EXPECT(fields[2].memoryOffsetInfo.memoryOffset == 8)
+    SWTIS_TEST_EXPECT(fields[3].memoryOffsetInfo.memoryOffset == 12)
+    SWTIS_TEST_EXPECT(maybeType.memoryInfo.memorySize == 8 && maybeType.memoryInfo.memoryAlign == 4)
+    SWTIS_TEST_EXPECT(recordType.memoryInfo.memorySize == 20 && recordType.memoryInfo.memoryAlign == 4)
+    SWTIS_TEST_EXPECT(memoryInfoEquals(listType.memoryInfo, recordType.memoryInfo))
+
+    // The reference grows to eight octets, and with it the alignment
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, &swtisLayoutProfile64) == 0)
+    SWTIS_TEST_EXPECT(fields[2].memoryOffsetInfo.memoryOffset == 8)
+    SWTIS_TEST_EXPECT(fields[3].memoryOffsetInfo.memoryOffset == 16)
+    SWTIS_TEST_EXPECT(recordType.memoryInfo.memorySize == 24 && recordType.memoryInfo.memoryAlign == 8)
+
+    SWTIS_TEST_EXPECT(swtisLayoutValidate(&chunk, &swtisLayoutProfile64) == 0)
+    SWTIS_TEST_EXPECT(swtisLayoutValidate(&chunk, &swtisLayoutProfile32) == -6)
+}
+
+/// Without the layout on the wire, the reader computes it for its own profile.
+static void testOmittedRoundTrip(void)
+{
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, &swtisLayoutProfile32) == 0)
+
+    SwtisSerializeOptions serializeOptions;
+    memset(&serializeOptions, 0, sizeof(serializeOptions));
+    static uint8_t full[1024];
+    int fullWritten = swtisSerializeWithOptions(full, sizeof(full), &chunk, &serializeOptions);
+    serializeOptions.formatFlags = SWTIS_FORMAT_FLAG_LAYOUT_OMITTED;
+    static uint8_t octets[1024];
+    int written = swtisSerializeWithOptions(octets, sizeof(octets), &chunk, &serializeOptions);
+    SWTIS_TEST_EXPECT(written > 0 && written < fullWritten)
+
+    const SwtisLayoutProfile* profiles[2] = {&swtisLayoutProfile32, &swtisLayoutProfile64};
+    for (size_t i = 0; i < 2; ++i) {
+        SwtisDeserializeOptions options;
+        memset(&options, 0, sizeof(options));
+        options.layoutProfile = profiles[i];
+
+        SwtiChunk target;
+        SWTIS_TEST_EXPECT(swtisDeserializeWithOptions(octets, (size_t) written, &target, swtisTestAllocator(),
+                                                      &options) == written)
+        SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, profiles[i]) == 0)
+        const SwtiRecordType* record = (const SwtiRecordType*) target.types[6];
+        SWTIS_TEST_EXPECT(memoryInfoEquals(record->memoryInfo, recordType.memoryInfo))
+        for (size_t fieldIndex = 0; fieldIndex < 4; ++fieldIndex) {
+            SWTIS_TEST_EXPECT(record->fields[fieldIndex].memoryOffsetInfo.memoryOffset ==
+                              fields[fieldIndex].memoryOffsetInfo.memoryOffset)
+            SWTIS_TEST_EXPECT(memoryInfoEquals(record->fields[fieldIndex].memoryOffsetInfo.memoryInfo,
+                                               fields[fieldIndex].memoryOffsetInfo.memoryInfo))
+        }
+        SWTIS_TEST_EXPECT(swtisLayoutValidate(&target, profiles[i]) == 0)
+
+        static uint8_t again[1024];
+        SWTIS_TEST_EXPECT(swtisSerializeWithOptions(again, sizeof(again), &target, &serializeOptions) == written)
+        SWTIS_TEST_EXPECT(memcmp(again, octets, (size_t) written) == 0)
+    }
+}
+
+/// A layout on the wire that the reader would not produce is rejected when the reader asks for validation.
+static void testValidateMismatch(void)
+{
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, &swtisLayoutProfile32) == 0)
+    static uint8_t octets[1024];
+    int written = swtisSerialize(octets, sizeof(octets), &chunk);
+    SWTIS_TEST_EXPECT(written > 0)
+
+    SwtisDeserializeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.layoutProfile = &swtisLayoutProfile64;
+
+    SwtiChunk target;
+    SWTIS_TEST_EXPECT(swtisDeserializeWithOptions(octets, (size_t) written, &target, swtisTestAllocator(), &options) ==
+                      written)
+
+    options.validateLayout = 1;
+    SWTIS_TEST_EXPECT(swtisDeserializeWithOptions(octets, (size_t) written, &target, swtisTestAllocator(), &options) ==
+                      -6)
+
+    options.layoutProfile = &swtisLayoutProfile32;
+    SWTIS_TEST_EXPECT(swtisDeserializeWithOptions(octets, (size_t) written, &target, swtisTestAllocator(), &options) ==
+                      written)
+}
+
+int main(void)
+{
+    buildChunk();
+    testCompute();
+    testOmittedRoundTrip();
+    testValidateMismatch();
+
+    return swtisTestResult("layout");
+}
@@ -0,0 +1,228 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/link.h>
+
+// Module: Int 0, String 1, { a : Int, s : String } 2, Function(2, Int) 3, File 4, Pos alias of 2 5
+static SwtiIntType moduleInt;
+static SwtiStringType moduleString;
+static SwtiRecordTypeField moduleFields[2];
+static SwtiRecordType moduleRecord;
+static const SwtiType* moduleParameters[2];
+static SwtiFunctionType moduleFunction;
+static SwtiUnmanagedType moduleFile;
+static SwtiAliasType moduleAlias;
+static const SwtiType* moduleTypes[6];
+static SwtiChunk module;
+
+// Host, in another order: Int 0, { a : Int, s : String } 1, String 2, Rec alias of 1 3, Function(3, Int) 4, File 5
+static SwtiIntType hostInt;
+static SwtiStringType hostString;
+static SwtiRecordTypeField hostFields[2];
+static SwtiRecordType hostRecord;
+static SwtiAliasType hostAlias;
+static const SwtiType* hostParameters[2];
+static SwtiFunctionType hostFunction;
+static SwtiUnmanagedType hostFile;
+static const SwtiType* hostTypes[6];
+static SwtiChunk host;
+
+static const SwtisLinkSymbol moduleSymbols[3] = {{"update", 3}, {"file", 4}, {"pos", 5}};
+static const SwtisLinkSymbol hostSymbols[3] = {{"file", 5}, {"pos", 1}, {"update", 4}};
+
+static void buildRecord(SwtiRecordType* record, SwtiRecordTypeField* fields, const SwtiType* intType,
+                        const SwtiType* stringType)
+{
+    swtisTestInitType(&record->internal, SwtiTypeRecord, "Record");
+    fields[0].name = "a";
+    fields[0].fieldType = intType;
+    fields[1].name = "s";
+    fields[1].fieldType = stringType;
+    record->fields = fields;
+    record->fieldCount = 2;
+}
+
+static void buildChunks(void)
+{
+    swtisTestInitType(&moduleInt.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&moduleString.internal, SwtiTypeString, "String");
+    buildRecord(&moduleRecord, moduleFields, &moduleInt.internal, &moduleString.internal);
+    swtisTestInitType(&moduleFunction.internal, SwtiTypeFunction, "Function");
+    moduleParameters[0] = &moduleRecord.internal;
+    moduleParameters[1] = &moduleInt.internal;
+    moduleFunction.parameterTypes = moduleParameters;
+    moduleFunction.parameterCount = 2;
+    swtisTestInitType(&moduleFile.internal, SwtiTypeUnmanaged, "File");
+    moduleFile.userTypeId = 5;
+    swtisTestInitType(&moduleAlias.internal, SwtiTypeAlias, "Pos");
+    moduleAlias.targetType = &moduleRecord.internal;
+
+    moduleTypes[0] = &moduleInt.internal;
+    moduleTypes[1] = &moduleString.internal;
+    moduleTypes[2] = &moduleRecord.internal;
+    moduleTypes[3] = &moduleFunction.internal;
+    moduleTypes[4] = &moduleFile.internal;
+    moduleTypes[5] = &moduleAlias.internal;
+    swtisTestInitChunk(&module, moduleTypes, 6);
+
+    swtisTestInitType(&hostInt.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&hostString.internal, SwtiTypeString, "String");
+    buildRecord(&hostRecord, hostFields, &hostInt.internal, &hostString.internal);
+    swtisTestInitType(&hostAlias.internal, SwtiTypeAlias, "Rec");
+    hostAlias.targetType = &hostRecord.internal;
+    swtisTestInitType(&hostFunction.internal, SwtiTypeFunction, "Function");
+    hostParameters[0] = &hostAlias.internal;
+    hostParameters[1] = &hostInt.internal;
+    hostFunction.parameterTypes = hostParameters;
+    hostFunction.parameterCount = 2;
+    swtisTestInitType(&hostFile.internal, SwtiTypeUnmanaged, "File");
+    hostFile.userTypeId = 5;
+
+    hostTypes[0] = &hostInt.internal;
+    hostTypes[1] = &hostRecord.internal;
+    hostTypes[2] = &hostString.internal;
+    hostTypes[3] = &hostAlias.internal;
+    hostTypes[4] = &hostFunction.internal;
+    hostTypes[5] = &hostFile.internal;
+    swtisTestInitChunk(&host, hostTypes, 6);
+}
+
+static int check(SwtisLinkMismatch* mismatches, size_t maxMismatchCount)
+{
+    return swtisLinkCheck(&module, moduleSymbols, 3, &host, hostSymbols, 3, mismatches, maxMismatchCount);
+}
+
+static void testEquivalent(void)
+{
+    buildChunks();
+
+    SwtisLinkMismatch mismatches[4];
+    SWTIS_TEST_EXPECT(check(mismatches, 4) == 0)
+}
+
+/// Both symbols that use the record report the field, with the record itself as the innermost difference.
+static void testFieldName(void)
+{
+    buildChunks();
+    hostFields[1].name = "b";
+
+    SwtisLinkMismatch mismatches[4];
+    SWTIS_TEST_EXPECT(check(mismatches, 4) == 2)
+    SWTIS_TEST_EXPECT(strcmp(mismatches[0].name, "update") == 0 && strcmp(mismatches[1].name, "pos") == 0)
+    for (size_t i = 0; i < 2; ++i) {
+        SWTIS_TEST_EXPECT(mismatches[i].reason == SwtisLinkReasonFieldName && mismatches[i].memberIndex == 1)
+        SWTIS_TEST_EXPECT(mismatches[i].moduleTypeIndex == 2 && mismatches[i].hostTypeIndex == 1)
+    }
+
+    // Only as many as there is room for are written, but all are counted
+    SWTIS_TEST_EXPECT(check(mismatches, 1) == 2)
+}
+
+static void testKindAndUserTypeId(void)
+{
+    buildChunks();
+    hostParameters[1] = &hostString.internal;
+    hostFile.userTypeId = 6;
+
+    SwtisLinkMismatch mismatches[4];
+    SWTIS_TEST_EXPECT(check(mismatches, 4) == 2)
+    SWTIS_TEST_EXPECT(strcmp(mismatches[0].name, "update") == 0 && mismatches[0].reason == SwtisLinkReasonKind)
+    SWTIS_TEST_EXPECT(mismatches[0].moduleTypeIndex == 0 && mismatches[0].hostTypeIndex == 2)
+    SWTIS_TEST_EXPECT(strcmp(mismatches[1].name, "file") == 0 && mismatches[1].reason == SwtisLinkReasonUserTypeId)
+}
+
+static void testMissing(void)
+{
+    buildChunks();
+
+    SwtisLinkMismatch mismatches[4];
+    SWTIS_TEST_EXPECT(swtisLinkCheck(&module, moduleSymbols, 3, &host, hostSymbols, 2, mismatches, 4) == 1)
+    SWTIS_TEST_EXPECT(strcmp(mismatches[0].name, "update") == 0 && mismatches[0].reason == SwtisLinkReasonMissing)
+}
+
+/// A type ref id is not the type it refers to, but two of them to equivalent types are equivalent.
+static void testTypeRefId(void)
+{
+    buildChunks();
+
+    static SwtiTypeRefIdType moduleRefId;
+    static SwtiTypeRefIdType hostRefId;
+    static const SwtiType* refIdModuleTypes[7];
+    static const SwtiType* refIdHostTypes[7];
+    memcpy(refIdModuleTypes, moduleTypes, sizeof(moduleTypes));
+    memcpy(refIdHostTypes, hostTypes, sizeof(hostTypes));
+    swtisTestInitType(&moduleRefId.internal, SwtiTypeRefId, "RefId");
+    moduleRefId.referencedType = &moduleRecord.internal;
+    swtisTestInitType(&hostRefId.internal, SwtiTypeRefId, "RefId");
+    hostRefId.referencedType = &hostAlias.internal;
+    refIdModuleTypes[6] = &moduleRefId.internal;
+    refIdHostTypes[6] = &hostRefId.internal;
+    swtisTestInitChunk(&module, refIdModuleTypes, 7);
+    swtisTestInitChunk(&host, refIdHostTypes, 7);
+
+    static const SwtisLinkSymbol refIdModuleSymbols[2] = {{"plain", 6}, {"both", 6}};
+    static const SwtisLinkSymbol refIdHostSymbols[2] = {{"plain", 1}, {"both", 6}};
+    SwtisLinkMismatch mismatches[4];
+    SWTIS_TEST_EXPECT(swtisLinkCheck(&module, refIdModuleSymbols, 2, &host, refIdHostSymbols, 2, mismatches, 4) == 1)
+    SWTIS_TEST_EXPECT(strcmp(mismatches[0].name, "plain") == 0 && mismatches[0].reason == SwtisLinkReasonKind)
+    SWTIS_TEST_EXPECT(mismatches[0].moduleTypeIndex == 6 && mismatches[0].hostTypeIndex == 1)
+
+    // Also through the hash, which is computed before the types are compared
+    hostFields[1].name = "b";
+    SWTIS_TEST_EXPECT(swtisLinkCheck(&module, refIdModuleSymbols + 1, 1, &host, refIdHostSymbols + 1, 1, mismatches,
+                                     4) == 1)
+    SWTIS_TEST_EXPECT(mismatches[0].reason == SwtisLinkReasonFieldName)
+}
+
+/// The deserializer clears generic parameters that it can not resolve. Two cleared ones are equal, but a cleared one
+/// is not equal to a type.
+static void testClearedGenerics(void)
+{
+    buildChunks();
+
+    static SwtiCustomType moduleCustom;
+    static SwtiCustomType hostCustom;
+    static const SwtiType* moduleGenerics[1];
+    static const SwtiType* hostGenerics[1];
+    static const SwtiType* customModuleTypes[7];
+    static const SwtiType* customHostTypes[7];
+    memcpy(customModuleTypes, moduleTypes, sizeof(moduleTypes));
+    memcpy(customHostTypes, hostTypes, sizeof(hostTypes));
+    swtisTestInitType(&moduleCustom.internal, SwtiTypeCustom, "Maybe");
+    moduleCustom.generic.genericTypes = moduleGenerics;
+    moduleCustom.generic.genericCount = 1;
+    moduleCustom.variantTypes = 0;
+    moduleCustom.variantCount = 0;
+    hostCustom = moduleCustom;
+    hostCustom.generic.genericTypes = hostGenerics;
+    customModuleTypes[6] = &moduleCustom.internal;
+    customHostTypes[6] = &hostCustom.internal;
+    swtisTestInitChunk(&module, customModuleTypes, 7);
+    swtisTestInitChunk(&host, customHostTypes, 7);
+
+    static const SwtisLinkSymbol symbols[1] = {{"maybe", 6}};
+    SwtisLinkMismatch mismatches[4];
+    moduleGenerics[0] = 0;
+    hostGenerics[0] = 0;
+    SWTIS_TEST_EXPECT(swtisLinkCheck(&module, symbols, 1, &host, symbols, 1, mismatches, 4) == 0)
+
+    hostGenerics[0] = &hostInt.internal;
+    SWTIS_TEST_EXPECT(swtisLinkCheck(&module, symbols, 1, &host, symbols, 1, mismatches, 4) == 1)
+    SWTIS_TEST_EXPECT(mismatches[0].reason == SwtisLinkReasonKind)
+}
+
+int main(void)
+{
+    testEquivalent();
+    testFieldName();
+    testKindAndUserTypeId();
+    testMissing();
+    testTypeRefId();
+    testClearedGenerics();
+
+    return swtisTestResult("link");
+}
@@ -0,0 +1,118 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/format.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/loader.h>
+#include <swamp-typeinfo-serialize/serialize.h>
+#include <unistd.h>
+
+enum { RecordCount = 200 };
+enum { MaxOctetCount = 64 * 1024 };
+
+static SwtiIntType intType;
+static SwtiStringType stringType;
+static SwtiRecordType records[RecordCount];
+static SwtiRecordTypeField recordFields[RecordCount][2];
+static const SwtiType* types[2 + RecordCount];
+static SwtiChunk chunk;
+
+static void buildChunk(void)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+    types[0] = &intType.internal;
+    types[1] = &stringType.internal;
+
+    for (size_t i = 0; i < RecordCount; ++i) {
+        swtisTestInitType(&records[i].internal, SwtiTypeRecord, "Record");
+        recordFields[i][0].name = "score";
+        recordFields[i][0].fieldType = &intType.internal;
+        recordFields[i][1].name = "name";
+        recordFields[i][1].fieldType = &stringType.internal;
+        records[i].fields = recordFields[i];
+        records[i].fieldCount = 2;
+        types[2 + i] = &records[i].internal;
+    }
+
+    swtisTestInitChunk(&chunk, types, 2 + RecordCount);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+}
+
+static void writeFile(const char* path, const uint8_t* octets, size_t octetCount)
+{
+    FILE* file = fopen(path, "wb");
+    SWTIS_TEST_EXPECT(file != 0)
+    if (file != 0) {
+        SWTIS_TEST_EXPECT(fwrite(octets, 1, octetCount, file) == octetCount)
+        fclose(file);
+    }
+}
+
+/// Loads the file in both modes, with blocks that split it in many places, and checks that it serializes back to
+/// the same octets.
+static void testModes(const char* path, uint8_t formatFlags)
+{
+    static uint8_t octets[MaxOctetCount];
+    static uint8_t again[MaxOctetCount];
+
+    SwtisSerializeOptions serializeOptions;
+    memset(&serializeOptions, 0, sizeof(serializeOptions));
+    serializeOptions.formatFlags = formatFlags;
+    int written = swtisSerializeWithOptions(octets, sizeof(octets), &chunk, &serializeOptions);
+    SWTIS_TEST_EXPECT(written > 0)
+    writeFile(path, octets, (size_t) written);
+
+    const SwtisLoadMode modes[3] = {SwtisLoadModeMap, SwtisLoadModeBlocks, SwtisLoadModeBlocks};
+    const size_t blockSizes[3] = {0, 0, 97};
+    for (size_t i = 0; i < 3; ++i) {
+        SwtisLoadOptions options;
+        memset(&options, 0, sizeof(options));
+        options.mode = modes[i];
+        options.blockSize = blockSizes[i];
+
+        SwtiChunk target;
+        SwtisLoadStats stats;
+        SWTIS_TEST_EXPECT(swtisLoadFile(path, &target, swtisTestAllocator(), &options, &stats) == written)
+        SWTIS_TEST_EXPECT(stats.octetCount == (size_t) written && target.typeCount == chunk.typeCount)
+        SWTIS_TEST_EXPECT(swtisSerializeWithOptions(again, sizeof(again), &target, &serializeOptions) == written)
+        SWTIS_TEST_EXPECT(memcmp(octets, again, (size_t) written) == 0)
+    }
+
+    // A file that ends early fails in both modes
+    writeFile(path, octets, (size_t) written - 1);
+    for (size_t i = 0; i < 3; ++i) {
+        SwtisLoadOptions options;
+        memset(&options, 0, sizeof(options));
+        options.mode = modes[i];
+        options.blockSize = blockSizes[i];
+
+        SwtiChunk target;
+        SWTIS_TEST_EXPECT(swtisLoadFile(path, &target, swtisTestAllocator(), &options, 0) < 0)
+    }
+}
+
+int main(void)
+{
+    buildChunk();
+
+    char path[] = "/tmp/swtis_test_loader_XXXXXX";
+    int fd = mkstemp(path);
+    SWTIS_TEST_EXPECT(fd >= 0)
+    if (fd >= 0) {
+        close(fd);
+        testModes(path, 0);
+        testModes(path, SWTIS_FORMAT_FLAG_LAYOUT_OMITTED);
+        testModes(path, SWTIS_FORMAT_FLAG_SECTIONED | SWTIS_FORMAT_FLAG_CHECKSUM);
+        unlink(path);
+    }
+
+    SwtiChunk target;
+    SWTIS_TEST_EXPECT(swtisLoadFile("/nonexistent/swtis_test_loader", &target, swtisTestAllocator(), 0, 0) < 0)
+
+    return swtisTestResult("loader");
+}
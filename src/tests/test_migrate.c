@@ -0,0 +1,393 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/migrate.h>
+#include <swamp-typeinfo-serialize/value.h>
+
+typedef struct NumberChunk {
+    SwtiIntType intType;
+    SwtiFixedType fixedType;
+    SwtiRecordTypeField fields[1];
+    SwtiRecordType record;
+    const SwtiType* types[3];
+    SwtiChunk chunk;
+} NumberChunk;
+
+/// { v: Int } or { v: Fixed }
+static void buildNumberChunk(NumberChunk* self, SwtiTypeValue fieldType)
+{
+    swtisTestInitType(&self->intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&self->fixedType.internal, SwtiTypeFixed, "Fixed");
+    swtisTestInitType(&self->record.internal, SwtiTypeRecord, "Number");
+    self->fields[0].name = "v";
+    self->fields[0].fieldType = fieldType == SwtiTypeInt ? &self->intType.internal : &self->fixedType.internal;
+    self->record.fields = self->fields;
+    self->record.fieldCount = 1;
+    self->types[0] = &self->intType.internal;
+    self->types[1] = &self->fixedType.internal;
+    self->types[2] = &self->record.internal;
+    swtisTestInitChunk(&self->chunk, self->types, 3);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&self->chunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+}
+
+static void testIntToFixed(void)
+{
+    static NumberChunk oldChunk;
+    static NumberChunk newChunk;
+    buildNumberChunk(&oldChunk, SwtiTypeInt);
+    buildNumberChunk(&newChunk, SwtiTypeFixed);
+
+    SwtisMigration migration;
+    ImprintAllocator* allocator = swtisTestAllocator();
+    swtisMigrationInit(&migration, &oldChunk.chunk, &newChunk.chunk, allocator);
+
+    const SwtisMigrationTable* table;
+    SWTIS_TEST_EXPECT(swtisMigrationPrepare(&migration, &oldChunk.record.internal, &newChunk.record.internal,
+                                            &table) == 0)
+
+    int32_t oldValues[3] = {5, -2147483, 2147483};
+    int32_t newValues[3];
+    SWTIS_TEST_EXPECT(swtisMigrateValues(table, oldValues, 3, newValues, allocator) == 0)
+    SWTIS_TEST_EXPECT(newValues[0] == 5000)
+    SWTIS_TEST_EXPECT(newValues[1] == -2147483000)
+    SWTIS_TEST_EXPECT(newValues[2] == 2147483000)
+
+    int32_t tooBig[2] = {2147484, -3000000};
+    SWTIS_TEST_EXPECT(swtisMigrateValues(table, &tooBig[0], 1, newValues, allocator) == -7)
+    SWTIS_TEST_EXPECT(swtisMigrateValues(table, &tooBig[1], 1, newValues, allocator) == -7)
+
+    const SwtisMigrationTable* back;
+    SWTIS_TEST_EXPECT(swtisMigrationPrepare(&migration, &newChunk.record.internal, &oldChunk.record.internal,
+                                            &back) == -5)
+}
+
+typedef struct CycleChunk {
+    SwtiCustomTypeVariant variant;
+    const SwtiCustomTypeVariant* variants[1];
+    SwtiCustomType custom;
+    SwtiListType listOfS;
+    SwtiListType listOfR;
+    SwtiRecordTypeField rFields[2];
+    SwtiRecordTypeField sFields[1];
+    SwtiRecordType r;
+    SwtiRecordType s;
+    const SwtiType* types[6];
+    SwtiChunk chunk;
+} CycleChunk;
+
+/// R { items: List S, c: C } and S { back: List R }, where C has no variants in the new chunk.
+static void buildCycleChunk(CycleChunk* self, size_t variantCount)
+{
+    swtisTestInitType(&self->variant.internal, SwtiTypeCustomVariant, "V");
+    self->variant.name = "V";
+    self->variant.inCustomType = &self->custom;
+    self->variant.fields = 0;
+    self->variant.paramCount = 0;
+    self->variants[0] = &self->variant;
+    swtisTestInitType(&self->custom.internal, SwtiTypeCustom, "C");
+    self->custom.generic.genericTypes = 0;
+    self->custom.generic.genericCount = 0;
+    self->custom.variantTypes = self->variants;
+    self->custom.variantCount = variantCount;
+    swtisTestInitType(&self->listOfS.internal, SwtiTypeList, "List");
+    self->listOfS.itemType = &self->s.internal;
+    swtisTestInitType(&self->listOfR.internal, SwtiTypeList, "List");
+    self->listOfR.itemType = &self->r.internal;
+    swtisTestInitType(&self->r.internal, SwtiTypeRecord, "R");
+    self->rFields[0].name = "items";
+    self->rFields[0].fieldType = &self->listOfS.internal;
+    self->rFields[1].name = "c";
+    self->rFields[1].fieldType = &self->custom.internal;
+    self->r.fields = self->rFields;
+    self->r.fieldCount = 2;
+    swtisTestInitType(&self->s.internal, SwtiTypeRecord, "S");
+    self->sFields[0].name = "back";
+    self->sFields[0].fieldType = &self->listOfR.internal;
+    self->s.fields = self->sFields;
+    self->s.fieldCount = 1;
+
+    self->types[0] = &self->r.internal;
+    self->types[1] = &self->s.internal;
+    self->types[2] = &self->listOfS.internal;
+    self->types[3] = &self->listOfR.internal;
+    self->types[4] = &self->custom.internal;
+    self->types[5] = &self->variant.internal;
+    swtisTestInitChunk(&self->chunk, self->types, 6);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&self->chunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+}
+
+/// The table for S is built while building R, and refers to it. When R fails, S must not stay behind.
+static void testFailedPrepareIsRolledBack(void)
+{
+    static CycleChunk oldChunk;
+    static CycleChunk newChunk;
+    buildCycleChunk(&oldChunk, 1);
+    buildCycleChunk(&newChunk, 0);
+
+    SwtisMigration migration;
+    swtisMigrationInit(&migration, &oldChunk.chunk, &newChunk.chunk, swtisTestAllocator());
+
+    const SwtisMigrationTable* table;
+    SWTIS_TEST_EXPECT(swtisMigrationPrepare(&migration, &oldChunk.r.internal, &newChunk.r.internal, &table) == -3)
+    for (size_t i = 0; i < oldChunk.chunk.typeCount; ++i) {
+        SWTIS_TEST_EXPECT(migration.tablesByOldIndex[i] == 0)
+    }
+    SWTIS_TEST_EXPECT(migration.lastBuilt == 0)
+    SWTIS_TEST_EXPECT(swtisMigrationPrepare(&migration, &oldChunk.s.internal, &newChunk.s.internal, &table) == -3)
+}
+
+typedef struct SceneChunk {
+    SwtiIntType intType;
+    SwtiRecordTypeField pointFields[3];
+    SwtiRecordType point;
+    SwtiListType points;
+    SwtiCustomTypeVariantField circleFields[1];
+    SwtiCustomTypeVariantField rectFields[2];
+    SwtiCustomTypeVariant circle;
+    SwtiCustomTypeVariant rect;
+    SwtiCustomTypeVariant dot;
+    const SwtiCustomTypeVariant* variants[3];
+    SwtiCustomType shape;
+    SwtiRecordTypeField sceneFields[3];
+    SwtiRecordType scene;
+    const SwtiType* types[8];
+    SwtiChunk chunk;
+} SceneChunk;
+
+static void initVariant(SceneChunk* self, SwtiCustomTypeVariant* variant, const char* name,
+                        SwtiCustomTypeVariantField* fields, size_t paramCount)
+{
+    swtisTestInitType(&variant->internal, SwtiTypeCustomVariant, name);
+    variant->name = name;
+    variant->inCustomType = &self->shape;
+    for (size_t i = 0; i < paramCount; ++i) {
+        fields[i].fieldType = &self->intType.internal;
+    }
+    variant->fields = fields;
+    variant->paramCount = paramCount;
+}
+
+static void initRecord(SwtiRecordType* record, const char* name, SwtiRecordTypeField* fields, const char* const* names,
+                       const SwtiType* const* fieldTypes, size_t fieldCount)
+{
+    swtisTestInitType(&record->internal, SwtiTypeRecord, name);
+    for (size_t i = 0; i < fieldCount; ++i) {
+        fields[i].name = names[i];
+        fields[i].fieldType = fieldTypes[i];
+    }
+    record->fields = fields;
+    record->fieldCount = fieldCount;
+}
+
+/// Old: Point { x, y, z : Int }, Shape = Circle Int | Rect Int Int | Dot and Scene { points : List Point,
+/// shape : Shape, id : Int }.
+/// New: Point { z, x, w : Int } (y removed, w added), Shape = Dot | Rect Int Int | Ring Int and Scene { id : Int,
+/// shape : Shape, points : List Point }.
+static void buildSceneChunk(SceneChunk* self, int isNew)
+{
+    swtisTestInitType(&self->intType.internal, SwtiTypeInt, "Int");
+
+    static const char* const oldPointNames[] = {"x", "y", "z"};
+    static const char* const newPointNames[] = {"z", "x", "w"};
+    const SwtiType* pointTypes[] = {&self->intType.internal, &self->intType.internal, &self->intType.internal};
+    initRecord(&self->point, "Point", self->pointFields, isNew ? newPointNames : oldPointNames, pointTypes, 3);
+
+    swtisTestInitType(&self->points.internal, SwtiTypeList, "List");
+    self->points.itemType = &self->point.internal;
+
+    initVariant(self, &self->circle, isNew ? "Ring" : "Circle", self->circleFields, 1);
+    initVariant(self, &self->rect, "Rect", self->rectFields, 2);
+    initVariant(self, &self->dot, "Dot", 0, 0);
+    self->variants[0] = isNew ? &self->dot : &self->circle;
+    self->variants[1] = &self->rect;
+    self->variants[2] = isNew ? &self->circle : &self->dot;
+    swtisTestInitType(&self->shape.internal, SwtiTypeCustom, "Shape");
+    self->shape.generic.genericTypes = 0;
+    self->shape.generic.genericCount = 0;
+    self->shape.variantTypes = self->variants;
+    self->shape.variantCount = 3;
+
+    static const char* const oldSceneNames[] = {"points", "shape", "id"};
+    static const char* const newSceneNames[] = {"id", "shape", "points"};
+    const SwtiType* oldSceneTypes[] = {&self->points.internal, &self->shape.internal, &self->intType.internal};
+    const SwtiType* newSceneTypes[] = {&self->intType.internal, &self->shape.internal, &self->points.internal};
+    initRecord(&self->scene, "Scene", self->sceneFields, isNew ? newSceneNames : oldSceneNames,
+               isNew ? newSceneTypes : oldSceneTypes, 3);
+
+    self->types[0] = &self->intType.internal;
+    self->types[1] = &self->point.internal;
+    self->types[2] = &self->points.internal;
+    self->types[3] = &self->circle.internal;
+    self->types[4] = &self->rect.internal;
+    self->types[5] = &self->dot.internal;
+    self->types[6] = &self->shape.internal;
+    self->types[7] = &self->scene.internal;
+    swtisTestInitChunk(&self->chunk, self->types, 8);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&self->chunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+}
+
+static SceneChunk oldScene;
+static SceneChunk newScene;
+
+static const SwtisMigrationVariantRename circleToRing[] = {{"Shape", "Circle", "Ring"}};
+
+static void writeInt(uint8_t* value, const SwtiMemoryOffsetInfo* info, int32_t x)
+{
+    memcpy(value + info->memoryOffset, &x, sizeof(x));
+}
+
+static int32_t readInt(const uint8_t* value, const SwtiMemoryOffsetInfo* info)
+{
+    int32_t x;
+    memcpy(&x, value + info->memoryOffset, sizeof(x));
+    return x;
+}
+
+/// Fields are matched by name, whatever their position. Removed fields are dropped and added fields are zero.
+static void testRecordFields(void)
+{
+    SwtisMigration migration;
+    ImprintAllocator* allocator = swtisTestAllocator();
+    swtisMigrationInit(&migration, &oldScene.chunk, &newScene.chunk, allocator);
+
+    const SwtisMigrationTable* table;
+    SWTIS_TEST_EXPECT(swtisMigrationPrepare(&migration, &oldScene.point.internal, &newScene.point.internal, &table) ==
+                      0)
+    SWTIS_TEST_EXPECT(!table->isIdentical)
+
+    int32_t oldPoints[2][3] = {{1, 2, 3}, {-4, -5, -6}};
+    int32_t newPoints[2][3];
+    memset(newPoints, 0xff, sizeof(newPoints));
+    SWTIS_TEST_EXPECT(swtisMigrateValues(table, oldPoints, 2, newPoints, allocator) == 0)
+    // z, x, w
+    SWTIS_TEST_EXPECT(newPoints[0][0] == 3 && newPoints[0][1] == 1 && newPoints[0][2] == 0)
+    SWTIS_TEST_EXPECT(newPoints[1][0] == -6 && newPoints[1][1] == -4 && newPoints[1][2] == 0)
+
+    // The same layout is copied as is
+    SwtisMigration same;
+    swtisMigrationInit(&same, &oldScene.chunk, &oldScene.chunk, allocator);
+    SWTIS_TEST_EXPECT(swtisMigrationPrepare(&same, &oldScene.point.internal, &oldScene.point.internal, &table) == 0)
+    SWTIS_TEST_EXPECT(table->isIdentical)
+}
+
+/// Variants are matched by name, also when they move. A variant that is gone fails the prepare, unless it is renamed.
+static void testVariants(void)
+{
+    SwtisMigration migration;
+    ImprintAllocator* allocator = swtisTestAllocator();
+    swtisMigrationInit(&migration, &oldScene.chunk, &newScene.chunk, allocator);
+
+    const SwtisMigrationTable* table;
+    SWTIS_TEST_EXPECT(swtisMigrationPrepare(&migration, &oldScene.shape.internal, &newScene.shape.internal, &table) ==
+                      -8)
+    SWTIS_TEST_EXPECT(migration.lastBuilt == 0)
+    SWTIS_TEST_EXPECT(swtisMigrationPrepareByName(&migration, &oldScene.shape.internal, &table) == -8)
+
+    swtisMigrationSetVariantRenames(&migration, circleToRing, 1);
+    SWTIS_TEST_EXPECT(swtisMigrationPrepareByName(&migration, &oldScene.shape.internal, &table) == 0)
+    SWTIS_TEST_EXPECT(table->variantCount == 3)
+    SWTIS_TEST_EXPECT(table->variants[0].newVariantIndex == 2)
+    SWTIS_TEST_EXPECT(table->variants[1].newVariantIndex == 1)
+    SWTIS_TEST_EXPECT(table->variants[2].newVariantIndex == 0)
+
+    size_t oldSize = oldScene.shape.memoryInfo.memorySize;
+    size_t newSize = newScene.shape.memoryInfo.memorySize;
+    uint8_t oldShapes[3][16];
+    uint8_t newShapes[3][16];
+    SWTIS_TEST_EXPECT(oldSize <= sizeof(oldShapes[0]) && newSize <= sizeof(newShapes[0]) && oldSize == newSize)
+    memset(oldShapes, 0, sizeof(oldShapes));
+    oldShapes[0][0] = 0;
+    writeInt(oldShapes[0], &oldScene.circleFields[0].memoryOffsetInfo, 7);
+    oldShapes[1][0] = 1;
+    writeInt(oldShapes[1], &oldScene.rectFields[0].memoryOffsetInfo, 10);
+    writeInt(oldShapes[1], &oldScene.rectFields[1].memoryOffsetInfo, 20);
+    oldShapes[2][0] = 2;
+
+    for (size_t i = 0; i < 3; ++i) {
+        SWTIS_TEST_EXPECT(swtisMigrateValues(table, oldShapes[i], 1, newShapes[i], allocator) == 0)
+    }
+    SWTIS_TEST_EXPECT(newShapes[0][0] == 2 && readInt(newShapes[0], &newScene.circleFields[0].memoryOffsetInfo) == 7)
+    SWTIS_TEST_EXPECT(newShapes[1][0] == 1 && readInt(newShapes[1], &newScene.rectFields[0].memoryOffsetInfo) == 10 &&
+                      readInt(newShapes[1], &newScene.rectFields[1].memoryOffsetInfo) == 20)
+    SWTIS_TEST_EXPECT(newShapes[2][0] == 0)
+
+    oldShapes[0][0] = 3;
+    SWTIS_TEST_EXPECT(swtisMigrateValues(table, oldShapes[0], 1, newShapes[0], allocator) == -6)
+
+    // A rename to a variant that does not exist is not matched either
+    static const SwtisMigrationVariantRename circleToOval[] = {{"Shape", "Circle", "Oval"}};
+    SwtisMigration wrong;
+    swtisMigrationInit(&wrong, &oldScene.chunk, &newScene.chunk, allocator);
+    swtisMigrationSetVariantRenames(&wrong, circleToOval, 1);
+    SWTIS_TEST_EXPECT(swtisMigrationPrepareByName(&wrong, &oldScene.shape.internal, &table) == -8)
+}
+
+/// A reordered record that holds a migrated custom type and a list of migrated records.
+static void testNested(void)
+{
+    SwtisMigration migration;
+    ImprintAllocator* allocator = swtisTestAllocator();
+    swtisMigrationInit(&migration, &oldScene.chunk, &newScene.chunk, allocator);
+    swtisMigrationSetVariantRenames(&migration, circleToRing, 1);
+
+    const SwtisMigrationTable* table;
+    SWTIS_TEST_EXPECT(swtisMigrationPrepare(&migration, &oldScene.scene.internal, &newScene.scene.internal, &table) ==
+                      0)
+
+    int32_t oldPoints[2][3] = {{1, 2, 3}, {4, 5, 6}};
+    SwtisValueList oldList;
+    oldList.value = oldPoints;
+    oldList.count = 2;
+    oldList.itemSize = sizeof(oldPoints[0]);
+    oldList.itemAlign = sizeof(int32_t);
+    const SwtisValueList* oldListPointer = &oldList;
+
+    uint8_t oldValue[64];
+    uint8_t newValue[64];
+    SWTIS_TEST_EXPECT(oldScene.scene.memoryInfo.memorySize <= sizeof(oldValue) &&
+                      newScene.scene.memoryInfo.memorySize <= sizeof(newValue))
+    memset(oldValue, 0, sizeof(oldValue));
+    memcpy(oldValue + oldScene.sceneFields[0].memoryOffsetInfo.memoryOffset, &oldListPointer, sizeof(oldListPointer));
+    uint8_t* oldShape = oldValue + oldScene.sceneFields[1].memoryOffsetInfo.memoryOffset;
+    oldShape[0] = 0;
+    writeInt(oldShape, &oldScene.circleFields[0].memoryOffsetInfo, 9);
+    writeInt(oldValue, &oldScene.sceneFields[2].memoryOffsetInfo, 42);
+
+    SWTIS_TEST_EXPECT(swtisMigrateValues(table, oldValue, 1, newValue, allocator) == 0)
+    SWTIS_TEST_EXPECT(readInt(newValue, &newScene.sceneFields[0].memoryOffsetInfo) == 42)
+    const uint8_t* newShape = newValue + newScene.sceneFields[1].memoryOffsetInfo.memoryOffset;
+    SWTIS_TEST_EXPECT(newShape[0] == 2 && readInt(newShape, &newScene.circleFields[0].memoryOffsetInfo) == 9)
+
+    const SwtisValueList* newList;
+    memcpy((void*) &newList, newValue + newScene.sceneFields[2].memoryOffsetInfo.memoryOffset, sizeof(newList));
+    SWTIS_TEST_EXPECT(newList != 0 && newList != &oldList)
+    SWTIS_TEST_EXPECT(newList->count == 2 && newList->itemSize == newScene.point.memoryInfo.memorySize)
+    const int32_t* newPoints = (const int32_t*) newList->value;
+    SWTIS_TEST_EXPECT(newPoints[0] == 3 && newPoints[1] == 1 && newPoints[2] == 0)
+    SWTIS_TEST_EXPECT(newPoints[3] == 6 && newPoints[4] == 4 && newPoints[5] == 0)
+
+    // An empty list stays empty
+    memset(oldValue + oldScene.sceneFields[0].memoryOffsetInfo.memoryOffset, 0, sizeof(oldListPointer));
+    SWTIS_TEST_EXPECT(swtisMigrateValues(table, oldValue, 1, newValue, allocator) == 0)
+    memcpy((void*) &newList, newValue + newScene.sceneFields[2].memoryOffsetInfo.memoryOffset, sizeof(newList));
+    SWTIS_TEST_EXPECT(newList == 0)
+}
+
+int main(void)
+{
+    testIntToFixed();
+    testFailedPrepareIsRolledBack();
+
+    buildSceneChunk(&oldScene, 0);
+    buildSceneChunk(&newScene, 1);
+    testRecordFields();
+    testVariants();
+    testNested();
+
+    return swtisTestResult("migrate");
+}
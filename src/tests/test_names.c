@@ -0,0 +1,129 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo-serialize/format.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/names.h>
+#include <swamp-typeinfo-serialize/serialize.h>
+
+static SwtiIntType intType;
+static SwtiCustomTypeVariant nothingVariant;
+static SwtiCustomTypeVariant justVariant;
+static SwtiCustomTypeVariantField justFields[1];
+static const SwtiCustomTypeVariant* maybeVariants[2];
+static SwtiCustomType maybeType;
+static SwtiRecordTypeField fields[2];
+static SwtiRecordType recordType;
+static const SwtiType* types[5];
+static SwtiChunk chunk;
+
+/// Int 0, Nothing 1, Just Int 2, Maybe 3, { score : Int, best : Maybe } 4.
+static void buildChunk(void)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&nothingVariant.internal, SwtiTypeCustomVariant, "Nothing");
+    nothingVariant.name = "Nothing";
+    nothingVariant.inCustomType = &maybeType;
+    nothingVariant.fields = 0;
+    nothingVariant.paramCount = 0;
+    swtisTestInitType(&justVariant.internal, SwtiTypeCustomVariant, "Just");
+    justVariant.name = "Just";
+    justVariant.inCustomType = &maybeType;
+    justFields[0].fieldType = &intType.internal;
+    justVariant.fields = justFields;
+    justVariant.paramCount = 1;
+    maybeVariants[0] = &nothingVariant;
+    maybeVariants[1] = &justVariant;
+    swtisTestInitType(&maybeType.internal, SwtiTypeCustom, "Maybe");
+    maybeType.generic.genericTypes = 0;
+    maybeType.generic.genericCount = 0;
+    maybeType.variantTypes = maybeVariants;
+    maybeType.variantCount = 2;
+    swtisTestInitType(&recordType.internal, SwtiTypeRecord, "Record");
+    fields[0].name = "score";
+    fields[0].fieldType = &intType.internal;
+    fields[1].name = "best";
+    fields[1].fieldType = &maybeType.internal;
+    recordType.fields = fields;
+    recordType.fieldCount = 2;
+
+    types[0] = &intType.internal;
+    types[1] = &nothingVariant.internal;
+    types[2] = &justVariant.internal;
+    types[3] = &maybeType.internal;
+    types[4] = &recordType.internal;
+    swtisTestInitChunk(&chunk, types, 5);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+}
+
+static int serialize(uint8_t* octets, size_t octetCount, int stripNames)
+{
+    SwtisSerializeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.formatFlags = SWTIS_FORMAT_FLAG_SECTIONED;
+    options.stripNames = stripNames;
+
+    return swtisSerializeWithOptions(octets, octetCount, &chunk, &options);
+}
+
+static void testLazyNames(void)
+{
+    static uint8_t octets[512];
+    int written = serialize(octets, sizeof(octets), 0);
+    SWTIS_TEST_EXPECT(written > 0)
+
+    SwtisDeserializeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.lazyNames = 1;
+    SwtiChunk target;
+    SWTIS_TEST_EXPECT(swtisDeserializeWithOptions(octets, (size_t) written, &target, swtisTestAllocator(), &options) ==
+                      written)
+    const SwtiRecordType* record = (const SwtiRecordType*) target.types[4];
+    SWTIS_TEST_EXPECT(strcmp(target.types[3]->name, "") == 0 && strcmp(record->fields[0].name, "") == 0)
+
+    SwtisNames names;
+    SWTIS_TEST_EXPECT(swtisNamesInit(&names, &target, octets, (size_t) written) == 0)
+    SWTIS_TEST_EXPECT(swtisNamesType(&names, 0) == 0)
+    SWTIS_TEST_EXPECT(strcmp(swtisNamesType(&names, 1), "Nothing") == 0)
+    SWTIS_TEST_EXPECT(strcmp(swtisNamesType(&names, 2), "Just") == 0)
+    SWTIS_TEST_EXPECT(strcmp(swtisNamesType(&names, 3), "Maybe") == 0)
+    SWTIS_TEST_EXPECT(strcmp(swtisNamesRecordField(&names, 4, 0), "score") == 0)
+    SWTIS_TEST_EXPECT(strcmp(swtisNamesRecordField(&names, 4, 1), "best") == 0)
+    SWTIS_TEST_EXPECT(swtisNamesRecordField(&names, 4, 2) == 0)
+    SWTIS_TEST_EXPECT(swtisNamesType(&names, 5) == 0)
+
+    SWTIS_TEST_EXPECT(swtisNamesApply(&names, &target) == 0)
+    SWTIS_TEST_EXPECT(strcmp(target.types[3]->name, "Maybe") == 0)
+    SWTIS_TEST_EXPECT(strcmp(((const SwtiCustomTypeVariant*) target.types[2])->name, "Just") == 0)
+    SWTIS_TEST_EXPECT(strcmp(record->fields[1].name, "best") == 0)
+    swtisNamesDestroy(&names);
+}
+
+static void testStrippedNames(void)
+{
+    static uint8_t octets[512];
+    static uint8_t withNames[512];
+    int written = serialize(octets, sizeof(octets), 1);
+    SWTIS_TEST_EXPECT(written > 0 && written < serialize(withNames, sizeof(withNames), 0))
+
+    SwtiChunk target;
+    SWTIS_TEST_EXPECT(swtisDeserialize(octets, (size_t) written, &target, swtisTestAllocator()) == written)
+    SWTIS_TEST_EXPECT(target.typeCount == 5)
+
+    SwtisNames names;
+    SWTIS_TEST_EXPECT(swtisNamesInit(&names, &target, octets, (size_t) written) == -1)
+}
+
+int main(void)
+{
+    buildChunk();
+    testLazyNames();
+    testStrippedNames();
+
+    return swtisTestResult("names");
+}
@@ -0,0 +1,189 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <flood/in_stream.h>
+#include <flood/out_stream.h>
+#include <string.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/plan.h>
+#include <swamp-typeinfo-serialize/value.h>
+
+/// R { items: List S, f: Function } and S { back: List R }. Compiling R compiles S on the way and then fails on the
+/// function, so S must not be left behind pointing at the plan of R.
+static void testFailedCompileIsRolledBack(void)
+{
+    static SwtiFunctionType functionType;
+    static SwtiListType listOfS;
+    static SwtiListType listOfR;
+    static SwtiRecordTypeField rFields[2];
+    static SwtiRecordTypeField sFields[1];
+    static SwtiRecordType r;
+    static SwtiRecordType s;
+    static const SwtiType* types[5];
+    SwtiChunk chunk;
+
+    swtisTestInitType(&functionType.internal, SwtiTypeFunction, "Function");
+    functionType.parameterTypes = 0;
+    functionType.parameterCount = 0;
+    swtisTestInitType(&listOfS.internal, SwtiTypeList, "List");
+    listOfS.itemType = &s.internal;
+    swtisTestInitType(&listOfR.internal, SwtiTypeList, "List");
+    listOfR.itemType = &r.internal;
+    swtisTestInitType(&r.internal, SwtiTypeRecord, "R");
+    rFields[0].name = "items";
+    rFields[0].fieldType = &listOfS.internal;
+    rFields[1].name = "f";
+    rFields[1].fieldType = &functionType.internal;
+    r.fields = rFields;
+    r.fieldCount = 2;
+    swtisTestInitType(&s.internal, SwtiTypeRecord, "S");
+    sFields[0].name = "back";
+    sFields[0].fieldType = &listOfR.internal;
+    s.fields = sFields;
+    s.fieldCount = 1;
+
+    types[0] = &r.internal;
+    types[1] = &s.internal;
+    types[2] = &listOfS.internal;
+    types[3] = &listOfR.internal;
+    types[4] = &functionType.internal;
+    swtisTestInitChunk(&chunk, types, 5);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+
+    SwtisPlanCache cache;
+    swtisPlanCacheInit(&cache, &chunk, swtisTestAllocator());
+
+    const SwtisPlan* plan = 0;
+    SWTIS_TEST_EXPECT(swtisPlanCacheGet(&cache, &r.internal, &plan) == -1)
+    for (size_t i = 0; i < chunk.typeCount; ++i) {
+        SWTIS_TEST_EXPECT(cache.plans[i] == 0)
+    }
+    SWTIS_TEST_EXPECT(swtisPlanCacheGet(&cache, &s.internal, &plan) == -1)
+    SWTIS_TEST_EXPECT(swtisPlanCacheCompileAll(&cache) == -1)
+}
+
+typedef struct Item {
+    int32_t a;
+    uint8_t b;
+    const SwtisValueString* name;
+} Item;
+
+/// The plan must write the same octets as the value codec and read them back.
+static void testRoundTrip(void)
+{
+    static SwtiIntType intType;
+    static SwtiBooleanType boolType;
+    static SwtiStringType stringType;
+    static SwtiRecordTypeField fields[3];
+    static SwtiRecordType record;
+    static SwtiListType list;
+    static const SwtiType* types[5];
+    SwtiChunk chunk;
+
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&boolType.internal, SwtiTypeBoolean, "Bool");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+    swtisTestInitType(&record.internal, SwtiTypeRecord, "Item");
+    fields[0].name = "a";
+    fields[0].fieldType = &intType.internal;
+    fields[1].name = "b";
+    fields[1].fieldType = &boolType.internal;
+    fields[2].name = "name";
+    fields[2].fieldType = &stringType.internal;
+    record.fields = fields;
+    record.fieldCount = 3;
+    swtisTestInitType(&list.internal, SwtiTypeList, "List");
+    list.itemType = &record.internal;
+
+    types[0] = &intType.internal;
+    types[1] = &boolType.internal;
+    types[2] = &stringType.internal;
+    types[3] = &record.internal;
+    types[4] = &list.internal;
+    swtisTestInitChunk(&chunk, types, 5);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+    SWTIS_TEST_EXPECT(record.memoryInfo.memorySize == sizeof(Item))
+
+    SwtisValueString names[2] = {{"first", 5}, {"", 0}};
+    Item items[2] = {{-1, 1, &names[0]}, {0x7fffffff, 0, &names[1]}};
+    SwtisValueList value = {items, 2, sizeof(Item), 8};
+    const SwtisValueList* valuePointer = &value;
+
+    uint8_t expected[256];
+    FldOutStream outStream;
+    fldOutStreamInit(&outStream, expected, sizeof(expected));
+    int expectedCount = swtisSerializeValue(&outStream, &list.internal, &valuePointer);
+    SWTIS_TEST_EXPECT(expectedCount > 0)
+
+    SwtisPlanCache cache;
+    ImprintAllocator* allocator = swtisTestAllocator();
+    swtisPlanCacheInit(&cache, &chunk, allocator);
+    SWTIS_TEST_EXPECT(swtisPlanCacheCompileAll(&cache) == 0)
+    const SwtisPlan* plan;
+    SWTIS_TEST_EXPECT(swtisPlanCacheGet(&cache, &list.internal, &plan) == 0)
+
+    uint8_t octets[256];
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    SWTIS_TEST_EXPECT(swtisPlanSerializeValue(plan, &outStream, &valuePointer) == expectedCount)
+    SWTIS_TEST_EXPECT(memcmp(octets, expected, (size_t) expectedCount) == 0)
+
+    const SwtisValueList* readBack = 0;
+    FldInStream inStream;
+    fldInStreamInit(&inStream, octets, (size_t) expectedCount);
+    SWTIS_TEST_EXPECT(swtisPlanDeserializeValue(plan, &inStream, &readBack, allocator) == expectedCount)
+    SWTIS_TEST_EXPECT(readBack->count == 2)
+    const Item* readItems = readBack->value;
+    SWTIS_TEST_EXPECT(readItems[0].a == -1 && readItems[0].b == 1 && readItems[0].name->characterCount == 5)
+    SWTIS_TEST_EXPECT(readItems[1].a == 0x7fffffff && readItems[1].b == 0 && readItems[1].name->characterCount == 0)
+
+    fldInStreamInit(&inStream, octets, (size_t) expectedCount - 1);
+    SWTIS_TEST_EXPECT(swtisPlanDeserializeValue(plan, &inStream, &readBack, allocator) < 0)
+}
+
+/// An empty record takes no octets, so a long list of them is only the count on the wire.
+static void testListOfEmptyRecords(void)
+{
+    static SwtiRecordType emptyType;
+    static SwtiListType emptyListType;
+    static const SwtiType* types[2];
+    SwtiChunk chunk;
+
+    swtisTestInitType(&emptyType.internal, SwtiTypeRecord, "Empty");
+    emptyType.fields = 0;
+    emptyType.fieldCount = 0;
+    swtisTestInitType(&emptyListType.internal, SwtiTypeList, "List");
+    emptyListType.itemType = &emptyType.internal;
+    types[0] = &emptyType.internal;
+    types[1] = &emptyListType.internal;
+    swtisTestInitChunk(&chunk, types, 2);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+
+    SwtisPlanCache cache;
+    ImprintAllocator* allocator = swtisTestAllocator();
+    swtisPlanCacheInit(&cache, &chunk, allocator);
+    const SwtisPlan* plan;
+    SWTIS_TEST_EXPECT(swtisPlanCacheGet(&cache, &emptyListType.internal, &plan) == 0)
+
+    static const uint8_t wire[] = {0xe8, 0x03, 0, 0};
+    const SwtisValueList* readBack = 0;
+    FldInStream inStream;
+    fldInStreamInit(&inStream, wire, sizeof(wire));
+    SWTIS_TEST_EXPECT(swtisPlanDeserializeValue(plan, &inStream, &readBack, allocator) == 4)
+    SWTIS_TEST_EXPECT(readBack != 0 && readBack->count == 1000)
+
+    static const uint8_t tooMany[] = {0xff, 0xff, 0xff, 0xff};
+    fldInStreamInit(&inStream, tooMany, sizeof(tooMany));
+    SWTIS_TEST_EXPECT(swtisPlanDeserializeValue(plan, &inStream, &readBack, allocator) == -7)
+}
+
+int main(void)
+{
+    testFailedCompileIsRolledBack();
+    testRoundTrip();
+    testListOfEmptyRecords();
+
+    return swtisTestResult("plan");
+}
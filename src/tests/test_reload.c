@@ -0,0 +1,107 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/reload.h>
+#include <swamp-typeinfo-serialize/serialize.h>
+
+typedef struct Blob {
+    uint8_t octets[64];
+    size_t octetCount;
+} Blob;
+
+static SwtiIntType intType;
+static SwtiBooleanType boolType;
+static SwtiStringType stringType;
+static const SwtiType* types[3];
+
+/// Three different blobs, with the first one, two and three types.
+static Blob blobs[3];
+
+static void buildBlobs(void)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&boolType.internal, SwtiTypeBoolean, "Bool");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+    types[0] = &intType.internal;
+    types[1] = &boolType.internal;
+    types[2] = &stringType.internal;
+
+    for (size_t i = 0; i < 3; ++i) {
+        SwtiChunk chunk;
+        swtisTestInitChunk(&chunk, types, i + 1);
+        int written = swtisSerialize(blobs[i].octets, sizeof(blobs[i].octets), &chunk);
+        SWTIS_TEST_EXPECT(written > 0)
+        blobs[i].octetCount = (size_t) written;
+    }
+}
+
+static int reload(SwtisReloader* reloader, size_t blobIndex)
+{
+    return swtisReloaderReload(reloader, blobs[blobIndex].octets, blobs[blobIndex].octetCount);
+}
+
+static void testReload(void)
+{
+    SwtisReloaderOptions options;
+    memset(&options, 0, sizeof(options));
+    options.maxReaderCount = 1;
+    SwtisReloader* reloader = swtisReloaderCreate(&options);
+
+    SwtisReloadReader* reader;
+    SwtisReloadReader* tooMany;
+    SWTIS_TEST_EXPECT(swtisReloadReaderRegister(reloader, &reader) == 0)
+    SWTIS_TEST_EXPECT(swtisReloadReaderRegister(reloader, &tooMany) == -4)
+    // Each reader has a cache line of its own
+    SWTIS_TEST_EXPECT(((uintptr_t) reader & 63) == 0)
+
+    SWTIS_TEST_EXPECT(swtisReloadReaderEnter(reader) == 0)
+    swtisReloadReaderLeave(reader);
+    SWTIS_TEST_EXPECT(swtisReloaderGeneration(reloader) == 0)
+
+    SWTIS_TEST_EXPECT(reload(reloader, 0) == (int) blobs[0].octetCount && swtisReloaderGeneration(reloader) == 1)
+    const SwtiChunk* chunk = swtisReloadReaderEnter(reader);
+    SWTIS_TEST_EXPECT(chunk != 0 && chunk->typeCount == 1)
+
+    // The reader keeps the first chunk while the second one is published into the other arena
+    SWTIS_TEST_EXPECT(reload(reloader, 1) == (int) blobs[1].octetCount && swtisReloaderGeneration(reloader) == 2)
+    SWTIS_TEST_EXPECT(chunk->typeCount == 1)
+
+    // Both arenas are in use until the reader leaves
+    SWTIS_TEST_EXPECT(swtisReloaderCollect(reloader) == 0)
+    SWTIS_TEST_EXPECT(reload(reloader, 2) == -4 && swtisReloaderGeneration(reloader) == 2)
+    swtisReloadReaderLeave(reader);
+    SWTIS_TEST_EXPECT(swtisReloaderCollect(reloader) == 1)
+
+    chunk = swtisReloadReaderEnter(reader);
+    SWTIS_TEST_EXPECT(chunk != 0 && chunk->typeCount == 2)
+    swtisReloadReaderLeave(reader);
+
+    // A blob that fails to load keeps the current chunk
+    SWTIS_TEST_EXPECT(swtisReloaderReload(reloader, blobs[2].octets, blobs[2].octetCount - 1) < 0)
+    SWTIS_TEST_EXPECT(swtisReloaderGeneration(reloader) == 2)
+    chunk = swtisReloadReaderEnter(reader);
+    SWTIS_TEST_EXPECT(chunk != 0 && chunk->typeCount == 2)
+    swtisReloadReaderLeave(reader);
+
+    SWTIS_TEST_EXPECT(reload(reloader, 2) == (int) blobs[2].octetCount && swtisReloaderGeneration(reloader) == 3)
+    chunk = swtisReloadReaderEnter(reader);
+    SWTIS_TEST_EXPECT(chunk != 0 && chunk->typeCount == 3)
+    swtisReloadReaderLeave(reader);
+
+    swtisReloadReaderUnregister(reader);
+    swtisReloaderDestroy(reloader);
+}
+
+int main(void)
+{
+    // The reloader has its own memory, this only sets up the logging
+    swtisTestAllocator();
+    buildBlobs();
+    testReload();
+
+    return swtisTestResult("reload");
+}
@@ -0,0 +1,156 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo-serialize/format.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/serialize.h>
+
+// Not a whole number of blocks, so the last block is a short one
+enum { TypeCount = SWTIS_SERIALIZE_PARALLEL_MIN_TYPE_COUNT + 1000 };
+enum { MaxOctetCount = 1024 * 1024 };
+
+static SwtiIntType intType;
+static SwtiStringType stringType;
+static SwtiRecordType records[TypeCount / 2];
+static SwtiRecordTypeField recordFields[TypeCount / 2][2];
+static SwtiListType lists[TypeCount / 2];
+static const SwtiType* types[TypeCount];
+static SwtiChunk chunk;
+
+/// Int and String, then records of the two and lists of the records before them, enough to be written in parallel.
+static void buildChunk(void)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+    types[0] = &intType.internal;
+    types[1] = &stringType.internal;
+
+    for (size_t i = 2; i < TypeCount; ++i) {
+        size_t pairIndex = i / 2;
+        if (i % 2 == 0) {
+            SwtiRecordType* record = &records[pairIndex];
+            swtisTestInitType(&record->internal, SwtiTypeRecord, "Record");
+            recordFields[pairIndex][0].name = "a";
+            recordFields[pairIndex][0].fieldType = &intType.internal;
+            recordFields[pairIndex][1].name = "s";
+            recordFields[pairIndex][1].fieldType = &stringType.internal;
+            record->fields = recordFields[pairIndex];
+            record->fieldCount = 2;
+            types[i] = &record->internal;
+        } else {
+            SwtiListType* list = &lists[pairIndex];
+            swtisTestInitType(&list->internal, SwtiTypeList, "List");
+            list->itemType = types[i - 1];
+            types[i] = &list->internal;
+        }
+    }
+
+    swtisTestInitChunk(&chunk, types, TypeCount);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+}
+
+/// The output must not depend on the thread count.
+static void testThreadCounts(uint8_t formatFlags)
+{
+    static uint8_t single[MaxOctetCount];
+    static uint8_t parallel[MaxOctetCount];
+
+    SwtisSerializeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.formatFlags = formatFlags;
+    options.threadCount = 1;
+    int written = swtisSerializeWithOptions(single, sizeof(single), &chunk, &options);
+    SWTIS_TEST_EXPECT(written > 0)
+
+    const size_t threadCounts[3] = {2, 4, 7};
+    for (size_t i = 0; i < 3; ++i) {
+        options.threadCount = threadCounts[i];
+        SWTIS_TEST_EXPECT(swtisSerializeWithOptions(parallel, sizeof(parallel), &chunk, &options) == written)
+        SWTIS_TEST_EXPECT(memcmp(single, parallel, (size_t) written) == 0)
+
+        // Too small, in the middle of the types
+        SWTIS_TEST_EXPECT(swtisSerializeWithOptions(parallel, (size_t) written / 2, &chunk, &options) < 0)
+    }
+
+    SwtiChunk target;
+    SWTIS_TEST_EXPECT(swtisDeserialize(single, (size_t) written, &target, swtisTestAllocator()) == written)
+    SWTIS_TEST_EXPECT(target.typeCount == TypeCount)
+    const SwtiListType* list = (const SwtiListType*) target.types[TypeCount - 1];
+    SWTIS_TEST_EXPECT(list->internal.type == SwtiTypeList && list->itemType == target.types[TypeCount - 2])
+}
+
+/// A generic that was cleared when it could not be resolved is written so that it reads back cleared. Any other
+/// reference to nothing is an error.
+static void testClearedReferences(void)
+{
+    static SwtiIntType maybeInt;
+    static SwtiCustomTypeVariant nothing;
+    static const SwtiCustomTypeVariant* variants[1];
+    static const SwtiType* generics[2];
+    static SwtiCustomType maybe;
+    static SwtiRecordTypeField fields[1];
+    static SwtiRecordType record;
+    static const SwtiType* maybeTypes[4];
+    static SwtiChunk maybeChunk;
+
+    swtisTestInitType(&maybeInt.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&nothing.internal, SwtiTypeCustomVariant, "Nothing");
+    nothing.name = "Nothing";
+    nothing.inCustomType = &maybe;
+    nothing.fields = 0;
+    nothing.paramCount = 0;
+    variants[0] = &nothing;
+    generics[0] = 0;
+    generics[1] = &maybeInt.internal;
+    swtisTestInitType(&maybe.internal, SwtiTypeCustom, "Maybe");
+    maybe.generic.genericTypes = generics;
+    maybe.generic.genericCount = 2;
+    maybe.variantTypes = variants;
+    maybe.variantCount = 1;
+    swtisTestInitType(&record.internal, SwtiTypeRecord, "Record");
+    fields[0].name = "a";
+    fields[0].fieldType = &maybeInt.internal;
+    record.fields = fields;
+    record.fieldCount = 1;
+    maybeTypes[0] = &maybeInt.internal;
+    maybeTypes[1] = &nothing.internal;
+    maybeTypes[2] = &maybe.internal;
+    maybeTypes[3] = &record.internal;
+    swtisTestInitChunk(&maybeChunk, maybeTypes, 4);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&maybeChunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+
+    static uint8_t octets[1024];
+    int written = swtisSerialize(octets, sizeof(octets), &maybeChunk);
+    SWTIS_TEST_EXPECT(written > 0)
+
+    SwtiChunk target;
+    SWTIS_TEST_EXPECT(swtisDeserialize(octets, (size_t) written, &target, swtisTestAllocator()) == written)
+    const SwtiCustomType* custom = (const SwtiCustomType*) target.types[2];
+    SWTIS_TEST_EXPECT(custom->generic.genericCount == 2)
+    SWTIS_TEST_EXPECT(custom->generic.genericTypes[0] == 0 && custom->generic.genericTypes[1] == target.types[0])
+
+    static uint8_t again[1024];
+    SWTIS_TEST_EXPECT(swtisSerialize(again, sizeof(again), &target) == written)
+    SWTIS_TEST_EXPECT(memcmp(again, octets, (size_t) written) == 0)
+
+    fields[0].fieldType = 0;
+    SWTIS_TEST_EXPECT(swtisSerialize(octets, sizeof(octets), &maybeChunk) == -3)
+    nothing.inCustomType = 0;
+    fields[0].fieldType = &maybeInt.internal;
+    SWTIS_TEST_EXPECT(swtisSerialize(octets, sizeof(octets), &maybeChunk) == -3)
+}
+
+int main(void)
+{
+    testClearedReferences();
+    buildChunk();
+    testThreadCounts(0);
+    testThreadCounts(SWTIS_FORMAT_FLAG_SECTIONED | SWTIS_FORMAT_FLAG_CHECKSUM);
+
+    return swtisTestResult("serialize");
+}
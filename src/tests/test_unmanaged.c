@@ -0,0 +1,96 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <string.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo-serialize/serialize.h>
+#include <swamp-typeinfo-serialize/unmanaged.h>
+
+static SwtiIntType intType;
+static SwtiUnmanagedType fileType;
+static SwtiUnmanagedType socketType;
+static const SwtiType* types[3];
+static SwtiChunk chunk;
+
+static void buildChunk(uint16_t fileId, uint16_t socketId)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&fileType.internal, SwtiTypeUnmanaged, "File");
+    fileType.userTypeId = fileId;
+    swtisTestInitType(&socketType.internal, SwtiTypeUnmanaged, "Socket");
+    socketType.userTypeId = socketId;
+
+    types[0] = &intType.internal;
+    types[1] = &fileType.internal;
+    types[2] = &socketType.internal;
+    swtisTestInitChunk(&chunk, types, 3);
+}
+
+static int deserializeWithTable(SwtiChunk* target, SwtisUnmanagedTable* table)
+{
+    static uint8_t octets[256];
+    int written = swtisSerialize(octets, sizeof(octets), &chunk);
+    SWTIS_TEST_EXPECT(written > 0)
+
+    SwtisDeserializeOptions options;
+    memset(&options, 0, sizeof(options));
+    options.unmanagedTable = table;
+
+    return swtisDeserializeWithOptions(octets, (size_t) written, target, swtisTestAllocator(), &options);
+}
+
+static void testTable(void)
+{
+    buildChunk(7, 3);
+
+    SwtiChunk target;
+    SwtisUnmanagedTable table;
+    SWTIS_TEST_EXPECT(deserializeWithTable(&target, &table) > 0)
+    SWTIS_TEST_EXPECT(table.count == 8)
+
+    const SwtisUnmanagedEntry* entry = swtisUnmanagedTableFind(&table, 7);
+    SWTIS_TEST_EXPECT(entry != 0 && entry->type == (const SwtiUnmanagedType*) target.types[1] && entry->handler == 0)
+    entry = swtisUnmanagedTableFind(&table, 3);
+    SWTIS_TEST_EXPECT(entry != 0 && entry->type == (const SwtiUnmanagedType*) target.types[2])
+    SWTIS_TEST_EXPECT(swtisUnmanagedTableFind(&table, 0) == 0)
+    SWTIS_TEST_EXPECT(swtisUnmanagedTableFind(&table, 8) == 0)
+
+    int handler;
+    SWTIS_TEST_EXPECT(swtisUnmanagedTableSetHandler(&table, 3, &handler) == 0)
+    SWTIS_TEST_EXPECT(swtisUnmanagedTableFind(&table, 3)->handler == &handler)
+    SWTIS_TEST_EXPECT(swtisUnmanagedTableSetHandler(&table, 4, &handler) == -1)
+    SWTIS_TEST_EXPECT(swtisUnmanagedTableSetHandler(&table, 1000, &handler) == -1)
+}
+
+static void testDuplicateUserTypeId(void)
+{
+    buildChunk(5, 5);
+
+    SwtiChunk target;
+    SwtisUnmanagedTable table;
+    SWTIS_TEST_EXPECT(deserializeWithTable(&target, &table) == -6)
+}
+
+static void testWithoutUnmanagedTypes(void)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    types[0] = &intType.internal;
+    swtisTestInitChunk(&chunk, types, 1);
+
+    SwtiChunk target;
+    SwtisUnmanagedTable table;
+    SWTIS_TEST_EXPECT(deserializeWithTable(&target, &table) > 0)
+    SWTIS_TEST_EXPECT(table.count == 0 && swtisUnmanagedTableFind(&table, 0) == 0)
+}
+
+int main(void)
+{
+    testTable();
+    testDuplicateUserTypeId();
+    testWithoutUnmanagedTypes();
+
+    return swtisTestResult("unmanaged");
+}
@@ -0,0 +1,187 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <flood/in_stream.h>
+#include <flood/out_stream.h>
+#include <string.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/value.h>
+
+static SwtiIntType intType;
+static SwtiBooleanType boolType;
+static SwtiStringType stringType;
+static SwtiListType intListType;
+static SwtiRecordTypeField fields[4];
+static SwtiRecordType recordType;
+static const SwtiType* types[5];
+static SwtiChunk chunk;
+
+static void buildChunk(const SwtisLayoutProfile* profile)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&boolType.internal, SwtiTypeBoolean, "Bool");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+    swtisTestInitType(&intListType.internal, SwtiTypeList, "List");
+    intListType.itemType = &intType.internal;
+    swtisTestInitType(&recordType.internal, SwtiTypeRecord, "Record");
+    fields[0].name = "a";
+    fields[0].fieldType = &intType.internal;
+    fields[1].name = "b";
+    fields[1].fieldType = &boolType.internal;
+    fields[2].name = "s";
+    fields[2].fieldType = &stringType.internal;
+    fields[3].name = "l";
+    fields[3].fieldType = &intListType.internal;
+    recordType.fields = fields;
+    recordType.fieldCount = 4;
+
+    types[0] = &intType.internal;
+    types[1] = &boolType.internal;
+    types[2] = &stringType.internal;
+    types[3] = &intListType.internal;
+    types[4] = &recordType.internal;
+    swtisTestInitChunk(&chunk, types, 5);
+
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, profile) == 0)
+}
+
+static void writePointer(uint8_t* target, const void* pointer)
+{
+    memcpy(target, (const void*) &pointer, sizeof(pointer));
+}
+
+static const void* readPointer(const uint8_t* source)
+{
+    const void* pointer;
+    memcpy((void*) &pointer, source, sizeof(pointer));
+    return pointer;
+}
+
+/// Int is 8 octets in this profile, so the record and list item sizes must come from the chunk and not the host.
+static void testWideIntProfile(void)
+{
+    SwtisLayoutProfile wide = *SWTIS_LAYOUT_PROFILE_HOST;
+    wide.intInfo.memorySize = 8;
+    wide.intInfo.memoryAlign = 8;
+    buildChunk(&wide);
+
+    SWTIS_TEST_EXPECT(fields[0].memoryOffsetInfo.memoryInfo.memorySize == 8)
+    SWTIS_TEST_EXPECT(intListType.memoryInfo.memorySize == 8)
+
+    int64_t items[3] = {1, -2, 0x123456789};
+    SwtisValueList list = {items, 3, sizeof(int64_t), sizeof(int64_t)};
+    SwtisValueString string = {"hello", 5};
+
+    uint8_t value[64];
+    memset(value, 0, sizeof(value));
+    int64_t a = -0x1122334455;
+    memcpy(value + fields[0].memoryOffsetInfo.memoryOffset, &a, sizeof(a));
+    value[fields[1].memoryOffsetInfo.memoryOffset] = 1;
+    writePointer(value + fields[2].memoryOffsetInfo.memoryOffset, &string);
+    writePointer(value + fields[3].memoryOffsetInfo.memoryOffset, &list);
+
+    uint8_t octets[128];
+    FldOutStream outStream;
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    int written = swtisSerializeValue(&outStream, &recordType.internal, value);
+    SWTIS_TEST_EXPECT(written == 8 + 1 + 4 + 5 + 4 + 3 * 8)
+
+    uint8_t readBack[64];
+    FldInStream inStream;
+    fldInStreamInit(&inStream, octets, (size_t) written);
+    int read = swtisDeserializeValue(&inStream, &recordType.internal, readBack, swtisTestAllocator());
+    SWTIS_TEST_EXPECT(read == written)
+
+    int64_t readA;
+    memcpy(&readA, readBack + fields[0].memoryOffsetInfo.memoryOffset, sizeof(readA));
+    SWTIS_TEST_EXPECT(readA == a)
+    SWTIS_TEST_EXPECT(readBack[fields[1].memoryOffsetInfo.memoryOffset] == 1)
+    const SwtisValueString* readString = readPointer(readBack + fields[2].memoryOffsetInfo.memoryOffset);
+    SWTIS_TEST_EXPECT(readString->characterCount == 5 && memcmp(readString->characters, "hello", 5) == 0)
+    const SwtisValueList* readList = readPointer(readBack + fields[3].memoryOffsetInfo.memoryOffset);
+    SWTIS_TEST_EXPECT(readList->count == 3 && readList->itemSize == 8)
+    SWTIS_TEST_EXPECT(memcmp(readList->value, items, sizeof(items)) == 0)
+}
+
+/// A value that is not held by a field or list has no layout in the chunk and uses the host profile.
+static void testTopLevelScalar(void)
+{
+    buildChunk(SWTIS_LAYOUT_PROFILE_HOST);
+
+    int32_t value = -7;
+    uint8_t octets[16];
+    FldOutStream outStream;
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    SWTIS_TEST_EXPECT(swtisSerializeValue(&outStream, &intType.internal, &value) == 4)
+}
+
+/// References are written as host pointers, so a chunk with smaller reference slots can not hold them.
+static void testReferenceSlotMismatch(void)
+{
+    SwtisLayoutProfile narrow = *SWTIS_LAYOUT_PROFILE_HOST;
+    narrow.referenceInfo.memorySize = 2;
+    narrow.referenceInfo.memoryAlign = 2;
+    buildChunk(&narrow);
+
+    uint8_t value[64];
+    memset(value, 0, sizeof(value));
+    uint8_t octets[64];
+    FldOutStream outStream;
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    SWTIS_TEST_EXPECT(swtisSerializeValue(&outStream, &recordType.internal, value) == -4)
+
+    static const uint8_t wire[] = {1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+    FldInStream inStream;
+    fldInStreamInit(&inStream, wire, sizeof(wire));
+    SWTIS_TEST_EXPECT(swtisDeserializeValue(&inStream, &recordType.internal, value, swtisTestAllocator()) == -4)
+}
+
+/// An empty record takes no octets, so a long list of them is only the count on the wire.
+static void testListOfEmptyRecords(void)
+{
+    static SwtiRecordType emptyType;
+    static SwtiListType emptyListType;
+    static const SwtiType* emptyTypes[2];
+    static SwtiChunk emptyChunk;
+
+    swtisTestInitType(&emptyType.internal, SwtiTypeRecord, "Empty");
+    emptyType.fields = 0;
+    emptyType.fieldCount = 0;
+    swtisTestInitType(&emptyListType.internal, SwtiTypeList, "List");
+    emptyListType.itemType = &emptyType.internal;
+    emptyTypes[0] = &emptyType.internal;
+    emptyTypes[1] = &emptyListType.internal;
+    swtisTestInitChunk(&emptyChunk, emptyTypes, 2);
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&emptyChunk, SWTIS_LAYOUT_PROFILE_HOST) == 0)
+
+    static const uint8_t wire[] = {0xe8, 0x03, 0, 0};
+    uint8_t target[sizeof(void*)];
+    FldInStream inStream;
+    fldInStreamInit(&inStream, wire, sizeof(wire));
+    SWTIS_TEST_EXPECT(swtisDeserializeValue(&inStream, &emptyListType.internal, target, swtisTestAllocator()) == 4)
+    const SwtisValueList* list = readPointer(target);
+    SWTIS_TEST_EXPECT(list->count == 1000)
+
+    uint8_t octets[16];
+    FldOutStream outStream;
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    SWTIS_TEST_EXPECT(swtisSerializeValue(&outStream, &emptyListType.internal, target) == 4)
+    SWTIS_TEST_EXPECT(memcmp(octets, wire, sizeof(wire)) == 0)
+
+    static const uint8_t tooMany[] = {0xff, 0xff, 0xff, 0xff};
+    fldInStreamInit(&inStream, tooMany, sizeof(tooMany));
+    SWTIS_TEST_EXPECT(swtisDeserializeValue(&inStream, &emptyListType.internal, target, swtisTestAllocator()) == -7)
+}
+
+int main(void)
+{
+    testWideIntProfile();
+    testTopLevelScalar();
+    testReferenceSlotMismatch();
+    testListOfEmptyRecords();
+
+    return swtisTestResult("value");
+}
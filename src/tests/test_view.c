@@ -0,0 +1,332 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#include "utils.h"
+
+#include <flood/out_stream.h>
+#include <string.h>
+#include <swamp-typeinfo-serialize/layout.h>
+#include <swamp-typeinfo-serialize/value.h>
+#include <swamp-typeinfo-serialize/view.h>
+
+static SwtiIntType intType;
+static SwtiBooleanType boolType;
+static SwtiStringType stringType;
+static SwtiListType intListType;
+static SwtiRecordTypeField fields[4];
+static SwtiRecordType recordType;
+static SwtiListType stringListType;
+static SwtiCustomTypeVariant emptyVariant;
+static SwtiCustomTypeVariant namedVariant;
+static SwtiCustomTypeVariantField namedFields[2];
+static const SwtiCustomTypeVariant* shapeVariants[2];
+static SwtiCustomType shapeType;
+static SwtiListType shapeListType;
+static const SwtiType* types[10];
+static SwtiChunk chunk;
+
+static void buildChunk(const SwtisLayoutProfile* profile)
+{
+    swtisTestInitType(&intType.internal, SwtiTypeInt, "Int");
+    swtisTestInitType(&boolType.internal, SwtiTypeBoolean, "Bool");
+    swtisTestInitType(&stringType.internal, SwtiTypeString, "String");
+    swtisTestInitType(&intListType.internal, SwtiTypeList, "List");
+    intListType.itemType = &intType.internal;
+    swtisTestInitType(&recordType.internal, SwtiTypeRecord, "Record");
+    fields[0].name = "a";
+    fields[0].fieldType = &intType.internal;
+    fields[1].name = "b";
+    fields[1].fieldType = &boolType.internal;
+    fields[2].name = "s";
+    fields[2].fieldType = &stringType.internal;
+    fields[3].name = "l";
+    fields[3].fieldType = &intListType.internal;
+    recordType.fields = fields;
+    recordType.fieldCount = 4;
+    swtisTestInitType(&stringListType.internal, SwtiTypeList, "List");
+    stringListType.itemType = &stringType.internal;
+
+    // Shape = Empty | Named String Int
+    swtisTestInitType(&emptyVariant.internal, SwtiTypeCustomVariant, "Empty");
+    emptyVariant.name = "Empty";
+    emptyVariant.inCustomType = &shapeType;
+    emptyVariant.fields = 0;
+    emptyVariant.paramCount = 0;
+    swtisTestInitType(&namedVariant.internal, SwtiTypeCustomVariant, "Named");
+    namedVariant.name = "Named";
+    namedVariant.inCustomType = &shapeType;
+    namedFields[0].fieldType = &stringType.internal;
+    namedFields[1].fieldType = &intType.internal;
+    namedVariant.fields = namedFields;
+    namedVariant.paramCount = 2;
+    shapeVariants[0] = &emptyVariant;
+    shapeVariants[1] = &namedVariant;
+    swtisTestInitType(&shapeType.internal, SwtiTypeCustom, "Shape");
+    shapeType.variantTypes = shapeVariants;
+    shapeType.variantCount = 2;
+    swtisTestInitType(&shapeListType.internal, SwtiTypeList, "List");
+    shapeListType.itemType = &shapeType.internal;
+
+    types[0] = &intType.internal;
+    types[1] = &boolType.internal;
+    types[2] = &stringType.internal;
+    types[3] = &intListType.internal;
+    types[4] = &recordType.internal;
+    types[5] = &stringListType.internal;
+    types[6] = &emptyVariant.internal;
+    types[7] = &namedVariant.internal;
+    types[8] = &shapeType.internal;
+    types[9] = &shapeListType.internal;
+    swtisTestInitChunk(&chunk, types, 10);
+
+    SWTIS_TEST_EXPECT(swtisLayoutCompute(&chunk, profile) == 0)
+}
+
+static void writePointer(uint8_t* target, const void* pointer)
+{
+    memcpy(target, (const void*) &pointer, sizeof(pointer));
+}
+
+/// Writes the record with Int items of `intSize` octets and returns the number of octets in `octets`.
+static int writeRecord(uint8_t* octets, size_t octetCount, int64_t a, const int64_t* items, size_t intSize)
+{
+    static uint8_t itemMemory[3 * 8];
+    for (size_t i = 0; i < 3; ++i) {
+        memcpy(itemMemory + i * intSize, &items[i], intSize);
+    }
+    static SwtisValueList list;
+    list.value = itemMemory;
+    list.count = 3;
+    list.itemSize = intSize;
+    list.itemAlign = intSize;
+    static SwtisValueString string = {"hello", 5};
+
+    uint8_t value[64];
+    memset(value, 0, sizeof(value));
+    memcpy(value + fields[0].memoryOffsetInfo.memoryOffset, &a, intSize);
+    value[fields[1].memoryOffsetInfo.memoryOffset] = 1;
+    writePointer(value + fields[2].memoryOffsetInfo.memoryOffset, &string);
+    writePointer(value + fields[3].memoryOffsetInfo.memoryOffset, &list);
+
+    FldOutStream outStream;
+    fldOutStreamInit(&outStream, octets, octetCount);
+    return swtisViewSerializeValue(&outStream, &recordType.internal, value);
+}
+
+/// Sign extends a little endian Int of `intSize` octets that was copied into the start of `value`.
+static int64_t widen(int64_t value, size_t intSize)
+{
+    return intSize == 4 ? (int64_t) (int32_t) value : value;
+}
+
+static void checkRecord(const uint8_t* octets, int written, int64_t a, const int64_t* items, size_t intSize)
+{
+    SwtisView view;
+    SWTIS_TEST_EXPECT(swtisViewInit(&view, &recordType.internal, octets, (size_t) written) == 0)
+
+    SwtisView field;
+    int64_t readA = 0;
+    SWTIS_TEST_EXPECT(swtisViewFieldByName(&view, "a", &field) == 0)
+    SWTIS_TEST_EXPECT(field.octetCount == intSize && swtisViewScalar(&field, &readA) == 0 &&
+                      widen(readA, intSize) == a)
+
+    uint8_t b = 0;
+    SWTIS_TEST_EXPECT(swtisViewField(&view, 1, &field) == 0 && swtisViewScalar(&field, &b) == 0 && b == 1)
+
+    const uint8_t* characters;
+    size_t characterCount;
+    SWTIS_TEST_EXPECT(swtisViewField(&view, 2, &field) == 0)
+    SWTIS_TEST_EXPECT(swtisViewOctets(&field, &characters, &characterCount) == 0)
+    SWTIS_TEST_EXPECT(characterCount == 5 && memcmp(characters, "hello", 5) == 0)
+
+    size_t count = 0;
+    SWTIS_TEST_EXPECT(swtisViewField(&view, 3, &field) == 0 && swtisViewListCount(&field, &count) == 0 && count == 3)
+    for (size_t i = 0; i < 3; ++i) {
+        SwtisView item;
+        int64_t readItem = 0;
+        SWTIS_TEST_EXPECT(swtisViewListItem(&field, i, &item) == 0 && swtisViewScalar(&item, &readItem) == 0)
+        SWTIS_TEST_EXPECT(widen(readItem, intSize) == items[i])
+    }
+    SwtisView item;
+    SWTIS_TEST_EXPECT(swtisViewListItem(&field, 3, &item) == -3)
+}
+
+static void testRoundTrip(void)
+{
+    buildChunk(SWTIS_LAYOUT_PROFILE_HOST);
+
+    int64_t items[3] = {1, -2, 0x12345678};
+    uint8_t octets[128];
+    int written = writeRecord(octets, sizeof(octets), -5, items, 4);
+    SWTIS_TEST_EXPECT(written == 4 * 4 + 4 + 1 + 4 + 5 + 4 + 3 * 4)
+    checkRecord(octets, written, -5, items, 4);
+
+    // A truncated list can not be read past its end
+    SwtisView view;
+    SwtisView field;
+    SwtisView item;
+    swtisViewInit(&view, &recordType.internal, octets, (size_t) written - 4);
+    SWTIS_TEST_EXPECT(swtisViewField(&view, 3, &field) == 0 && swtisViewListItem(&field, 0, &item) == -7)
+
+    SWTIS_TEST_EXPECT(writeRecord(octets, 20, -5, items, 4) < 0)
+}
+
+/// Int is 8 octets in this profile, so the field, list item and scalar sizes must come from the chunk.
+static void testWideIntProfile(void)
+{
+    SwtisLayoutProfile wide = *SWTIS_LAYOUT_PROFILE_HOST;
+    wide.intInfo.memorySize = 8;
+    wide.intInfo.memoryAlign = 8;
+    buildChunk(&wide);
+
+    int64_t items[3] = {1, -2, 0x123456789};
+    uint8_t octets[128];
+    int written = writeRecord(octets, sizeof(octets), -0x1122334455, items, 8);
+    SWTIS_TEST_EXPECT(written == 4 * 4 + 8 + 1 + 4 + 5 + 4 + 3 * 8)
+    checkRecord(octets, written, -0x1122334455, items, 8);
+}
+
+/// Writes `Named name value` into `target`, laid out like a value in memory.
+static void writeNamed(uint8_t* target, const SwtisValueString* name, int32_t value)
+{
+    target[0] = 1;
+    writePointer(target + namedFields[0].memoryOffsetInfo.memoryOffset, name);
+    memcpy(target + namedFields[1].memoryOffsetInfo.memoryOffset, &value, sizeof(value));
+}
+
+static void checkNamed(const SwtisView* view, const char* name, int32_t value)
+{
+    uint8_t variantIndex = 0;
+    SWTIS_TEST_EXPECT(swtisViewVariant(view, &variantIndex) == 0 && variantIndex == 1)
+
+    SwtisView field;
+    const uint8_t* characters;
+    size_t characterCount;
+    SWTIS_TEST_EXPECT(swtisViewVariantField(view, 0, &field) == 0)
+    SWTIS_TEST_EXPECT(swtisViewOctets(&field, &characters, &characterCount) == 0)
+    SWTIS_TEST_EXPECT(characterCount == strlen(name) && memcmp(characters, name, characterCount) == 0)
+
+    int32_t readValue = 0;
+    SWTIS_TEST_EXPECT(swtisViewVariantField(view, 1, &field) == 0 && swtisViewScalar(&field, &readValue) == 0 &&
+                      readValue == value)
+    SWTIS_TEST_EXPECT(swtisViewVariantField(view, 2, &field) == -3)
+}
+
+static void testVariants(void)
+{
+    buildChunk(SWTIS_LAYOUT_PROFILE_HOST);
+
+    static SwtisValueString name = {"box", 3};
+    uint8_t value[64];
+    memset(value, 0, sizeof(value));
+    writeNamed(value, &name, 7);
+
+    // The String makes the payload vary in size, so the variant fields get an offset table
+    uint8_t octets[64];
+    FldOutStream outStream;
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    int written = swtisViewSerializeValue(&outStream, &shapeType.internal, value);
+    SWTIS_TEST_EXPECT(written == 1 + 2 * 4 + 4 + 3 + 4 && outStream.pos == (size_t) written)
+
+    SwtisView view;
+    SWTIS_TEST_EXPECT(swtisViewInit(&view, &shapeType.internal, octets, (size_t) written) == 0)
+    checkNamed(&view, "box", 7);
+
+    SwtisView field;
+    swtisViewInit(&view, &shapeType.internal, octets, 0);
+    SWTIS_TEST_EXPECT(swtisViewVariantField(&view, 0, &field) == -7)
+    swtisViewInit(&view, &recordType.internal, octets, (size_t) written);
+    SWTIS_TEST_EXPECT(swtisViewVariantField(&view, 0, &field) == -1)
+
+    memset(value, 0, sizeof(value));
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    SWTIS_TEST_EXPECT(swtisViewSerializeValue(&outStream, &shapeType.internal, value) == 1)
+    uint8_t variantIndex = 1;
+    swtisViewInit(&view, &shapeType.internal, octets, 1);
+    SWTIS_TEST_EXPECT(swtisViewVariant(&view, &variantIndex) == 0 && variantIndex == 0)
+    SWTIS_TEST_EXPECT(swtisViewVariantField(&view, 0, &field) == -3)
+
+    octets[0] = 2;
+    SWTIS_TEST_EXPECT(swtisViewVariant(&view, &variantIndex) == -6)
+    value[0] = 2;
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    SWTIS_TEST_EXPECT(swtisViewSerializeValue(&outStream, &shapeType.internal, value) == -6)
+}
+
+static void testVariableSizeItems(void)
+{
+    buildChunk(SWTIS_LAYOUT_PROFILE_HOST);
+
+    static SwtisValueString strings[3] = {{"a", 1}, {"", 0}, {"hello", 5}};
+    uint8_t stringItems[3 * sizeof(void*)];
+    for (size_t i = 0; i < 3; ++i) {
+        writePointer(stringItems + i * stringListType.memoryInfo.memorySize, &strings[i]);
+    }
+    SwtisValueList stringList = {stringItems, 3, stringListType.memoryInfo.memorySize,
+                                 stringListType.memoryInfo.memoryAlign};
+    uint8_t value[sizeof(void*)];
+    writePointer(value, &stringList);
+
+    uint8_t octets[128];
+    FldOutStream outStream;
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    int written = swtisViewSerializeValue(&outStream, &stringListType.internal, value);
+    SWTIS_TEST_EXPECT(written == 4 + 3 * 4 + (4 + 1) + 4 + (4 + 5))
+
+    SwtisView view;
+    SwtisView item;
+    size_t count = 0;
+    swtisViewInit(&view, &stringListType.internal, octets, (size_t) written);
+    SWTIS_TEST_EXPECT(swtisViewListCount(&view, &count) == 0 && count == 3)
+    for (size_t i = 0; i < 3; ++i) {
+        const uint8_t* characters;
+        size_t characterCount;
+        SWTIS_TEST_EXPECT(swtisViewListItem(&view, i, &item) == 0)
+        SWTIS_TEST_EXPECT(swtisViewOctets(&item, &characters, &characterCount) == 0)
+        SWTIS_TEST_EXPECT(characterCount == strings[i].characterCount &&
+                          memcmp(characters, strings[i].characters, characterCount) == 0)
+    }
+
+    // An offset that points back into the table is rejected
+    octets[4 + 4] = 4;
+    SWTIS_TEST_EXPECT(swtisViewListItem(&view, 1, &item) == -8)
+
+    // Empty and Named have different sizes, so the items get an offset table too
+    static SwtisValueString name = {"tree", 4};
+    size_t stride = shapeListType.memoryInfo.memorySize;
+    uint8_t shapeItems[3 * 64];
+    memset(shapeItems, 0, sizeof(shapeItems));
+    writeNamed(shapeItems, &name, -1);
+    writeNamed(shapeItems + 2 * stride, &strings[2], 42);
+    SwtisValueList shapeList = {shapeItems, 3, stride, shapeListType.memoryInfo.memoryAlign};
+    writePointer(value, &shapeList);
+
+    fldOutStreamInit(&outStream, octets, sizeof(octets));
+    written = swtisViewSerializeValue(&outStream, &shapeListType.internal, value);
+    size_t namedSize = 1 + 2 * 4 + 4 + 4;
+    SWTIS_TEST_EXPECT(written == (int) (4 + 3 * 4 + (namedSize + 4) + 1 + (namedSize + 5)))
+
+    swtisViewInit(&view, &shapeListType.internal, octets, (size_t) written);
+    SWTIS_TEST_EXPECT(swtisViewListItem(&view, 0, &item) == 0)
+    checkNamed(&item, "tree", -1);
+    uint8_t variantIndex = 1;
+    SWTIS_TEST_EXPECT(swtisViewListItem(&view, 1, &item) == 0 && item.octetCount == 1)
+    SWTIS_TEST_EXPECT(swtisViewVariant(&item, &variantIndex) == 0 && variantIndex == 0)
+    SWTIS_TEST_EXPECT(swtisViewListItem(&view, 2, &item) == 0)
+    checkNamed(&item, "hello", 42);
+
+    // No room for the offset table
+    fldOutStreamInit(&outStream, octets, 4 + 2 * 4);
+    SWTIS_TEST_EXPECT(swtisViewSerializeValue(&outStream, &shapeListType.internal, value) < 0)
+}
+
+int main(void)
+{
+    testRoundTrip();
+    testWideIntProfile();
+    testVariants();
+    testVariableSizeItems();
+
+    return swtisTestResult("view");
+}
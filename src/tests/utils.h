@@ -0,0 +1,77 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+#ifndef SWAMP_TYPEINFO_SERIALIZE_TESTS_UTILS_H
+#define SWAMP_TYPEINFO_SERIALIZE_TESTS_UTILS_H
+
+#include <clog/clog.h>
+#include <imprint/linear_allocator.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <swamp-typeinfo/chunk.h>
+#include <swamp-typeinfo/typeinfo.h>
+
+// Each test is a program that returns non zero if any expectation failed, so ctest can run it as is.
+
+clog_config g_clog;
+
+static int swtisTestFailures;
+
+#define SWTIS_TEST_EXPECT(condition)                                                                               \
+    if (!(condition)) {                                                                                            \
+        fprintf(stderr, "%s:%d: expected %s\n", __FILE__, __LINE__, #condition);                                    \
+        swtisTestFailures++;                                                                                       \
+    }
+
+static void swtisTestLog(enum clog_type type, const char* string)
+{
+    (void) type;
+    fprintf(stderr, "%s\n", string);
+}
+
+static ImprintAllocator* swtisTestAllocator(void)
+{
+    static ImprintLinearAllocator linear;
+    static uint8_t* memory;
+    const size_t size = 32 * 1024 * 1024;
+
+    if (memory == 0) {
+        g_clog.log = swtisTestLog;
+        memory = (uint8_t*) malloc(size);
+    }
+    imprintLinearAllocatorInit(&linear, memory, size, "test");
+
+    return &linear.info;
+}
+
+static inline void swtisTestInitType(SwtiType* type, SwtiTypeValue typeValue, const char* name)
+{
+    type->type = typeValue;
+    type->name = name;
+    type->hash = 0;
+    type->index = 0;
+}
+
+/// Numbers the types in the order given, as the deserializer would.
+static inline void swtisTestInitChunk(SwtiChunk* chunk, const SwtiType** types, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        ((SwtiType*) types[i])->index = (uint16_t) i;
+    }
+    chunk->types = types;
+    chunk->typeCount = count;
+    chunk->maxCount = count;
+}
+
+static inline int swtisTestResult(const char* name)
+{
+    if (swtisTestFailures != 0) {
+        fprintf(stderr, "%s: %d failed\n", name, swtisTestFailures);
+        return 1;
+    }
+
+    return 0;
+}
+
+#endif
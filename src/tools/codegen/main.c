@@ -0,0 +1,503 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+
+// Reads a serialized typeinfo file and writes C source that defines the same chunk as `static const` data, with all
+// type references already resolved. The types need no deserialization or fixup at startup and are placed in
+// read-only (after relocation) data.
+//
+//   swtis-codegen <input.swamp-typeinfo> <output.c> <symbol>
+//
+// The output defines `const SwtiChunk <symbol>`. Declare it with `extern const SwtiChunk <symbol>;` where it is used.
+
+#include <imprint/linear_allocator.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo/chunk.h>
+#include <swamp-typeinfo/typeinfo.h>
+
+/// Memory used for the deserialized chunk, per octet of serialized typeinfo.
+#define SWTIS_CODEGEN_MEMORY_FACTOR (64)
+
+static const char* structName(SwtiTypeValue type)
+{
+    switch (type) {
+        case SwtiTypeInt:
+            return "SwtiIntType";
+        case SwtiTypeFixed:
+            return "SwtiFixedType";
+        case SwtiTypeBoolean:
+            return "SwtiBooleanType";
+        case SwtiTypeString:
+            return "SwtiStringType";
+        case SwtiTypeChar:
+            return "SwtiCharType";
+        case SwtiTypeBlob:
+            return "SwtiBlobType";
+        case SwtiTypeList:
+            return "SwtiListType";
+        case SwtiTypeArray:
+            return "SwtiArrayType";
+        case SwtiTypeRecord:
+            return "SwtiRecordType";
+        case SwtiTypeTuple:
+            return "SwtiTupleType";
+        case SwtiTypeCustom:
+            return "SwtiCustomType";
+        case SwtiTypeCustomVariant:
+            return "SwtiCustomTypeVariant";
+        case SwtiTypeFunction:
+            return "SwtiFunctionType";
+        case SwtiTypeAlias:
+            return "SwtiAliasType";
+        case SwtiTypeRefId:
+            return "SwtiTypeRefIdType";
+        case SwtiTypeAny:
+            return "SwtiAnyType";
+        case SwtiTypeAnyMatchingTypes:
+            return "SwtiAnyMatchingTypesType";
+        case SwtiTypeUnmanaged:
+            return "SwtiUnmanagedType";
+        default:
+            return 0;
+    }
+}
+
+static const char* typeValueName(SwtiTypeValue type)
+{
+    switch (type) {
+        case SwtiTypeInt:
+            return "SwtiTypeInt";
+        case SwtiTypeFixed:
+            return "SwtiTypeFixed";
+        case SwtiTypeBoolean:
+            return "SwtiTypeBoolean";
+        case SwtiTypeString:
+            return "SwtiTypeString";
+        case SwtiTypeChar:
+            return "SwtiTypeChar";
+        case SwtiTypeBlob:
+            return "SwtiTypeBlob";
+        case SwtiTypeList:
+            return "SwtiTypeList";
+        case SwtiTypeArray:
+            return "SwtiTypeArray";
+        case SwtiTypeRecord:
+            return "SwtiTypeRecord";
+        case SwtiTypeTuple:
+            return "SwtiTypeTuple";
+        case SwtiTypeCustom:
+            return "SwtiTypeCustom";
+        case SwtiTypeCustomVariant:
+            return "SwtiTypeCustomVariant";
+        case SwtiTypeFunction:
+            return "SwtiTypeFunction";
+        case SwtiTypeAlias:
+            return "SwtiTypeAlias";
+        case SwtiTypeRefId:
+            return "SwtiTypeRefId";
+        case SwtiTypeAny:
+            return "SwtiTypeAny";
+        case SwtiTypeAnyMatchingTypes:
+            return "SwtiTypeAnyMatchingTypes";
+        case SwtiTypeUnmanaged:
+            return "SwtiTypeUnmanaged";
+        default:
+            return 0;
+    }
+}
+
+static void writeString(FILE* out, const char* s)
+{
+    if (s == 0) {
+        fputs("0", out);
+        return;
+    }
+
+    fputc('"', out);
+    for (const unsigned char* p = (const unsigned char*) s; *p != 0; ++p) {
+        if (*p == '"' || *p == '\\') {
+            fprintf(out, "\\%c", *p);
+        } else if (*p < 0x20 || *p >= 0x7f) {
+            // Always three digits, so a following digit is never taken as part of the escape
+            fprintf(out, "\\%03o", *p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void writeTypeRef(FILE* out, const SwtiType* type)
+{
+    if (type == 0) {
+        fputs("0", out);
+        return;
+    }
+    fprintf(out, "&t%u.internal", type->index);
+}
+
+static void writeMemoryInfo(FILE* out, const SwtiMemoryInfo* info)
+{
+    fprintf(out, "{ .memorySize = %u, .memoryAlign = %u }", info->memorySize, info->memoryAlign);
+}
+
+static void writeMemoryOffsetInfo(FILE* out, const SwtiMemoryOffsetInfo* info)
+{
+    fprintf(out, "{ .memoryOffset = %u, .memoryInfo = ", info->memoryOffset);
+    writeMemoryInfo(out, &info->memoryInfo);
+    fputs(" }", out);
+}
+
+static void writeTypeRefArray(FILE* out, size_t index, const char* suffix, const SwtiType** types, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+
+    fprintf(out, "static const SwtiType* const t%zu%s[] = {", index, suffix);
+    for (size_t i = 0; i < count; ++i) {
+        fputs(i == 0 ? " " : ", ", out);
+        writeTypeRef(out, types[i]);
+    }
+    fputs(" };\n", out);
+}
+
+static void writeArrayRef(FILE* out, size_t index, const char* suffix, size_t count, const char* cast)
+{
+    if (count == 0) {
+        fputs("0", out);
+        return;
+    }
+    fprintf(out, "%st%zu%s", cast, index, suffix);
+}
+
+static void writeRecordFields(FILE* out, size_t index, const SwtiRecordTypeField* fields, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+
+    fprintf(out, "static const SwtiRecordTypeField t%zuFields[] = {\n", index);
+    for (size_t i = 0; i < count; ++i) {
+        fputs("    { .name = ", out);
+        writeString(out, fields[i].name);
+        fputs(", .fieldType = ", out);
+        writeTypeRef(out, fields[i].fieldType);
+        fputs(", .memoryOffsetInfo = ", out);
+        writeMemoryOffsetInfo(out, &fields[i].memoryOffsetInfo);
+        fputs(" },\n", out);
+    }
+    fputs("};\n", out);
+}
+
+static void writeTupleFields(FILE* out, size_t index, const SwtiTupleTypeField* fields, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+
+    fprintf(out, "static const SwtiTupleTypeField t%zuFields[] = {\n", index);
+    for (size_t i = 0; i < count; ++i) {
+        fputs("    { .name = ", out);
+        writeString(out, fields[i].name);
+        fputs(", .fieldType = ", out);
+        writeTypeRef(out, fields[i].fieldType);
+        fputs(", .memoryOffsetInfo = ", out);
+        writeMemoryOffsetInfo(out, &fields[i].memoryOffsetInfo);
+        fputs(" },\n", out);
+    }
+    fputs("};\n", out);
+}
+
+static void writeVariantFields(FILE* out, size_t index, const SwtiCustomTypeVariantField* fields, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+
+    fprintf(out, "static const SwtiCustomTypeVariantField t%zuFields[] = {\n", index);
+    for (size_t i = 0; i < count; ++i) {
+        fputs("    { .fieldType = ", out);
+        writeTypeRef(out, fields[i].fieldType);
+        fputs(", .memoryOffsetInfo = ", out);
+        writeMemoryOffsetInfo(out, &fields[i].memoryOffsetInfo);
+        fputs(" },\n", out);
+    }
+    fputs("};\n", out);
+}
+
+static void writeVariantRefs(FILE* out, size_t index, const SwtiCustomTypeVariant** variants, size_t count)
+{
+    if (count == 0) {
+        return;
+    }
+
+    fprintf(out, "static const SwtiCustomTypeVariant* const t%zuVariants[] = {", index);
+    for (size_t i = 0; i < count; ++i) {
+        fprintf(out, "%s&t%u", i == 0 ? " " : ", ", variants[i]->internal.index);
+    }
+    fputs(" };\n", out);
+}
+
+/// Arrays that the type points to. They only need the forward declarations of the types.
+static void writeTypeArrays(FILE* out, const SwtiType* type, size_t index)
+{
+    switch (type->type) {
+        case SwtiTypeRecord: {
+            const SwtiRecordType* record = (const SwtiRecordType*) type;
+            writeRecordFields(out, index, record->fields, record->fieldCount);
+            break;
+        }
+        case SwtiTypeTuple: {
+            const SwtiTupleType* tuple = (const SwtiTupleType*) type;
+            writeTupleFields(out, index, tuple->fields, tuple->fieldCount);
+            break;
+        }
+        case SwtiTypeCustom: {
+            const SwtiCustomType* custom = (const SwtiCustomType*) type;
+            writeTypeRefArray(out, index, "Generics", custom->generic.genericTypes, custom->generic.genericCount);
+            writeVariantRefs(out, index, custom->variantTypes, custom->variantCount);
+            break;
+        }
+        case SwtiTypeCustomVariant: {
+            const SwtiCustomTypeVariant* variant = (const SwtiCustomTypeVariant*) type;
+            writeVariantFields(out, index, variant->fields, variant->paramCount);
+            break;
+        }
+        case SwtiTypeFunction: {
+            const SwtiFunctionType* fn = (const SwtiFunctionType*) type;
+            writeTypeRefArray(out, index, "Parameters", fn->parameterTypes, fn->parameterCount);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+static void writeType(FILE* out, const SwtiType* type, size_t index)
+{
+    fprintf(out, "static const %s t%zu = {\n    .internal = { .type = %s, .name = ", structName(type->type), index,
+            typeValueName(type->type));
+    writeString(out, type->name);
+    fprintf(out, ", .hash = 0x%08xu, .index = %u },\n", (unsigned int) type->hash, type->index);
+
+    switch (type->type) {
+        case SwtiTypeList:
+        case SwtiTypeArray: {
+            // Both have the same layout
+            const SwtiListType* list = (const SwtiListType*) type;
+            fputs("    .itemType = ", out);
+            writeTypeRef(out, list->itemType);
+            fputs(",\n    .memoryInfo = ", out);
+            writeMemoryInfo(out, &list->memoryInfo);
+            fputs(",\n", out);
+            break;
+        }
+        case SwtiTypeRecord: {
+            const SwtiRecordType* record = (const SwtiRecordType*) type;
+            fputs("    .fields = ", out);
+            writeArrayRef(out, index, "Fields", record->fieldCount, "");
+            fprintf(out, ",\n    .fieldCount = %zu,\n    .memoryInfo = ", record->fieldCount);
+            writeMemoryInfo(out, &record->memoryInfo);
+            fputs(",\n", out);
+            break;
+        }
+        case SwtiTypeTuple: {
+            const SwtiTupleType* tuple = (const SwtiTupleType*) type;
+            fputs("    .fields = ", out);
+            writeArrayRef(out, index, "Fields", tuple->fieldCount, "");
+            fprintf(out, ",\n    .fieldCount = %zu,\n    .memoryInfo = ", tuple->fieldCount);
+            writeMemoryInfo(out, &tuple->memoryInfo);
+            fputs(",\n", out);
+            break;
+        }
+        case SwtiTypeCustom: {
+            const SwtiCustomType* custom = (const SwtiCustomType*) type;
+            // The arrays are const, the pointers in the type are not, but nothing writes through them
+            fputs("    .generic = { .genericTypes = ", out);
+            writeArrayRef(out, index, "Generics", custom->generic.genericCount, "(const SwtiType**) ");
+            fprintf(out, ", .genericCount = %zu },\n    .variantTypes = ", custom->generic.genericCount);
+            writeArrayRef(out, index, "Variants", custom->variantCount, "(const SwtiCustomTypeVariant**) ");
+            fprintf(out, ",\n    .variantCount = %zu,\n    .memoryInfo = ", custom->variantCount);
+            writeMemoryInfo(out, &custom->memoryInfo);
+            fputs(",\n", out);
+            break;
+        }
+        case SwtiTypeCustomVariant: {
+            const SwtiCustomTypeVariant* variant = (const SwtiCustomTypeVariant*) type;
+            fputs("    .name = ", out);
+            writeString(out, variant->name);
+            if (variant->inCustomType != 0) {
+                fprintf(out, ",\n    .inCustomType = &t%u", variant->inCustomType->internal.index);
+            } else {
+                fputs(",\n    .inCustomType = 0", out);
+            }
+            fputs(",\n    .fields = ", out);
+            writeArrayRef(out, index, "Fields", variant->paramCount, "");
+            fprintf(out, ",\n    .paramCount = %u,\n    .memoryInfo = ", variant->paramCount);
+            writeMemoryInfo(out, &variant->memoryInfo);
+            fputs(",\n", out);
+            break;
+        }
+        case SwtiTypeFunction: {
+            const SwtiFunctionType* fn = (const SwtiFunctionType*) type;
+            fputs("    .parameterTypes = ", out);
+            writeArrayRef(out, index, "Parameters", fn->parameterCount, "(const SwtiType**) ");
+            fprintf(out, ",\n    .parameterCount = %zu,\n", fn->parameterCount);
+            break;
+        }
+        case SwtiTypeAlias: {
+            const SwtiAliasType* alias = (const SwtiAliasType*) type;
+            fputs("    .targetType = ", out);
+            writeTypeRef(out, alias->targetType);
+            fputs(",\n", out);
+            break;
+        }
+        case SwtiTypeRefId: {
+            const SwtiTypeRefIdType* refId = (const SwtiTypeRefIdType*) type;
+            fputs("    .referencedType = ", out);
+            writeTypeRef(out, refId->referencedType);
+            fputs(",\n", out);
+            break;
+        }
+        case SwtiTypeUnmanaged: {
+            const SwtiUnmanagedType* unmanaged = (const SwtiUnmanagedType*) type;
+            fprintf(out, "    .userTypeId = %u,\n", unmanaged->userTypeId);
+            break;
+        }
+        default:
+            break;
+    }
+
+    fputs("};\n\n", out);
+}
+
+static int writeChunk(FILE* out, const SwtiChunk* chunk, const char* inputPath, const char* symbol)
+{
+    for (size_t i = 0; i < chunk->typeCount; ++i) {
+        const SwtiType* type = chunk->types[i];
+        if (structName(type->type) == 0) {
+            fprintf(stderr, "swtis-codegen: type %zu has unknown type %d\n", i, type->type);
+            return -14;
+        }
+        if (type->index != i) {
+            fprintf(stderr, "swtis-codegen: type %zu has index %u\n", i, type->index);
+            return -3;
+        }
+    }
+
+    fputs("// Generated by swtis-codegen from '", out);
+    fputs(inputPath, out);
+    fputs("'. Do not edit.\n\n#include <swamp-typeinfo/chunk.h>\n#include <swamp-typeinfo/typeinfo.h>\n\n", out);
+
+    // Types can refer to each other in any order, so declare them all first
+    for (size_t i = 0; i < chunk->typeCount; ++i) {
+        fprintf(out, "static const %s t%zu;\n", structName(chunk->types[i]->type), i);
+    }
+    fputs("\n", out);
+
+    for (size_t i = 0; i < chunk->typeCount; ++i) {
+        writeTypeArrays(out, chunk->types[i], i);
+        writeType(out, chunk->types[i], i);
+    }
+
+    fputs("static const SwtiType* const types[] = {\n", out);
+    for (size_t i = 0; i < chunk->typeCount; ++i) {
+        fprintf(out, "    &t%zu.internal,\n", i);
+    }
+    fputs("};\n\n", out);
+
+    fprintf(out, "const SwtiChunk %s = { .types = (const SwtiType**) types, .typeCount = %zu, .maxCount = %zu };\n",
+            symbol, chunk->typeCount, chunk->typeCount);
+
+    return 0;
+}
+
+static int readFile(const char* path, uint8_t** outOctets, size_t* outOctetCount)
+{
+    FILE* f = fopen(path, "rb");
+    if (f == 0) {
+        fprintf(stderr, "swtis-codegen: can not open '%s'\n", path);
+        return -1;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size <= 0) {
+        fprintf(stderr, "swtis-codegen: '%s' is empty\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    uint8_t* octets = malloc((size_t) size);
+    size_t octetsRead = fread(octets, 1, (size_t) size, f);
+    fclose(f);
+    if (octetsRead != (size_t) size) {
+        fprintf(stderr, "swtis-codegen: could not read '%s'\n", path);
+        free(octets);
+        return -1;
+    }
+
+    *outOctets = octets;
+    *outOctetCount = (size_t) size;
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 4) {
+        fprintf(stderr, "usage: swtis-codegen <input.swamp-typeinfo> <output.c> <symbol>\n");
+        return 1;
+    }
+
+    const char* inputPath = argv[1];
+    const char* outputPath = argv[2];
+    const char* symbol = argv[3];
+
+    uint8_t* octets;
+    size_t octetCount;
+    if (readFile(inputPath, &octets, &octetCount) != 0) {
+        return 1;
+    }
+
+    size_t memorySize = octetCount * SWTIS_CODEGEN_MEMORY_FACTOR;
+    uint8_t* memory = malloc(memorySize);
+    ImprintLinearAllocator allocator;
+    imprintLinearAllocatorInit(&allocator, memory, memorySize, "swtisCodegen");
+
+    SwtiChunk chunk;
+    int result = swtisDeserialize(octets, octetCount, &chunk, &allocator.info);
+    if (result < 0) {
+        fprintf(stderr, "swtis-codegen: could not deserialize '%s' (%d)\n", inputPath, result);
+        free(memory);
+        free(octets);
+        return 1;
+    }
+
+    FILE* out = fopen(outputPath, "w");
+    if (out == 0) {
+        fprintf(stderr, "swtis-codegen: can not create '%s'\n", outputPath);
+        free(memory);
+        free(octets);
+        return 1;
+    }
+
+    result = writeChunk(out, &chunk, inputPath, symbol);
+    if (fclose(out) != 0 && result == 0) {
+        fprintf(stderr, "swtis-codegen: could not write '%s'\n", outputPath);
+        result = -1;
+    }
+    if (result != 0) {
+        remove(outputPath);
+    }
+
+    free(memory);
+    free(octets);
+
+    return result == 0 ? 0 : 1;
+}
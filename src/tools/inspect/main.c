@@ -0,0 +1,805 @@
+/*---------------------------------------------------------------------------------------------
+ *  Copyright (c) Peter Bjorklund. All rights reserved.
+ *  Licensed under the MIT License. See LICENSE in the project root for license information.
+ *--------------------------------------------------------------------------------------------*/
+
+// Reports where the octets and the load time of serialized typeinfo go.
+//
+//   swtis-inspect [--json] [--top <count>] [--repeat <count>] <file or directory>...
+//
+// Directories are not searched recursively. Decode and fixup times are the best of `--repeat` runs.
+
+#include <dirent.h>
+#include <imprint/linear_allocator.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <swamp-typeinfo-serialize/deserialize.h>
+#include <swamp-typeinfo-serialize/deserialize_internal.h>
+#include <swamp-typeinfo-serialize/format.h>
+#include <swamp-typeinfo-serialize/sections_internal.h>
+#include <swamp-typeinfo-serialize/serialize_internal.h>
+#include <swamp-typeinfo/chunk.h>
+#include <swamp-typeinfo/typeinfo.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/// Memory used for the deserialized chunk, per octet of serialized typeinfo.
+#define SWTIS_INSPECT_MEMORY_FACTOR (64)
+#define SWTIS_INSPECT_KIND_COUNT (SwtiTypeUnmanaged + 1)
+#define SWTIS_INSPECT_MAX_TOP_COUNT (64)
+// Generics and variants of a custom type are the most a type can refer to
+#define SWTIS_INSPECT_MAX_REF_COUNT (2 * 255 + 1)
+
+typedef struct InspectOptions {
+    int json;
+    size_t topCount;
+    size_t repeatCount;
+} InspectOptions;
+
+typedef struct KindStats {
+    size_t count;
+    size_t octetCount;
+} KindStats;
+
+typedef struct Ranked {
+    size_t typeIndex;
+    size_t value;
+} Ranked;
+
+typedef struct Report {
+    size_t octetCount;
+    uint8_t formatFlags;
+    size_t typeCount;
+    KindStats kinds[SWTIS_INSPECT_KIND_COUNT];
+    size_t nameOctetCount;
+    size_t structureOctetCount;
+    size_t overheadOctetCount;
+    size_t duplicateGroupCount;
+    size_t duplicateTypeCount;
+    size_t refCount;
+    size_t maxFanOut;
+    size_t maxFanOutTypeIndex;
+    Ranked largestRecords[SWTIS_INSPECT_MAX_TOP_COUNT];
+    size_t largestRecordCount;
+    Ranked largestCustoms[SWTIS_INSPECT_MAX_TOP_COUNT];
+    size_t largestCustomCount;
+    Ranked mostReferenced[SWTIS_INSPECT_MAX_TOP_COUNT];
+    size_t mostReferencedCount;
+    // Names to show for the ranked types, recorded while the chunk is still around
+    const char* largestRecordNames[SWTIS_INSPECT_MAX_TOP_COUNT];
+    const char* largestCustomNames[SWTIS_INSPECT_MAX_TOP_COUNT];
+    const char* mostReferencedNames[SWTIS_INSPECT_MAX_TOP_COUNT];
+    uint64_t decodeNanoseconds;
+    uint64_t fixupNanoseconds;
+} Report;
+
+static const char* kindName(size_t kind)
+{
+    switch (kind) {
+        case SwtiTypeInt:
+            return "Int";
+        case SwtiTypeFixed:
+            return "Fixed";
+        case SwtiTypeBoolean:
+            return "Bool";
+        case SwtiTypeString:
+            return "String";
+        case SwtiTypeChar:
+            return "Char";
+        case SwtiTypeBlob:
+            return "Blob";
+        case SwtiTypeResourceName:
+            return "ResourceName";
+        case SwtiTypeList:
+            return "List";
+        case SwtiTypeArray:
+            return "Array";
+        case SwtiTypeRecord:
+            return "Record";
+        case SwtiTypeTuple:
+            return "Tuple";
+        case SwtiTypeCustom:
+            return "Custom";
+        case SwtiTypeCustomVariant:
+            return "Variant";
+        case SwtiTypeFunction:
+            return "Function";
+        case SwtiTypeAlias:
+            return "Alias";
+        case SwtiTypeRefId:
+            return "RefId";
+        case SwtiTypeAny:
+            return "Any";
+        case SwtiTypeAnyMatchingTypes:
+            return "AnyMatchingTypes";
+        case SwtiTypeUnmanaged:
+            return "Unmanaged";
+        default:
+            return "Unknown";
+    }
+}
+
+static uint64_t nowNanoseconds(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t) now.tv_sec * 1000000000u + (uint64_t) now.tv_nsec;
+}
+
+static size_t collectRefs(const SwtiType* type, const SwtiType** refs)
+{
+    size_t count = 0;
+
+    switch (type->type) {
+        case SwtiTypeList:
+        case SwtiTypeArray:
+            refs[count++] = ((const SwtiListType*) type)->itemType;
+            break;
+        case SwtiTypeRecord: {
+            const SwtiRecordType* record = (const SwtiRecordType*) type;
+            for (size_t i = 0; i < record->fieldCount; ++i) {
+                refs[count++] = record->fields[i].fieldType;
+            }
+            break;
+        }
+        case SwtiTypeTuple: {
+            const SwtiTupleType* tuple = (const SwtiTupleType*) type;
+            for (size_t i = 0; i < tuple->fieldCount; ++i) {
+                refs[count++] = tuple->fields[i].fieldType;
+            }
+            break;
+        }
+        case SwtiTypeCustom: {
+            const SwtiCustomType* custom = (const SwtiCustomType*) type;
+            for (size_t i = 0; i < custom->generic.genericCount; ++i) {
+                // Generic parameters that could not be resolved are cleared by the deserializer
+                if (custom->generic.genericTypes[i] != 0) {
+                    refs[count++] = custom->generic.genericTypes[i];
+                }
+            }
+            for (size_t i = 0; i < custom->variantCount; ++i) {
+                refs[count++] = &custom->variantTypes[i]->internal;
+            }
+            break;
+        }
+        case SwtiTypeCustomVariant: {
+            const SwtiCustomTypeVariant* variant = (const SwtiCustomTypeVariant*) type;
+            for (size_t i = 0; i < variant->paramCount; ++i) {
+                refs[count++] = variant->fields[i].fieldType;
+            }
+            break;
+        }
+        case SwtiTypeFunction: {
+            const SwtiFunctionType* fn = (const SwtiFunctionType*) type;
+            for (size_t i = 0; i < fn->parameterCount; ++i) {
+                refs[count++] = fn->parameterTypes[i];
+            }
+            break;
+        }
+        case SwtiTypeAlias:
+            refs[count++] = ((const SwtiAliasType*) type)->targetType;
+            break;
+        case SwtiTypeRefId:
+            refs[count++] = ((const SwtiTypeRefIdType*) type)->referencedType;
+            break;
+        default:
+            break;
+    }
+
+    return count;
+}
+
+typedef struct Encoding {
+    uint32_t* values;
+    size_t count;
+    size_t capacity;
+} Encoding;
+
+static void encodingAdd(Encoding* encoding, uint32_t value)
+{
+    if (encoding->count == encoding->capacity) {
+        encoding->capacity = encoding->capacity == 0 ? 1024 : encoding->capacity * 2;
+        encoding->values = realloc(encoding->values, encoding->capacity * sizeof(uint32_t));
+    }
+    encoding->values[encoding->count++] = value;
+}
+
+static void encodingAddMemoryInfo(Encoding* encoding, const SwtiMemoryInfo* info)
+{
+    encodingAdd(encoding, ((uint32_t) info->memorySize << 8) | info->memoryAlign);
+}
+
+/// Everything about the type except its names, so types that only differ in names encode the same.
+static void encodeStructure(Encoding* encoding, const SwtiType* type)
+{
+    const SwtiType* refs[SWTIS_INSPECT_MAX_REF_COUNT];
+    size_t refCount = collectRefs(type, refs);
+
+    encodingAdd(encoding, type->type);
+    encodingAdd(encoding, (uint32_t) refCount);
+    for (size_t i = 0; i < refCount; ++i) {
+        encodingAdd(encoding, refs[i]->index);
+    }
+
+    switch (type->type) {
+        case SwtiTypeList:
+        case SwtiTypeArray:
+            encodingAddMemoryInfo(encoding, &((const SwtiListType*) type)->memoryInfo);
+            break;
+        case SwtiTypeRecord: {
+            const SwtiRecordType* record = (const SwtiRecordType*) type;
+            encodingAddMemoryInfo(encoding, &record->memoryInfo);
+            for (size_t i = 0; i < record->fieldCount; ++i) {
+                encodingAdd(encoding, record->fields[i].memoryOffsetInfo.memoryOffset);
+            }
+            break;
+        }
+        case SwtiTypeTuple: {
+            const SwtiTupleType* tuple = (const SwtiTupleType*) type;
+            encodingAddMemoryInfo(encoding, &tuple->memoryInfo);
+            for (size_t i = 0; i < tuple->fieldCount; ++i) {
+                encodingAdd(encoding, tuple->fields[i].memoryOffsetInfo.memoryOffset);
+            }
+            break;
+        }
+        case SwtiTypeCustom: {
+            const SwtiCustomType* custom = (const SwtiCustomType*) type;
+            encodingAddMemoryInfo(encoding, &custom->memoryInfo);
+            encodingAdd(encoding, (uint32_t) custom->generic.genericCount);
+            break;
+        }
+        case SwtiTypeCustomVariant: {
+            const SwtiCustomTypeVariant* variant = (const SwtiCustomTypeVariant*) type;
+            encodingAddMemoryInfo(encoding, &variant->memoryInfo);
+            encodingAdd(encoding, variant->inCustomType != 0 ? variant->inCustomType->internal.index : 0xffffffffu);
+            for (size_t i = 0; i < variant->paramCount; ++i) {
+                encodingAdd(encoding, variant->fields[i].memoryOffsetInfo.memoryOffset);
+            }
+            break;
+        }
+        case SwtiTypeUnmanaged:
+            encodingAdd(encoding, ((const SwtiUnmanagedType*) type)->userTypeId);
+            break;
+        default:
+            break;
+    }
+}
+
+typedef struct EncodedType {
+    uint64_t hash;
+    size_t start;
+    size_t count;
+} EncodedType;
+
+static const Encoding* g_sortEncoding;
+
+static int compareEncodedTypes(const void* a, const void* b)
+{
+    const EncodedType* x = (const EncodedType*) a;
+    const EncodedType* y = (const EncodedType*) b;
+    if (x->hash != y->hash) {
+        return x->hash < y->hash ? -1 : 1;
+    }
+    if (x->count != y->count) {
+        return x->count < y->count ? -1 : 1;
+    }
+
+    return memcmp(g_sortEncoding->values + x->start, g_sortEncoding->values + y->start, x->count * sizeof(uint32_t));
+}
+
+static void findDuplicates(const SwtiChunk* chunk, Report* report)
+{
+    Encoding encoding = {0, 0, 0};
+    EncodedType* encoded = malloc((chunk->typeCount + 1) * sizeof(EncodedType));
+
+    for (size_t i = 0; i < chunk->typeCount; ++i) {
+        size_t start = encoding.count;
+        encodeStructure(&encoding, chunk->types[i]);
+
+        uint64_t hash = 0xcbf29ce484222325u;
+        for (size_t j = start; j < encoding.count; ++j) {
+            hash ^= encoding.values[j];
+            hash *= 0x100000001b3u;
+        }
+        encoded[i].hash = hash;
+        encoded[i].start = start;
+        encoded[i].count = encoding.count - start;
+    }
+
+    g_sortEncoding = &encoding;
+    qsort(encoded, chunk->typeCount, sizeof(EncodedType), compareEncodedTypes);
+
+    for (size_t i = 1; i < chunk->typeCount; ++i) {
+        if (compareEncodedTypes(&encoded[i - 1], &encoded[i]) == 0) {
+            report->duplicateTypeCount++;
+            if (i == 1 || compareEncodedTypes(&encoded[i - 2], &encoded[i - 1]) != 0) {
+                report->duplicateGroupCount++;
+            }
+        }
+    }
+
+    free(encoded);
+    free(encoding.values);
+}
+
+/// Keeps the `topCount` largest values, largest first.
+static void rank(Ranked* ranked, size_t* count, size_t topCount, size_t typeIndex, size_t value)
+{
+    size_t pos = *count;
+    if (pos == topCount) {
+        if (topCount == 0 || ranked[topCount - 1].value >= value) {
+            return;
+        }
+        pos--;
+    } else {
+        (*count)++;
+    }
+
+    while (pos > 0 && ranked[pos - 1].value < value) {
+        ranked[pos] = ranked[pos - 1];
+        pos--;
+    }
+    ranked[pos].typeIndex = typeIndex;
+    ranked[pos].value = value;
+}
+
+/// Records have no name of their own, so use the name of an alias to them if there is one.
+static const char* displayName(const SwtiChunk* chunk, const char** aliasNames, size_t typeIndex)
+{
+    const SwtiType* type = chunk->types[typeIndex];
+    switch (type->type) {
+        case SwtiTypeRecord:
+            return aliasNames[typeIndex] != 0 ? aliasNames[typeIndex] : "";
+        case SwtiTypeCustomVariant:
+            return ((const SwtiCustomTypeVariant*) type)->name;
+        default:
+            return type->name != 0 ? type->name : "";
+    }
+}
+
+static size_t inlineNameOctetCount(const SwtiType* type)
+{
+    size_t octetCount = 0;
+    size_t nameCount = swtisSectionNameCount(type);
+    for (size_t i = 0; i < nameCount; ++i) {
+        const char* name = *swtisSectionNameAt((SwtiType*) type, i);
+        // Same truncation as the serializer
+        octetCount += 1 + (uint8_t) (name != 0 ? strlen(name) : 0);
+    }
+
+    return octetCount;
+}
+
+static void analyze(const SwtiChunk* chunk, const uint8_t* octets, size_t octetCount, size_t topCount, Report* report)
+{
+    size_t typeOctetCount = 0;
+    size_t* fanIn = calloc(chunk->typeCount + 1, sizeof(size_t));
+    const char** aliasNames = calloc(chunk->typeCount + 1, sizeof(const char*));
+    const SwtiType* refs[SWTIS_INSPECT_MAX_REF_COUNT];
+
+    for (size_t i = 0; i < chunk->typeCount; ++i) {
+        const SwtiType* type = chunk->types[i];
+        size_t typeOctets = swtisSerializeTypeOctetCount(report->formatFlags, type);
+        typeOctetCount += typeOctets;
+        if ((size_t) type->type < SWTIS_INSPECT_KIND_COUNT) {
+            report->kinds[type->type].count++;
+            report->kinds[type->type].octetCount += typeOctets;
+        }
+
+        if (!(report->formatFlags & SWTIS_FORMAT_FLAG_SECTIONED)) {
+            report->nameOctetCount += inlineNameOctetCount(type);
+        }
+
+        size_t refCount = collectRefs(type, refs);
+        report->refCount += refCount;
+        if (refCount > report->maxFanOut) {
+            report->maxFanOut = refCount;
+            report->maxFanOutTypeIndex = i;
+        }
+        for (size_t j = 0; j < refCount; ++j) {
+            fanIn[refs[j]->index]++;
+        }
+
+        if (type->type == SwtiTypeAlias) {
+            const SwtiType* target = ((const SwtiAliasType*) type)->targetType;
+            if (aliasNames[target->index] == 0) {
+                aliasNames[target->index] = type->name;
+            }
+        }
+    }
+
+    size_t namesSectionOctetCount = 0;
+    if (report->formatFlags & SWTIS_FORMAT_FLAG_SECTIONED) {
+        SwtisSectionDirectory directory;
+        if (swtisSectionDirectoryRead(&directory, octets, octetCount) == 0) {
+            const SwtisSection* names = swtisSectionDirectoryFind(&directory, SWTIS_SECTION_NAMES);
+            namesSectionOctetCount = names != 0 ? names->octetCount : 0;
+        }
+        report->nameOctetCount = namesSectionOctetCount;
+    }
+
+    size_t accounted = typeOctetCount + namesSectionOctetCount;
+    report->structureOctetCount = typeOctetCount + namesSectionOctetCount - report->nameOctetCount;
+    report->overheadOctetCount = octetCount > accounted ? octetCount - accounted : 0;
+
+    for (size_t i = 0; i < chunk->typeCount; ++i) {
+        const SwtiType* type = chunk->types[i];
+        rank(report->mostReferenced, &report->mostReferencedCount, topCount, i, fanIn[i]);
+
+        if (type->type == SwtiTypeRecord) {
+            rank(report->largestRecords, &report->largestRecordCount, topCount, i,
+                 swtisSerializeTypeOctetCount(report->formatFlags, type));
+        } else if (type->type == SwtiTypeCustom) {
+            // Including its variants
+            const SwtiCustomType* custom = (const SwtiCustomType*) type;
+            size_t customOctets = swtisSerializeTypeOctetCount(report->formatFlags, type);
+            for (size_t j = 0; j < custom->variantCount; ++j) {
+                customOctets += swtisSerializeTypeOctetCount(report->formatFlags, &custom->variantTypes[j]->internal);
+            }
+            rank(report->largestCustoms, &report->largestCustomCount, topCount, i, customOctets);
+        }
+    }
+
+    for (size_t i = 0; i < report->largestRecordCount; ++i) {
+        report->largestRecordNames[i] = displayName(chunk, aliasNames, report->largestRecords[i].typeIndex);
+    }
+    for (size_t i = 0; i < report->largestCustomCount; ++i) {
+        report->largestCustomNames[i] = displayName(chunk, aliasNames, report->largestCustoms[i].typeIndex);
+    }
+    for (size_t i = 0; i < report->mostReferencedCount; ++i) {
+        report->mostReferencedNames[i] = displayName(chunk, aliasNames, report->mostReferenced[i].typeIndex);
+    }
+
+    findDuplicates(chunk, report);
+
+    free(aliasNames);
+    free(fanIn);
+}
+
+/// Decodes `repeatCount` times and keeps the fastest decode and fixup. The chunk from the last run is left in
+/// `memory` for the analysis.
+static int decode(const uint8_t* octets, size_t octetCount, uint8_t* memory, size_t memorySize, size_t repeatCount,
+                  SwtiChunk* chunk, Report* report)
+{
+    report->decodeNanoseconds = UINT64_MAX;
+    report->fixupNanoseconds = UINT64_MAX;
+
+    for (size_t run = 0; run < repeatCount; ++run) {
+        ImprintLinearAllocator allocator;
+        imprintLinearAllocatorInit(&allocator, memory, memorySize, "swtisInspect");
+
+        SwtisDeserializeProgress progress;
+        uint64_t start = nowNanoseconds();
+        swtisDeserializeProgressInit(&progress, chunk, &allocator.info, 0);
+        int result = swtisDeserializeProgressFeed(&progress, octets, octetCount);
+        uint64_t decoded = nowNanoseconds();
+        if (result != 1) {
+            return result < 0 ? result : -1;
+        }
+        result = swtisDeserializeProgressFinish(&progress);
+        uint64_t fixedUp = nowNanoseconds();
+        if (result < 0) {
+            return result;
+        }
+
+        if (decoded - start < report->decodeNanoseconds) {
+            report->decodeNanoseconds = decoded - start;
+        }
+        if (fixedUp - decoded < report->fixupNanoseconds) {
+            report->fixupNanoseconds = fixedUp - decoded;
+        }
+    }
+
+    return 0;
+}
+
+static int readFile(const char* path, uint8_t** outOctets, size_t* outOctetCount)
+{
+    FILE* f = fopen(path, "rb");
+    if (f == 0) {
+        fprintf(stderr, "swtis-inspect: can not open '%s'\n", path);
+        return -1;
+    }
+
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    if (size <= 0) {
+        fprintf(stderr, "swtis-inspect: '%s' is empty\n", path);
+        fclose(f);
+        return -1;
+    }
+
+    uint8_t* octets = malloc((size_t) size);
+    size_t octetsRead = fread(octets, 1, (size_t) size, f);
+    fclose(f);
+    if (octetsRead != (size_t) size) {
+        fprintf(stderr, "swtis-inspect: could not read '%s'\n", path);
+        free(octets);
+        return -1;
+    }
+
+    *outOctets = octets;
+    *outOctetCount = (size_t) size;
+
+    return 0;
+}
+
+static void writeJsonString(const char* s)
+{
+    putchar('"');
+    for (const unsigned char* p = (const unsigned char*) s; *p != 0; ++p) {
+        if (*p == '"' || *p == '\\') {
+            printf("\\%c", *p);
+        } else if (*p < 0x20) {
+            printf("\\u%04x", *p);
+        } else {
+            putchar(*p);
+        }
+    }
+    putchar('"');
+}
+
+static void writeJsonRanked(const char* key, const Ranked* ranked, const char* const* names, size_t count,
+                            const char* valueKey)
+{
+    printf(", \"%s\": [", key);
+    for (size_t i = 0; i < count; ++i) {
+        printf("%s{\"index\": %zu, \"name\": ", i == 0 ? "" : ", ", ranked[i].typeIndex);
+        writeJsonString(names[i]);
+        printf(", \"%s\": %zu}", valueKey, ranked[i].value);
+    }
+    printf("]");
+}
+
+static void writeJsonKinds(const KindStats* kinds)
+{
+    printf("\"kinds\": {");
+    int isFirst = 1;
+    for (size_t kind = 0; kind < SWTIS_INSPECT_KIND_COUNT; ++kind) {
+        if (kinds[kind].count == 0) {
+            continue;
+        }
+        printf("%s\"%s\": {\"count\": %zu, \"octets\": %zu}", isFirst ? "" : ", ", kindName(kind), kinds[kind].count,
+               kinds[kind].octetCount);
+        isFirst = 0;
+    }
+    printf("}");
+}
+
+static void writeJsonReport(const char* path, const Report* report)
+{
+    printf("{\"path\": ");
+    writeJsonString(path);
+    printf(", \"octets\": %zu, \"formatFlags\": %u, \"typeCount\": %zu, ", report->octetCount, report->formatFlags,
+           report->typeCount);
+    writeJsonKinds(report->kinds);
+    printf(", \"nameOctets\": %zu, \"structureOctets\": %zu, \"overheadOctets\": %zu", report->nameOctetCount,
+           report->structureOctetCount, report->overheadOctetCount);
+    printf(", \"duplicateStructures\": {\"groups\": %zu, \"types\": %zu}", report->duplicateGroupCount,
+           report->duplicateTypeCount);
+    printf(", \"refs\": {\"count\": %zu, \"maxFanOut\": %zu, \"maxFanOutIndex\": %zu}", report->refCount,
+           report->maxFanOut, report->maxFanOutTypeIndex);
+    writeJsonRanked("largestRecords", report->largestRecords, report->largestRecordNames, report->largestRecordCount,
+                    "octets");
+    writeJsonRanked("largestCustomTypes", report->largestCustoms, report->largestCustomNames,
+                    report->largestCustomCount, "octets");
+    writeJsonRanked("mostReferenced", report->mostReferenced, report->mostReferencedNames,
+                    report->mostReferencedCount, "refs");
+    printf(", \"decodeNanoseconds\": %llu, \"fixupNanoseconds\": %llu}", (unsigned long long) report->decodeNanoseconds,
+           (unsigned long long) report->fixupNanoseconds);
+}
+
+static void writeTextRanked(const char* title, const Ranked* ranked, const char* const* names, size_t count,
+                            const char* unit)
+{
+    if (count == 0) {
+        return;
+    }
+
+    printf("  %s:\n", title);
+    for (size_t i = 0; i < count; ++i) {
+        printf("    #%-6zu %-32s %zu %s\n", ranked[i].typeIndex, names[i], ranked[i].value, unit);
+    }
+}
+
+static void writeTextReport(const char* path, const Report* report)
+{
+    printf("%s: %zu octets, %zu types, format flags 0x%02x\n", path, report->octetCount, report->typeCount,
+           report->formatFlags);
+    printf("  decode %.1f us, fixup %.1f us\n", report->decodeNanoseconds / 1000.0, report->fixupNanoseconds / 1000.0);
+    printf("  %-18s %8s %10s\n", "kind", "count", "octets");
+    for (size_t kind = 0; kind < SWTIS_INSPECT_KIND_COUNT; ++kind) {
+        if (report->kinds[kind].count != 0) {
+            printf("  %-18s %8zu %10zu\n", kindName(kind), report->kinds[kind].count, report->kinds[kind].octetCount);
+        }
+    }
+    printf("  names %zu octets, structure %zu octets, header and footer %zu octets\n", report->nameOctetCount,
+           report->structureOctetCount, report->overheadOctetCount);
+    printf("  duplicate structures: %zu types in %zu groups\n", report->duplicateTypeCount,
+           report->duplicateGroupCount);
+    printf("  refs: %zu, %.2f per type, max fan-out %zu (#%zu)\n", report->refCount,
+           report->typeCount != 0 ? (double) report->refCount / report->typeCount : 0.0, report->maxFanOut,
+           report->maxFanOutTypeIndex);
+    writeTextRanked("largest records", report->largestRecords, report->largestRecordNames, report->largestRecordCount,
+                    "octets");
+    writeTextRanked("largest custom types (with variants)", report->largestCustoms, report->largestCustomNames,
+                    report->largestCustomCount, "octets");
+    writeTextRanked("most referenced", report->mostReferenced, report->mostReferencedNames,
+                    report->mostReferencedCount, "refs");
+}
+
+static void addToTotal(Report* total, const Report* report)
+{
+    total->octetCount += report->octetCount;
+    total->typeCount += report->typeCount;
+    for (size_t kind = 0; kind < SWTIS_INSPECT_KIND_COUNT; ++kind) {
+        total->kinds[kind].count += report->kinds[kind].count;
+        total->kinds[kind].octetCount += report->kinds[kind].octetCount;
+    }
+    total->nameOctetCount += report->nameOctetCount;
+    total->structureOctetCount += report->structureOctetCount;
+    total->overheadOctetCount += report->overheadOctetCount;
+    total->duplicateTypeCount += report->duplicateTypeCount;
+    total->refCount += report->refCount;
+    total->decodeNanoseconds += report->decodeNanoseconds;
+    total->fixupNanoseconds += report->fixupNanoseconds;
+}
+
+static int inspectFile(const char* path, const InspectOptions* options, Report* total, size_t* reportCount)
+{
+    uint8_t* octets;
+    size_t octetCount;
+    if (readFile(path, &octets, &octetCount) != 0) {
+        return -1;
+    }
+
+    Report* report = calloc(1, sizeof(Report));
+    report->octetCount = octetCount;
+    report->formatFlags = octetCount > 3 ? octets[3] : 0;
+
+    size_t memorySize = octetCount * SWTIS_INSPECT_MEMORY_FACTOR;
+    uint8_t* memory = malloc(memorySize);
+    SwtiChunk chunk;
+    int result = decode(octets, octetCount, memory, memorySize, options->repeatCount, &chunk, report);
+    if (result < 0) {
+        fprintf(stderr, "swtis-inspect: could not deserialize '%s' (%d)\n", path, result);
+    } else {
+        report->typeCount = chunk.typeCount;
+        analyze(&chunk, octets, octetCount, options->topCount, report);
+
+        if (options->json) {
+            printf("%s\n    ", *reportCount == 0 ? "" : ",");
+            writeJsonReport(path, report);
+        } else {
+            writeTextReport(path, report);
+            printf("\n");
+        }
+        addToTotal(total, report);
+        (*reportCount)++;
+    }
+
+    free(memory);
+    free(report);
+    free(octets);
+
+    return result < 0 ? -1 : 0;
+}
+
+static int inspectPath(const char* path, const InspectOptions* options, Report* total, size_t* reportCount)
+{
+    struct stat info;
+    if (stat(path, &info) != 0) {
+        fprintf(stderr, "swtis-inspect: can not find '%s'\n", path);
+        return -1;
+    }
+
+    if (!S_ISDIR(info.st_mode)) {
+        return inspectFile(path, options, total, reportCount);
+    }
+
+    struct dirent** entries;
+    int entryCount = scandir(path, &entries, 0, alphasort);
+    if (entryCount < 0) {
+        fprintf(stderr, "swtis-inspect: can not read directory '%s'\n", path);
+        return -1;
+    }
+
+    int result = 0;
+    for (int i = 0; i < entryCount; ++i) {
+        size_t length = strlen(path) + 1 + strlen(entries[i]->d_name) + 1;
+        char* filePath = malloc(length);
+        snprintf(filePath, length, "%s/%s", path, entries[i]->d_name);
+        struct stat fileInfo;
+        if (stat(filePath, &fileInfo) == 0 && S_ISREG(fileInfo.st_mode)) {
+            if (inspectFile(filePath, options, total, reportCount) != 0) {
+                result = -1;
+            }
+        }
+        free(filePath);
+        free(entries[i]);
+    }
+    free(entries);
+
+    return result;
+}
+
+static int parseCount(const char* s, size_t* outCount)
+{
+    char* end;
+    unsigned long value = strtoul(s, &end, 10);
+    if (*s == 0 || *end != 0) {
+        return -1;
+    }
+    *outCount = (size_t) value;
+
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    InspectOptions options;
+    options.json = 0;
+    options.topCount = 10;
+    options.repeatCount = 1;
+
+    int firstPath = 1;
+    for (; firstPath < argc && argv[firstPath][0] == '-'; ++firstPath) {
+        const char* arg = argv[firstPath];
+        if (strcmp(arg, "--json") == 0) {
+            options.json = 1;
+        } else if (strcmp(arg, "--top") == 0 && firstPath + 1 < argc &&
+                   parseCount(argv[firstPath + 1], &options.topCount) == 0 &&
+                   options.topCount <= SWTIS_INSPECT_MAX_TOP_COUNT) {
+            firstPath++;
+        } else if (strcmp(arg, "--repeat") == 0 && firstPath + 1 < argc &&
+                   parseCount(argv[firstPath + 1], &options.repeatCount) == 0 && options.repeatCount > 0) {
+            firstPath++;
+        } else {
+            firstPath = argc;
+            break;
+        }
+    }
+
+    if (firstPath >= argc) {
+        fprintf(stderr, "usage: swtis-inspect [--json] [--top <count, at most %d>] [--repeat <count>] <file or "
+                        "directory>...\n",
+                SWTIS_INSPECT_MAX_TOP_COUNT);
+        return 1;
+    }
+
+    Report* total = calloc(1, sizeof(Report));
+    size_t reportCount = 0;
+    int result = 0;
+
+    if (options.json) {
+        printf("{\"files\": [");
+    }
+
+    for (int i = firstPath; i < argc; ++i) {
+        if (inspectPath(argv[i], &options, total, &reportCount) != 0) {
+            result = 1;
+        }
+    }
+
+    if (options.json) {
+        printf("\n], \"total\": {\"fileCount\": %zu, \"octets\": %zu, \"typeCount\": %zu, ", reportCount,
+               total->octetCount, total->typeCount);
+        writeJsonKinds(total->kinds);
+        printf(", \"nameOctets\": %zu, \"structureOctets\": %zu, \"overheadOctets\": %zu, \"duplicateTypes\": %zu, "
+               "\"refs\": %zu, \"decodeNanoseconds\": %llu, \"fixupNanoseconds\": %llu}}\n",
+               total->nameOctetCount, total->structureOctetCount, total->overheadOctetCount, total->duplicateTypeCount,
+               total->refCount, (unsigned long long) total->decodeNanoseconds,
+               (unsigned long long) total->fixupNanoseconds);
+    } else if (reportCount > 1) {
+        printf("total: %zu files, %zu octets, %zu types, names %zu octets, structure %zu octets, decode %.1f us, "
+               "fixup %.1f us\n",
+               reportCount, total->octetCount, total->typeCount, total->nameOctetCount, total->structureOctetCount,
+               total->decodeNanoseconds / 1000.0, total->fixupNanoseconds / 1000.0);
+    }
+
+    free(total);
+
+    return result;
+}